@@ -0,0 +1,495 @@
+// Microbenchmarks for the MI++ hot paths, run against the in-memory MI stub.
+//
+// Usage: mi_bench [filter] [instance count] [duration ms]
+// Only the benchmarks whose name contains "filter" are run, each one for at
+// least "duration" milliseconds. A short duration makes a quick smoke test.
+
+#include <windows.h>
+#include <MI++.h>
+#include <MIClassSchemaCache.h>
+#include <MIColumnReader.h>
+#include <MIExceptions.h>
+#include <MIFanOutQuery.h>
+#include <MIJsonSerializer.h>
+#include <MIPrefetcher.h>
+#include <MISessionPool.h>
+#include <MIWriteBatch.h>
+#include <MIStub.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+
+#define BENCH_NAMESPACE L"root/bench"
+#define BENCH_CLASS L"Bench_Item"
+
+static void DefineBenchClasses()
+{
+    MIStub::ClassDefinition item = { BENCH_NAMESPACE, BENCH_CLASS, L"", {
+        { L"Id", MI_UINT32, MI_FLAG_KEY },
+        { L"Name", MI_STRING, MI_FLAG_KEY },
+        { L"Description", MI_STRING, 0 },
+        { L"Enabled", MI_BOOLEAN, 0 },
+        { L"Size", MI_UINT64, 0 },
+        { L"Ratio", MI_REAL64, 0 },
+        { L"Tags", MI_STRINGA, 0 },
+        { L"Data", MI_UINT8A, 0 },
+    }, {
+        { L"Resize", MI_UINT32, 0, {
+            { L"NewSize", MI_UINT64, MI_FLAG_IN },
+            { L"Force", MI_BOOLEAN, MI_FLAG_IN },
+            { L"Timeout", MI_UINT32, MI_FLAG_IN },
+            { L"PreviousSize", MI_UINT64, MI_FLAG_OUT },
+        } },
+    } };
+    // Padding, to get a class as wide as the common CIM classes
+    for (unsigned i = 0; i < 32; i++)
+    {
+        item.m_properties.push_back({ L"Property" + std::to_wstring(i), MI_UINT32, 0 });
+    }
+    MIStub::DefineClass(item);
+
+    MIStub::ClassDefinition error = { BENCH_NAMESPACE, L"Bench_Error", L"MSFT_WmiError", {
+        { L"Detail", MI_STRING, 0 },
+    } };
+    MIStub::DefineClass(error);
+}
+
+static void AddBenchInstances(MI::Application& app, unsigned count, const std::wstring& host = L"localhost")
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        auto instance = app.NewInstance(BENCH_CLASS);
+        instance->AddElement(L"Id", *MI::MIValue::FromUint32(i));
+        instance->AddElement(L"Name", *MI::MIValue::FromString(L"item" + std::to_wstring(i)));
+        instance->AddElement(L"Description", *MI::MIValue::FromString(L"Synthetic benchmark item"));
+        instance->AddElement(L"Enabled", *MI::MIValue::FromBoolean(i % 2 ? MI_TRUE : MI_FALSE));
+        instance->AddElement(L"Size", *MI::MIValue::FromUint64((MI_Uint64)i * 4096));
+        instance->AddElement(L"Ratio", *MI::MIValue::FromReal64(i / 3.0));
+
+        auto tags = MI::MIValue::CreateArray(3, MI_STRINGA);
+        const wchar_t* tagValues[] = { L"alpha", L"beta", L"gamma" };
+        for (unsigned j = 0; j < 3; j++)
+        {
+            tags->SetArrayItem(*MI::MIValue::FromString(tagValues[j]), j);
+        }
+        instance->AddElement(L"Tags", *tags);
+
+        auto data = MI::MIValue::CreateArray(16, MI_UINT8A);
+        for (unsigned j = 0; j < 16; j++)
+        {
+            data->SetArrayItem(*MI::MIValue::FromUint8((MI_Uint8)(i + j)), j);
+        }
+        instance->AddElement(L"Data", *data);
+
+        MIStub::AddInstance(host, BENCH_NAMESPACE, instance->GetMIObject());
+    }
+}
+
+static std::chrono::milliseconds g_minDuration(500);
+
+// Runs "op" until at least "g_minDuration" elapsed, "op" returns the number of
+// items it processed.
+static void Run(const char* name, const std::function<size_t()>& op)
+{
+    size_t items = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::duration::zero();
+    do
+    {
+        items += op();
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < g_minDuration);
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    std::printf("%-40s %12.0f ops/s %10.1f ns/op\n", name, items / seconds, seconds * 1e9 / items);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string filter = argc > 1 ? argv[1] : "";
+    unsigned count = argc > 2 ? (unsigned)std::strtoul(argv[2], nullptr, 10) : 1000;
+    if (argc > 3)
+    {
+        g_minDuration = std::chrono::milliseconds(std::strtoul(argv[3], nullptr, 10));
+    }
+    auto enabled = [&](const char* name) { return std::string(name).find(filter) != std::string::npos; };
+
+    try
+    {
+        MIStub::Reset();
+        DefineBenchClasses();
+
+        MI::Application app(L"mi_bench");
+        AddBenchInstances(app, count);
+        auto session = app.NewSession();
+        const std::wstring query = L"SELECT * FROM " BENCH_CLASS;
+
+        if (enabled("Operation::GetNextInstance"))
+        {
+            Run("Operation::GetNextInstance", [&]() {
+                size_t n = 0;
+                auto operation = session->ExecQuery(BENCH_NAMESPACE, query);
+                while (operation->GetNextInstance())
+                {
+                    n++;
+                }
+                return n;
+            });
+        }
+
+        if (enabled("ColumnReader::ReadOperation"))
+        {
+            MI::ColumnReader columnReader({ L"Id", L"Name", L"Size", L"Ratio", L"Enabled" });
+            Run("ColumnReader::ReadOperation", [&]() {
+                auto operation = session->ExecQuery(BENCH_NAMESPACE, query);
+                auto n = columnReader.ReadOperation(*operation);
+                columnReader.TakeColumns();
+                return n;
+            });
+        }
+
+        auto instance = session->ExecQuery(BENCH_NAMESPACE, query)->GetNextInstance()->Clone();
+
+        if (enabled("Instance::operator[](name)"))
+        {
+            const std::wstring names[] = { L"Id", L"Name", L"Description", L"Enabled", L"Size", L"Ratio",
+                L"Property7", L"Property15", L"Property23", L"Property31" };
+            Run("Instance::operator[](name)", [&]() {
+                for (auto const& name : names)
+                {
+                    (*instance)[name];
+                }
+                return sizeof(names) / sizeof(names[0]);
+            });
+        }
+
+        if (enabled("Instance::operator[](index)"))
+        {
+            Run("Instance::operator[](index)", [&]() {
+                unsigned n = instance->GetElementsCount();
+                for (unsigned i = 0; i < n; i++)
+                {
+                    (*instance)[i];
+                }
+                return (size_t)n;
+            });
+        }
+
+        if (enabled("Instance::GetAllElements"))
+        {
+            std::vector<MI::ValueElementRef> elements;
+            Run("Instance::GetAllElements", [&]() {
+                instance->GetAllElements(elements);
+                return elements.size();
+            });
+        }
+
+        if (enabled("Instance::GetPath"))
+        {
+            Run("Instance::GetPath", [&]() {
+                // GetPath caches the key names per instance, measure a fresh wrapper each time
+                MI::Instance wrapper(instance->GetMIObject(), false);
+                wrapper.GetPath();
+                return (size_t)1;
+            });
+        }
+
+        auto classOperation = session->GetClass(BENCH_NAMESPACE, BENCH_CLASS);
+        auto miClass = classOperation->GetNextClass();
+
+        if (enabled("Class::GetKey"))
+        {
+            Run("Class::GetKey", [&]() {
+                // GetKey caches the key per class, measure a fresh class each time
+                auto clone = miClass->Clone();
+                clone->GetKey();
+                return (size_t)1;
+            });
+        }
+
+        if (enabled("Class::operator[](name)"))
+        {
+            Run("Class::operator[](name)", [&]() {
+                (*miClass)[L"Description"];
+                return (size_t)1;
+            });
+        }
+
+        if (enabled("Application::NewMethodParamsInstance"))
+        {
+            Run("Application::NewMethodParamsInstance", [&]() {
+                app.NewMethodParamsInstance(*miClass, L"Resize");
+                return (size_t)1;
+            });
+        }
+
+        // Error path, as hit by code probing for optional methods or instances
+        auto invokeMissingMethod = [&]() {
+            try
+            {
+                session->InvokeMethod(BENCH_NAMESPACE, BENCH_CLASS, L"Missing", nullptr)->GetNextInstance();
+            }
+            catch (MI::MIException&)
+            {
+            }
+            return (size_t)1;
+        };
+
+        if (enabled("Session::InvokeMethod(not found)"))
+        {
+            Run("Session::InvokeMethod(not found)", invokeMissingMethod);
+        }
+
+        if (enabled("Session::InvokeMethod(not found, subclass)"))
+        {
+            // The extended error is an instance of a subclass of MSFT_WmiError
+            MIStub::SetErrorClass(L"Bench_Error");
+            Run("Session::InvokeMethod(not found, subclass)", invokeMissingMethod);
+            MIStub::SetErrorClass(L"MSFT_WmiError");
+        }
+
+        if (enabled("FanOutQuery"))
+        {
+            // 64 hosts answering in 10 ms each, queried 16 at a time
+            std::vector<std::wstring> hosts;
+            for (unsigned i = 0; i < 64; i++)
+            {
+                hosts.push_back(L"host" + std::to_wstring(i));
+                AddBenchInstances(app, 10, hosts.back());
+                MIStub::SetHostLatency(hosts.back(), std::chrono::milliseconds(10));
+            }
+            auto sharedApp = std::shared_ptr<MI::Application>(&app, [](MI::Application*) {});
+            Run("FanOutQuery", [&]() {
+                size_t n = 0;
+                MI::FanOutQuery fanOutQuery(sharedApp, hosts, BENCH_NAMESPACE, query);
+                MI::FanOutResult result;
+                while (fanOutQuery.GetNextResult(result))
+                {
+                    n += result.m_instance ? 1 : 0;
+                }
+                return n;
+            });
+        }
+
+        if (enabled("SessionPool"))
+        {
+            // Opening a session costs 5 ms, as a DCOM activation or WinRM authentication
+            MIStub::SetHostConnectLatency(L"pooledhost", std::chrono::milliseconds(5));
+            AddBenchInstances(app, 1, L"pooledhost");
+            auto sharedApp = std::shared_ptr<MI::Application>(&app, [](MI::Application*) {});
+            MI::SessionPool sessionPool(sharedApp);
+
+            Run("SessionPool(unpooled)", [&]() {
+                auto newSession = app.NewSession(L"", L"pooledhost");
+                newSession->TestConnection();
+                return (size_t)1;
+            });
+            Run("SessionPool::GetSession", [&]() {
+                auto pooledSession = sessionPool.GetSession(L"", L"pooledhost");
+                pooledSession->TestConnection();
+                return (size_t)1;
+            });
+        }
+
+        if (enabled("WriteBatch"))
+        {
+            // 64 creates and deletes against a host answering in 2 ms, one at a time and 16 at a time
+            MIStub::SetHostLatency(L"writehost", std::chrono::milliseconds(2));
+            auto writeSession = std::shared_ptr<MI::Session>(app.NewSession(L"", L"writehost"));
+            std::vector<std::shared_ptr<MI::Instance>> writeInstances;
+            for (unsigned i = 0; i < 64; i++)
+            {
+                auto writeInstance = app.NewInstance(BENCH_CLASS);
+                writeInstance->AddElement(L"Id", *MI::MIValue::FromUint32(i));
+                writeInstance->AddElement(L"Name", *MI::MIValue::FromString(L"written" + std::to_wstring(i)));
+                writeInstances.push_back(writeInstance);
+            }
+
+            Run("WriteBatch(serial)", [&]() {
+                for (auto& writeInstance : writeInstances)
+                {
+                    writeSession->CreateInstance(BENCH_NAMESPACE, *writeInstance);
+                }
+                for (auto& writeInstance : writeInstances)
+                {
+                    writeSession->DeleteInstance(BENCH_NAMESPACE, *writeInstance);
+                }
+                return writeInstances.size() * 2;
+            });
+            Run("WriteBatch::Execute", [&]() {
+                for (auto operation : { MI::WRITE_BATCH_CREATE, MI::WRITE_BATCH_DELETE })
+                {
+                    MI::WriteBatch writeBatch(writeSession, BENCH_NAMESPACE);
+                    for (auto& writeInstance : writeInstances)
+                    {
+                        writeBatch.Add(operation, writeInstance);
+                    }
+                    for (auto& error : writeBatch.Execute())
+                    {
+                        if (error)
+                        {
+                            std::rethrow_exception(error);
+                        }
+                    }
+                }
+                return writeInstances.size() * 2;
+            });
+        }
+
+        if (enabled("Prefetcher"))
+        {
+            // Enumerating from a host taking 5 ms per batch of 32 instances, with
+            // 100 us of processing per instance, serially and overlapped
+            AddBenchInstances(app, 256, L"prefetchhost");
+            MIStub::SetHostBatchLatency(L"prefetchhost", std::chrono::milliseconds(5), 32);
+            auto prefetchSession = std::shared_ptr<MI::Session>(app.NewSession(L"", L"prefetchhost"));
+            auto process = []() {
+                auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(100);
+                while (std::chrono::steady_clock::now() < end)
+                {
+                }
+            };
+
+            Run("Operation::GetNextInstance(batched)", [&]() {
+                size_t n = 0;
+                auto operation = prefetchSession->ExecQuery(BENCH_NAMESPACE, query);
+                while (operation->GetNextInstance())
+                {
+                    process();
+                    n++;
+                }
+                return n;
+            });
+            Run("Prefetcher::GetNextInstance(batched)", [&]() {
+                size_t n = 0;
+                MI::Prefetcher prefetcher(prefetchSession->ExecQuery(BENCH_NAMESPACE, query), 64);
+                while (prefetcher.GetNextInstance())
+                {
+                    process();
+                    n++;
+                }
+                return n;
+            });
+        }
+
+        if (enabled("ClassSchemaCache"))
+        {
+            // Getting a class from a host answering in 2 ms, as a new process would
+            // without and with the cache file written by a previous one
+            MIStub::SetHostLatency(L"schemahost", std::chrono::milliseconds(2));
+            auto schemaSession = std::shared_ptr<MI::Session>(app.NewSession(L"", L"schemahost"));
+            auto sharedApp = std::shared_ptr<MI::Application>(&app, [](MI::Application*) {});
+            const std::wstring cachePath = L"mi_bench_schema.cache";
+            MI::ClassSchemaCache(sharedApp, cachePath).GetClass(schemaSession, L"schemahost", BENCH_NAMESPACE,
+                BENCH_CLASS);
+
+            Run("ClassSchemaCache(uncached)", [&]() {
+                schemaSession->GetClass(BENCH_NAMESPACE, BENCH_CLASS)->GetNextClass()->Clone();
+                return (size_t)1;
+            });
+            Run("ClassSchemaCache::GetClass(file)", [&]() {
+                MI::ClassSchemaCache classSchemaCache(sharedApp, cachePath);
+                classSchemaCache.GetClass(schemaSession, L"schemahost", BENCH_NAMESPACE, BENCH_CLASS);
+                return (size_t)1;
+            });
+            std::remove("mi_bench_schema.cache");
+        }
+
+        if (enabled("Serializer::SerializeInstance"))
+        {
+            auto serializer = app.NewSerializer();
+            Run("Serializer::SerializeInstance", [&]() {
+                serializer->SerializeInstance(*instance);
+                return (size_t)1;
+            });
+        }
+
+        if (enabled("Serializer::SerializeInstances"))
+        {
+            auto serializer = app.NewSerializer();
+            std::vector<std::shared_ptr<const MI::Instance>> instances(100, instance);
+            Run("Serializer::SerializeInstances(100)", [&]() {
+                return serializer->SerializeInstances(instances).size();
+            });
+        }
+
+        if (enabled("JsonSerializer::SerializeInstance"))
+        {
+            MI::JsonSerializer serializer;
+            Run("JsonSerializer::SerializeInstance", [&]() {
+                serializer.SerializeInstance(*instance);
+                return (size_t)1;
+            });
+        }
+
+        if (enabled("JsonSerializer::SerializeOperation"))
+        {
+            MI::JsonSerializer serializer;
+            Run("JsonSerializer::SerializeOperation", [&]() {
+                auto operation = session->ExecQuery(BENCH_NAMESPACE, query);
+                serializer.SerializeOperation(*operation);
+                return (size_t)count;
+            });
+        }
+
+        if (enabled("MIValue::SetArrayItem") || enabled("MIValue::GetArrayItems"))
+        {
+            // Filling a string[] parameter, per item temporaries vs in place
+            std::vector<std::wstring> strings;
+            for (unsigned i = 0; i < count; i++)
+            {
+                strings.push_back(L"requestedInformation" + std::to_wstring(i));
+            }
+
+            Run("MIValue::SetArrayItem(string)", [&]() {
+                auto value = MI::MIValue::CreateArray(count, MI_STRINGA);
+                for (unsigned i = 0; i < count; i++)
+                {
+                    value->SetArrayItem(*MI::MIValue::FromString(strings[i]), i);
+                }
+                return (size_t)count;
+            });
+            Run("MIValue::GetArrayItems(string)", [&]() {
+                auto value = MI::MIValue::CreateArray(count, MI_STRINGA);
+                auto items = (MI_Char**)value->GetArrayItems();
+                for (unsigned i = 0; i < count; i++)
+                {
+                    items[i] = MI::MIValue::NewString(strings[i].length());
+                    memcpy(items[i], strings[i].c_str(), strings[i].length() * sizeof(MI_Char));
+                }
+                return (size_t)count;
+            });
+            Run("MIValue::SetArrayItem(uint32)", [&]() {
+                auto value = MI::MIValue::CreateArray(count, MI_UINT32A);
+                for (unsigned i = 0; i < count; i++)
+                {
+                    value->SetArrayItem(*MI::MIValue::FromUint32(i), i);
+                }
+                return (size_t)count;
+            });
+            Run("MIValue::GetArrayItems(uint32)", [&]() {
+                auto value = MI::MIValue::CreateArray(count, MI_UINT32A);
+                auto items = (MI_Uint32*)value->GetArrayItems();
+                for (unsigned i = 0; i < count; i++)
+                {
+                    items[i] = i;
+                }
+                return (size_t)count;
+            });
+        }
+    }
+    catch (MI::MIException& ex)
+    {
+        std::fprintf(stderr, "MI error %u: %s\n", (unsigned)ex.GetResult(), ex.what());
+        return 1;
+    }
+    catch (std::exception& ex)
+    {
+        std::fprintf(stderr, "Error: %s\n", ex.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -2,66 +2,454 @@
 #include "MI++.h"
 #include "MIExceptions.h"
 #include <algorithm>
-#include <sstream>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <wctype.h>
 
 using namespace MI;
 
+static void MICheckResult(MI_Result result, const MI_Instance* extError = nullptr);
 
-static bool IsInstanceOf(const Instance& instance, const std::wstring& className)
+static void ReplaceAll(std::wstring& str, const std::wstring& from, const std::wstring& to)
+{
+    size_t start_pos = 0;
+    while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
+        str.replace(start_pos, from.length(), to);
+        start_pos += to.length();
+    }
+}
+
+static bool ElementNameEquals(const MI_Char* name1, const MI_Char* name2)
 {
-    if (instance.GetClassName() == className)
+    while (*name1 && *name2)
+    {
+        if (*name1 != *name2 && towlower(*name1) != towlower(*name2))
+        {
+            return false;
+        }
+        name1++;
+        name2++;
+    }
+    return *name1 == *name2;
+}
+
+static int CompareNoCase(const MI_Char* name1, const MI_Char* name2)
+{
+    for (;; name1++, name2++)
+    {
+        wint_t c1 = towlower(*name1);
+        wint_t c2 = towlower(*name2);
+        if (c1 != c2 || !c1)
+        {
+            return c1 < c2 ? -1 : c1 > c2 ? 1 : 0;
+        }
+    }
+}
+
+// Classes of the extended errors seen so far and whether they derive from
+// MSFT_WmiError. Only a few distinct error classes exist, so they are kept
+// in a short list that can be searched without allocating.
+#define MAX_CACHED_ERROR_CLASSES 64
+
+static std::mutex g_errorClassesMutex;
+static std::vector<std::pair<std::wstring, bool>> g_errorClasses;
+
+static bool IsWmiError(const MI_Instance* instance)
+{
+    const MI_Char* className = nullptr;
+    if (::MI_Instance_GetClassName(instance, &className) != MI_RESULT_OK || !className)
+    {
+        return false;
+    }
+    if (ElementNameEquals(className, L"MSFT_WmiError"))
     {
         return true;
     }
-    else
+
     {
-        auto cls = instance.GetClass()->GetParentClass();
-        while (cls)
+        std::lock_guard<std::mutex> lock(g_errorClassesMutex);
+        for (auto const& it : g_errorClasses)
         {
-            if (cls->GetClassName() == className)
+            if (ElementNameEquals(it.first.c_str(), className))
             {
-                return true;
+                return it.second;
             }
+        }
+    }
+
+    // Walk the parent classes only the first time an error class is seen
+    bool isWmiError = false;
+    try
+    {
+        MI_Class* miClass = nullptr;
+        MICheckResult(::MI_Instance_GetClass(instance, &miClass));
+        auto cls = Class(miClass, true).GetParentClass();
+        while (cls && !isWmiError)
+        {
+            isWmiError = cls->GetClassName() == L"MSFT_WmiError";
             cls = cls->GetParentClass();
         }
     }
+    catch (std::exception&)
+    {
+        return false;
+    }
 
-    return false;
+    std::lock_guard<std::mutex> lock(g_errorClassesMutex);
+    if (g_errorClasses.size() < MAX_CACHED_ERROR_CLASSES)
+    {
+        g_errorClasses.push_back(std::make_pair(std::wstring(className), isWmiError));
+    }
+    return isWmiError;
 }
 
-static void MICheckResult(MI_Result result, const MI_Instance* extError = nullptr)
+static bool GetErrorElement(const MI_Instance* instance, const MI_Char* name, MI_Type type, MI_Value& value)
+{
+    MI_Type elementType;
+    MI_Uint32 flags = 0;
+    return ::MI_Instance_GetElement(instance, name, &value, &elementType, &flags, nullptr) == MI_RESULT_OK &&
+        elementType == type && !(flags & MI_FLAG_NULL);
+}
+
+static void MICheckResult(MI_Result result, const MI_Instance* extError)
 {
     if (result != MI_RESULT_OK)
     {
-        if (extError)
+        // Reads the error details directly, errors are frequent and expected in some workloads
+        if (extError && IsWmiError(extError))
         {
-            Instance instance((MI_Instance*)extError, false);
-            if(IsInstanceOf(instance, L"MSFT_WmiError"))
+            MI_Value value;
+            const MI_Char* message = L"";
+            if (GetErrorElement(extError, L"Message", MI_STRING, value) && value.string)
+            {
+                message = value.string;
+            }
+            MI_Uint32 errorCode = 0;
+            if (GetErrorElement(extError, L"error_code", MI_UINT32, value))
             {
-                const MI_Char* message = instance[L"Message"]->m_value.string;
-                message = message ? message : L"";
-
-                auto errorCode = instance[L"error_code"]->m_value.uint32;
-
-                switch(errorCode)
-                {
-                case WMI_ERR_TIMEOUT:
-                    throw MITimeoutException(result, errorCode, message);
-                default:
-                    throw MIException(result, errorCode, message);
-                }
+                errorCode = value.uint32;
+            }
+
+            switch(errorCode)
+            {
+            case WMI_ERR_TIMEOUT:
+                throw MITimeoutException(result, errorCode, message);
+            default:
+                throw MIException(result, errorCode, message);
             }
         }
         throw MIException(result);
     }
 }
 
-static void ReplaceAll(std::wstring& str, const std::wstring& from, const std::wstring& to)
+namespace MI
 {
-    size_t start_pos = 0;
-    while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
-        str.replace(start_pos, from.length(), to);
-        start_pos += to.length();
+    // Element names are resolved once per class, the cached indexes are
+    // validated against the element name on use, as instances of a class
+    // created without class information can have different layouts.
+    class ElementIndexTable
+    {
+    private:
+        std::unordered_map<std::wstring, unsigned> m_indexes;
+        std::shared_ptr<void> m_data;
+        std::mutex m_mutex;
+
+    public:
+        bool Find(const std::wstring& name, unsigned& index)
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            auto it = this->m_indexes.find(name);
+            if (it == this->m_indexes.end())
+            {
+                return false;
+            }
+            index = it->second;
+            return true;
+        }
+
+        void Add(const std::wstring& name, unsigned index)
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            this->m_indexes[name] = index;
+        }
+
+        std::shared_ptr<void> GetData()
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            return this->m_data;
+        }
+
+        std::shared_ptr<void> SetData(const std::shared_ptr<void>& data)
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            if (!this->m_data)
+            {
+                this->m_data = data;
+            }
+            return this->m_data;
+        }
+    };
+};
+
+namespace MI
+{
+    struct ClassCacheEntry
+    {
+        std::wstring m_serverName;
+        std::wstring m_nameSpace;
+        std::wstring m_className;
+        std::shared_ptr<ElementIndexTable> m_elementIndexTable = std::make_shared<ElementIndexTable>();
+        // Guarded by g_classCacheMutex
+        std::shared_ptr<const ClassMetadata> m_metadata;
+        std::atomic<bool> m_invalidated = { false };
+    };
+};
+
+static std::mutex g_classCacheMutex;
+static std::unordered_map<std::wstring, std::shared_ptr<ClassCacheEntry>> g_classCache;
+
+static bool NameSpaceEquals(const MI_Char* ns1, const MI_Char* ns2)
+{
+    while (*ns1 && *ns2)
+    {
+        wint_t c1 = *ns1 == L'\\' ? L'/' : towlower(*ns1);
+        wint_t c2 = *ns2 == L'\\' ? L'/' : towlower(*ns2);
+        if (c1 != c2)
+        {
+            return false;
+        }
+        ns1++;
+        ns2++;
+    }
+    return *ns1 == *ns2;
+}
+
+static bool ClassCacheEntryMatches(const ClassCacheEntry& entry, const MI_Char* serverName, const MI_Char* ns,
+    const MI_Char* className)
+{
+    return !entry.m_invalidated &&
+        ElementNameEquals(entry.m_className.c_str(), className) &&
+        NameSpaceEquals(entry.m_nameSpace.c_str(), ns) &&
+        ElementNameEquals(entry.m_serverName.c_str(), serverName);
+}
+
+static std::shared_ptr<ClassCacheEntry> GetClassCacheEntry(const MI_Char* serverName, const MI_Char* ns,
+    const MI_Char* className, const std::shared_ptr<ClassCacheEntry>& hint = nullptr)
+{
+    serverName = serverName ? serverName : L"";
+    ns = ns ? ns : L"";
+    className = className ? className : L"";
+
+    if (hint && ClassCacheEntryMatches(*hint, serverName, ns, className))
+    {
+        return hint;
+    }
+
+    std::wstring key = serverName;
+    key += L"|";
+    key += ns;
+    key += L":";
+    key += className;
+    std::transform(key.begin(), key.end(), key.begin(), ::towlower);
+    std::replace(key.begin(), key.end(), L'\\', L'/');
+
+    std::lock_guard<std::mutex> lock(g_classCacheMutex);
+    auto& entry = g_classCache[key];
+    if (!entry)
+    {
+        entry = std::make_shared<ClassCacheEntry>();
+        entry->m_serverName = serverName;
+        entry->m_nameSpace = ns;
+        entry->m_className = className;
+    }
+    return entry;
+}
+
+static std::shared_ptr<ClassCacheEntry> GetClassCacheEntry(const MI_Instance* instance,
+    const std::shared_ptr<ClassCacheEntry>& hint = nullptr)
+{
+    const MI_Char* serverName = nullptr;
+    const MI_Char* ns = nullptr;
+    const MI_Char* className = nullptr;
+    MICheckResult(::MI_Instance_GetServerName(instance, &serverName));
+    MICheckResult(::MI_Instance_GetNameSpace(instance, &ns));
+    MICheckResult(::MI_Instance_GetClassName(instance, &className));
+    return GetClassCacheEntry(serverName, ns, className, hint);
+}
+
+static std::shared_ptr<const ClassMetadata> GetClassMetadata(ClassCacheEntry& entry, const Class& miClass)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_classCacheMutex);
+        if (entry.m_metadata)
+        {
+            return entry.m_metadata;
+        }
+    }
+
+    // Built without holding the lock, concurrent builds of the same class are harmless
+    auto metadata = std::make_shared<const ClassMetadata>(miClass);
+    for (auto const& element : metadata->GetElements())
+    {
+        entry.m_elementIndexTable->Add(element.m_name, element.m_index);
+    }
+
+    std::lock_guard<std::mutex> lock(g_classCacheMutex);
+    if (!entry.m_metadata)
+    {
+        entry.m_metadata = metadata;
+    }
+    return entry.m_metadata;
+}
+
+ClassMetadata::ClassMetadata(const Class& miClass)
+{
+    this->m_serverName = miClass.GetServerName();
+    this->m_nameSpace = miClass.GetNameSpace();
+    this->m_className = miClass.GetClassName();
+
+    auto parentClass = miClass.GetParentClass();
+    while (parentClass)
+    {
+        this->m_parentClassNames.push_back(parentClass->GetClassName());
+        parentClass = parentClass->GetParentClass();
+    }
+
+    unsigned count = miClass.GetElementsCount();
+    this->m_elements.resize(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        auto& element = this->m_elements[i];
+        const MI_Char* name = nullptr;
+        MI_Value value;
+        MI_Boolean valueExists;
+        MI_QualifierSet qualifierSet;
+        MICheckResult(::MI_Class_GetElementAt(miClass.m_class, i, &name, &value, &valueExists, &element.m_type,
+            nullptr, &qualifierSet, &element.m_flags));
+        element.m_name = name;
+        element.m_index = i;
+        if ((element.m_flags & MI_FLAG_KEY) || QualifierSet(qualifierSet).Contains(L"Key"))
+        {
+            this->m_key.push_back(name);
+        }
+    }
+
+    count = miClass.GetMethodCount();
+    this->m_methods.resize(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        auto& method = this->m_methods[i];
+        const MI_Char* name = nullptr;
+        MI_QualifierSet qualifierSet;
+        MI_ParameterSet paramSet;
+        MICheckResult(::MI_Class_GetMethodAt(miClass.m_class, i, &name, &qualifierSet, &paramSet));
+        method.m_name = name;
+        method.m_index = i;
+        method.m_static = QualifierSet(qualifierSet).Contains(L"Static");
+        MI_QualifierSet returnQualifierSet;
+        MICheckResult(::MI_ParameterSet_GetMethodReturnType(&paramSet, &method.m_returnType, &returnQualifierSet));
+
+        MI_Uint32 paramCount = 0;
+        MICheckResult(::MI_ParameterSet_GetParameterCount(&paramSet, &paramCount));
+        method.m_parameters.resize(paramCount);
+        for (MI_Uint32 j = 0; j < paramCount; j++)
+        {
+            auto& param = method.m_parameters[j];
+            const MI_Char* paramName = nullptr;
+            MI_QualifierSet paramQualifierSet;
+            MICheckResult(::MI_ParameterSet_GetParameterAt(&paramSet, j, &paramName, &param.m_type, nullptr,
+                &paramQualifierSet));
+            QualifierSet paramQualifiers(paramQualifierSet);
+            param.m_name = paramName;
+            param.m_index = j;
+            param.m_in = paramQualifiers.Contains(L"In");
+            param.m_out = paramQualifiers.Contains(L"Out");
+        }
+    }
+}
+
+const BaseElementInfoWithFlags* ClassMetadata::FindElement(const std::wstring& name) const
+{
+    for (auto const& element : this->m_elements)
+    {
+        if (ElementNameEquals(element.m_name.c_str(), name.c_str()))
+        {
+            return &element;
+        }
+    }
+    return nullptr;
+}
+
+const MethodSignature* ClassMetadata::FindMethod(const std::wstring& name) const
+{
+    for (auto const& method : this->m_methods)
+    {
+        if (ElementNameEquals(method.m_name.c_str(), name.c_str()))
+        {
+            return &method;
+        }
+    }
+    return nullptr;
+}
+
+bool ClassMetadata::IsA(const std::wstring& className) const
+{
+    if (ElementNameEquals(this->m_className.c_str(), className.c_str()))
+    {
+        return true;
+    }
+    for (auto const& parentClassName : this->m_parentClassNames)
+    {
+        if (ElementNameEquals(parentClassName.c_str(), className.c_str()))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<const ClassMetadata> ClassCache::GetMetadata(const Class& miClass)
+{
+    const MI_Char* serverName = nullptr;
+    const MI_Char* ns = nullptr;
+    const MI_Char* className = nullptr;
+    MICheckResult(::MI_Class_GetServerName(miClass.m_class, &serverName));
+    MICheckResult(::MI_Class_GetNameSpace(miClass.m_class, &ns));
+    MICheckResult(::MI_Class_GetClassName(miClass.m_class, &className));
+    auto entry = ::GetClassCacheEntry(serverName, ns, className);
+    return GetClassMetadata(*entry, miClass);
+}
+
+std::shared_ptr<const ClassMetadata> ClassCache::FindMetadata(const std::wstring& serverName,
+    const std::wstring& ns, const std::wstring& className)
+{
+    auto entry = ::GetClassCacheEntry(serverName.c_str(), ns.c_str(), className.c_str());
+    std::lock_guard<std::mutex> lock(g_classCacheMutex);
+    return entry->m_metadata;
+}
+
+void ClassCache::Invalidate(const std::wstring& serverName, const std::wstring& ns, const std::wstring& className)
+{
+    // Released after unlocking, the element index data may take other locks when freed
+    std::vector<std::shared_ptr<ClassCacheEntry>> invalidated;
+    std::lock_guard<std::mutex> lock(g_classCacheMutex);
+    for (auto it = g_classCache.begin(); it != g_classCache.end();)
+    {
+        auto& entry = *it->second;
+        if ((serverName.empty() || ElementNameEquals(entry.m_serverName.c_str(), serverName.c_str())) &&
+            (ns.empty() || NameSpaceEquals(entry.m_nameSpace.c_str(), ns.c_str())) &&
+            (className.empty() || ElementNameEquals(entry.m_className.c_str(), className.c_str())))
+        {
+            // Objects still referencing the entry keep using it, operations stop passing it on
+            entry.m_invalidated = true;
+            invalidated.push_back(std::move(it->second));
+            it = g_classCache.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
     }
 }
 
@@ -334,14 +722,9 @@ std::shared_ptr<Instance> Application::NewMethodParamsInstance(const Class& miCl
     for (auto const &it : methodInfo->m_parameters)
     {
         auto& param = it.second;
-        for (auto const &it2 : param->m_qualifiers)
+        if (param->m_qualifiers.Contains(L"In"))
         {
-            std::wstring name = it2.second->m_name;
-            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-            if (name == L"in")
-            {
-                instance->AddElement(param->m_name, MIValue(param->m_type));
-            }
+            instance->AddElement(param->m_name, MIValue(param->m_type));
         }
     }
 
@@ -355,6 +738,13 @@ std::shared_ptr<Serializer> Application::NewSerializer()
     return std::shared_ptr<Serializer>(new Serializer(serializer));
 }
 
+std::shared_ptr<Deserializer> Application::NewDeserializer()
+{
+    MI_Deserializer deserializer;
+    MICheckResult(::MI_Application_NewDeserializer(&this->m_app, 0, L"MI_XML", &deserializer));
+    return std::shared_ptr<Deserializer>(new Deserializer(deserializer));
+}
+
 std::shared_ptr<OperationOptions> Application::NewOperationOptions()
 {
     MI_OperationOptions operationOptions;
@@ -376,22 +766,83 @@ unsigned Class::GetMethodCount() const
     return count;
 }
 
-std::map<std::wstring, std::shared_ptr<Qualifier>> GetQualifiers(MI_QualifierSet* qualifierSet)
+QualifierSet::QualifierSet()
 {
-    std::map<std::wstring, std::shared_ptr<Qualifier>> qualifiers;
+    memset(&this->m_qualifierSet, 0, sizeof(this->m_qualifierSet));
+}
 
+unsigned QualifierSet::GetCount() const
+{
+    if (this->m_decoded)
+    {
+        return (unsigned)this->m_qualifiers.size();
+    }
+    if (!this->m_qualifierSet.ft)
+    {
+        return 0;
+    }
     MI_Uint32 count = 0;
-    MICheckResult(::MI_QualifierSet_GetQualifierCount(qualifierSet, &count));
+    MICheckResult(::MI_QualifierSet_GetQualifierCount(&this->m_qualifierSet, &count));
+    return count;
+}
+
+void QualifierSet::Decode() const
+{
+    unsigned count = this->GetCount();
+    std::vector<Qualifier> qualifiers(count);
+    for (MI_Uint32 i = 0; i < count; i++)
+    {
+        auto& q = qualifiers[i];
+        MICheckResult(::MI_QualifierSet_GetQualifierAt(&this->m_qualifierSet, i, &q.m_name, &q.m_type, &q.m_flags, &q.m_value));
+    }
+    std::sort(qualifiers.begin(), qualifiers.end(), [](const Qualifier& q1, const Qualifier& q2) {
+        return CompareNoCase(q1.m_name, q2.m_name) < 0;
+    });
+    this->m_qualifiers.swap(qualifiers);
+    this->m_decoded = true;
+}
+
+const std::vector<Qualifier>& QualifierSet::GetQualifiers() const
+{
+    if (!this->m_decoded)
+    {
+        this->Decode();
+    }
+    return this->m_qualifiers;
+}
+
+bool QualifierSet::Find(const MI_Char* name, Qualifier& qualifier) const
+{
+    if (this->m_decoded)
+    {
+        auto it = std::lower_bound(this->m_qualifiers.begin(), this->m_qualifiers.end(), name,
+            [](const Qualifier& q, const MI_Char* name) { return CompareNoCase(q.m_name, name) < 0; });
+        if (it != this->m_qualifiers.end() && !CompareNoCase(it->m_name, name))
+        {
+            qualifier = *it;
+            return true;
+        }
+        return false;
+    }
+
+    // A linear scan of the few qualifiers of an element is cheaper than decoding them
+    unsigned count = this->GetCount();
     for (MI_Uint32 i = 0; i < count; i++)
     {
-        const MI_Char* qualifierName = nullptr;
-        auto q = std::make_shared<Qualifier>();
-        MICheckResult(::MI_QualifierSet_GetQualifierAt(qualifierSet, i, &qualifierName, &q->m_type, &q->m_flags, &q->m_value));
-        q->m_name = qualifierName;
-        qualifiers[qualifierName] = q;
+        MICheckResult(::MI_QualifierSet_GetQualifierAt(&this->m_qualifierSet, i, &qualifier.m_name, &qualifier.m_type,
+            &qualifier.m_flags, &qualifier.m_value));
+        if (ElementNameEquals(qualifier.m_name, name))
+        {
+            return true;
+        }
     }
+    return false;
+}
 
-    return qualifiers;
+bool QualifierSet::Contains(const MI_Char* name) const
+{
+    Qualifier qualifier;
+    return this->Find(name, qualifier);
 }
 
 std::map<std::wstring, std::shared_ptr<ParameterInfo>> GetParametersInfo(MI_ParameterSet* paramSet)
@@ -408,7 +859,7 @@ std::map<std::wstring, std::shared_ptr<ParameterInfo>> GetParametersInfo(MI_Para
         MICheckResult(::MI_ParameterSet_GetParameterAt(paramSet, i, &paramName, &paramInfo->m_type, nullptr, &qualifierSet));
         paramInfo->m_name = paramName;
         paramInfo->m_index = i;
-        paramInfo->m_qualifiers = GetQualifiers(&qualifierSet);
+        paramInfo->m_qualifiers = QualifierSet(qualifierSet);
         parametersInfo[paramName] = paramInfo;
     }
 
@@ -417,16 +868,46 @@ std::map<std::wstring, std::shared_ptr<ParameterInfo>> GetParametersInfo(MI_Para
 
 std::shared_ptr<MethodInfo> Class::GetMethodInfo(const std::wstring& name) const
 {
-    auto info = std::make_shared<MethodInfo>();
+    std::shared_ptr<MethodInfo> info;
+    if (!this->TryGetMethodInfo(name, info))
+    {
+        throw MIException(MI_RESULT_METHOD_NOT_FOUND);
+    }
+    return info;
+}
+
+bool Class::TryGetMethodInfo(const std::wstring& name, std::shared_ptr<MethodInfo>& info) const
+{
     MI_ParameterSet paramSet;
     MI_QualifierSet qualifierSet;
     MI_Uint32 index;
-    MICheckResult(::MI_Class_GetMethod(this->m_class, name.c_str(), &qualifierSet, &paramSet, &index));
+    MI_Result result = ::MI_Class_GetMethod(this->m_class, name.c_str(), &qualifierSet, &paramSet, &index);
+    if (result == MI_RESULT_METHOD_NOT_FOUND || result == MI_RESULT_NOT_FOUND)
+    {
+        return false;
+    }
+    MICheckResult(result);
+
+    info = std::make_shared<MethodInfo>();
     info->m_name = name;
     info->m_index = index;
-    info->m_qualifiers = GetQualifiers(&qualifierSet);
+    info->m_qualifiers = QualifierSet(qualifierSet);
     info->m_parameters = GetParametersInfo(&paramSet);
-    return info;
+    return true;
+}
+
+bool Class::HasMethod(const std::wstring& name) const
+{
+    MI_ParameterSet paramSet;
+    MI_QualifierSet qualifierSet;
+    MI_Uint32 index;
+    MI_Result result = ::MI_Class_GetMethod(this->m_class, name.c_str(), &qualifierSet, &paramSet, &index);
+    if (result == MI_RESULT_METHOD_NOT_FOUND || result == MI_RESULT_NOT_FOUND)
+    {
+        return false;
+    }
+    MICheckResult(result);
+    return true;
 }
 
 std::shared_ptr<MethodInfo> Class::GetMethodInfo(unsigned index) const
@@ -438,7 +919,7 @@ std::shared_ptr<MethodInfo> Class::GetMethodInfo(unsigned index) const
     MICheckResult(::MI_Class_GetMethodAt(this->m_class, index, &name, &qualifierSet, &paramSet));
     info->m_name = name;
     info->m_index = index;
-    info->m_qualifiers = GetQualifiers(&qualifierSet);
+    info->m_qualifiers = QualifierSet(qualifierSet);
     info->m_parameters = GetParametersInfo(&paramSet);
     return info;
 }
@@ -479,30 +960,9 @@ std::shared_ptr<const std::vector<std::wstring>> Class::GetKey()
 {
     if (!this->m_key)
     {
-        auto key = std::make_shared<std::vector<std::wstring>>();
-        unsigned count = this->GetElementsCount();
-        for (unsigned i = 0; i < count; i++)
-        {
-            auto element = (*this)[i];
-            if (element->m_flags & MI_FLAG_KEY)
-            {
-                key->push_back(element->m_name);
-            }
-            else
-            {
-                for (auto const &it : element->m_qualifiers)
-                {
-                    std::wstring name = it.second->m_name;
-                    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-                    if (name == L"key")
-                    {
-                        key->push_back(element->m_name);
-                    }
-                }
-            }
-        }
-        // Cache the key for subsequent calls
-        this->m_key = key;
+        // Shares the key cached for all the classes and instances of this class
+        auto metadata = ClassCache::GetMetadata(*this);
+        this->m_key = std::shared_ptr<const std::vector<std::wstring>>(metadata, &metadata->GetKey());
     }
 
     return this->m_key;
@@ -515,7 +975,7 @@ std::shared_ptr<ClassElement> Class::operator[] (const std::wstring& name) const
     MICheckResult(::MI_Class_GetElement(this->m_class, name.c_str(), &element->m_value, &element->m_valueExists, &element->m_type,
         nullptr, &qualifierSet, &element->m_flags, &element->m_index));
     element->m_name = name;
-    element->m_qualifiers = GetQualifiers(&qualifierSet);
+    element->m_qualifiers = QualifierSet(qualifierSet);
     return element;
 }
 
@@ -528,7 +988,7 @@ std::shared_ptr<ClassElement> Class::operator[] (unsigned index) const
         nullptr, &qualifierSet, &element->m_flags));
     element->m_name = name;
     element->m_index = index;
-    element->m_qualifiers = GetQualifiers(&qualifierSet);
+    element->m_qualifiers = QualifierSet(qualifierSet);
     return element;
 }
 
@@ -563,7 +1023,9 @@ std::shared_ptr<Class> Class::Clone() const
     {
         MI_Class* newClass = nullptr;
         MICheckResult(::MI_Class_Clone(this->m_class, &newClass));
-        return std::make_shared<Class>(newClass, true);
+        auto clonedClass = std::make_shared<Class>(newClass, true);
+        clonedClass->m_parentClass = this->m_parentClass;
+        return clonedClass;
     }
     return nullptr;
 }
@@ -683,6 +1145,7 @@ OperationOptions::~OperationOptions()
 void DestinationOptions::SetUILocale(const std::wstring& locale)
 {
     MICheckResult(::MI_DestinationOptions_SetUILocale(&this->m_destinationOptions, locale.c_str()));
+    this->m_options[L"UILocale"] = locale;
 }
 
 std::wstring DestinationOptions::GetUILocale()
@@ -695,6 +1158,9 @@ std::wstring DestinationOptions::GetUILocale()
 void DestinationOptions::SetTimeout(const MI_Interval& timeout)
 {
     MICheckResult(::MI_DestinationOptions_SetTimeout(&this->m_destinationOptions, &timeout));
+    this->m_options[L"Timeout"] = std::to_wstring(timeout.days) + L":" + std::to_wstring(timeout.hours) + L":" +
+        std::to_wstring(timeout.minutes) + L":" + std::to_wstring(timeout.seconds) + L"." +
+        std::to_wstring(timeout.microseconds);
 }
 
 MI_Interval DestinationOptions::GetTimeout()
@@ -707,6 +1173,7 @@ MI_Interval DestinationOptions::GetTimeout()
 void DestinationOptions::SetTransport(const std::wstring& transport)
 {
     MICheckResult(::MI_DestinationOptions_SetTransport(&this->m_destinationOptions, transport.c_str()));
+    this->m_options[L"Transport"] = transport;
 }
 
 std::wstring DestinationOptions::GetTransport()
@@ -723,6 +1190,7 @@ void DestinationOptions::AddCredentials(const std::wstring& authType,
     creds.credentials.certificateThumbprint = certThumbprint.c_str();
 
     MICheckResult(::MI_DestinationOptions_AddDestinationCredentials(&this->m_destinationOptions, &creds));
+    this->m_credentials.push_back({ authType, certThumbprint });
 }
 
 void DestinationOptions::AddCredentials(const std::wstring& authType, const std::wstring& domain,
@@ -734,13 +1202,17 @@ void DestinationOptions::AddCredentials(const std::wstring& authType, const std:
     creds.credentials.usernamePassword.password = password.c_str();
 
     MICheckResult(::MI_DestinationOptions_AddDestinationCredentials(&this->m_destinationOptions, &creds));
+    this->m_credentials.push_back({ authType, domain, username, password });
 }
 
 std::shared_ptr<DestinationOptions> DestinationOptions::Clone() const
 {
     MI_DestinationOptions clonedDestinationOptions;
     MICheckResult(::MI_DestinationOptions_Clone(&this->m_destinationOptions, &clonedDestinationOptions));
-    return std::shared_ptr<DestinationOptions>(new DestinationOptions(clonedDestinationOptions));
+    auto destinationOptions = std::shared_ptr<DestinationOptions>(new DestinationOptions(clonedDestinationOptions));
+    destinationOptions->m_options = this->m_options;
+    destinationOptions->m_credentials = this->m_credentials;
+    return destinationOptions;
 }
 
 void DestinationOptions::Delete()
@@ -760,16 +1232,30 @@ DestinationOptions::~DestinationOptions()
 
 bool Session::IsClosed()
 {
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
     MI_Session nullSession = MI_SESSION_NULL;
     return memcmp(&this->m_session, &nullSession, sizeof(MI_Session)) == 0;
 }
 
 void Session::Close()
 {
+    std::unique_lock<std::shared_timed_mutex> lock(this->m_mutex);
     MICheckResult(::MI_Session_Close(&this->m_session, nullptr, nullptr));
     this->m_session = MI_SESSION_NULL;
 }
 
+void Session::TestConnection()
+{
+    MI_Operation op = MI_OPERATION_NULL;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
+    ::MI_Session_TestConnection(&this->m_session, 0, nullptr, &op);
+    Operation operation(op);
+    while (operation.HasMoreResults())
+    {
+        operation.GetNextInstance();
+    }
+}
+
 Session::~Session()
 {
     try
@@ -786,22 +1272,29 @@ Session::~Session()
 }
 
 std::shared_ptr<Operation> Session::ExecQuery(const std::wstring& ns, const std::wstring& query, const std::wstring& dialect,
-                                              std::shared_ptr<OperationOptions> operationOptions)
+                                              std::shared_ptr<OperationOptions> operationOptions,
+                                              std::shared_ptr<Callbacks> callbacks)
 {
+    MI_OperationCallbacks opCallbacks = GetMIOperationCallbacks(callbacks);
     MI_Operation op = MI_OPERATION_NULL;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
     ::MI_Session_QueryInstances(
         &this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI,
         operationOptions ? &operationOptions->m_operationOptions : nullptr,
         ns.c_str(), dialect.c_str(),
-        query.c_str(), nullptr, &op);
-    return std::make_shared<Operation>(op);
+        query.c_str(), callbacks ? &opCallbacks : nullptr, &op);
+    auto operation = std::make_shared<Operation>(op);
+    operation->m_callbacks = callbacks;
+    return operation;
 }
 
 std::shared_ptr<Operation> Session::GetAssociators(const std::wstring& ns, const Instance& instance, const std::wstring& assocClass,
     const std::wstring& resultClass, const std::wstring& role, const std::wstring& resultRole, bool keysOnly,
-    std::shared_ptr<OperationOptions> operationOptions)
+    std::shared_ptr<OperationOptions> operationOptions, std::shared_ptr<Callbacks> callbacks)
 {
+    MI_OperationCallbacks opCallbacks = GetMIOperationCallbacks(callbacks);
     MI_Operation op = MI_OPERATION_NULL;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
     ::MI_Session_AssociatorInstances(
         &this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI,
         operationOptions ? &operationOptions->m_operationOptions : nullptr,
@@ -810,40 +1303,51 @@ std::shared_ptr<Operation> Session::GetAssociators(const std::wstring& ns, const
         resultClass.length() ? resultClass.c_str() : nullptr,
         role.length() ? role.c_str() : nullptr,
         resultRole.length() ? resultRole.c_str() : nullptr,
-        keysOnly, nullptr, &op);
-    return std::make_shared<Operation>(op);
+        keysOnly, callbacks ? &opCallbacks : nullptr, &op);
+    auto operation = std::make_shared<Operation>(op);
+    operation->m_callbacks = callbacks;
+    return operation;
 }
 
 std::shared_ptr<Operation> Session::InvokeMethod(
     Instance& instance, const std::wstring& methodName, std::shared_ptr<const Instance> inboundParams,
-    std::shared_ptr<OperationOptions> operationOptions)
+    std::shared_ptr<OperationOptions> operationOptions, std::shared_ptr<Callbacks> callbacks)
 {
+    MI_OperationCallbacks opCallbacks = GetMIOperationCallbacks(callbacks);
     MI_Operation op = MI_OPERATION_NULL;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
     ::MI_Session_Invoke(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI,
         operationOptions ? &operationOptions->m_operationOptions : nullptr,
         instance.GetNameSpace().c_str(), instance.GetClassName().c_str(), methodName.c_str(), instance.m_instance,
         inboundParams && inboundParams->GetElementsCount() > 0 ? inboundParams->m_instance : nullptr,
-        nullptr, &op);
-    return std::make_shared<Operation>(op);
+        callbacks ? &opCallbacks : nullptr, &op);
+    auto operation = std::make_shared<Operation>(op);
+    operation->m_callbacks = callbacks;
+    return operation;
 }
 
 std::shared_ptr<Operation> Session::InvokeMethod(
     const std::wstring& ns, const std::wstring& className, const std::wstring& methodName, std::shared_ptr<const Instance> inboundParams,
-    std::shared_ptr<OperationOptions> operationOptions)
+    std::shared_ptr<OperationOptions> operationOptions, std::shared_ptr<Callbacks> callbacks)
 {
+    MI_OperationCallbacks opCallbacks = GetMIOperationCallbacks(callbacks);
     MI_Operation op = MI_OPERATION_NULL;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
     ::MI_Session_Invoke(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI,
         operationOptions ? &operationOptions->m_operationOptions : nullptr,
         ns.c_str(), className.c_str(), methodName.c_str(), nullptr,
         inboundParams && inboundParams->GetElementsCount() > 0 ? inboundParams->m_instance : nullptr,
-        nullptr, &op);
-    return std::make_shared<Operation>(op);
+        callbacks ? &opCallbacks : nullptr, &op);
+    auto operation = std::make_shared<Operation>(op);
+    operation->m_callbacks = callbacks;
+    return operation;
 }
 
 void Session::DeleteInstance(const std::wstring& ns, const Instance& instance,
                              std::shared_ptr<OperationOptions> operationOptions)
 {
     MI_Operation op;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
     ::MI_Session_DeleteInstance(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI,
 		                        operationOptions ? &operationOptions->m_operationOptions : nullptr,
                                 ns.c_str(), instance.m_instance, nullptr, &op);
@@ -858,6 +1362,7 @@ void Session::ModifyInstance(const std::wstring& ns, const Instance& instance,
                              std::shared_ptr<OperationOptions> operationOptions)
 {
     MI_Operation op;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
     ::MI_Session_ModifyInstance(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI,
                                 operationOptions ? &operationOptions->m_operationOptions : nullptr,
                                 ns.c_str(), instance.m_instance, nullptr, &op);
@@ -872,6 +1377,7 @@ void Session::CreateInstance(const std::wstring& ns, const Instance& instance,
                              std::shared_ptr<OperationOptions> operationOptions)
 {
     MI_Operation op;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
     ::MI_Session_CreateInstance(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI,
                                 operationOptions ? &operationOptions->m_operationOptions : nullptr,
                                 ns.c_str(), instance.m_instance, nullptr, &op);
@@ -882,17 +1388,69 @@ void Session::CreateInstance(const std::wstring& ns, const Instance& instance,
     }
 }
 
-std::shared_ptr<Operation> Session::GetInstance(const std::wstring& ns, const Instance& keyInstance)
+std::shared_ptr<Operation> Session::CreateInstanceAsync(const std::wstring& ns, std::shared_ptr<const Instance> instance,
+    std::shared_ptr<OperationOptions> operationOptions, std::shared_ptr<Callbacks> callbacks)
+{
+    MI_OperationCallbacks opCallbacks = GetMIOperationCallbacks(callbacks);
+    MI_Operation op = MI_OPERATION_NULL;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
+    ::MI_Session_CreateInstance(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI,
+                                operationOptions ? &operationOptions->m_operationOptions : nullptr,
+                                ns.c_str(), instance->m_instance, callbacks ? &opCallbacks : nullptr, &op);
+    auto operation = std::make_shared<Operation>(op);
+    operation->m_callbacks = callbacks;
+    operation->m_inboundInstance = instance;
+    return operation;
+}
+
+std::shared_ptr<Operation> Session::ModifyInstanceAsync(const std::wstring& ns, std::shared_ptr<const Instance> instance,
+    std::shared_ptr<OperationOptions> operationOptions, std::shared_ptr<Callbacks> callbacks)
+{
+    MI_OperationCallbacks opCallbacks = GetMIOperationCallbacks(callbacks);
+    MI_Operation op = MI_OPERATION_NULL;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
+    ::MI_Session_ModifyInstance(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI,
+                                operationOptions ? &operationOptions->m_operationOptions : nullptr,
+                                ns.c_str(), instance->m_instance, callbacks ? &opCallbacks : nullptr, &op);
+    auto operation = std::make_shared<Operation>(op);
+    operation->m_callbacks = callbacks;
+    operation->m_inboundInstance = instance;
+    return operation;
+}
+
+std::shared_ptr<Operation> Session::DeleteInstanceAsync(const std::wstring& ns, std::shared_ptr<const Instance> instance,
+    std::shared_ptr<OperationOptions> operationOptions, std::shared_ptr<Callbacks> callbacks)
 {
+    MI_OperationCallbacks opCallbacks = GetMIOperationCallbacks(callbacks);
+    MI_Operation op = MI_OPERATION_NULL;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
+    ::MI_Session_DeleteInstance(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI,
+                                operationOptions ? &operationOptions->m_operationOptions : nullptr,
+                                ns.c_str(), instance->m_instance, callbacks ? &opCallbacks : nullptr, &op);
+    auto operation = std::make_shared<Operation>(op);
+    operation->m_callbacks = callbacks;
+    operation->m_inboundInstance = instance;
+    return operation;
+}
+
+std::shared_ptr<Operation> Session::GetInstance(const std::wstring& ns, const Instance& keyInstance,
+    std::shared_ptr<Callbacks> callbacks)
+{
+    MI_OperationCallbacks opCallbacks = GetMIOperationCallbacks(callbacks);
     MI_Operation op;
-    ::MI_Session_GetInstance(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI, nullptr, ns.c_str(), keyInstance.m_instance, nullptr, &op);
-    return std::make_shared<Operation>(op);
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
+    ::MI_Session_GetInstance(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI, nullptr, ns.c_str(), keyInstance.m_instance,
+        callbacks ? &opCallbacks : nullptr, &op);
+    auto operation = std::make_shared<Operation>(op);
+    operation->m_callbacks = callbacks;
+    return operation;
 }
 
 std::shared_ptr<Operation> Session::GetClass(const std::wstring& ns, const std::wstring& className)
 {
     MI_Class* miClass = nullptr;
     MI_Operation op;
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
     ::MI_Session_GetClass(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI, nullptr, ns.c_str(), className.c_str(), nullptr, &op);
     return std::make_shared<Operation>(op);
 }
@@ -903,10 +1461,13 @@ std::shared_ptr<Operation> Session::Subscribe(const std::wstring& ns, const std:
     MI_OperationCallbacks opCallbacks = GetMIOperationCallbacks(callbacks);
     MI_Operation op;
     // TODO: Add MI_SubscriptionDeliveryOptions for WinRM case
+    std::shared_lock<std::shared_timed_mutex> lock(this->m_mutex);
     ::MI_Session_Subscribe(&this->m_session, MI_OPERATIONFLAGS_DEFAULT_RTTI,
         operationOptions ? &operationOptions->m_operationOptions : nullptr,
         ns.c_str(), dialect.c_str(), query.c_str(), nullptr, callbacks ? &opCallbacks : nullptr, &op);
-    return std::make_shared<Operation>(op);
+    auto operation = std::make_shared<Operation>(op);
+    operation->m_callbacks = callbacks;
+    return operation;
 }
 
 void ScopedItem::RemoveFromScopeContext()
@@ -914,6 +1475,7 @@ void ScopedItem::RemoveFromScopeContext()
     if (this->m_scopeOwner)
     {
         this->m_scopeOwner->RemoveFromScopeContext(this);
+        this->m_scopeOwner = nullptr;
     }
 }
 
@@ -924,9 +1486,9 @@ ScopedItem::~ScopedItem()
 
 MI_Type Instance::GetElementType(const std::wstring& name) const
 {
-    MI_Type itemType;
-    MICheckResult(::MI_Instance_GetElement(this->m_instance, name.c_str(), nullptr, &itemType, nullptr, nullptr));
-    return itemType;
+    ValueElementRef element;
+    this->GetElement(name, element);
+    return element.m_type;
 }
 
 MI_Type Instance::GetElementType(unsigned index) const
@@ -938,7 +1500,15 @@ MI_Type Instance::GetElementType(unsigned index) const
 
 void Instance::SetElement(const std::wstring& name, const MIValue& value)
 {
-    MICheckResult(::MI_Instance_SetElement(this->m_instance, name.c_str(), &value.m_value, value.m_type, value.m_flags));
+    unsigned index = 0;
+    if (this->GetElementIndex(name, index))
+    {
+        MICheckResult(::MI_Instance_SetElementAt(this->m_instance, index, &value.m_value, value.m_type, value.m_flags));
+    }
+    else
+    {
+        MICheckResult(::MI_Instance_SetElement(this->m_instance, name.c_str(), &value.m_value, value.m_type, value.m_flags));
+    }
 }
 
 void Instance::SetElement(unsigned index, const MIValue& value)
@@ -965,78 +1535,109 @@ const std::vector<std::wstring>& Instance::GetKeyElementNames()
 {
     if (!this->m_keyElementNames)
     {
-        auto miClass = this->GetClass();
-        this->m_keyElementNames = miClass->GetKey();
+        auto entry = this->GetClassCacheEntry();
+        std::shared_ptr<const ClassMetadata> metadata;
+        {
+            std::lock_guard<std::mutex> lock(g_classCacheMutex);
+            metadata = entry->m_metadata;
+        }
+        if (!metadata)
+        {
+            // Only the first instance of a class needs to retrieve it
+            auto miClass = this->GetClass();
+            metadata = GetClassMetadata(*entry, *miClass);
+        }
+        this->m_keyElementNames = std::shared_ptr<const std::vector<std::wstring>>(metadata, &metadata->GetKey());
     }
 
     return *this->m_keyElementNames;
 }
 
-std::wstring Instance::GetPath()
+ClassCacheEntry* Instance::GetClassCacheEntry() const
 {
-    std::wstring ns = this->GetNameSpace();
-    std::wstring className = this->GetClassName();
-    std::wstring serverName = this->GetServerName();
+    if (!this->m_classCacheEntry)
+    {
+        this->m_classCacheEntry = ::GetClassCacheEntry(this->m_instance);
+    }
+    return this->m_classCacheEntry.get();
+}
 
-    if (!serverName.length())
+std::wstring Instance::GetPath()
+{
+    const MI_Char* serverName = nullptr;
+    const MI_Char* ns = nullptr;
+    const MI_Char* className = nullptr;
+    MICheckResult(::MI_Instance_GetServerName(this->m_instance, &serverName));
+    if (!serverName || !*serverName)
     {
         return L"";
     }
+    MICheckResult(::MI_Instance_GetNameSpace(this->m_instance, &ns));
+    MICheckResult(::MI_Instance_GetClassName(this->m_instance, &className));
 
-    std::replace(ns.begin(), ns.end(), L'/', L'\\');
-
-    std::wostringstream o;
-    o << L"\\\\" << serverName << L"\\" << ns << L":" << className << L".";
-
-    auto key = this->GetKeyElementNames();
+    auto const& key = this->GetKeyElementNames();
     if (key.empty())
     {
         throw Exception(L"Cannot get path of an instance without key elements");
     }
 
+    std::wstring path = L"\\\\";
+    path += serverName;
+    path += L"\\";
+    size_t nsStart = path.length();
+    path += ns ? ns : L"";
+    std::replace(path.begin() + nsStart, path.end(), L'/', L'\\');
+    path += L":";
+    path += className;
+    path += L".";
+
     bool isFirst = true;
     for (auto const &it : key)
     {
-        auto element = (*this)[it.c_str()];
+        ValueElementRef element;
+        this->GetElement(it, element);
         if (!isFirst)
         {
-            o << L",";
+            path += L",";
         }
-        o << it << L"=";
+        path += it;
+        path += L"=";
 
-        switch (element->m_type)
+        switch (element.m_type)
         {
         case MI_STRING:
             {
-                std::wstring value = element->m_value.string;
+                std::wstring value = element.m_value.string;
                 ReplaceAll(value, L"\\", L"\\\\");
                 ReplaceAll(value, L"\"", L"\\\"");
-                o << L"\"" << value << L"\"";
+                path += L"\"";
+                path += value;
+                path += L"\"";
             }
             break;
         case MI_UINT8:
-            o << element->m_value.uint8;
+            path += std::to_wstring(element.m_value.uint8);
             break;
         case MI_UINT16:
-            o << element->m_value.uint16;
+            path += std::to_wstring(element.m_value.uint16);
             break;
         case MI_UINT32:
-            o << element->m_value.uint32;
+            path += std::to_wstring(element.m_value.uint32);
             break;
         case MI_UINT64:
-            o << element->m_value.uint64;
+            path += std::to_wstring(element.m_value.uint64);
             break;
         case MI_SINT8:
-            o << element->m_value.sint8;
+            path += std::to_wstring(element.m_value.sint8);
             break;
         case MI_SINT16:
-            o << element->m_value.sint16;
+            path += std::to_wstring(element.m_value.sint16);
             break;
         case MI_SINT32:
-            o << element->m_value.sint32;
+            path += std::to_wstring(element.m_value.sint32);
             break;
         case MI_SINT64:
-            o << element->m_value.sint64;
+            path += std::to_wstring(element.m_value.sint64);
             break;
         default:
             throw Exception(L"Unsupported key type in path generation");
@@ -1044,18 +1645,113 @@ std::wstring Instance::GetPath()
 
         isFirst = false;
     }
-    return o.str();
+    return path;
 }
 
 std::shared_ptr<ValueElement> Instance::operator[] (const std::wstring& name) const
 {
+    ValueElementRef elementRef;
+    this->GetElement(name, elementRef);
+
     auto element = std::make_shared<ValueElement>();
-    MICheckResult(::MI_Instance_GetElement(this->m_instance, name.c_str(), &element->m_value, &element->m_type,
-        &element->m_flags, &element->m_index));
     element->m_name = name;
+    element->m_index = elementRef.m_index;
+    element->m_type = elementRef.m_type;
+    element->m_flags = elementRef.m_flags;
+    element->m_value = elementRef.m_value;
     return element;
 }
 
+ElementIndexTable* Instance::GetElementIndexTable() const
+{
+    return this->GetClassCacheEntry()->m_elementIndexTable.get();
+}
+
+std::shared_ptr<void> Instance::GetElementIndexData() const
+{
+    return this->GetElementIndexTable()->GetData();
+}
+
+std::shared_ptr<void> Instance::SetElementIndexData(const std::shared_ptr<void>& data) const
+{
+    return this->GetElementIndexTable()->SetData(data);
+}
+
+// Returns false if the name is not in the class index table or if the
+// cached index refers to a different element in this instance.
+bool Instance::GetElementIndex(const std::wstring& name, unsigned& index) const
+{
+    if (this->GetElementIndexTable()->Find(name, index))
+    {
+        const MI_Char* elementName = nullptr;
+        MI_Value value;
+        MI_Type type;
+        MI_Uint32 flags;
+        if (::MI_Instance_GetElementAt(this->m_instance, index, &elementName, &value, &type, &flags) == MI_RESULT_OK &&
+            ElementNameEquals(elementName, name.c_str()))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+MI_Result Instance::FindElement(const std::wstring& name, ValueElementRef& element) const
+{
+    auto table = this->GetElementIndexTable();
+    unsigned index = 0;
+    if (table->Find(name, index) &&
+        ::MI_Instance_GetElementAt(this->m_instance, index, &element.m_name, &element.m_value, &element.m_type,
+            &element.m_flags) == MI_RESULT_OK &&
+        ElementNameEquals(element.m_name, name.c_str()))
+    {
+        element.m_index = index;
+        return MI_RESULT_OK;
+    }
+
+    MI_Result result = ::MI_Instance_GetElement(this->m_instance, name.c_str(), nullptr, nullptr, nullptr, &index);
+    if (result == MI_RESULT_OK)
+    {
+        this->GetElement(index, element);
+        table->Add(name, index);
+    }
+    return result;
+}
+
+void Instance::GetElement(const std::wstring& name, ValueElementRef& element) const
+{
+    MICheckResult(this->FindElement(name, element));
+}
+
+bool Instance::TryGetElement(const std::wstring& name, ValueElementRef& element) const
+{
+    MI_Result result = this->FindElement(name, element);
+    if (result == MI_RESULT_NO_SUCH_PROPERTY || result == MI_RESULT_NOT_FOUND)
+    {
+        return false;
+    }
+    MICheckResult(result);
+    return true;
+}
+
+bool Instance::TryGetElementType(const std::wstring& name, MI_Type& type) const
+{
+    ValueElementRef element;
+    if (!this->TryGetElement(name, element))
+    {
+        return false;
+    }
+    type = element.m_type;
+    return true;
+}
+
+void Instance::GetElement(unsigned index, ValueElementRef& element) const
+{
+    MICheckResult(::MI_Instance_GetElementAt(this->m_instance, index, &element.m_name, &element.m_value,
+        &element.m_type, &element.m_flags));
+    element.m_index = index;
+}
+
 std::shared_ptr<ValueElement> Instance::operator[] (unsigned index) const
 {
     auto element = std::make_shared<ValueElement>();
@@ -1067,6 +1763,26 @@ std::shared_ptr<ValueElement> Instance::operator[] (unsigned index) const
     return element;
 }
 
+void Instance::GetAllElements(std::vector<ValueElementRef>& elements) const
+{
+    elements.resize(this->GetElementsCount());
+    elements.resize(this->GetAllElements(elements.data(), (unsigned)elements.size()));
+}
+
+unsigned Instance::GetAllElements(ValueElementRef* elements, unsigned count) const
+{
+    unsigned elementsCount = this->GetElementsCount();
+    if (elementsCount > count)
+    {
+        elementsCount = count;
+    }
+    for (unsigned i = 0; i < elementsCount; i++)
+    {
+        this->GetElement(i, elements[i]);
+    }
+    return elementsCount;
+}
+
 unsigned Instance::GetElementsCount() const
 {
     MI_Uint32 count = 0;
@@ -1080,7 +1796,9 @@ std::shared_ptr<Instance> Instance::Clone() const
     {
         MI_Instance* newInstance = nullptr;
         MICheckResult(::MI_Instance_Clone(this->m_instance, &newInstance));
-        return std::make_shared<Instance>(newInstance, true);
+        auto instance = std::make_shared<Instance>(newInstance, true);
+        instance->m_classCacheEntry = this->m_classCacheEntry;
+        return instance;
     }
 
     return nullptr;
@@ -1124,13 +1842,25 @@ void Instance::SetOutOfScope()
 {
     if (!this->m_ownsInstance)
     {
-        this->m_instance = nullptr;
+        MI_Instance* newInstance = nullptr;
+        if (this->m_retained && this->m_instance &&
+            ::MI_Instance_Clone(this->m_instance, &newInstance) == MI_RESULT_OK)
+        {
+            this->m_instance = newInstance;
+            this->m_ownsInstance = true;
+        }
+        else
+        {
+            this->m_instance = nullptr;
+        }
     }
     ScopedItem::SetOutOfScope();
 }
 
 Instance::~Instance()
 {
+    // Before anything else, the operation may set the result out of scope meanwhile
+    RemoveFromScopeContext();
     try
     {
         if (this->m_instance && this->m_ownsInstance)
@@ -1151,14 +1881,18 @@ void Operation::Cancel()
 
 void Operation::RemoveFromScopeContext(ScopedItem* item)
 {
+    std::lock_guard<std::mutex> lock(this->m_scopeMutex);
     if (item == this->m_currentItem)
     {
         this->m_currentItem = nullptr;
     }
 }
 
+// The previous result is released by MI when getting the next one, so it goes
+// out of scope before that, while it can still be cloned if it's retained
 void Operation::SetCurrentItem(ScopedItem* currentItem)
 {
+    std::lock_guard<std::mutex> lock(this->m_scopeMutex);
     if (this->m_currentItem)
     {
         this->m_currentItem->SetOutOfScope();
@@ -1175,6 +1909,7 @@ std::shared_ptr<Class> Operation::GetNextClass()
         const MI_Instance* compDetails = nullptr;
 
         const MI_Class* miClass = nullptr;
+        SetCurrentItem(nullptr);
         MICheckResult(::MI_Operation_GetClass(&this->m_operation, &miClass, &this->m_hasMoreResults, &miResult,
             &errMsg, &compDetails));
         MICheckResult(miResult, compDetails);
@@ -1198,13 +1933,16 @@ std::shared_ptr<Instance> Operation::GetNextInstance()
         const MI_Char* errMsg = nullptr;
         const MI_Instance* compDetails = nullptr;
         const MI_Instance* miInstance = nullptr;
+        SetCurrentItem(nullptr);
         MICheckResult(::MI_Operation_GetInstance(&this->m_operation, &miInstance, &this->m_hasMoreResults, &miResult,
             &errMsg, &compDetails));
         MICheckResult(miResult, compDetails);
 
         if (miInstance)
         {
+            this->m_classCacheEntry = ::GetClassCacheEntry(miInstance, this->m_classCacheEntry);
             Instance* instance = new Instance((MI_Instance*)miInstance, false, this);
+            instance->m_classCacheEntry = this->m_classCacheEntry;
             SetCurrentItem(instance);
             return std::shared_ptr<Instance>(instance);
         }
@@ -1221,6 +1959,7 @@ std::shared_ptr<Instance> Operation::GetNextIndication()
         const MI_Char* errMsg = nullptr;
         const MI_Instance* compDetails = nullptr;
         const MI_Instance* miInstance = nullptr;
+        SetCurrentItem(nullptr);
         // TODO: Add bookmark and machineID support
         MICheckResult(::MI_Operation_GetIndication(&this->m_operation, &miInstance, nullptr, nullptr, &this->m_hasMoreResults,
             &miResult, &errMsg, &compDetails));
@@ -1228,7 +1967,9 @@ std::shared_ptr<Instance> Operation::GetNextIndication()
 
         if (miInstance)
         {
+            this->m_classCacheEntry = ::GetClassCacheEntry(miInstance, this->m_classCacheEntry);
             Instance* instance = new Instance((MI_Instance*)miInstance, false, this);
+            instance->m_classCacheEntry = this->m_classCacheEntry;
             SetCurrentItem(instance);
             return std::shared_ptr<Instance>(instance);
         }
@@ -1237,48 +1978,82 @@ std::shared_ptr<Instance> Operation::GetNextIndication()
     return nullptr;
 }
 
-std::wstring Serializer::SerializeInstance(const Instance& instance, bool includeClass)
-{
-    MI_Uint32 flags = includeClass ? MI_SERIALIZER_FLAGS_INSTANCE_WITH_CLASS : 0;
-    MI_Uint32 bufferSizeNeeded = 0;
-    ::MI_Serializer_SerializeInstance(&m_serializer, flags, instance.m_instance, nullptr, 0, &bufferSizeNeeded);
+// Most instances and classes serialize to less than this
+#define INITIAL_SERIALIZER_BUFFER_SIZE (16 * 1024)
+// Larger buffers are released after use instead of being kept for the next call
+#define MAX_RETAINED_SERIALIZER_BUFFER_SIZE (1024 * 1024)
 
-    MI_Uint8* buffer = new MI_Uint8[bufferSizeNeeded];
-    try
+// Serializes into the reusable buffer, the size is probed only when the data
+// doesn't fit. Returns the size of the data. Called with m_mutex held.
+MI_Uint32 Serializer::SerializeToBuffer(const std::function<MI_Result(MI_Uint8*, MI_Uint32, MI_Uint32*)>& serialize)
+{
+    if (this->m_buffer.empty())
     {
-        MICheckResult(::MI_Serializer_SerializeInstance(&m_serializer, flags, instance.m_instance, buffer,
-            bufferSizeNeeded, &bufferSizeNeeded));
-        auto data = std::wstring((wchar_t*)buffer, bufferSizeNeeded / sizeof(wchar_t));
-        delete[] buffer;
-        return data;
+        this->m_buffer.resize(INITIAL_SERIALIZER_BUFFER_SIZE);
     }
-    catch (std::exception&)
+
+    MI_Uint32 bufferSizeNeeded = 0;
+    auto result = serialize(this->m_buffer.data(), (MI_Uint32)this->m_buffer.size(), &bufferSizeNeeded);
+    if (result != MI_RESULT_OK && bufferSizeNeeded > this->m_buffer.size())
     {
-        delete[] buffer;
-        throw;
+        this->m_buffer.resize(bufferSizeNeeded > this->m_buffer.size() * 2 ? bufferSizeNeeded : this->m_buffer.size() * 2);
+        result = serialize(this->m_buffer.data(), (MI_Uint32)this->m_buffer.size(), &bufferSizeNeeded);
     }
+    MICheckResult(result);
+    return bufferSizeNeeded;
 }
 
-std::wstring Serializer::SerializeClass(const Class& miClass, bool deep)
+void Serializer::ReleaseBuffer()
 {
-    MI_Uint32 flags = deep ? MI_SERIALIZER_FLAGS_CLASS_DEEP : 0;
-    MI_Uint32 bufferSizeNeeded = 0;
-    ::MI_Serializer_SerializeClass(&m_serializer, flags, miClass.m_class, nullptr, 0, &bufferSizeNeeded);
-
-    MI_Uint8* buffer = new MI_Uint8[bufferSizeNeeded];
-    try
+    if (this->m_buffer.size() > MAX_RETAINED_SERIALIZER_BUFFER_SIZE)
     {
-        MICheckResult(::MI_Serializer_SerializeClass(&m_serializer, flags, miClass.m_class, buffer, bufferSizeNeeded, &bufferSizeNeeded));
-        auto data = std::wstring((wchar_t*)buffer, bufferSizeNeeded / sizeof(wchar_t));
-        delete[] buffer;
-        return data;
+        std::vector<MI_Uint8>().swap(this->m_buffer);
     }
-    catch (std::exception&)
+}
+
+std::wstring Serializer::SerializeInstanceToString(const Instance& instance, bool includeClass)
+{
+    MI_Uint32 flags = includeClass ? MI_SERIALIZER_FLAGS_INSTANCE_WITH_CLASS : 0;
+    auto size = SerializeToBuffer([&](MI_Uint8* buffer, MI_Uint32 bufferLength, MI_Uint32* bufferSizeNeeded) {
+        return ::MI_Serializer_SerializeInstance(&this->m_serializer, flags, instance.m_instance, buffer,
+            bufferLength, bufferSizeNeeded);
+    });
+    return std::wstring((wchar_t*)this->m_buffer.data(), size / sizeof(wchar_t));
+}
+
+std::wstring Serializer::SerializeInstance(const Instance& instance, bool includeClass)
+{
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    auto data = SerializeInstanceToString(instance, includeClass);
+    ReleaseBuffer();
+    return data;
+}
+
+std::vector<std::wstring> Serializer::SerializeInstances(const std::vector<std::shared_ptr<const Instance>>& instances,
+    bool includeClass)
+{
+    std::vector<std::wstring> data;
+    data.reserve(instances.size());
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    for (auto const& instance : instances)
     {
-        delete[] buffer;
-        throw;
+        data.push_back(SerializeInstanceToString(*instance, includeClass));
     }
+    ReleaseBuffer();
+    return data;
+}
 
+std::wstring Serializer::SerializeClass(const Class& miClass, bool deep)
+{
+    MI_Uint32 flags = deep ? MI_SERIALIZER_FLAGS_CLASS_DEEP : 0;
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    auto size = SerializeToBuffer([&](MI_Uint8* buffer, MI_Uint32 bufferLength, MI_Uint32* bufferSizeNeeded) {
+        return ::MI_Serializer_SerializeClass(&this->m_serializer, flags, miClass.m_class, buffer,
+            bufferLength, bufferSizeNeeded);
+    });
+    auto data = std::wstring((wchar_t*)this->m_buffer.data(), size / sizeof(wchar_t));
+    ReleaseBuffer();
+    return data;
 }
 
 bool Serializer::IsClosed()
@@ -1308,3 +2083,70 @@ Serializer::~Serializer()
         // Ignore
     }
 }
+
+std::shared_ptr<Class> Deserializer::DeserializeClass(const MI_Uint8* data, MI_Uint32 size, const std::wstring& ns,
+    const std::wstring& serverName)
+{
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    std::shared_ptr<Class> miClass;
+    MI_Uint32 offset = 0;
+    while (offset < size)
+    {
+        MI_Class* deserializedClass = nullptr;
+        MI_Instance* extError = nullptr;
+        MI_Uint32 read = 0;
+        MICheckResult(::MI_Deserializer_DeserializeClass(&this->m_deserializer, 0, const_cast<MI_Uint8*>(data) + offset,
+            size - offset, miClass ? miClass->m_class : nullptr, serverName.length() ? serverName.c_str() : nullptr,
+            ns.length() ? ns.c_str() : nullptr, nullptr, nullptr, &read, &deserializedClass, &extError), extError);
+
+        auto parentClass = miClass;
+        miClass = std::make_shared<Class>(deserializedClass, true);
+        miClass->m_parentClass = parentClass;
+        if (!read)
+        {
+            break;
+        }
+        offset += read;
+    }
+
+    if (!miClass)
+    {
+        throw MIException(MI_RESULT_INVALID_PARAMETER);
+    }
+    return miClass;
+}
+
+std::shared_ptr<Class> Deserializer::DeserializeClass(const std::wstring& data, const std::wstring& ns,
+    const std::wstring& serverName)
+{
+    return DeserializeClass((const MI_Uint8*)data.c_str(), (MI_Uint32)(data.length() * sizeof(wchar_t)), ns,
+        serverName);
+}
+
+bool Deserializer::IsClosed()
+{
+    MI_Deserializer nullDeserializer;
+    ZeroMemory(&nullDeserializer, sizeof(MI_Deserializer));
+    return memcmp(&this->m_deserializer, &nullDeserializer, sizeof(MI_Deserializer)) == 0;
+}
+
+void Deserializer::Close()
+{
+    MICheckResult(::MI_Deserializer_Close(&m_deserializer));
+    ZeroMemory(&this->m_deserializer, sizeof(MI_Deserializer));
+}
+
+Deserializer::~Deserializer()
+{
+    try
+    {
+        if (!this->IsClosed())
+        {
+            this->Close();
+        }
+    }
+    catch (std::exception&)
+    {
+        // Ignore
+    }
+}
@@ -6,6 +6,9 @@
 #include <map>
 #include <vector>
 #include <memory>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
 #include "MIValue.h"
 
 namespace MI
@@ -15,8 +18,12 @@ namespace MI
     class Operation;
     class Class;
     class Serializer;
+    class Deserializer;
     class OperationOptions;
     class DestinationOptions;
+    class SessionPool;
+    class ElementIndexTable;
+    struct ClassCacheEntry;
 
     class Callbacks
     {
@@ -76,6 +83,7 @@ namespace MI
         std::shared_ptr<OperationOptions> NewOperationOptions();
         std::shared_ptr<DestinationOptions> NewDestinationOptions();
         std::shared_ptr<Serializer> NewSerializer();
+        std::shared_ptr<Deserializer> NewDeserializer();
     };
 
     class OperationOptions
@@ -104,10 +112,15 @@ namespace MI
     {
     private:
         MI_DestinationOptions m_destinationOptions;
+        // The options and credentials set so far, compared by the session pool. Passwords
+        // are kept as well, as sessions must not be shared among different credentials
+        std::map<std::wstring, std::wstring> m_options;
+        std::vector<std::vector<std::wstring>> m_credentials;
         DestinationOptions(MI_DestinationOptions destinationOptions) : m_destinationOptions(destinationOptions) {}
         DestinationOptions(const DestinationOptions &obj) {}
 
         friend Application;
+        friend SessionPool;
 
     public:
         std::shared_ptr<DestinationOptions> Clone() const;
@@ -129,6 +142,8 @@ namespace MI
     {
     private:
         MI_Session m_session;
+        // Operations are started concurrently, only Close needs exclusive access to the handle
+        std::shared_timed_mutex m_mutex;
         Session(MI_Session session) : m_session(session) {}
         Session(const Session &obj) {}
 
@@ -137,41 +152,79 @@ namespace MI
     public:
         std::shared_ptr<Operation> ExecQuery(const std::wstring& ns, const std::wstring& query,
                                              const std::wstring& dialect = L"WQL",
-                                             std::shared_ptr<OperationOptions> operationOptions = nullptr);
+                                             std::shared_ptr<OperationOptions> operationOptions = nullptr,
+                                             std::shared_ptr<Callbacks> callbacks = nullptr);
         std::shared_ptr<Operation> InvokeMethod(
             Instance& instance, const std::wstring& methodName, std::shared_ptr<const Instance> inboundParams,
-            std::shared_ptr<OperationOptions> operationOptions = nullptr);
+            std::shared_ptr<OperationOptions> operationOptions = nullptr, std::shared_ptr<Callbacks> callbacks = nullptr);
         std::shared_ptr<Operation> InvokeMethod(
             const std::wstring& ns, const std::wstring& className, const std::wstring& methodName, std::shared_ptr<const Instance>,
-            std::shared_ptr<OperationOptions> operationOptions = nullptr);
+            std::shared_ptr<OperationOptions> operationOptions = nullptr, std::shared_ptr<Callbacks> callbacks = nullptr);
         void CreateInstance(const std::wstring& ns, const Instance& instance,
             std::shared_ptr<OperationOptions> operationOptions = nullptr);
         void ModifyInstance(const std::wstring& ns, const Instance& instance,
             std::shared_ptr<OperationOptions> operationOptions = nullptr);
         void DeleteInstance(const std::wstring& ns, const Instance& instance,
                             std::shared_ptr<OperationOptions> operationOptions = nullptr);
+        // Start the write and return without waiting for it, the returned operation
+        // completes with the write and GetNextInstance throws if it failed
+        std::shared_ptr<Operation> CreateInstanceAsync(const std::wstring& ns, std::shared_ptr<const Instance> instance,
+            std::shared_ptr<OperationOptions> operationOptions = nullptr, std::shared_ptr<Callbacks> callbacks = nullptr);
+        std::shared_ptr<Operation> ModifyInstanceAsync(const std::wstring& ns, std::shared_ptr<const Instance> instance,
+            std::shared_ptr<OperationOptions> operationOptions = nullptr, std::shared_ptr<Callbacks> callbacks = nullptr);
+        std::shared_ptr<Operation> DeleteInstanceAsync(const std::wstring& ns, std::shared_ptr<const Instance> instance,
+            std::shared_ptr<OperationOptions> operationOptions = nullptr, std::shared_ptr<Callbacks> callbacks = nullptr);
         std::shared_ptr<Operation> GetClass(const std::wstring& ns, const std::wstring& className);
-        std::shared_ptr<Operation> GetInstance(const std::wstring& ns, const Instance& keyInstance);
+        std::shared_ptr<Operation> GetInstance(const std::wstring& ns, const Instance& keyInstance,
+            std::shared_ptr<Callbacks> callbacks = nullptr);
         std::shared_ptr<Operation> GetAssociators(const std::wstring& ns, const Instance& instance, const std::wstring& assocClass = L"",
             const std::wstring& resultClass = L"", const std::wstring& role = L"",
             const std::wstring& resultRole = L"", bool keysOnly = false,
-            std::shared_ptr<OperationOptions> operationOptions = nullptr);
+            std::shared_ptr<OperationOptions> operationOptions = nullptr,
+            std::shared_ptr<Callbacks> callbacks = nullptr);
         std::shared_ptr<Operation> Subscribe(const std::wstring& ns, const std::wstring& query, std::shared_ptr<Callbacks> callback = nullptr,
             std::shared_ptr<OperationOptions> operationOptions = nullptr, const std::wstring& dialect = L"WQL");
+        // Throws if the destination can't be reached with this session
+        void TestConnection();
         void Close();
         bool IsClosed();
         virtual ~Session();
     };
 
+    // The name and the value are owned by the class the qualifier belongs to.
     struct Qualifier
     {
     public:
-        std::wstring m_name;
+        const MI_Char* m_name;
         MI_Type m_type;
         MI_Value m_value;
         MI_Uint32 m_flags;
     };
 
+    // Lazy view over the qualifiers of a class element, method or parameter.
+    // Lookups by name don't decode the set, enumerating it decodes it once
+    // into a flat vector sorted by name. Valid as long as the class is.
+    class QualifierSet
+    {
+    private:
+        MI_QualifierSet m_qualifierSet;
+        mutable std::vector<Qualifier> m_qualifiers;
+        mutable bool m_decoded = false;
+
+        void Decode() const;
+
+    public:
+        QualifierSet();
+        QualifierSet(const MI_QualifierSet& qualifierSet) : m_qualifierSet(qualifierSet) {}
+        unsigned GetCount() const;
+        // Case insensitive
+        bool Find(const MI_Char* name, Qualifier& qualifier) const;
+        bool Contains(const MI_Char* name) const;
+        const std::vector<Qualifier>& GetQualifiers() const;
+        std::vector<Qualifier>::const_iterator begin() const { return this->GetQualifiers().begin(); }
+        std::vector<Qualifier>::const_iterator end() const { return this->GetQualifiers().end(); }
+    };
+
     struct BaseElementInfo
     {
     public:
@@ -183,7 +236,7 @@ namespace MI
     struct ParameterInfo : public BaseElementInfo
     {
     public:
-        std::map<std::wstring, std::shared_ptr<Qualifier>> m_qualifiers;
+        QualifierSet m_qualifiers;
     };
 
     struct MethodInfo
@@ -191,7 +244,7 @@ namespace MI
     public:
         std::wstring m_name;
         unsigned m_index;
-        std::map<std::wstring, std::shared_ptr<Qualifier>> m_qualifiers;
+        QualifierSet m_qualifiers;
         std::map<std::wstring, std::shared_ptr<ParameterInfo>> m_parameters;
     };
 
@@ -207,11 +260,90 @@ namespace MI
         MI_Value m_value;
     };
 
+    // Lightweight element view filled by Instance::GetAllElements. The name
+    // and the value are owned by the instance and remain valid until it is
+    // modified or released.
+    struct ValueElementRef
+    {
+    public:
+        const MI_Char* m_name;
+        unsigned m_index;
+        MI_Type m_type;
+        MI_Uint32 m_flags;
+        MI_Value m_value;
+    };
+
     struct ClassElement : public ValueElement
     {
     public:
         MI_Boolean m_valueExists;
-        std::map<std::wstring, std::shared_ptr<Qualifier>> m_qualifiers;
+        QualifierSet m_qualifiers;
+    };
+
+    struct ParameterSignature
+    {
+    public:
+        std::wstring m_name;
+        unsigned m_index;
+        MI_Type m_type;
+        bool m_in;
+        bool m_out;
+    };
+
+    struct MethodSignature
+    {
+    public:
+        std::wstring m_name;
+        unsigned m_index;
+        MI_Type m_returnType;
+        bool m_static;
+        std::vector<ParameterSignature> m_parameters;
+    };
+
+    // Schema information of a class. Unlike Class it owns its data, so it can
+    // be shared by the instances of the class and outlive the operation the
+    // class was retrieved with.
+    class ClassMetadata
+    {
+    private:
+        std::wstring m_serverName;
+        std::wstring m_nameSpace;
+        std::wstring m_className;
+        // Nearest parent first
+        std::vector<std::wstring> m_parentClassNames;
+        std::vector<std::wstring> m_key;
+        std::vector<BaseElementInfoWithFlags> m_elements;
+        std::vector<MethodSignature> m_methods;
+
+    public:
+        ClassMetadata(const Class& miClass);
+        const std::wstring& GetServerName() const { return this->m_serverName; }
+        const std::wstring& GetNameSpace() const { return this->m_nameSpace; }
+        const std::wstring& GetClassName() const { return this->m_className; }
+        const std::vector<std::wstring>& GetParentClassNames() const { return this->m_parentClassNames; }
+        const std::vector<std::wstring>& GetKey() const { return this->m_key; }
+        const std::vector<BaseElementInfoWithFlags>& GetElements() const { return this->m_elements; }
+        const std::vector<MethodSignature>& GetMethods() const { return this->m_methods; }
+        // Case insensitive, return nullptr if not found
+        const BaseElementInfoWithFlags* FindElement(const std::wstring& name) const;
+        const MethodSignature* FindMethod(const std::wstring& name) const;
+        bool IsA(const std::wstring& className) const;
+    };
+
+    // Process wide cache of class metadata and element index tables, keyed by
+    // server, namespace and class name. Entries are not refreshed when a class
+    // definition changes on the server, use Invalidate.
+    class ClassCache
+    {
+    public:
+        // Builds and caches the metadata on first use
+        static std::shared_ptr<const ClassMetadata> GetMetadata(const Class& miClass);
+        // Returns nullptr if the metadata is not cached
+        static std::shared_ptr<const ClassMetadata> FindMetadata(const std::wstring& serverName,
+            const std::wstring& ns, const std::wstring& className);
+        // Empty arguments match any server, namespace or class
+        static void Invalidate(const std::wstring& serverName = L"", const std::wstring& ns = L"",
+            const std::wstring& className = L"");
     };
 
     class ScopedItem;
@@ -238,7 +370,9 @@ namespace MI
     private:
         MI_Class* m_class = nullptr;
         bool m_ownsInstance = false;
-        std::shared_ptr<std::vector<std::wstring>> m_key = nullptr;
+        std::shared_ptr<const std::vector<std::wstring>> m_key = nullptr;
+        // The parent a deserialized class was built on, kept as long as the class
+        std::shared_ptr<Class> m_parentClass = nullptr;
 
         Class(const Class &obj) : ScopedItem(nullptr) {} // Use Clone
 
@@ -246,6 +380,9 @@ namespace MI
         friend Instance;
         friend Operation;
         friend Serializer;
+        friend Deserializer;
+        friend ClassMetadata;
+        friend ClassCache;
 
     public:
         Class(MI_Class* miClass, bool ownsInstance, ScopeContextOwner* scopeOwner = nullptr) :
@@ -257,6 +394,9 @@ namespace MI
         unsigned GetMethodCount() const;
         std::shared_ptr<MethodInfo> GetMethodInfo(const std::wstring& name) const;
         std::shared_ptr<MethodInfo> GetMethodInfo(unsigned index) const;
+        // Return false instead of throwing if the method doesn't exist
+        bool TryGetMethodInfo(const std::wstring& name, std::shared_ptr<MethodInfo>& info) const;
+        bool HasMethod(const std::wstring& name) const;
         std::wstring GetClassName() const;
         std::wstring GetNameSpace() const;
         std::wstring GetServerName() const;
@@ -273,20 +413,29 @@ namespace MI
     private:
         MI_Instance* m_instance = nullptr;
         bool m_ownsInstance = false;
+        // Cloned instead of invalidated when going out of scope
+        bool m_retained = false;
         std::shared_ptr<const std::vector<std::wstring>> m_keyElementNames = nullptr;
+        mutable std::shared_ptr<ClassCacheEntry> m_classCacheEntry = nullptr;
 
         Instance(const Instance &obj) : ScopedItem(nullptr) {} // Use Clone
         const std::vector<std::wstring>& GetKeyElementNames();
+        ClassCacheEntry* GetClassCacheEntry() const;
+        bool GetElementIndex(const std::wstring& name, unsigned& index) const;
+        MI_Result FindElement(const std::wstring& name, ValueElementRef& element) const;
 
         friend Application;
         friend Operation;
         friend Session;
         friend Serializer;
+        friend class JsonSerializer;
 
     public:
         Instance(MI_Instance* instance, bool ownsInstance, ScopeContextOwner* scopeOwner = nullptr) :
             m_instance(instance), m_ownsInstance(ownsInstance), ScopedItem(scopeOwner) {}
         MI_Instance* GetMIObject() { return this->m_instance; }
+        // False for the results of an operation, valid only while in its scope
+        bool OwnsInstance() const { return this->m_ownsInstance; }
         std::shared_ptr<Instance> Clone() const;
         std::shared_ptr<Class> GetClass() const;
         std::wstring GetClassName() const;
@@ -296,6 +445,20 @@ namespace MI
         std::wstring GetPath();
         std::shared_ptr<ValueElement> operator[] (const std::wstring& name) const;
         std::shared_ptr<ValueElement> operator[] (unsigned index) const;
+        void GetElement(const std::wstring& name, ValueElementRef& element) const;
+        void GetElement(unsigned index, ValueElementRef& element) const;
+        // Return false instead of throwing if the element doesn't exist
+        bool TryGetElement(const std::wstring& name, ValueElementRef& element) const;
+        bool TryGetElementType(const std::wstring& name, MI_Type& type) const;
+        // Name to element index table shared by the instances of this class
+        ElementIndexTable* GetElementIndexTable() const;
+        // Caller data kept with the element index table and released along with it,
+        // Set returns the data already set, if any
+        std::shared_ptr<void> GetElementIndexData() const;
+        std::shared_ptr<void> SetElementIndexData(const std::shared_ptr<void>& data) const;
+        void GetAllElements(std::vector<ValueElementRef>& elements) const;
+        // Fills up to "count" elements, returns the number of elements filled
+        unsigned GetAllElements(ValueElementRef* elements, unsigned count) const;
         void AddElement(const std::wstring& name, const MIValue& value);
         void SetElement(const std::wstring& name, const MIValue& value);
         void SetElement(unsigned index, const MIValue& value);
@@ -303,6 +466,10 @@ namespace MI
         MI_Type GetElementType(unsigned index) const;
         void ClearElement(const std::wstring& name);
         void ClearElement(unsigned index);
+        // Keeps a result valid once its operation moves on or is closed, by cloning
+        // it at that point. The results which are not retained are invalidated.
+        void Retain() { this->m_retained = true; }
+        bool IsRetained() const { return this->m_retained; }
         void SetOutOfScope();
         void Delete();
         virtual ~Instance();
@@ -314,7 +481,15 @@ namespace MI
         MI_Operation m_operation;
         MI_Boolean m_hasMoreResults = TRUE;
         bool m_ownsInstance = false;
+        // Results can be released from any thread, guarded by m_scopeMutex
         ScopedItem* m_currentItem = nullptr;
+        std::mutex m_scopeMutex;
+        // Results are usually of the same class, saves a class cache lookup per result
+        std::shared_ptr<ClassCacheEntry> m_classCacheEntry = nullptr;
+        // Results are pushed to the callbacks until the operation is closed
+        std::shared_ptr<Callbacks> m_callbacks = nullptr;
+        // The instance written by the operation, kept until the operation is released
+        std::shared_ptr<const Instance> m_inboundInstance = nullptr;
 
         Operation(const Operation &obj) {}
         void RemoveFromScopeContext(ScopedItem* item);
@@ -338,16 +513,47 @@ namespace MI
     {
     private:
         MI_Serializer m_serializer;
+        // Output buffer reused across calls, grown when the data doesn't fit
+        std::vector<MI_Uint8> m_buffer;
+        std::mutex m_mutex;
         Serializer(const Serializer &obj) {} // Use Clone
         Serializer(MI_Serializer& serializer) : m_serializer(serializer) {}
 
+        MI_Uint32 SerializeToBuffer(const std::function<MI_Result(MI_Uint8*, MI_Uint32, MI_Uint32*)>& serialize);
+        std::wstring SerializeInstanceToString(const Instance& instance, bool includeClass);
+        void ReleaseBuffer();
+
         friend Application;
 
     public:
         std::wstring SerializeInstance(const Instance& instance, bool includeClass=false);
+        std::vector<std::wstring> SerializeInstances(const std::vector<std::shared_ptr<const Instance>>& instances,
+            bool includeClass=false);
         std::wstring SerializeClass(const Class& miClass, bool deep=false);
         void Close();
         bool IsClosed();
         virtual ~Serializer();
     };
+
+    class Deserializer
+    {
+    private:
+        MI_Deserializer m_deserializer;
+        std::mutex m_mutex;
+        Deserializer(const Deserializer &obj) = delete;
+        Deserializer(MI_Deserializer& deserializer) : m_deserializer(deserializer) {}
+
+        friend Application;
+
+    public:
+        // Reads the classes written by Serializer::SerializeClass, parents first
+        // when "deep" was set, and returns the last one
+        std::shared_ptr<Class> DeserializeClass(const MI_Uint8* data, MI_Uint32 size, const std::wstring& ns = L"",
+            const std::wstring& serverName = L"");
+        std::shared_ptr<Class> DeserializeClass(const std::wstring& data, const std::wstring& ns = L"",
+            const std::wstring& serverName = L"");
+        void Close();
+        bool IsClosed();
+        virtual ~Deserializer();
+    };
 };
@@ -0,0 +1,588 @@
+#include "stdafx.h"
+#include "MIClassSchemaCache.h"
+#include "MIExceptions.h"
+#include <algorithm>
+#include <cstring>
+#ifndef _WIN32
+#include <codecvt>
+#include <fcntl.h>
+#include <locale>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace MI;
+
+#define CLASS_SCHEMA_CACHE_MAGIC "MICLSCHM"
+#define CLASS_SCHEMA_CACHE_FORMAT_VERSION 1
+
+// The file starts with a FileHeader and the schema version, followed by the
+// entries: an EntryHeader, the server, namespace and class names and the
+// serialized class. Names are stored as wchar_t, whose size is part of the format.
+struct FileHeader
+{
+    char m_magic[8];
+    MI_Uint32 m_formatVersion;
+    MI_Uint32 m_charSize;
+    MI_Uint32 m_schemaVersionLength;
+    MI_Uint32 m_entryCount;
+};
+
+struct EntryHeader
+{
+    MI_Uint64 m_timestamp;
+    MI_Uint32 m_serverNameLength;
+    MI_Uint32 m_nameSpaceLength;
+    MI_Uint32 m_classNameLength;
+    MI_Uint32 m_size;
+    MI_Uint32 m_checksum;
+    MI_Uint32 m_reserved;
+};
+
+class ClassSchemaCache::MappedFile
+{
+private:
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = NULL;
+#endif
+    const MI_Uint8* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_offset = 0;
+
+public:
+    // Returns false if the file doesn't exist or can't be mapped
+    bool Open(const std::wstring& path)
+    {
+#ifdef _WIN32
+        this->m_file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        LARGE_INTEGER size;
+        if (this->m_file == INVALID_HANDLE_VALUE || !::GetFileSizeEx(this->m_file, &size) || !size.QuadPart)
+        {
+            return false;
+        }
+        this->m_mapping = ::CreateFileMappingW(this->m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!this->m_mapping)
+        {
+            return false;
+        }
+        this->m_data = (const MI_Uint8*)::MapViewOfFile(this->m_mapping, FILE_MAP_READ, 0, 0, 0);
+        this->m_size = (size_t)size.QuadPart;
+#else
+        std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t> cv;
+        int fd = ::open(cv.to_bytes(path).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (!::fstat(fd, &st) && st.st_size)
+        {
+            void* data = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                this->m_data = (const MI_Uint8*)data;
+                this->m_size = (size_t)st.st_size;
+            }
+        }
+        ::close(fd);
+#endif
+        return this->m_data != nullptr;
+    }
+
+    const MI_Uint8* GetData() const
+    {
+        return this->m_data;
+    }
+
+    size_t GetSize() const
+    {
+        return this->m_size;
+    }
+
+    // Returns a pointer to the next "size" bytes, or nullptr past the end of the file
+    const MI_Uint8* ReadBytes(size_t size)
+    {
+        if (this->m_size - this->m_offset < size)
+        {
+            return nullptr;
+        }
+        auto data = this->m_data + this->m_offset;
+        this->m_offset += size;
+        return data;
+    }
+
+    template<typename T> bool Read(T& value)
+    {
+        auto data = ReadBytes(sizeof(T));
+        if (data)
+        {
+            memcpy(&value, data, sizeof(T));
+        }
+        return data != nullptr;
+    }
+
+    bool ReadString(MI_Uint32 length, std::wstring& value)
+    {
+        auto data = ReadBytes(length * sizeof(wchar_t));
+        if (data)
+        {
+            value.resize(length);
+            memcpy(&value[0], data, length * sizeof(wchar_t));
+        }
+        return data != nullptr;
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (this->m_data)
+        {
+            ::UnmapViewOfFile(this->m_data);
+        }
+        if (this->m_mapping)
+        {
+            ::CloseHandle(this->m_mapping);
+        }
+        if (this->m_file != INVALID_HANDLE_VALUE)
+        {
+            ::CloseHandle(this->m_file);
+        }
+#else
+        if (this->m_data)
+        {
+            ::munmap((void*)this->m_data, this->m_size);
+        }
+#endif
+    }
+};
+
+// FNV-1a, to detect truncated or otherwise damaged entries
+static MI_Uint32 Checksum(const MI_Uint8* data, size_t size)
+{
+    MI_Uint32 hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static MI_Uint64 GetTimestamp()
+{
+    return (MI_Uint64)std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static std::wstring Normalize(std::wstring name)
+{
+    std::transform(name.begin(), name.end(), name.begin(), ::towlower);
+    std::replace(name.begin(), name.end(), L'\\', L'/');
+    return name;
+}
+
+static std::wstring GetKey(const std::wstring& serverName, const std::wstring& ns, const std::wstring& className)
+{
+    return serverName + L"|" + ns + L":" + className;
+}
+
+static void Append(std::vector<MI_Uint8>& buffer, const void* data, size_t size)
+{
+    buffer.insert(buffer.end(), (const MI_Uint8*)data, (const MI_Uint8*)data + size);
+}
+
+static void Append(std::vector<MI_Uint8>& buffer, const std::wstring& value)
+{
+    Append(buffer, value.c_str(), value.length() * sizeof(wchar_t));
+}
+
+// Writes a temporary file and renames it, readers never see a partial file
+static void WriteCacheFile(const std::wstring& path, const std::vector<MI_Uint8>& data)
+{
+#ifdef _WIN32
+    auto tempPath = path + L"." + std::to_wstring(::GetCurrentProcessId()) + L".tmp";
+    HANDLE file = ::CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    bool written = file != INVALID_HANDLE_VALUE;
+    size_t offset = 0;
+    while (written && offset < data.size())
+    {
+        DWORD size = 0;
+        written = ::WriteFile(file, data.data() + offset, (DWORD)(data.size() - offset), &size, NULL) != FALSE;
+        offset += size;
+    }
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        ::CloseHandle(file);
+    }
+    if (!written || !::MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        ::DeleteFileW(tempPath.c_str());
+        throw Exception(L"Cannot write the class schema cache file: " + path);
+    }
+#else
+    std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t> cv;
+    auto filePath = cv.to_bytes(path);
+    auto tempPath = filePath + "." + std::to_string(::getpid()) + ".tmp";
+    int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool written = fd >= 0;
+    size_t offset = 0;
+    while (written && offset < data.size())
+    {
+        ssize_t size = ::write(fd, data.data() + offset, data.size() - offset);
+        written = size > 0;
+        offset += written ? (size_t)size : 0;
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+    if (!written || ::rename(tempPath.c_str(), filePath.c_str()))
+    {
+        ::unlink(tempPath.c_str());
+        throw Exception(L"Cannot write the class schema cache file: " + path);
+    }
+#endif
+}
+
+ClassSchemaCache::ClassSchemaCache(std::shared_ptr<Application> app, const std::wstring& path,
+    const std::wstring& schemaVersion, std::chrono::seconds maxAge) :
+    m_app(app), m_path(path), m_schemaVersion(schemaVersion), m_maxAge(maxAge)
+{
+    this->m_serializer = app->NewSerializer();
+    this->m_deserializer = app->NewDeserializer();
+    if (!Load())
+    {
+        // Stale or damaged, the file is replaced on Save
+        this->m_entries.clear();
+        this->m_file.reset();
+        this->m_modified = true;
+    }
+}
+
+// Returns false if the file exists but can't be used
+bool ClassSchemaCache::Load()
+{
+    this->m_file.reset(new MappedFile());
+    if (!this->m_file->Open(this->m_path))
+    {
+        this->m_file.reset();
+        return true;
+    }
+
+    std::vector<Entry> entries;
+    if (!ReadEntries(*this->m_file, entries))
+    {
+        return false;
+    }
+    for (auto& entry : entries)
+    {
+        auto key = GetKey(entry.m_serverName, entry.m_nameSpace, entry.m_className);
+        this->m_entries[key] = std::move(entry);
+    }
+    return true;
+}
+
+// Returns false if the file is stale or damaged, the entries refer to the mapped file
+bool ClassSchemaCache::ReadEntries(MappedFile& file, std::vector<Entry>& entries) const
+{
+    FileHeader header;
+    std::wstring schemaVersion;
+    if (!file.Read(header) ||
+        memcmp(header.m_magic, CLASS_SCHEMA_CACHE_MAGIC, sizeof(header.m_magic)) ||
+        header.m_formatVersion != CLASS_SCHEMA_CACHE_FORMAT_VERSION ||
+        header.m_charSize != sizeof(wchar_t) ||
+        !file.ReadString(header.m_schemaVersionLength, schemaVersion) ||
+        schemaVersion != this->m_schemaVersion)
+    {
+        return false;
+    }
+
+    for (MI_Uint32 i = 0; i < header.m_entryCount; i++)
+    {
+        EntryHeader entryHeader;
+        Entry entry;
+        if (!file.Read(entryHeader) ||
+            !file.ReadString(entryHeader.m_serverNameLength, entry.m_serverName) ||
+            !file.ReadString(entryHeader.m_nameSpaceLength, entry.m_nameSpace) ||
+            !file.ReadString(entryHeader.m_classNameLength, entry.m_className) ||
+            !(entry.m_mappedData = file.ReadBytes(entryHeader.m_size)))
+        {
+            return false;
+        }
+        entry.m_timestamp = entryHeader.m_timestamp;
+        entry.m_size = entryHeader.m_size;
+        entry.m_checksum = entryHeader.m_checksum;
+        entries.push_back(std::move(entry));
+    }
+    return true;
+}
+
+// Takes the entries of "file" newer than the cached ones and than their removal
+void ClassSchemaCache::Merge(MappedFile& file)
+{
+    std::vector<Entry> entries;
+    if (!ReadEntries(file, entries))
+    {
+        return;
+    }
+
+    auto now = GetTimestamp();
+    for (auto& entry : entries)
+    {
+        auto key = GetKey(entry.m_serverName, entry.m_nameSpace, entry.m_className);
+        auto removed = this->m_removed.find(key);
+        if (IsExpired(entry, now) || (removed != this->m_removed.end() && removed->second >= entry.m_timestamp))
+        {
+            continue;
+        }
+        auto it = this->m_entries.find(key);
+        if (it == this->m_entries.end() || it->second.m_timestamp < entry.m_timestamp)
+        {
+            this->m_entries[key] = std::move(entry);
+        }
+    }
+}
+
+bool ClassSchemaCache::IsExpired(const Entry& entry, MI_Uint64 now) const
+{
+    return this->m_maxAge.count() && now - entry.m_timestamp > (MI_Uint64)this->m_maxAge.count();
+}
+
+// Deserializes the class on first use, dropping the entries which can't be used
+std::shared_ptr<Class> ClassSchemaCache::GetCachedClass(const std::wstring& key, const std::wstring& serverName,
+    const std::wstring& ns)
+{
+    auto it = this->m_entries.find(key);
+    if (it == this->m_entries.end())
+    {
+        return nullptr;
+    }
+
+    auto& entry = it->second;
+    bool expired = IsExpired(entry, GetTimestamp());
+    if (!expired && !entry.m_class)
+    {
+        auto data = entry.m_mappedData ? entry.m_mappedData : entry.m_data.data();
+        if (Checksum(data, entry.m_size) == entry.m_checksum)
+        {
+            try
+            {
+                entry.m_class = this->m_deserializer->DeserializeClass(data, entry.m_size, ns, serverName);
+            }
+            catch (std::exception&)
+            {
+                // Written by an incompatible MI version
+            }
+        }
+    }
+
+    if (expired || !entry.m_class)
+    {
+        this->m_removed[key] = GetTimestamp();
+        this->m_entries.erase(it);
+        this->m_modified = true;
+        return nullptr;
+    }
+    return entry.m_class;
+}
+
+std::shared_ptr<Class> ClassSchemaCache::GetClass(std::shared_ptr<Session> session, const std::wstring& serverName,
+    const std::wstring& ns, const std::wstring& className)
+{
+    Entry entry;
+    entry.m_serverName = Normalize(serverName);
+    entry.m_nameSpace = Normalize(ns);
+    entry.m_className = Normalize(className);
+    auto key = GetKey(entry.m_serverName, entry.m_nameSpace, entry.m_className);
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        auto miClass = GetCachedClass(key, serverName, ns);
+        if (miClass)
+        {
+            return miClass->Clone();
+        }
+    }
+
+    // Not holding the lock during the round trip
+    std::shared_ptr<Class> miClass;
+    {
+        auto operation = session->GetClass(ns, className);
+        auto operationClass = operation->GetNextClass();
+        if (!operationClass)
+        {
+            throw MIException(MI_RESULT_NOT_FOUND);
+        }
+        miClass = operationClass->Clone();
+    }
+
+    auto data = this->m_serializer->SerializeClass(*miClass, true);
+    entry.m_timestamp = GetTimestamp();
+    entry.m_data.assign((const MI_Uint8*)data.c_str(), (const MI_Uint8*)(data.c_str() + data.length()));
+    entry.m_size = (MI_Uint32)entry.m_data.size();
+    entry.m_checksum = Checksum(entry.m_data.data(), entry.m_size);
+    entry.m_class = miClass;
+
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    this->m_entries[key] = std::move(entry);
+    this->m_modified = true;
+    return miClass->Clone();
+}
+
+std::shared_ptr<Class> ClassSchemaCache::FindClass(const std::wstring& serverName, const std::wstring& ns,
+    const std::wstring& className)
+{
+    auto key = GetKey(Normalize(serverName), Normalize(ns), Normalize(className));
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    auto miClass = GetCachedClass(key, serverName, ns);
+    return miClass ? miClass->Clone() : nullptr;
+}
+
+void ClassSchemaCache::Invalidate(const std::wstring& serverName, const std::wstring& ns,
+    const std::wstring& className)
+{
+    auto normalizedServerName = Normalize(serverName);
+    auto normalizedNameSpace = Normalize(ns);
+    auto normalizedClassName = Normalize(className);
+    auto now = GetTimestamp();
+
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    for (auto it = this->m_entries.begin(); it != this->m_entries.end();)
+    {
+        auto& entry = it->second;
+        if ((serverName.empty() || entry.m_serverName == normalizedServerName) &&
+            (ns.empty() || entry.m_nameSpace == normalizedNameSpace) &&
+            (className.empty() || entry.m_className == normalizedClassName))
+        {
+            this->m_removed[it->first] = now;
+            it = this->m_entries.erase(it);
+            this->m_modified = true;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void ClassSchemaCache::Save()
+{
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    if (!this->m_modified)
+    {
+        return;
+    }
+
+    // Mapped until the file is written, as the merged entries refer to it
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if (file->Open(this->m_path))
+    {
+        Merge(*file);
+    }
+
+    std::vector<MI_Uint8> buffer;
+    FileHeader header;
+    memcpy(header.m_magic, CLASS_SCHEMA_CACHE_MAGIC, sizeof(header.m_magic));
+    header.m_formatVersion = CLASS_SCHEMA_CACHE_FORMAT_VERSION;
+    header.m_charSize = sizeof(wchar_t);
+    header.m_schemaVersionLength = (MI_Uint32)this->m_schemaVersion.length();
+    header.m_entryCount = 0;
+    Append(buffer, &header, sizeof(header));
+    Append(buffer, this->m_schemaVersion);
+
+    // Offset of each entry's data in the buffer
+    std::vector<std::pair<Entry*, size_t>> offsets;
+    auto now = GetTimestamp();
+    for (auto it = this->m_entries.begin(); it != this->m_entries.end();)
+    {
+        auto& entry = it->second;
+        if (IsExpired(entry, now))
+        {
+            it = this->m_entries.erase(it);
+            continue;
+        }
+
+        EntryHeader entryHeader;
+        entryHeader.m_timestamp = entry.m_timestamp;
+        entryHeader.m_serverNameLength = (MI_Uint32)entry.m_serverName.length();
+        entryHeader.m_nameSpaceLength = (MI_Uint32)entry.m_nameSpace.length();
+        entryHeader.m_classNameLength = (MI_Uint32)entry.m_className.length();
+        entryHeader.m_size = entry.m_size;
+        entryHeader.m_checksum = entry.m_checksum;
+        entryHeader.m_reserved = 0;
+        Append(buffer, &entryHeader, sizeof(entryHeader));
+        Append(buffer, entry.m_serverName);
+        Append(buffer, entry.m_nameSpace);
+        Append(buffer, entry.m_className);
+        offsets.push_back(std::make_pair(&entry, buffer.size()));
+        Append(buffer, entry.m_mappedData ? entry.m_mappedData : entry.m_data.data(), entry.m_size);
+        header.m_entryCount++;
+        ++it;
+    }
+    memcpy(buffer.data(), &header, sizeof(header));
+
+    // Points the entries to "data", the new file's content, or to copies of their data
+    auto relocate = [&](const MI_Uint8* data) {
+        for (auto& offset : offsets)
+        {
+            auto& entry = *offset.first;
+            if (data)
+            {
+                entry.m_mappedData = data + offset.second;
+                std::vector<MI_Uint8>().swap(entry.m_data);
+            }
+            else if (entry.m_mappedData)
+            {
+                entry.m_data.assign(buffer.data() + offset.second, buffer.data() + offset.second + entry.m_size);
+                entry.m_mappedData = nullptr;
+            }
+        }
+    };
+
+    // The mappings are released before the file is replaced
+    this->m_file.reset();
+    file.reset();
+    try
+    {
+        WriteCacheFile(this->m_path, buffer);
+    }
+    catch (std::exception&)
+    {
+        relocate(nullptr);
+        throw;
+    }
+
+    // Unless replaced meanwhile by another process
+    file.reset(new MappedFile());
+    if (file->Open(this->m_path) && file->GetSize() == buffer.size() &&
+        !memcmp(file->GetData(), buffer.data(), buffer.size()))
+    {
+        relocate(file->GetData());
+        this->m_file = std::move(file);
+    }
+    else
+    {
+        relocate(nullptr);
+    }
+    this->m_removed.clear();
+    this->m_modified = false;
+}
+
+size_t ClassSchemaCache::GetSize()
+{
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    return this->m_entries.size();
+}
+
+ClassSchemaCache::~ClassSchemaCache()
+{
+    try
+    {
+        Save();
+    }
+    catch (std::exception&)
+    {
+        // Ignore
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "MI++.h"
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+namespace MI
+{
+    // Persistent cache of class definitions, keyed by server, namespace and
+    // class name. Classes are stored as written by Serializer::SerializeClass in
+    // a file which is memory mapped when the cache is created and are
+    // deserialized on first use, so a new process gets them without a round trip.
+    //
+    // The whole file is discarded if its format or "schemaVersion" don't match,
+    // e.g. after an OS update. Single entries are fetched again when older than
+    // "maxAge" (zero means no expiry) or when they can't be deserialized anymore.
+    // Use Invalidate for classes known to have changed on the server.
+    class ClassSchemaCache
+    {
+    private:
+        struct Entry
+        {
+            std::wstring m_serverName;
+            std::wstring m_nameSpace;
+            std::wstring m_className;
+            MI_Uint64 m_timestamp = 0;
+            // The serialized class, either in the mapped file or in m_data
+            const MI_Uint8* m_mappedData = nullptr;
+            std::vector<MI_Uint8> m_data;
+            MI_Uint32 m_size = 0;
+            MI_Uint32 m_checksum = 0;
+            std::shared_ptr<Class> m_class;
+        };
+        class MappedFile;
+
+        std::shared_ptr<Application> m_app;
+        std::shared_ptr<Serializer> m_serializer;
+        std::shared_ptr<Deserializer> m_deserializer;
+        std::wstring m_path;
+        std::wstring m_schemaVersion;
+        std::chrono::seconds m_maxAge;
+        std::unique_ptr<MappedFile> m_file;
+        std::unordered_map<std::wstring, Entry> m_entries;
+        // Time of the removals since the last save, not to undo when merging the file
+        std::unordered_map<std::wstring, MI_Uint64> m_removed;
+        bool m_modified = false;
+        std::mutex m_mutex;
+
+        ClassSchemaCache(const ClassSchemaCache &obj) = delete;
+        bool Load();
+        bool ReadEntries(MappedFile& file, std::vector<Entry>& entries) const;
+        void Merge(MappedFile& file);
+        bool IsExpired(const Entry& entry, MI_Uint64 now) const;
+        std::shared_ptr<Class> GetCachedClass(const std::wstring& key, const std::wstring& serverName,
+            const std::wstring& ns);
+
+    public:
+        ClassSchemaCache(std::shared_ptr<Application> app, const std::wstring& path,
+            const std::wstring& schemaVersion = L"", std::chrono::seconds maxAge = std::chrono::seconds::zero());
+        // Returns a copy of the cached class, otherwise gets the class with "session",
+        // connected to "serverName", and caches it
+        std::shared_ptr<Class> GetClass(std::shared_ptr<Session> session, const std::wstring& serverName,
+            const std::wstring& ns, const std::wstring& className);
+        // Returns nullptr if the class is not cached
+        std::shared_ptr<Class> FindClass(const std::wstring& serverName, const std::wstring& ns,
+            const std::wstring& className);
+        // Empty arguments match any server, namespace or class
+        void Invalidate(const std::wstring& serverName = L"", const std::wstring& ns = L"",
+            const std::wstring& className = L"");
+        // Writes the file if the cache changed, merged with the classes saved
+        // meanwhile by other processes, keeping the newest entry of each class.
+        // The file is replaced, processes which mapped the previous one keep reading it.
+        void Save();
+        size_t GetSize();
+        // Saves the cache, ignoring errors
+        virtual ~ClassSchemaCache();
+    };
+}
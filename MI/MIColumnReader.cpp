@@ -0,0 +1,216 @@
+#include "stdafx.h"
+#include "MIColumnReader.h"
+#include "MIExceptions.h"
+
+using namespace MI;
+
+static size_t GetValueSize(MI_Type type)
+{
+    switch (type)
+    {
+    case MI_BOOLEAN: return sizeof(MI_Boolean);
+    case MI_UINT8: return sizeof(MI_Uint8);
+    case MI_SINT8: return sizeof(MI_Sint8);
+    case MI_UINT16: return sizeof(MI_Uint16);
+    case MI_SINT16: return sizeof(MI_Sint16);
+    case MI_UINT32: return sizeof(MI_Uint32);
+    case MI_SINT32: return sizeof(MI_Sint32);
+    case MI_UINT64: return sizeof(MI_Uint64);
+    case MI_SINT64: return sizeof(MI_Sint64);
+    case MI_REAL32: return sizeof(MI_Real32);
+    case MI_REAL64: return sizeof(MI_Real64);
+    case MI_CHAR16: return sizeof(MI_Char16);
+    case MI_DATETIME: return sizeof(MI_Sint64);
+    case MI_STRING: return 1;
+    default:
+        throw TypeConversionException(L"Unsupported column type");
+    }
+}
+
+// Days since 1970-01-01 in the proleptic Gregorian calendar
+static MI_Sint64 DaysFromCivil(MI_Sint64 year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    MI_Sint64 era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yearOfEra = (unsigned)(year - era * 400);
+    unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + (MI_Sint64)dayOfEra - 719468;
+}
+
+static MI_Sint64 DatetimeToMicroseconds(const MI_Datetime& value)
+{
+    if (value.isTimestamp)
+    {
+        const auto& ts = value.u.timestamp;
+        MI_Sint64 seconds = DaysFromCivil(ts.year, ts.month, ts.day) * 86400 + ts.hour * 3600 + ts.minute * 60 +
+            ts.second - (MI_Sint64)ts.utc * 60;
+        return seconds * 1000000 + ts.microseconds;
+    }
+
+    const auto& interval = value.u.interval;
+    MI_Sint64 seconds = (MI_Sint64)interval.days * 86400 + interval.hours * 3600 + interval.minutes * 60 +
+        interval.seconds;
+    return seconds * 1000000 + interval.microseconds;
+}
+
+// UTF-16 surrogate pairs are combined, lone surrogates are replaced
+static void AppendUtf8(std::vector<MI_Uint8>& buffer, const MI_Char* value)
+{
+    for (const MI_Char* p = value; *p; p++)
+    {
+        MI_Uint32 c = (MI_Uint32)*p;
+        if (c < 0x80)
+        {
+            buffer.push_back((MI_Uint8)c);
+            continue;
+        }
+
+        if (c >= 0xD800 && c <= 0xDBFF && p[1] >= 0xDC00 && p[1] <= 0xDFFF)
+        {
+            c = 0x10000 + ((c - 0xD800) << 10) + ((MI_Uint32)p[1] - 0xDC00);
+            p++;
+        }
+        else if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF)
+        {
+            c = 0xFFFD;
+        }
+
+        if (c < 0x800)
+        {
+            buffer.push_back((MI_Uint8)(0xC0 | (c >> 6)));
+            buffer.push_back((MI_Uint8)(0x80 | (c & 0x3F)));
+        }
+        else if (c < 0x10000)
+        {
+            buffer.push_back((MI_Uint8)(0xE0 | (c >> 12)));
+            buffer.push_back((MI_Uint8)(0x80 | ((c >> 6) & 0x3F)));
+            buffer.push_back((MI_Uint8)(0x80 | (c & 0x3F)));
+        }
+        else
+        {
+            buffer.push_back((MI_Uint8)(0xF0 | (c >> 18)));
+            buffer.push_back((MI_Uint8)(0x80 | ((c >> 12) & 0x3F)));
+            buffer.push_back((MI_Uint8)(0x80 | ((c >> 6) & 0x3F)));
+            buffer.push_back((MI_Uint8)(0x80 | (c & 0x3F)));
+        }
+    }
+}
+
+size_t Column::GetItemSize() const
+{
+    return GetValueSize(this->m_type);
+}
+
+ColumnReader::ColumnReader(const std::vector<std::wstring>& names)
+{
+    for (const auto& name : names)
+    {
+        Column column;
+        column.m_name = name;
+        this->m_columns.push_back(std::move(column));
+    }
+}
+
+void ColumnReader::AppendValue(Column& column, const ValueElementRef& element)
+{
+    if (column.m_type == MI_ARRAY)
+    {
+        GetValueSize(element.m_type);
+        column.m_type = element.m_type;
+        if (column.m_type == MI_STRING)
+        {
+            column.m_offsets.push_back(0);
+        }
+    }
+    else if (element.m_type != column.m_type)
+    {
+        throw TypeConversionException(L"Inconsistent type for column: " + column.m_name);
+    }
+
+    bool isNull = (element.m_flags & MI_FLAG_NULL) != 0;
+    if (column.m_count % 8 == 0)
+    {
+        column.m_validity.push_back(0);
+    }
+    if (isNull)
+    {
+        column.m_nullCount++;
+    }
+    else
+    {
+        column.m_validity.back() |= (MI_Uint8)(1 << (column.m_count % 8));
+    }
+
+    switch (column.m_type)
+    {
+    case MI_STRING:
+        if (!isNull && element.m_value.string)
+        {
+            AppendUtf8(column.m_values, element.m_value.string);
+        }
+        column.m_offsets.push_back((MI_Sint64)column.m_values.size());
+        break;
+    case MI_DATETIME:
+    {
+        MI_Sint64 microseconds = isNull ? 0 : DatetimeToMicroseconds(element.m_value.datetime);
+        auto data = (const MI_Uint8*)&microseconds;
+        column.m_values.insert(column.m_values.end(), data, data + sizeof(microseconds));
+        break;
+    }
+    default:
+    {
+        // The scalar union members all start at the beginning of the MI_Value
+        auto size = GetValueSize(column.m_type);
+        if (isNull)
+        {
+            column.m_values.resize(column.m_values.size() + size);
+        }
+        else
+        {
+            auto data = (const MI_Uint8*)&element.m_value;
+            column.m_values.insert(column.m_values.end(), data, data + size);
+        }
+    }
+    }
+    column.m_count++;
+}
+
+void ColumnReader::AppendInstance(const Instance& instance)
+{
+    ValueElementRef element;
+    for (auto& column : this->m_columns)
+    {
+        instance.GetElement(column.m_name, element);
+        AppendValue(column, element);
+    }
+}
+
+size_t ColumnReader::ReadOperation(Operation& operation, size_t maxRows)
+{
+    size_t count = 0;
+    while ((!maxRows || count < maxRows) && operation.HasMoreResults())
+    {
+        auto instance = operation.GetNextInstance();
+        if (!instance)
+        {
+            continue;
+        }
+        AppendInstance(*instance);
+        count++;
+    }
+    return count;
+}
+
+std::vector<Column> ColumnReader::TakeColumns()
+{
+    std::vector<Column> columns;
+    columns.swap(this->m_columns);
+    for (const auto& column : columns)
+    {
+        Column emptyColumn;
+        emptyColumn.m_name = column.m_name;
+        this->m_columns.push_back(std::move(emptyColumn));
+    }
+    return columns;
+}
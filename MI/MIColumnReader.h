@@ -0,0 +1,54 @@
+#pragma once
+
+#include "MI++.h"
+#include <string>
+#include <vector>
+
+namespace MI
+{
+    // The values of one property across the rows read by a ColumnReader.
+    // Numbers, booleans and char16 are stored contiguously as their MI type,
+    // datetimes as MI_Sint64 microseconds: since the Unix epoch (UTC) for
+    // timestamps, the duration for intervals. Strings are stored as UTF-8 in
+    // "m_values", row i spanning from m_offsets[i] to m_offsets[i + 1]. Null rows
+    // have a zero value or an empty string and their bit cleared in "m_validity",
+    // least significant bit first.
+    struct Column
+    {
+    public:
+        std::wstring m_name;
+        // Taken from the first row, MI_ARRAY if no row was read
+        MI_Type m_type = (MI_Type)MI_ARRAY;
+        size_t m_count = 0;
+        size_t m_nullCount = 0;
+        std::vector<MI_Uint8> m_values;
+        std::vector<MI_Sint64> m_offsets;
+        std::vector<MI_Uint8> m_validity;
+
+        // Size of a value in "m_values", 1 for strings
+        size_t GetItemSize() const;
+        bool IsNull(size_t row) const { return !(this->m_validity[row / 8] & (1 << (row % 8))); }
+    };
+
+    // Drains instances into one Column per property name, without keeping the
+    // instances. Array, reference and embedded instance properties are not
+    // supported.
+    class ColumnReader
+    {
+    private:
+        std::vector<Column> m_columns;
+
+        ColumnReader(const ColumnReader &obj) = delete;
+        void AppendValue(Column& column, const ValueElementRef& element);
+
+    public:
+        ColumnReader(const std::vector<std::wstring>& names);
+        void AppendInstance(const Instance& instance);
+        // Appends the remaining results of "operation", up to "maxRows" if not zero.
+        // Returns the number of rows read.
+        size_t ReadOperation(Operation& operation, size_t maxRows = 0);
+        const std::vector<Column>& GetColumns() const { return this->m_columns; }
+        // Moves the columns out of the reader, which starts over with empty columns
+        std::vector<Column> TakeColumns();
+    };
+}
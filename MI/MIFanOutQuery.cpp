@@ -0,0 +1,362 @@
+#include "stdafx.h"
+#include "MIFanOutQuery.h"
+#include "MIExceptions.h"
+#include <codecvt>
+#include <locale>
+
+using namespace MI;
+
+// Instances waiting to be consumed before the hosts are slowed down
+#define MAX_QUEUED_RESULTS 1024
+
+static std::wstring ToWString(const char* message)
+{
+    std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t> cv;
+    return cv.from_bytes(message);
+}
+
+class FanOutQuery::HostCallbacks : public Callbacks
+{
+private:
+    FanOutQuery* m_query;
+    size_t m_index;
+
+public:
+    HostCallbacks(FanOutQuery* query, size_t index) : m_query(query), m_index(index) {}
+
+    void InstanceResult(std::shared_ptr<Operation> operation, std::shared_ptr<const Instance> instance, bool moreResults,
+        MI_Result resultCode, const std::wstring& errorString, std::shared_ptr<const Instance> errorDetails)
+    {
+        m_query->OnInstanceResult(m_index, instance, moreResults, resultCode, errorString, errorDetails);
+    }
+};
+
+FanOutQuery::FanOutQuery(std::shared_ptr<Application> app, const std::vector<std::wstring>& computerNames,
+    const std::wstring& ns, const std::wstring& query, const std::wstring& dialect, const std::wstring& protocol,
+    std::shared_ptr<DestinationOptions> destinationOptions, std::shared_ptr<OperationOptions> operationOptions,
+    unsigned maxConcurrency, std::chrono::milliseconds hostTimeout) :
+    m_app(app), m_protocol(protocol), m_destinationOptions(destinationOptions), m_operationOptions(operationOptions),
+    m_ns(ns), m_query(query), m_dialect(dialect), m_maxConcurrency(maxConcurrency ? maxConcurrency : 1),
+    m_hostTimeout(hostTimeout)
+{
+    m_hosts.resize(computerNames.size());
+    for (size_t i = 0; i < computerNames.size(); i++)
+    {
+        m_hosts[i].m_computerName = computerNames[i];
+    }
+    m_dispatcher = std::thread([this]() { this->Run(); });
+}
+
+// Sessions and operations are only opened and closed here, as closing them from
+// the MI callbacks would wait for the callbacks themselves.
+void FanOutQuery::Run()
+{
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+    while (true)
+    {
+        while (this->m_completedHosts.size())
+        {
+            size_t index = this->m_completedHosts.back();
+            this->m_completedHosts.pop_back();
+            lock.unlock();
+            CloseHost(index);
+            lock.lock();
+            this->m_runningHosts--;
+        }
+
+        while (!this->m_cancelled && this->m_runningHosts < this->m_maxConcurrency &&
+            this->m_nextHost < this->m_hosts.size())
+        {
+            size_t index = this->m_nextHost++;
+            this->m_runningHosts++;
+            lock.unlock();
+            StartHost(index);
+            lock.lock();
+        }
+
+        if (!this->m_runningHosts && (this->m_cancelled || this->m_nextHost == this->m_hosts.size()))
+        {
+            break;
+        }
+
+        // Cancel the expired or cancelled hosts and wait for the next deadline
+        auto now = std::chrono::steady_clock::now();
+        auto nextDeadline = std::chrono::steady_clock::time_point::max();
+        std::vector<std::shared_ptr<Operation>> cancelOperations;
+        for (size_t index = 0; index < this->m_hosts.size(); index++)
+        {
+            auto& host = this->m_hosts[index];
+            if ((!host.m_operation && !host.m_connecting) || host.m_cancelled)
+            {
+                continue;
+            }
+            bool expired = this->m_hostTimeout.count() && host.m_deadline <= now;
+            if (expired || this->m_cancelled)
+            {
+                host.m_cancelled = true;
+                host.m_timedOut = expired;
+                if (host.m_operation)
+                {
+                    cancelOperations.push_back(host.m_operation);
+                }
+                else
+                {
+                    // Connecting can't be cancelled, the host is reported as completed
+                    // and its connector closes the session once connected
+                    PushCompletion(lock, index, MI_RESULT_FAILED, L"The query was cancelled", nullptr);
+                }
+            }
+            else if (this->m_hostTimeout.count() && host.m_deadline < nextDeadline)
+            {
+                nextDeadline = host.m_deadline;
+            }
+        }
+
+        if (cancelOperations.size())
+        {
+            lock.unlock();
+            for (auto& operation : cancelOperations)
+            {
+                try
+                {
+                    operation->Cancel();
+                }
+                catch (std::exception&)
+                {
+                    // The operation completed meanwhile
+                }
+            }
+            lock.lock();
+            continue;
+        }
+
+        // Cancelled hosts are waited for as well, until they report their completion
+        if (this->m_completedHosts.empty())
+        {
+            if (nextDeadline != std::chrono::steady_clock::time_point::max())
+            {
+                this->m_dispatchCv.wait_until(lock, nextDeadline);
+            }
+            else
+            {
+                this->m_dispatchCv.wait(lock);
+            }
+        }
+    }
+
+    this->m_done = true;
+    this->m_resultsCv.notify_all();
+}
+
+// The deadline includes the time taken to connect
+void FanOutQuery::StartHost(size_t index)
+{
+    auto& host = this->m_hosts[index];
+    try
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        host.m_deadline = std::chrono::steady_clock::now() + this->m_hostTimeout;
+        host.m_connecting = true;
+        host.m_connector = std::thread([this, index]() { this->ConnectHost(index); });
+    }
+    catch (std::exception& ex)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            host.m_connecting = false;
+        }
+        OnInstanceResult(index, nullptr, false, MI_RESULT_FAILED, ToWString(ex.what()), nullptr);
+    }
+}
+
+void FanOutQuery::ConnectHost(size_t index)
+{
+    auto& host = this->m_hosts[index];
+    try
+    {
+        auto session = this->m_app->NewSession(this->m_protocol, host.m_computerName, this->m_destinationOptions);
+        std::shared_ptr<Operation> operation;
+        bool cancelled = false;
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            cancelled = host.m_cancelled;
+        }
+        if (!cancelled)
+        {
+            // The results may be delivered before ExecQuery returns, the host is only
+            // closed by the dispatcher, after joining this thread
+            operation = session->ExecQuery(this->m_ns, this->m_query, this->m_dialect, this->m_operationOptions,
+                std::make_shared<HostCallbacks>(this, index));
+        }
+
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        host.m_session = session;
+        host.m_operation = operation;
+        host.m_connecting = false;
+        if (!operation)
+        {
+            // Already reported as completed by the dispatcher
+            this->m_completedHosts.push_back(index);
+        }
+        else if (host.m_cancelled)
+        {
+            // Expired or cancelled while starting the query, the dispatcher only
+            // cancels the operations it sees
+            host.m_cancelled = false;
+        }
+        this->m_dispatchCv.notify_one();
+    }
+    catch (MIException& ex)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            host.m_connecting = false;
+        }
+        OnInstanceResult(index, nullptr, false, ex.GetResult(), ToWString(ex.what()), nullptr);
+    }
+    catch (std::exception& ex)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            host.m_connecting = false;
+        }
+        OnInstanceResult(index, nullptr, false, MI_RESULT_FAILED, ToWString(ex.what()), nullptr);
+    }
+}
+
+void FanOutQuery::CloseHost(size_t index)
+{
+    auto& host = this->m_hosts[index];
+    if (host.m_connector.joinable())
+    {
+        host.m_connector.join();
+    }
+
+    std::shared_ptr<Operation> operation;
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        operation.swap(host.m_operation);
+        session.swap(host.m_session);
+    }
+
+    try
+    {
+        if (operation && !operation->IsClosed())
+        {
+            operation->Close();
+        }
+        if (session && !session->IsClosed())
+        {
+            session->Close();
+        }
+    }
+    catch (std::exception&)
+    {
+        // Ignore, the host already reported its completion
+    }
+}
+
+void FanOutQuery::OnInstanceResult(size_t index, std::shared_ptr<const Instance> instance, bool moreResults,
+    MI_Result resultCode, const std::wstring& errorString, std::shared_ptr<const Instance> errorDetails)
+{
+    // The results are valid only for the duration of the callback
+    FanOutResult result;
+    result.m_computerName = this->m_hosts[index].m_computerName;
+    if (instance)
+    {
+        result.m_instance = instance->Clone();
+    }
+    auto errorDetailsClone = !moreResults && errorDetails ? errorDetails->Clone() : nullptr;
+
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+    if (result.m_instance && !this->m_hosts[index].m_completed)
+    {
+        PushResult(lock, std::move(result), true);
+    }
+
+    if (!moreResults)
+    {
+        PushCompletion(lock, index, resultCode, errorString, errorDetailsClone);
+        this->m_completedHosts.push_back(index);
+        this->m_dispatchCv.notify_one();
+    }
+}
+
+// Hosts abandoned while connecting are reported as completed before their query does
+void FanOutQuery::PushCompletion(std::unique_lock<std::mutex>& lock, size_t index, MI_Result resultCode,
+    const std::wstring& errorString, std::shared_ptr<Instance> errorDetails)
+{
+    auto& host = this->m_hosts[index];
+    if (host.m_completed)
+    {
+        return;
+    }
+    host.m_completed = true;
+    this->m_reportedHosts++;
+
+    FanOutResult completion;
+    completion.m_computerName = host.m_computerName;
+    completion.m_result = resultCode;
+    completion.m_errorMessage = errorString;
+    if (resultCode != MI_RESULT_OK && host.m_timedOut)
+    {
+        completion.m_timedOut = true;
+        completion.m_errorMessage = L"The host did not complete the query before its deadline";
+    }
+    completion.m_errorDetails = errorDetails;
+    PushResult(lock, std::move(completion), false);
+}
+
+// Bounded results wait for the consumer, the instances of a cancelled query are dropped
+void FanOutQuery::PushResult(std::unique_lock<std::mutex>& lock, FanOutResult&& result, bool bounded)
+{
+    if (bounded)
+    {
+        this->m_resultsCv.wait(lock, [&]() {
+            return this->m_cancelled || this->m_results.size() < MAX_QUEUED_RESULTS;
+        });
+        if (this->m_cancelled)
+        {
+            return;
+        }
+    }
+    this->m_results.push_back(std::move(result));
+    this->m_resultsCv.notify_all();
+}
+
+bool FanOutQuery::GetNextResult(FanOutResult& result)
+{
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+    // Once all the hosts reported their completion, abandoned connections are not waited for
+    this->m_resultsCv.wait(lock, [&]() {
+        return this->m_results.size() || this->m_done ||
+            this->m_reportedHosts == (this->m_cancelled ? this->m_nextHost : this->m_hosts.size());
+    });
+    if (this->m_results.empty())
+    {
+        return false;
+    }
+
+    result = std::move(this->m_results.front());
+    this->m_results.pop_front();
+    this->m_resultsCv.notify_all();
+    return true;
+}
+
+void FanOutQuery::Cancel()
+{
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    this->m_cancelled = true;
+    this->m_dispatchCv.notify_one();
+    this->m_resultsCv.notify_all();
+}
+
+FanOutQuery::~FanOutQuery()
+{
+    Cancel();
+    if (this->m_dispatcher.joinable())
+    {
+        this->m_dispatcher.join();
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "MI++.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace MI
+{
+    // A result of a fan-out query, tagged with the host it comes from. The last
+    // result of each host has no instance and carries the host's completion status.
+    struct FanOutResult
+    {
+        std::wstring m_computerName;
+        std::shared_ptr<Instance> m_instance;
+        MI_Result m_result = MI_RESULT_OK;
+        std::wstring m_errorMessage;
+        std::shared_ptr<Instance> m_errorDetails;
+        bool m_timedOut = false;
+    };
+
+    // Runs the same query against many hosts, with at most "maxConcurrency" hosts
+    // queried at a time. Results are streamed as they arrive, through push mode
+    // operations, so no thread is parked per host once connected. Hosts are connected
+    // to on their own threads, an unreachable host doesn't hold back the others. A zero
+    // "hostTimeout" means no deadline, otherwise the host's connection and query are
+    // abandoned once it expires.
+    class FanOutQuery
+    {
+    private:
+        struct HostQuery
+        {
+            std::wstring m_computerName;
+            std::shared_ptr<Session> m_session;
+            std::shared_ptr<Operation> m_operation;
+            std::chrono::steady_clock::time_point m_deadline;
+            // Connects and starts the query, a host can take long to connect to
+            std::thread m_connector;
+            bool m_connecting = false;
+            bool m_cancelled = false;
+            bool m_timedOut = false;
+            // Set once the host's completion is pushed to the results
+            bool m_completed = false;
+        };
+        class HostCallbacks;
+
+        std::shared_ptr<Application> m_app;
+        std::wstring m_protocol;
+        std::shared_ptr<DestinationOptions> m_destinationOptions;
+        std::shared_ptr<OperationOptions> m_operationOptions;
+        std::wstring m_ns;
+        std::wstring m_query;
+        std::wstring m_dialect;
+        unsigned m_maxConcurrency;
+        std::chrono::milliseconds m_hostTimeout;
+
+        std::vector<HostQuery> m_hosts;
+        size_t m_nextHost = 0;
+        size_t m_runningHosts = 0;
+        std::vector<size_t> m_completedHosts;
+        // Hosts whose completion was pushed, their connectors may still be running
+        size_t m_reportedHosts = 0;
+        std::deque<FanOutResult> m_results;
+        bool m_cancelled = false;
+        bool m_done = false;
+
+        std::mutex m_mutex;
+        std::condition_variable m_dispatchCv;
+        std::condition_variable m_resultsCv;
+        std::thread m_dispatcher;
+
+        FanOutQuery(const FanOutQuery &obj) = delete;
+        void Run();
+        void StartHost(size_t index);
+        void ConnectHost(size_t index);
+        void CloseHost(size_t index);
+        void OnInstanceResult(size_t index, std::shared_ptr<const Instance> instance, bool moreResults,
+            MI_Result resultCode, const std::wstring& errorString, std::shared_ptr<const Instance> errorDetails);
+        void PushResult(std::unique_lock<std::mutex>& lock, FanOutResult&& result, bool bounded);
+        void PushCompletion(std::unique_lock<std::mutex>& lock, size_t index, MI_Result resultCode,
+            const std::wstring& errorString, std::shared_ptr<Instance> errorDetails);
+
+    public:
+        FanOutQuery(std::shared_ptr<Application> app, const std::vector<std::wstring>& computerNames,
+            const std::wstring& ns, const std::wstring& query, const std::wstring& dialect = L"WQL",
+            const std::wstring& protocol = L"", std::shared_ptr<DestinationOptions> destinationOptions = nullptr,
+            std::shared_ptr<OperationOptions> operationOptions = nullptr, unsigned maxConcurrency = 16,
+            std::chrono::milliseconds hostTimeout = std::chrono::milliseconds::zero());
+        // Waits for the next result, returns false once all the hosts completed
+        bool GetNextResult(FanOutResult& result);
+        void Cancel();
+        virtual ~FanOutQuery();
+    };
+}
@@ -0,0 +1,136 @@
+#include "stdafx.h"
+#include "MIIndicationQueue.h"
+#include "MIExceptions.h"
+
+using namespace MI;
+
+IndicationQueue::IndicationQueue(size_t capacity, IndicationOverflowPolicy policy) :
+    m_policy(policy), m_ring(capacity ? capacity : 1)
+{
+}
+
+void IndicationQueue::IndicationResult(std::shared_ptr<Operation> operation, std::shared_ptr<const Instance> instance,
+    const std::wstring& bookmark, const std::wstring& machineID, bool moreResults, MI_Result resultCode,
+    const std::wstring& errorString, std::shared_ptr<const Instance> errorDetails)
+{
+    // The instance is valid only for the duration of the callback
+    std::shared_ptr<Instance> clone;
+    if (instance)
+    {
+        clone = instance->Clone();
+    }
+
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+    if (clone && !this->m_stopped)
+    {
+        this->m_stats.m_received++;
+        bool enqueue = true;
+        if (this->m_count == this->m_ring.size())
+        {
+            this->m_stats.m_overflows++;
+            switch (this->m_policy)
+            {
+            case INDICATION_OVERFLOW_BLOCK:
+                this->m_spaceCv.wait(lock, [&]() {
+                    return this->m_stopped || this->m_count < this->m_ring.size();
+                });
+                enqueue = !this->m_stopped;
+                break;
+            case INDICATION_OVERFLOW_DROP_OLDEST:
+                this->m_ring[this->m_head] = nullptr;
+                this->m_head = (this->m_head + 1) % this->m_ring.size();
+                this->m_count--;
+                this->m_stats.m_dropped++;
+                break;
+            default:
+                enqueue = false;
+                break;
+            }
+            if (!enqueue)
+            {
+                this->m_stats.m_dropped++;
+            }
+        }
+
+        if (enqueue)
+        {
+            this->m_ring[(this->m_head + this->m_count) % this->m_ring.size()] = clone;
+            this->m_count++;
+            this->m_indicationsCv.notify_all();
+        }
+    }
+
+    if (!moreResults)
+    {
+        if (resultCode != MI_RESULT_OK)
+        {
+            this->m_error = std::make_exception_ptr(MIException(resultCode, 0, errorString));
+        }
+        this->m_done = true;
+        this->m_indicationsCv.notify_all();
+    }
+}
+
+size_t IndicationQueue::GetIndications(std::vector<std::shared_ptr<Instance>>& indications, size_t maxCount,
+    std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+    auto ready = [&]() { return this->m_count || this->m_done; };
+    if (timeout.count() < 0)
+    {
+        this->m_indicationsCv.wait(lock, ready);
+    }
+    else
+    {
+        this->m_indicationsCv.wait_for(lock, timeout, ready);
+    }
+
+    size_t count = maxCount < this->m_count ? maxCount : this->m_count;
+    if (!count && this->m_done && this->m_error)
+    {
+        // Reported once, as the operation does
+        auto error = this->m_error;
+        this->m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+
+    indications.reserve(indications.size() + count);
+    for (size_t i = 0; i < count; i++)
+    {
+        indications.push_back(std::move(this->m_ring[this->m_head]));
+        this->m_head = (this->m_head + 1) % this->m_ring.size();
+    }
+    this->m_count -= count;
+    if (count)
+    {
+        this->m_spaceCv.notify_one();
+    }
+    return count;
+}
+
+bool IndicationQueue::HasMoreResults()
+{
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    return this->m_count || !this->m_done || this->m_error;
+}
+
+IndicationQueueStats IndicationQueue::GetStats()
+{
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    auto stats = this->m_stats;
+    stats.m_queued = this->m_count;
+    return stats;
+}
+
+void IndicationQueue::Stop()
+{
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    this->m_stopped = true;
+    for (auto& indication : this->m_ring)
+    {
+        indication = nullptr;
+    }
+    this->m_head = 0;
+    this->m_count = 0;
+    this->m_spaceCv.notify_all();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "MI++.h"
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <vector>
+
+namespace MI
+{
+    // What an indication queue does with an indication arriving when it is full
+    enum IndicationOverflowPolicy
+    {
+        // Holds the subscription until the consumer makes room
+        INDICATION_OVERFLOW_BLOCK,
+        INDICATION_OVERFLOW_DROP_OLDEST,
+        INDICATION_OVERFLOW_DROP_NEWEST
+    };
+
+    struct IndicationQueueStats
+    {
+        MI_Uint64 m_received = 0;
+        MI_Uint64 m_dropped = 0;
+        // Indications that found the queue full, dropped or not depending on the policy
+        MI_Uint64 m_overflows = 0;
+        size_t m_queued = 0;
+    };
+
+    // Callbacks of a push mode subscription, cloning the indications into a ring of
+    // "capacity" slots to be drained in batches. The lock is held only to move
+    // instances in or out of the ring, the clones are made before taking it.
+    class IndicationQueue : public Callbacks
+    {
+    private:
+        IndicationOverflowPolicy m_policy;
+        std::vector<std::shared_ptr<Instance>> m_ring;
+        size_t m_head = 0;
+        size_t m_count = 0;
+        IndicationQueueStats m_stats;
+        std::exception_ptr m_error;
+        bool m_done = false;
+        bool m_stopped = false;
+
+        std::mutex m_mutex;
+        std::condition_variable m_indicationsCv;
+        std::condition_variable m_spaceCv;
+
+        IndicationQueue(const IndicationQueue &obj) = delete;
+
+    public:
+        IndicationQueue(size_t capacity, IndicationOverflowPolicy policy = INDICATION_OVERFLOW_DROP_OLDEST);
+        void IndicationResult(std::shared_ptr<Operation> operation, std::shared_ptr<const Instance> instance,
+            const std::wstring& bookmark, const std::wstring& machineID, bool moreResults, MI_Result resultCode,
+            const std::wstring& errorString, std::shared_ptr<const Instance> errorDetails);
+        // Waits up to "timeout" for an indication, a negative timeout waiting indefinitely,
+        // then appends up to "maxCount" of the queued ones to "indications" and returns
+        // their number. Once the subscription completed and the queue is drained, throws
+        // the error it completed with, if any.
+        size_t GetIndications(std::vector<std::shared_ptr<Instance>>& indications, size_t maxCount,
+            std::chrono::milliseconds timeout);
+        bool HasMoreResults();
+        IndicationQueueStats GetStats();
+        // Drops the queued indications and the ones still arriving, releasing a
+        // subscription blocked on a full queue
+        void Stop();
+    };
+}
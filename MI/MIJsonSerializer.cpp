@@ -0,0 +1,402 @@
+#include "stdafx.h"
+#include "MIJsonSerializer.h"
+#include "MIExceptions.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#define WriteFd _write
+#else
+#include <unistd.h>
+#define WriteFd write
+#endif
+
+using namespace MI;
+
+// Output buffered before being written to the file descriptor
+#define JSON_FLUSH_SIZE (64 * 1024)
+
+static void CheckMIResult(MI_Result result)
+{
+    if (result != MI_RESULT_OK)
+    {
+        throw MIException(result);
+    }
+}
+
+static size_t GetScalarSize(MI_Type type)
+{
+    switch (type)
+    {
+    case MI_BOOLEAN: return sizeof(MI_Boolean);
+    case MI_UINT8: return sizeof(MI_Uint8);
+    case MI_SINT8: return sizeof(MI_Sint8);
+    case MI_UINT16: return sizeof(MI_Uint16);
+    case MI_SINT16: return sizeof(MI_Sint16);
+    case MI_UINT32: return sizeof(MI_Uint32);
+    case MI_SINT32: return sizeof(MI_Sint32);
+    case MI_UINT64: return sizeof(MI_Uint64);
+    case MI_SINT64: return sizeof(MI_Sint64);
+    case MI_REAL32: return sizeof(MI_Real32);
+    case MI_REAL64: return sizeof(MI_Real64);
+    case MI_CHAR16: return sizeof(MI_Char16);
+    case MI_DATETIME: return sizeof(MI_Datetime);
+    case MI_STRING: return sizeof(MI_Char*);
+    case MI_REFERENCE:
+    case MI_INSTANCE: return sizeof(MI_Instance*);
+    default:
+        throw TypeConversionException();
+    }
+}
+
+std::string JsonSerializer::SerializeInstance(const Instance& instance)
+{
+    this->m_buffer.clear();
+    WriteObject(instance);
+    std::string data;
+    data.swap(this->m_buffer);
+    return data;
+}
+
+void JsonSerializer::WriteObject(const Instance& instance)
+{
+    this->m_buffer += '{';
+    bool first = true;
+    if (this->m_includeClassName)
+    {
+        const MI_Char* className = nullptr;
+        CheckMIResult(::MI_Instance_GetClassName(instance.m_instance, &className));
+        this->m_buffer += "\"__class__\":";
+        WriteString(className);
+        first = false;
+    }
+
+    MI_Uint32 count = 0;
+    CheckMIResult(::MI_Instance_GetElementCount(instance.m_instance, &count));
+    for (MI_Uint32 i = 0; i < count; i++)
+    {
+        const MI_Char* name = nullptr;
+        MI_Value value;
+        MI_Type type;
+        MI_Uint32 flags = 0;
+        CheckMIResult(::MI_Instance_GetElementAt(instance.m_instance, i, &name, &value, &type, &flags));
+        if (!first)
+        {
+            this->m_buffer += ',';
+        }
+        first = false;
+        WriteString(name);
+        this->m_buffer += ':';
+        if (flags & MI_FLAG_NULL)
+        {
+            this->m_buffer += "null";
+        }
+        else
+        {
+            WriteValue(value, type);
+        }
+    }
+    this->m_buffer += '}';
+}
+
+void JsonSerializer::WriteValue(const MI_Value& value, MI_Type type)
+{
+    if (!(type & MI_ARRAY))
+    {
+        WriteScalar(value, type);
+        return;
+    }
+
+    // The items of all the array types are laid out as the matching union member
+    auto itemType = (MI_Type)(type & ~MI_ARRAY);
+    auto itemSize = GetScalarSize(itemType);
+    auto data = (const MI_Uint8*)value.array.data;
+    this->m_buffer += '[';
+    for (MI_Uint32 i = 0; i < value.array.size; i++)
+    {
+        if (i)
+        {
+            this->m_buffer += ',';
+        }
+        MI_Value item;
+        memcpy(&item, data + i * itemSize, itemSize);
+        WriteScalar(item, itemType);
+    }
+    this->m_buffer += ']';
+}
+
+void JsonSerializer::WriteScalar(const MI_Value& value, MI_Type type)
+{
+    char number[32];
+    switch (type)
+    {
+    case MI_BOOLEAN:
+        this->m_buffer += value.boolean ? "true" : "false";
+        return;
+    case MI_UINT8:
+        snprintf(number, sizeof(number), "%u", (unsigned)value.uint8);
+        break;
+    case MI_SINT8:
+        snprintf(number, sizeof(number), "%d", (int)value.sint8);
+        break;
+    case MI_UINT16:
+        snprintf(number, sizeof(number), "%u", (unsigned)value.uint16);
+        break;
+    case MI_SINT16:
+        snprintf(number, sizeof(number), "%d", (int)value.sint16);
+        break;
+    case MI_UINT32:
+        snprintf(number, sizeof(number), "%u", (unsigned)value.uint32);
+        break;
+    case MI_SINT32:
+        snprintf(number, sizeof(number), "%d", (int)value.sint32);
+        break;
+    case MI_UINT64:
+        snprintf(number, sizeof(number), "%llu", (unsigned long long)value.uint64);
+        break;
+    case MI_SINT64:
+        snprintf(number, sizeof(number), "%lld", (long long)value.sint64);
+        break;
+    case MI_REAL32:
+    case MI_REAL64:
+    {
+        double real = type == MI_REAL32 ? value.real32 : value.real64;
+        if (!std::isfinite(real))
+        {
+            // Not representable in JSON
+            this->m_buffer += "null";
+            return;
+        }
+        snprintf(number, sizeof(number), type == MI_REAL32 ? "%.9g" : "%.17g", real);
+        break;
+    }
+    case MI_CHAR16:
+    {
+        MI_Char chars[2] = { (MI_Char)value.char16, 0 };
+        WriteString(chars);
+        return;
+    }
+    case MI_DATETIME:
+        WriteDatetime(value.datetime);
+        return;
+    case MI_STRING:
+        WriteString(value.string);
+        return;
+    case MI_REFERENCE:
+        WriteReference(value.reference);
+        return;
+    case MI_INSTANCE:
+        if (!value.instance)
+        {
+            this->m_buffer += "null";
+        }
+        else
+        {
+            WriteObject(Instance(value.instance, false));
+        }
+        return;
+    default:
+        throw TypeConversionException();
+    }
+    this->m_buffer += number;
+}
+
+void JsonSerializer::WriteString(const MI_Char* value)
+{
+    if (!value)
+    {
+        this->m_buffer += "null";
+        return;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    this->m_buffer += '"';
+    for (const MI_Char* p = value; *p; p++)
+    {
+        MI_Uint32 c = (MI_Uint32)*p;
+        if (c < 0x80)
+        {
+            switch (c)
+            {
+            case '"': this->m_buffer += "\\\""; break;
+            case '\\': this->m_buffer += "\\\\"; break;
+            case '\n': this->m_buffer += "\\n"; break;
+            case '\r': this->m_buffer += "\\r"; break;
+            case '\t': this->m_buffer += "\\t"; break;
+            case '\b': this->m_buffer += "\\b"; break;
+            case '\f': this->m_buffer += "\\f"; break;
+            default:
+                if (c < 0x20)
+                {
+                    char escape[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+                    this->m_buffer.append(escape, sizeof(escape));
+                }
+                else
+                {
+                    this->m_buffer += (char)c;
+                }
+            }
+            continue;
+        }
+
+        // UTF-16 surrogate pairs, lone surrogates are replaced
+        if (c >= 0xD800 && c <= 0xDBFF && p[1] >= 0xDC00 && p[1] <= 0xDFFF)
+        {
+            c = 0x10000 + ((c - 0xD800) << 10) + ((MI_Uint32)p[1] - 0xDC00);
+            p++;
+        }
+        else if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF)
+        {
+            c = 0xFFFD;
+        }
+
+        if (c < 0x800)
+        {
+            this->m_buffer += (char)(0xC0 | (c >> 6));
+            this->m_buffer += (char)(0x80 | (c & 0x3F));
+        }
+        else if (c < 0x10000)
+        {
+            this->m_buffer += (char)(0xE0 | (c >> 12));
+            this->m_buffer += (char)(0x80 | ((c >> 6) & 0x3F));
+            this->m_buffer += (char)(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            this->m_buffer += (char)(0xF0 | (c >> 18));
+            this->m_buffer += (char)(0x80 | ((c >> 12) & 0x3F));
+            this->m_buffer += (char)(0x80 | ((c >> 6) & 0x3F));
+            this->m_buffer += (char)(0x80 | (c & 0x3F));
+        }
+    }
+    this->m_buffer += '"';
+}
+
+void JsonSerializer::WriteDatetime(const MI_Datetime& value)
+{
+    char text[64];
+    if (value.isTimestamp)
+    {
+        auto const& ts = value.u.timestamp;
+        // "utc" is the offset from UTC in minutes
+        int offset = ts.utc < 0 ? -ts.utc : ts.utc;
+        snprintf(text, sizeof(text), "\"%04u-%02u-%02uT%02u:%02u:%02u.%06u%c%02d:%02d\"",
+            ts.year, ts.month, ts.day, ts.hour, ts.minute, ts.second, ts.microseconds,
+            ts.utc < 0 ? '-' : '+', offset / 60, offset % 60);
+    }
+    else
+    {
+        auto const& interval = value.u.interval;
+        snprintf(text, sizeof(text), "\"P%uDT%uH%uM%u.%06uS\"",
+            interval.days, interval.hours, interval.minutes, interval.seconds, interval.microseconds);
+    }
+    this->m_buffer += text;
+}
+
+void JsonSerializer::WriteReference(MI_Instance* reference)
+{
+    if (!reference)
+    {
+        this->m_buffer += "null";
+        return;
+    }
+
+    // References to instances without a path, e.g. created locally, are written as objects
+    Instance instance(reference, false);
+    std::wstring path;
+    try
+    {
+        path = instance.GetPath();
+    }
+    catch (Exception&)
+    {
+    }
+
+    if (path.empty())
+    {
+        WriteObject(instance);
+    }
+    else
+    {
+        WriteString(path.c_str());
+    }
+}
+
+void JsonSerializer::Flush(int fd)
+{
+    size_t written = 0;
+    while (written < this->m_buffer.size())
+    {
+        auto result = WriteFd(fd, this->m_buffer.data() + written, (unsigned)(this->m_buffer.size() - written));
+        if (result < 0)
+        {
+            // Interrupted by a signal before writing anything
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw Exception(L"Writing the JSON output failed: " + std::to_wstring(errno));
+        }
+        written += result;
+    }
+    this->m_buffer.clear();
+}
+
+size_t JsonSerializer::WriteResults(Operation& operation, int fd, bool ndjson)
+{
+    this->m_buffer.clear();
+    if (!ndjson)
+    {
+        this->m_buffer += '[';
+    }
+
+    size_t count = 0;
+    while (operation.HasMoreResults())
+    {
+        auto instance = operation.GetNextInstance();
+        if (!instance)
+        {
+            continue;
+        }
+        if (!ndjson && count)
+        {
+            this->m_buffer += ',';
+        }
+        WriteObject(*instance);
+        if (ndjson)
+        {
+            this->m_buffer += '\n';
+        }
+        count++;
+
+        if (fd >= 0 && this->m_buffer.size() >= JSON_FLUSH_SIZE)
+        {
+            Flush(fd);
+        }
+    }
+
+    if (!ndjson)
+    {
+        this->m_buffer += ']';
+    }
+    if (fd >= 0)
+    {
+        Flush(fd);
+    }
+    return count;
+}
+
+size_t JsonSerializer::WriteOperation(Operation& operation, int fd, bool ndjson)
+{
+    return WriteResults(operation, fd, ndjson);
+}
+
+std::string JsonSerializer::SerializeOperation(Operation& operation, bool ndjson)
+{
+    WriteResults(operation, -1, ndjson);
+    std::string data;
+    data.swap(this->m_buffer);
+    return data;
+}
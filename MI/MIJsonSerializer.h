@@ -0,0 +1,39 @@
+#pragma once
+
+#include "MI++.h"
+#include <string>
+
+namespace MI
+{
+    // Writes instances as UTF-8 JSON objects, without going through the MI
+    // serializer. Embedded instances are written as nested objects, references
+    // as their path, datetimes as ISO 8601 timestamps or durations and null
+    // elements as null. Operation results are written either as one object per
+    // line (NDJSON) or as a JSON array.
+    class JsonSerializer
+    {
+    private:
+        std::string m_buffer;
+        bool m_includeClassName;
+
+        JsonSerializer(const JsonSerializer &obj) = delete;
+        void WriteObject(const Instance& instance);
+        void WriteValue(const MI_Value& value, MI_Type type);
+        void WriteScalar(const MI_Value& value, MI_Type type);
+        void WriteString(const MI_Char* value);
+        void WriteDatetime(const MI_Datetime& value);
+        void WriteReference(MI_Instance* reference);
+        void Flush(int fd);
+        size_t WriteResults(Operation& operation, int fd, bool ndjson);
+
+    public:
+        // "includeClassName" adds a "__class__" member with the class name to each object
+        JsonSerializer(bool includeClassName = false) : m_includeClassName(includeClassName) {}
+        std::string SerializeInstance(const Instance& instance);
+        // Writes the remaining results of "operation" to "fd", flushing the output as
+        // it grows. Returns the number of instances written.
+        size_t WriteOperation(Operation& operation, int fd, bool ndjson = true);
+        // Same as WriteOperation, but returns the output
+        std::string SerializeOperation(Operation& operation, bool ndjson = true);
+    };
+}
@@ -0,0 +1,124 @@
+#include "stdafx.h"
+#include "MIPrefetcher.h"
+
+using namespace MI;
+
+Prefetcher::Prefetcher(std::shared_ptr<Operation> operation, size_t maxResults) :
+    m_operation(operation), m_maxResults(maxResults ? maxResults : 1)
+{
+    m_worker = std::thread([this]() { this->Run(); });
+}
+
+void Prefetcher::Run()
+{
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+    try
+    {
+        while (true)
+        {
+            this->m_spaceCv.wait(lock, [&]() {
+                return this->m_stopped || this->m_results.size() < this->m_maxResults;
+            });
+            if (this->m_stopped || !this->m_operation->HasMoreResults())
+            {
+                break;
+            }
+
+            this->m_fetching = true;
+            lock.unlock();
+            std::shared_ptr<Instance> instance;
+            try
+            {
+                // Getting the next result releases the previous one
+                instance = this->m_operation->GetNextInstance();
+                if (instance)
+                {
+                    instance = instance->Clone();
+                }
+            }
+            catch (std::exception&)
+            {
+                lock.lock();
+                this->m_fetching = false;
+                throw;
+            }
+            lock.lock();
+            this->m_fetching = false;
+
+            if (instance)
+            {
+                this->m_results.push_back(instance);
+                this->m_resultsCv.notify_all();
+            }
+        }
+    }
+    catch (std::exception&)
+    {
+        this->m_error = std::current_exception();
+    }
+
+    this->m_done = true;
+    this->m_resultsCv.notify_all();
+}
+
+std::shared_ptr<Instance> Prefetcher::GetNextInstance()
+{
+    std::unique_lock<std::mutex> lock(this->m_mutex);
+    this->m_resultsCv.wait(lock, [&]() { return this->m_results.size() || this->m_done; });
+    if (this->m_results.empty())
+    {
+        if (this->m_error)
+        {
+            // Reported once, as the operation does
+            auto error = this->m_error;
+            this->m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+        return nullptr;
+    }
+
+    auto instance = this->m_results.front();
+    this->m_results.pop_front();
+    this->m_spaceCv.notify_one();
+    return instance;
+}
+
+bool Prefetcher::HasMoreResults()
+{
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    return this->m_results.size() || !this->m_done || this->m_error;
+}
+
+void Prefetcher::Stop()
+{
+    bool cancel = false;
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_stopped = true;
+        this->m_results.clear();
+        cancel = this->m_fetching;
+        this->m_spaceCv.notify_one();
+    }
+
+    if (cancel)
+    {
+        try
+        {
+            this->m_operation->Cancel();
+        }
+        catch (std::exception&)
+        {
+            // The operation completed meanwhile
+        }
+    }
+
+    if (this->m_worker.joinable())
+    {
+        this->m_worker.join();
+    }
+}
+
+Prefetcher::~Prefetcher()
+{
+    Stop();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "MI++.h"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace MI
+{
+    // Reads the instance results of an operation from a worker thread, keeping up
+    // to "maxResults" of them ahead of the consumer. The results are cloned, so
+    // they remain valid after the operation moves on or is closed. The operation
+    // must not be used by anybody else until the prefetcher is stopped.
+    class Prefetcher
+    {
+    private:
+        std::shared_ptr<Operation> m_operation;
+        size_t m_maxResults;
+
+        std::deque<std::shared_ptr<Instance>> m_results;
+        std::exception_ptr m_error;
+        bool m_done = false;
+        bool m_stopped = false;
+        // Set while the worker waits for the operation
+        bool m_fetching = false;
+
+        std::mutex m_mutex;
+        std::condition_variable m_resultsCv;
+        std::condition_variable m_spaceCv;
+        std::thread m_worker;
+
+        Prefetcher(const Prefetcher &obj) = delete;
+        void Run();
+
+    public:
+        Prefetcher(std::shared_ptr<Operation> operation, size_t maxResults);
+        // Waits for the next result, returns nullptr once the operation has no more
+        // results. Throws the error the operation completed with, if any.
+        std::shared_ptr<Instance> GetNextInstance();
+        bool HasMoreResults();
+        // Cancels the operation if the worker is waiting for it, the results not
+        // consumed yet are dropped
+        void Stop();
+        virtual ~Prefetcher();
+    };
+}
@@ -0,0 +1,179 @@
+#include "stdafx.h"
+#include "MISessionPool.h"
+#include "MIExceptions.h"
+#include <algorithm>
+#include <wctype.h>
+
+using namespace MI;
+
+SessionPool::SessionPool(std::shared_ptr<Application> app, size_t maxSessions,
+    std::chrono::milliseconds idleTimeout, std::chrono::milliseconds validationInterval) :
+    m_app(app), m_maxSessions(maxSessions), m_idleTimeout(idleTimeout), m_validationInterval(validationInterval)
+{
+}
+
+SessionPool::Key SessionPool::GetKey(const std::wstring& protocol, const std::wstring& computerName,
+    std::shared_ptr<DestinationOptions> destinationOptions)
+{
+    Key key;
+    key.m_protocol = protocol;
+    key.m_computerName = computerName;
+    std::transform(key.m_protocol.begin(), key.m_protocol.end(), key.m_protocol.begin(), ::towlower);
+    std::transform(key.m_computerName.begin(), key.m_computerName.end(), key.m_computerName.begin(), ::towlower);
+    if (destinationOptions)
+    {
+        // Every option and credential set, including the authentication type and password
+        key.m_options = destinationOptions->m_options;
+        key.m_credentials = destinationOptions->m_credentials;
+    }
+    return key;
+}
+
+// Called with the lock held. Evicted entries are released by the caller once
+// unlocked, as closing a session may block.
+void SessionPool::EvictIdle(std::vector<std::shared_ptr<Entry>>& evicted, bool makeRoom)
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto idleTimeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(this->m_idleTimeout).count();
+    auto lru = this->m_entries.end();
+    for (auto it = this->m_entries.begin(); it != this->m_entries.end();)
+    {
+        auto& entry = *it->second;
+        if (!entry.m_users && now - entry.m_lastReleased >= idleTimeout)
+        {
+            evicted.push_back(it->second);
+            it = this->m_entries.erase(it);
+            continue;
+        }
+        if (!entry.m_users && (lru == this->m_entries.end() || entry.m_lastReleased < lru->second->m_lastReleased))
+        {
+            lru = it;
+        }
+        ++it;
+    }
+
+    if (makeRoom && this->m_entries.size() >= this->m_maxSessions && lru != this->m_entries.end())
+    {
+        evicted.push_back(lru->second);
+        this->m_entries.erase(lru);
+    }
+}
+
+// The entry's user count must be already incremented
+std::shared_ptr<Session> SessionPool::Acquire(std::shared_ptr<Entry> entry)
+{
+    return std::shared_ptr<Session>(entry->m_session.get(), [entry](Session*)
+    {
+        entry->m_lastReleased = std::chrono::steady_clock::now().time_since_epoch().count();
+        entry->m_users--;
+    });
+}
+
+std::shared_ptr<Session> SessionPool::GetSession(const std::wstring& protocol, const std::wstring& computerName,
+    std::shared_ptr<DestinationOptions> destinationOptions, bool* pooled)
+{
+    if (pooled)
+    {
+        *pooled = true;
+    }
+
+    auto key = GetKey(protocol, computerName, destinationOptions);
+    std::vector<std::shared_ptr<Entry>> evicted;
+    std::shared_ptr<Entry> entry;
+    bool validate = false;
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        EvictIdle(evicted, false);
+        auto it = this->m_entries.find(key);
+        if (it != this->m_entries.end())
+        {
+            entry = it->second;
+            entry->m_users++;
+            auto now = std::chrono::steady_clock::now();
+            if (now - entry->m_lastValidated >= this->m_validationInterval)
+            {
+                // Validated by a single caller at a time
+                entry->m_lastValidated = now;
+                validate = true;
+            }
+        }
+    }
+    evicted.clear();
+
+    if (entry)
+    {
+        auto session = Acquire(entry);
+        try
+        {
+            if (session->IsClosed())
+            {
+                throw Exception(L"The pooled session was closed");
+            }
+            if (validate)
+            {
+                session->TestConnection();
+            }
+            return session;
+        }
+        catch (std::exception&)
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            auto it = this->m_entries.find(key);
+            if (it != this->m_entries.end() && it->second == entry)
+            {
+                this->m_entries.erase(it);
+            }
+        }
+    }
+
+    // Connecting can take a while, other keys must not wait for it
+    auto newEntry = std::make_shared<Entry>();
+    newEntry->m_session = this->m_app->NewSession(protocol, computerName, destinationOptions);
+    newEntry->m_lastValidated = std::chrono::steady_clock::now();
+    newEntry->m_users = 1;
+
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    auto it = this->m_entries.find(key);
+    if (it != this->m_entries.end())
+    {
+        // Another caller connected meanwhile, the new session is closed on return
+        it->second->m_users++;
+        return Acquire(it->second);
+    }
+
+    if (this->m_entries.size() >= this->m_maxSessions)
+    {
+        EvictIdle(evicted, true);
+    }
+    if (this->m_entries.size() >= this->m_maxSessions)
+    {
+        // All the pooled sessions are in use
+        if (pooled)
+        {
+            *pooled = false;
+        }
+        return newEntry->m_session;
+    }
+    this->m_entries[key] = newEntry;
+    return Acquire(newEntry);
+}
+
+void SessionPool::Clear()
+{
+    std::map<Key, std::shared_ptr<Entry>> entries;
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        entries.swap(this->m_entries);
+    }
+}
+
+size_t SessionPool::GetSize()
+{
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    return this->m_entries.size();
+}
+
+SessionPool::~SessionPool()
+{
+    Clear();
+}
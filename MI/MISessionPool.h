@@ -0,0 +1,71 @@
+#pragma once
+
+#include "MI++.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace MI
+{
+    // Shares sessions among the callers connecting to the same host with the same
+    // protocol, destination options and credentials, sparing a DCOM activation or
+    // a WinRM authentication round trip per connection. Sessions are safe for
+    // concurrent use, so a single session is kept per key. Idle sessions are closed
+    // after "idleTimeout", and a session is tested before being reused if it wasn't
+    // for more than "validationInterval". Once "maxSessions" sessions are in use,
+    // unpooled sessions are returned.
+    class SessionPool
+    {
+    private:
+        // Compared exactly, sessions are only shared by the callers connecting the same way
+        struct Key
+        {
+            std::wstring m_protocol;
+            std::wstring m_computerName;
+            std::map<std::wstring, std::wstring> m_options;
+            std::vector<std::vector<std::wstring>> m_credentials;
+
+            bool operator<(const Key& other) const
+            {
+                return std::tie(this->m_protocol, this->m_computerName, this->m_options, this->m_credentials) <
+                    std::tie(other.m_protocol, other.m_computerName, other.m_options, other.m_credentials);
+            }
+        };
+
+        struct Entry
+        {
+            std::shared_ptr<Session> m_session;
+            std::atomic<unsigned> m_users{ 0 };
+            std::atomic<std::chrono::steady_clock::rep> m_lastReleased{ 0 };
+            std::chrono::steady_clock::time_point m_lastValidated;
+        };
+
+        std::shared_ptr<Application> m_app;
+        size_t m_maxSessions;
+        std::chrono::milliseconds m_idleTimeout;
+        std::chrono::milliseconds m_validationInterval;
+        std::map<Key, std::shared_ptr<Entry>> m_entries;
+        std::mutex m_mutex;
+
+        SessionPool(const SessionPool &obj) = delete;
+        static Key GetKey(const std::wstring& protocol, const std::wstring& computerName,
+            std::shared_ptr<DestinationOptions> destinationOptions);
+        void EvictIdle(std::vector<std::shared_ptr<Entry>>& evicted, bool makeRoom);
+        static std::shared_ptr<Session> Acquire(std::shared_ptr<Entry> entry);
+
+    public:
+        SessionPool(std::shared_ptr<Application> app, size_t maxSessions = 32,
+            std::chrono::milliseconds idleTimeout = std::chrono::minutes(5),
+            std::chrono::milliseconds validationInterval = std::chrono::seconds(30));
+        // Sets "pooled" to false if an unpooled session is returned, to be closed by the caller
+        std::shared_ptr<Session> GetSession(const std::wstring& protocol = L"", const std::wstring& computerName = L".",
+            std::shared_ptr<DestinationOptions> destinationOptions = nullptr, bool* pooled = nullptr);
+        // Closes the idle sessions, the ones in use are closed once released
+        void Clear();
+        size_t GetSize();
+        virtual ~SessionPool();
+    };
+}
@@ -51,21 +51,34 @@ void MIValue::SetNullValue()
     ::ZeroMemory(&m_value, sizeof(m_value));
 }
 
-void MIValue::CopyString(const std::string& value)
+MI_Char* MIValue::NewString(size_t length)
+{
+    MI_Char* value = new MI_Char[length + 1];
+    value[length] = 0;
+    return value;
+}
+
+MI_Char* MIValue::NewString(const std::string& value)
 {
     int len = (int)(value.length() + 1);
-    m_value.string = new MI_Char[len];
-    if (::MultiByteToWideChar(CP_ACP, 0, value.c_str(), len, m_value.string, len) != len)
+    MI_Char* str = new MI_Char[len];
+    if (::MultiByteToWideChar(CP_ACP, 0, value.c_str(), len, str, len) != len)
     {
-        delete[] m_value.string;
+        delete[] str;
         throw Exception(L"MultiByteToWideChar failed");
     }
+    return str;
+}
+
+void MIValue::CopyString(const std::string& value)
+{
+    m_value.string = NewString(value);
 }
 
 void MIValue::CopyWString(const std::wstring& value)
 {
-    auto len = value.length() + 1;
-    m_value.string = new MI_Char[len];
+    auto len = value.length();
+    m_value.string = NewString(len);
     memcpy_s(m_value.string, len * sizeof(MI_Char), value.c_str(), len * sizeof(MI_Char));
 }
 
@@ -150,6 +163,23 @@ std::shared_ptr<MIValue> MIValue::CreateArray(MI_Uint32 arraySize, MI_Type type)
     return self;
 }
 
+std::shared_ptr<MIValue> MIValue::FromArray(const void* items, MI_Uint32 arraySize, MI_Type type)
+{
+    MI_Type itemType = (MI_Type)(type ^ MI_ARRAY);
+    if (!(type & MI_ARRAY) || itemType == MI_STRING || itemType == MI_INSTANCE || itemType == MI_REFERENCE)
+    {
+        throw TypeConversionException();
+    }
+
+    auto self = CreateArray(arraySize, type);
+    if (arraySize)
+    {
+        memcpy_s(self->m_value.uint8a.data, GetItemSize(itemType) * arraySize, items,
+            GetItemSize(itemType) * arraySize);
+    }
+    return self;
+}
+
 std::shared_ptr<MIValue> MIValue::FromBoolean(MI_Boolean value)
 {
     return std::make_shared<MIValue>((void*)&value, MI_BOOLEAN);
@@ -1,6 +1,7 @@
 #pragma once
 #include <MI.h>
 #include <memory>
+#include <string>
 
 namespace MI
 {
@@ -40,7 +41,16 @@ namespace MI
         static std::shared_ptr<MIValue> FromInstance(MI::Instance& value);
         static std::shared_ptr<MIValue> FromReference(MI::Instance& value);
         static std::shared_ptr<MIValue> CreateArray(MI_Uint32 arraySize, MI_Type type);
+        // Copies "arraySize" items of a fixed size type, laid out as in an MI array
+        static std::shared_ptr<MIValue> FromArray(const void* items, MI_Uint32 arraySize, MI_Type type);
         void SetArrayItem(const MIValue& value, MI_Uint32 index);
+        // Items of an array created with CreateArray, to be filled in place instead of
+        // going through SetArrayItem. Strings must be allocated with NewString, the
+        // value then owns them.
+        void* GetArrayItems() { return this->m_value.uint8a.data; }
+        // Allocates a null terminated string of "length" characters, to be filled
+        static MI_Char* NewString(size_t length);
+        static MI_Char* NewString(const std::string& value);
 
         MIValue(void* value, MI_Type type);
         MIValue(MI_Type type);
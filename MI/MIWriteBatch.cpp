@@ -0,0 +1,77 @@
+#include "stdafx.h"
+#include "MIWriteBatch.h"
+#include "MIExceptions.h"
+#include <deque>
+
+using namespace MI;
+
+WriteBatch::WriteBatch(std::shared_ptr<Session> session, const std::wstring& ns,
+    std::shared_ptr<OperationOptions> operationOptions, unsigned window) :
+    m_session(session), m_ns(ns), m_operationOptions(operationOptions), m_window(window ? window : 1)
+{
+}
+
+void WriteBatch::Add(WriteBatchOperation operation, std::shared_ptr<const Instance> instance)
+{
+    this->m_items.push_back({ operation, instance });
+}
+
+std::shared_ptr<Operation> WriteBatch::Start(const Item& item)
+{
+    switch (item.m_operation)
+    {
+    case WRITE_BATCH_CREATE:
+        return this->m_session->CreateInstanceAsync(this->m_ns, item.m_instance, this->m_operationOptions);
+    case WRITE_BATCH_MODIFY:
+        return this->m_session->ModifyInstanceAsync(this->m_ns, item.m_instance, this->m_operationOptions);
+    case WRITE_BATCH_DELETE:
+        return this->m_session->DeleteInstanceAsync(this->m_ns, item.m_instance, this->m_operationOptions);
+    default:
+        throw Exception(L"Unsupported write batch operation");
+    }
+}
+
+std::vector<std::exception_ptr> WriteBatch::Execute()
+{
+    std::vector<std::exception_ptr> errors(this->m_items.size());
+    std::deque<std::pair<size_t, std::shared_ptr<Operation>>> inFlight;
+    size_t next = 0;
+
+    while (next < this->m_items.size() || inFlight.size())
+    {
+        while (next < this->m_items.size() && inFlight.size() < this->m_window)
+        {
+            try
+            {
+                inFlight.push_back(std::make_pair(next, Start(this->m_items[next])));
+            }
+            catch (std::exception&)
+            {
+                errors[next] = std::current_exception();
+            }
+            next++;
+        }
+
+        if (inFlight.empty())
+        {
+            continue;
+        }
+
+        // The oldest write is usually the first to complete
+        auto& oldest = inFlight.front();
+        try
+        {
+            while (oldest.second->HasMoreResults())
+            {
+                oldest.second->GetNextInstance();
+            }
+        }
+        catch (std::exception&)
+        {
+            errors[oldest.first] = std::current_exception();
+        }
+        inFlight.pop_front();
+    }
+
+    return errors;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "MI++.h"
+#include <exception>
+#include <vector>
+
+namespace MI
+{
+    enum WriteBatchOperation
+    {
+        WRITE_BATCH_CREATE,
+        WRITE_BATCH_MODIFY,
+        WRITE_BATCH_DELETE
+    };
+
+    // Pipelines instance writes on a session: up to "window" writes are in flight
+    // at a time instead of waiting for a round trip per write. The writes are issued
+    // in the order they were added, there's no ordering between the writes in flight.
+    class WriteBatch
+    {
+    private:
+        struct Item
+        {
+            WriteBatchOperation m_operation;
+            std::shared_ptr<const Instance> m_instance;
+        };
+
+        std::shared_ptr<Session> m_session;
+        std::wstring m_ns;
+        std::shared_ptr<OperationOptions> m_operationOptions;
+        unsigned m_window;
+        std::vector<Item> m_items;
+
+        WriteBatch(const WriteBatch &obj) = delete;
+        std::shared_ptr<Operation> Start(const Item& item);
+
+    public:
+        WriteBatch(std::shared_ptr<Session> session, const std::wstring& ns,
+            std::shared_ptr<OperationOptions> operationOptions = nullptr, unsigned window = 16);
+        void Add(WriteBatchOperation operation, std::shared_ptr<const Instance> instance);
+        size_t GetCount() const { return m_items.size(); }
+        // Runs the writes added so far, returns the error of each of them, null if it succeeded
+        std::vector<std::exception_ptr> Execute();
+    };
+}
@@ -0,0 +1,3831 @@
+#include "MIStub.h"
+#include <windows.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <wctype.h>
+
+using namespace MIStub;
+
+#define STUB_ERR_RPC_SERVER_UNAVAILABLE 0x800706BA
+#define STUB_ERR_TIMEOUT 0x00040004
+
+struct StubInstance;
+
+/*
+**==============================================================================
+**
+** Helpers
+**
+**==============================================================================
+*/
+
+static bool IEquals(const wchar_t* a, const wchar_t* b)
+{
+    if (a == b)
+        return true;
+    if (!a || !b)
+        return false;
+    while (*a && *b)
+    {
+        if (*a != *b && towlower(*a) != towlower(*b))
+            return false;
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static bool IEquals(const std::wstring& a, const std::wstring& b)
+{
+    return a.length() == b.length() && IEquals(a.c_str(), b.c_str());
+}
+
+static std::wstring ToLower(std::wstring s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), ::towlower);
+    return s;
+}
+
+static std::wstring NormalizeNamespace(const std::wstring& ns)
+{
+    std::wstring s = ToLower(ns);
+    std::replace(s.begin(), s.end(), L'\\', L'/');
+    return s;
+}
+
+static unsigned GetItemSize(MI_Type type)
+{
+    switch (type)
+    {
+    case MI_BOOLEAN: return sizeof(MI_Boolean);
+    case MI_UINT8: return sizeof(MI_Uint8);
+    case MI_SINT8: return sizeof(MI_Sint8);
+    case MI_UINT16: return sizeof(MI_Uint16);
+    case MI_SINT16: return sizeof(MI_Sint16);
+    case MI_UINT32: return sizeof(MI_Uint32);
+    case MI_SINT32: return sizeof(MI_Sint32);
+    case MI_UINT64: return sizeof(MI_Uint64);
+    case MI_SINT64: return sizeof(MI_Sint64);
+    case MI_REAL32: return sizeof(MI_Real32);
+    case MI_REAL64: return sizeof(MI_Real64);
+    case MI_CHAR16: return sizeof(MI_Char16);
+    case MI_DATETIME: return sizeof(MI_Datetime);
+    case MI_STRING: return sizeof(MI_Char*);
+    default: return sizeof(MI_Instance*);
+    }
+}
+
+static MI_Char* CopyString(const MI_Char* s)
+{
+    if (!s)
+        return nullptr;
+    size_t len = wcslen(s) + 1;
+    MI_Char* copy = new MI_Char[len];
+    memcpy(copy, s, len * sizeof(MI_Char));
+    return copy;
+}
+
+static MI_Instance* CloneInstance(const MI_Instance* instance)
+{
+    MI_Instance* clone = nullptr;
+    if (instance && instance->ft)
+        instance->ft->Clone(instance, &clone);
+    return clone;
+}
+
+static void DeleteInstance(MI_Instance* instance)
+{
+    if (instance && instance->ft)
+        instance->ft->Delete(instance);
+}
+
+// Deep copy of a value, strings and instances included.
+static void CopyValue(const MI_Value& src, MI_Type type, MI_Value& dst)
+{
+    memset(&dst, 0, sizeof(dst));
+    if (type & MI_ARRAY)
+    {
+        MI_Type itemType = (MI_Type)(type & ~MI_ARRAY);
+        unsigned itemSize = GetItemSize(itemType);
+        MI_Uint32 size = src.array.size;
+        dst.array.size = size;
+        if (!size || !src.array.data)
+        {
+            dst.array.data = nullptr;
+            return;
+        }
+        MI_Uint8* data = new MI_Uint8[itemSize * size];
+        memcpy(data, src.array.data, itemSize * size);
+        if (itemType == MI_STRING)
+        {
+            MI_Char** items = (MI_Char**)data;
+            for (MI_Uint32 i = 0; i < size; i++)
+                items[i] = CopyString(items[i]);
+        }
+        else if (itemType == MI_INSTANCE || itemType == MI_REFERENCE)
+        {
+            MI_Instance** items = (MI_Instance**)data;
+            for (MI_Uint32 i = 0; i < size; i++)
+                items[i] = CloneInstance(items[i]);
+        }
+        dst.array.data = data;
+        return;
+    }
+
+    switch (type)
+    {
+    case MI_STRING:
+        dst.string = CopyString(src.string);
+        break;
+    case MI_INSTANCE:
+    case MI_REFERENCE:
+        dst.instance = CloneInstance(src.instance);
+        break;
+    default:
+        memcpy(&dst, &src, GetItemSize(type));
+        break;
+    }
+}
+
+static void FreeValue(MI_Value& value, MI_Type type)
+{
+    if (type & MI_ARRAY)
+    {
+        MI_Type itemType = (MI_Type)(type & ~MI_ARRAY);
+        if (value.array.data)
+        {
+            if (itemType == MI_STRING)
+            {
+                MI_Char** items = (MI_Char**)value.array.data;
+                for (MI_Uint32 i = 0; i < value.array.size; i++)
+                    delete[] items[i];
+            }
+            else if (itemType == MI_INSTANCE || itemType == MI_REFERENCE)
+            {
+                MI_Instance** items = (MI_Instance**)value.array.data;
+                for (MI_Uint32 i = 0; i < value.array.size; i++)
+                    DeleteInstance(items[i]);
+            }
+            delete[] (MI_Uint8*)value.array.data;
+        }
+    }
+    else if (type == MI_STRING)
+    {
+        delete[] value.string;
+    }
+    else if (type == MI_INSTANCE || type == MI_REFERENCE)
+    {
+        DeleteInstance(value.instance);
+    }
+    memset(&value, 0, sizeof(value));
+}
+
+class OwnedValue
+{
+public:
+    MI_Value m_value;
+    MI_Type m_type = MI_BOOLEAN;
+    bool m_isNull = true;
+
+    OwnedValue()
+    {
+        memset(&m_value, 0, sizeof(m_value));
+    }
+
+    OwnedValue(const MI_Value* value, MI_Type type) : OwnedValue()
+    {
+        Set(value, type);
+    }
+
+    OwnedValue(const OwnedValue& other) : OwnedValue()
+    {
+        *this = other;
+    }
+
+    OwnedValue(OwnedValue&& other) : m_value(other.m_value), m_type(other.m_type), m_isNull(other.m_isNull)
+    {
+        memset(&other.m_value, 0, sizeof(other.m_value));
+        other.m_isNull = true;
+    }
+
+    OwnedValue& operator=(const OwnedValue& other)
+    {
+        if (this != &other)
+        {
+            Set(other.m_isNull ? nullptr : &other.m_value, other.m_type);
+        }
+        return *this;
+    }
+
+    void Set(const MI_Value* value, MI_Type type)
+    {
+        Clear();
+        m_type = type;
+        if (value)
+        {
+            CopyValue(*value, type, m_value);
+            m_isNull = false;
+        }
+    }
+
+    void Clear()
+    {
+        if (!m_isNull)
+        {
+            FreeValue(m_value, m_type);
+            m_isNull = true;
+        }
+    }
+
+    ~OwnedValue()
+    {
+        Clear();
+    }
+};
+
+/*
+**==============================================================================
+**
+** Class declarations
+**
+**==============================================================================
+*/
+
+struct QualifierImpl
+{
+    std::wstring m_name;
+    MI_Uint32 m_flags;
+    OwnedValue m_value;
+};
+
+typedef std::vector<QualifierImpl> QualifierList;
+
+struct PropertyImpl
+{
+    std::wstring m_name;
+    MI_Type m_type;
+    MI_Uint32 m_flags;
+    QualifierList m_qualifiers;
+    OwnedValue m_default;
+};
+
+struct ParameterImpl
+{
+    std::wstring m_name;
+    MI_Type m_type;
+    QualifierList m_qualifiers;
+};
+
+struct MethodImpl
+{
+    std::wstring m_name;
+    MI_Type m_returnType;
+    QualifierList m_qualifiers;
+    QualifierList m_returnQualifiers;
+    std::vector<ParameterImpl> m_parameters;
+};
+
+struct _MI_ClassDecl
+{
+    std::wstring m_name;
+    std::wstring m_namespace;
+    std::shared_ptr<const MI_ClassDecl> m_parent;
+    QualifierList m_qualifiers;
+    // Inherited members first, in declaration order
+    std::vector<PropertyImpl> m_properties;
+    std::vector<MethodImpl> m_methods;
+
+    bool IsA(const MI_ClassDecl* other) const
+    {
+        for (const MI_ClassDecl* decl = this; decl; decl = decl->m_parent.get())
+        {
+            if (decl == other)
+                return true;
+        }
+        return false;
+    }
+
+    bool IsA(const std::wstring& className) const
+    {
+        for (const MI_ClassDecl* decl = this; decl; decl = decl->m_parent.get())
+        {
+            if (IEquals(decl->m_name, className))
+                return true;
+        }
+        return false;
+    }
+
+    int FindProperty(const MI_Char* name) const
+    {
+        for (size_t i = 0; i < m_properties.size(); i++)
+        {
+            if (IEquals(m_properties[i].m_name.c_str(), name))
+                return (int)i;
+        }
+        return -1;
+    }
+
+    int FindMethod(const MI_Char* name) const
+    {
+        for (size_t i = 0; i < m_methods.size(); i++)
+        {
+            if (IEquals(m_methods[i].m_name.c_str(), name))
+                return (int)i;
+        }
+        return -1;
+    }
+};
+
+typedef std::shared_ptr<const MI_ClassDecl> ClassDeclPtr;
+
+static QualifierImpl MakeQualifier(const std::wstring& name, const std::wstring& value = L"")
+{
+    QualifierImpl q;
+    q.m_name = name;
+    q.m_flags = MI_FLAG_TOSUBCLASS;
+    MI_Value v;
+    if (value.length())
+    {
+        v.string = (MI_Char*)value.c_str();
+        q.m_value.Set(&v, MI_STRING);
+    }
+    else
+    {
+        v.boolean = MI_TRUE;
+        q.m_value.Set(&v, MI_BOOLEAN);
+    }
+    return q;
+}
+
+static bool HasQualifier(const QualifierList& qualifiers, const wchar_t* name)
+{
+    for (auto const& q : qualifiers)
+    {
+        if (IEquals(q.m_name.c_str(), name))
+            return true;
+    }
+    return false;
+}
+
+static QualifierList MakeQualifiers(const std::vector<QualifierDefinition>& definitions)
+{
+    QualifierList qualifiers;
+    for (auto const& d : definitions)
+    {
+        qualifiers.push_back(MakeQualifier(d.m_name, d.m_value));
+    }
+    return qualifiers;
+}
+
+/*
+**==============================================================================
+**
+** Instance
+**
+**==============================================================================
+*/
+
+struct ElementImpl
+{
+    std::wstring m_name;
+    MI_Type m_type;
+    MI_Uint32 m_flags;
+    OwnedValue m_value;
+};
+
+extern const MI_InstanceFT g_instanceFT;
+extern const MI_ClassFT g_classFT;
+
+struct StubInstance : public MI_Instance
+{
+    std::wstring m_className;
+    std::wstring m_namespace;
+    std::wstring m_serverName;
+    ClassDeclPtr m_decl;
+    std::vector<ElementImpl> m_elements;
+
+    StubInstance(const std::wstring& className, ClassDeclPtr decl = nullptr) :
+        m_className(className), m_decl(decl)
+    {
+        this->ft = &g_instanceFT;
+        memset(this->reserved, 0, sizeof(this->reserved));
+        if (decl)
+        {
+            for (auto const& p : decl->m_properties)
+            {
+                ElementImpl e;
+                e.m_name = p.m_name;
+                e.m_type = p.m_type;
+                e.m_flags = p.m_flags;
+                e.m_value = p.m_default;
+                e.m_value.m_type = p.m_type;
+                m_elements.push_back(std::move(e));
+            }
+        }
+        UpdateHeader();
+    }
+
+    StubInstance(const StubInstance& other) :
+        m_className(other.m_className), m_namespace(other.m_namespace), m_serverName(other.m_serverName),
+        m_decl(other.m_decl), m_elements(other.m_elements)
+    {
+        this->ft = &g_instanceFT;
+        memset(this->reserved, 0, sizeof(this->reserved));
+        UpdateHeader();
+    }
+
+    void UpdateHeader()
+    {
+        this->classDecl = m_decl.get();
+        this->nameSpace = m_namespace.length() ? m_namespace.c_str() : nullptr;
+        this->serverName = m_serverName.length() ? m_serverName.c_str() : nullptr;
+    }
+
+    int FindElement(const MI_Char* name) const
+    {
+        if (!name)
+            return -1;
+        // Linear, case insensitive, as in MI
+        for (size_t i = 0; i < m_elements.size(); i++)
+        {
+            if (IEquals(m_elements[i].m_name.c_str(), name))
+                return (int)i;
+        }
+        return -1;
+    }
+
+    const ElementImpl* GetElement(const MI_Char* name) const
+    {
+        int i = FindElement(name);
+        return i < 0 ? nullptr : &m_elements[i];
+    }
+
+    bool IsA(const std::wstring& className) const
+    {
+        return m_decl ? m_decl->IsA(className) : IEquals(m_className, className);
+    }
+};
+
+static StubInstance* AsStub(const MI_Instance* instance)
+{
+    return static_cast<StubInstance*>(const_cast<MI_Instance*>(instance));
+}
+
+struct StubClass : public MI_Class
+{
+    ClassDeclPtr m_decl;
+    std::wstring m_namespace;
+    std::wstring m_serverName;
+
+    StubClass(ClassDeclPtr decl, const std::wstring& ns, const std::wstring& serverName) :
+        m_decl(decl), m_namespace(ns), m_serverName(serverName)
+    {
+        this->ft = &g_classFT;
+        this->classDecl = decl.get();
+        this->namespaceName = m_namespace.length() ? m_namespace.c_str() : nullptr;
+        this->serverName = m_serverName.length() ? m_serverName.c_str() : nullptr;
+        memset(this->reserved, 0, sizeof(this->reserved));
+    }
+};
+
+static StubClass* AsStub(const MI_Class* miClass)
+{
+    return static_cast<StubClass*>(const_cast<MI_Class*>(miClass));
+}
+
+// Class of an instance created without class information, built from its elements.
+static ClassDeclPtr MakeDynamicClassDecl(const StubInstance* instance)
+{
+    auto decl = std::make_shared<MI_ClassDecl>();
+    decl->m_name = instance->m_className;
+    decl->m_namespace = instance->m_namespace;
+    for (auto const& e : instance->m_elements)
+    {
+        PropertyImpl p;
+        p.m_name = e.m_name;
+        p.m_type = e.m_type;
+        p.m_flags = e.m_flags & ~(MI_FLAG_NULL | MI_FLAG_BORROW | MI_FLAG_ADOPT);
+        decl->m_properties.push_back(std::move(p));
+    }
+    return decl;
+}
+
+static MI_Result MI_CALL Instance_Clone(const MI_Instance* self, MI_Instance** newInstance)
+{
+    if (!newInstance)
+        return MI_RESULT_INVALID_PARAMETER;
+    *newInstance = new StubInstance(*AsStub(self));
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_Delete(MI_Instance* self)
+{
+    delete AsStub(self);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_IsA(const MI_Instance* self, const MI_ClassDecl* classDecl, MI_Boolean* flag)
+{
+    if (!flag)
+        return MI_RESULT_INVALID_PARAMETER;
+    auto decl = AsStub(self)->m_decl;
+    *flag = decl && decl->IsA(classDecl) ? MI_TRUE : MI_FALSE;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_GetClassName(const MI_Instance* self, const MI_Char** className)
+{
+    if (!className)
+        return MI_RESULT_INVALID_PARAMETER;
+    *className = AsStub(self)->m_className.c_str();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_SetNameSpace(MI_Instance* self, const MI_Char* nameSpace)
+{
+    auto instance = AsStub(self);
+    instance->m_namespace = nameSpace ? nameSpace : L"";
+    instance->UpdateHeader();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_GetNameSpace(const MI_Instance* self, const MI_Char** nameSpace)
+{
+    if (!nameSpace)
+        return MI_RESULT_INVALID_PARAMETER;
+    *nameSpace = self->nameSpace;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_GetElementCount(const MI_Instance* self, MI_Uint32* count)
+{
+    if (!count)
+        return MI_RESULT_INVALID_PARAMETER;
+    *count = (MI_Uint32)AsStub(self)->m_elements.size();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_AddElement(MI_Instance* self, const MI_Char* name, const MI_Value* value,
+    MI_Type type, MI_Uint32 flags)
+{
+    auto instance = AsStub(self);
+    if (!name)
+        return MI_RESULT_INVALID_PARAMETER;
+    if (instance->FindElement(name) >= 0)
+        return MI_RESULT_ALREADY_EXISTS;
+
+    ElementImpl e;
+    e.m_name = name;
+    e.m_type = type;
+    e.m_flags = flags & ~(MI_FLAG_NULL | MI_FLAG_BORROW | MI_FLAG_ADOPT);
+    e.m_value.Set((flags & MI_FLAG_NULL) ? nullptr : value, type);
+    instance->m_elements.push_back(std::move(e));
+    return MI_RESULT_OK;
+}
+
+static MI_Result SetElementValue(StubInstance* instance, size_t index, const MI_Value* value, MI_Type type,
+    MI_Uint32 flags)
+{
+    ElementImpl& e = instance->m_elements[index];
+    bool isNull = !value || (flags & MI_FLAG_NULL);
+    if (type != e.m_type)
+    {
+        if (instance->m_decl && !isNull)
+            return MI_RESULT_TYPE_MISMATCH;
+        if (!instance->m_decl)
+            e.m_type = type;
+    }
+    e.m_value.Set(isNull ? nullptr : value, e.m_type);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_SetElement(MI_Instance* self, const MI_Char* name, const MI_Value* value,
+    MI_Type type, MI_Uint32 flags)
+{
+    auto instance = AsStub(self);
+    int index = instance->FindElement(name);
+    if (index < 0)
+        return MI_RESULT_NO_SUCH_PROPERTY;
+    return SetElementValue(instance, index, value, type, flags);
+}
+
+static MI_Result MI_CALL Instance_SetElementAt(MI_Instance* self, MI_Uint32 index, const MI_Value* value,
+    MI_Type type, MI_Uint32 flags)
+{
+    auto instance = AsStub(self);
+    if (index >= instance->m_elements.size())
+        return MI_RESULT_NOT_FOUND;
+    return SetElementValue(instance, index, value, type, flags);
+}
+
+static void GetElementData(const ElementImpl& e, MI_Value* value, MI_Type* type, MI_Uint32* flags)
+{
+    if (value)
+    {
+        if (e.m_value.m_isNull)
+            memset(value, 0, sizeof(MI_Value));
+        else
+            memcpy(value, &e.m_value.m_value, sizeof(MI_Value));
+    }
+    if (type)
+        *type = e.m_type;
+    if (flags)
+        *flags = e.m_flags | (e.m_value.m_isNull ? MI_FLAG_NULL : 0);
+}
+
+static MI_Result MI_CALL Instance_GetElement(const MI_Instance* self, const MI_Char* name, MI_Value* value,
+    MI_Type* type, MI_Uint32* flags, MI_Uint32* index)
+{
+    auto instance = AsStub(self);
+    int i = instance->FindElement(name);
+    if (i < 0)
+        return MI_RESULT_NO_SUCH_PROPERTY;
+    GetElementData(instance->m_elements[i], value, type, flags);
+    if (index)
+        *index = (MI_Uint32)i;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_GetElementAt(const MI_Instance* self, MI_Uint32 index, const MI_Char** name,
+    MI_Value* value, MI_Type* type, MI_Uint32* flags)
+{
+    auto instance = AsStub(self);
+    if (index >= instance->m_elements.size())
+        return MI_RESULT_NOT_FOUND;
+    const ElementImpl& e = instance->m_elements[index];
+    if (name)
+        *name = e.m_name.c_str();
+    GetElementData(e, value, type, flags);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_ClearElement(MI_Instance* self, const MI_Char* name)
+{
+    auto instance = AsStub(self);
+    int i = instance->FindElement(name);
+    if (i < 0)
+        return MI_RESULT_NO_SUCH_PROPERTY;
+    instance->m_elements[i].m_value.Clear();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_ClearElementAt(MI_Instance* self, MI_Uint32 index)
+{
+    auto instance = AsStub(self);
+    if (index >= instance->m_elements.size())
+        return MI_RESULT_NOT_FOUND;
+    instance->m_elements[index].m_value.Clear();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_GetServerName(const MI_Instance* self, const MI_Char** serverName)
+{
+    if (!serverName)
+        return MI_RESULT_INVALID_PARAMETER;
+    *serverName = self->serverName;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_SetServerName(MI_Instance* self, const MI_Char* serverName)
+{
+    auto instance = AsStub(self);
+    instance->m_serverName = serverName ? serverName : L"";
+    instance->UpdateHeader();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Instance_GetClass(const MI_Instance* self, MI_Class** instanceClass)
+{
+    if (!instanceClass)
+        return MI_RESULT_INVALID_PARAMETER;
+    auto instance = AsStub(self);
+    auto decl = instance->m_decl ? instance->m_decl : MakeDynamicClassDecl(instance);
+    *instanceClass = new StubClass(decl, instance->m_namespace, instance->m_serverName);
+    return MI_RESULT_OK;
+}
+
+const MI_InstanceFT g_instanceFT =
+{
+    Instance_Clone,
+    Instance_Delete,
+    Instance_Delete,
+    Instance_IsA,
+    Instance_GetClassName,
+    Instance_SetNameSpace,
+    Instance_GetNameSpace,
+    Instance_GetElementCount,
+    Instance_AddElement,
+    Instance_SetElement,
+    Instance_SetElementAt,
+    Instance_GetElement,
+    Instance_GetElementAt,
+    Instance_ClearElement,
+    Instance_ClearElementAt,
+    Instance_GetServerName,
+    Instance_SetServerName,
+    Instance_GetClass
+};
+
+/*
+**==============================================================================
+**
+** Qualifier and parameter sets
+**
+**==============================================================================
+*/
+
+extern const MI_QualifierSetFT g_qualifierSetFT;
+extern const MI_ParameterSetFT g_parameterSetFT;
+
+static void MakeQualifierSet(const QualifierList& qualifiers, MI_QualifierSet* qualifierSet)
+{
+    if (qualifierSet)
+    {
+        memset(qualifierSet, 0, sizeof(MI_QualifierSet));
+        qualifierSet->reserved2 = (ptrdiff_t)&qualifiers;
+        qualifierSet->ft = &g_qualifierSetFT;
+    }
+}
+
+static const QualifierList* GetQualifierList(const MI_QualifierSet* self)
+{
+    return (const QualifierList*)self->reserved2;
+}
+
+static MI_Result MI_CALL QualifierSet_GetQualifierCount(const MI_QualifierSet* self, MI_Uint32* count)
+{
+    if (!count)
+        return MI_RESULT_INVALID_PARAMETER;
+    *count = (MI_Uint32)GetQualifierList(self)->size();
+    return MI_RESULT_OK;
+}
+
+static void GetQualifierData(const QualifierImpl& q, MI_Type* qualifierType, MI_Uint32* qualifierFlags,
+    MI_Value* qualifierValue)
+{
+    if (qualifierType)
+        *qualifierType = q.m_value.m_type;
+    if (qualifierFlags)
+        *qualifierFlags = q.m_flags;
+    if (qualifierValue)
+        memcpy(qualifierValue, &q.m_value.m_value, sizeof(MI_Value));
+}
+
+static MI_Result MI_CALL QualifierSet_GetQualifierAt(const MI_QualifierSet* self, MI_Uint32 index,
+    const MI_Char** name, MI_Type* qualifierType, MI_Uint32* qualifierFlags, MI_Value* qualifierValue)
+{
+    auto qualifiers = GetQualifierList(self);
+    if (index >= qualifiers->size())
+        return MI_RESULT_NOT_FOUND;
+    auto const& q = (*qualifiers)[index];
+    if (name)
+        *name = q.m_name.c_str();
+    GetQualifierData(q, qualifierType, qualifierFlags, qualifierValue);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL QualifierSet_GetQualifier(const MI_QualifierSet* self, const MI_Char* name,
+    MI_Type* qualifierType, MI_Uint32* qualifierFlags, MI_Value* qualifierValue, MI_Uint32* index)
+{
+    auto qualifiers = GetQualifierList(self);
+    for (size_t i = 0; i < qualifiers->size(); i++)
+    {
+        auto const& q = (*qualifiers)[i];
+        if (IEquals(q.m_name.c_str(), name))
+        {
+            GetQualifierData(q, qualifierType, qualifierFlags, qualifierValue);
+            if (index)
+                *index = (MI_Uint32)i;
+            return MI_RESULT_OK;
+        }
+    }
+    return MI_RESULT_NOT_FOUND;
+}
+
+const MI_QualifierSetFT g_qualifierSetFT =
+{
+    QualifierSet_GetQualifierCount,
+    QualifierSet_GetQualifierAt,
+    QualifierSet_GetQualifier
+};
+
+static const MethodImpl* GetMethodImpl(const MI_ParameterSet* self)
+{
+    return (const MethodImpl*)self->reserved2;
+}
+
+static MI_Result MI_CALL ParameterSet_GetMethodReturnType(const MI_ParameterSet* self, MI_Type* returnType,
+    MI_QualifierSet* qualifierSet)
+{
+    auto method = GetMethodImpl(self);
+    if (returnType)
+        *returnType = method->m_returnType;
+    MakeQualifierSet(method->m_returnQualifiers, qualifierSet);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL ParameterSet_GetParameterCount(const MI_ParameterSet* self, MI_Uint32* count)
+{
+    if (!count)
+        return MI_RESULT_INVALID_PARAMETER;
+    *count = (MI_Uint32)GetMethodImpl(self)->m_parameters.size();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL ParameterSet_GetParameterAt(const MI_ParameterSet* self, MI_Uint32 index,
+    const MI_Char** name, MI_Type* parameterType, MI_Char** referenceClass, MI_QualifierSet* qualifierSet)
+{
+    auto method = GetMethodImpl(self);
+    if (index >= method->m_parameters.size())
+        return MI_RESULT_NOT_FOUND;
+    auto const& p = method->m_parameters[index];
+    if (name)
+        *name = p.m_name.c_str();
+    if (parameterType)
+        *parameterType = p.m_type;
+    if (referenceClass)
+        *referenceClass = nullptr;
+    MakeQualifierSet(p.m_qualifiers, qualifierSet);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL ParameterSet_GetParameter(const MI_ParameterSet* self, const MI_Char* name,
+    MI_Type* parameterType, MI_Char** referenceClass, MI_QualifierSet* qualifierSet, MI_Uint32* index)
+{
+    auto method = GetMethodImpl(self);
+    for (size_t i = 0; i < method->m_parameters.size(); i++)
+    {
+        if (IEquals(method->m_parameters[i].m_name.c_str(), name))
+        {
+            if (index)
+                *index = (MI_Uint32)i;
+            return ParameterSet_GetParameterAt(self, (MI_Uint32)i, nullptr, parameterType, referenceClass,
+                qualifierSet);
+        }
+    }
+    return MI_RESULT_NOT_FOUND;
+}
+
+const MI_ParameterSetFT g_parameterSetFT =
+{
+    ParameterSet_GetMethodReturnType,
+    ParameterSet_GetParameterCount,
+    ParameterSet_GetParameterAt,
+    ParameterSet_GetParameter
+};
+
+/*
+**==============================================================================
+**
+** Class
+**
+**==============================================================================
+*/
+
+static MI_Result MI_CALL Class_GetClassName(const MI_Class* self, const MI_Char** className)
+{
+    if (!className)
+        return MI_RESULT_INVALID_PARAMETER;
+    *className = AsStub(self)->m_decl->m_name.c_str();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Class_GetNameSpace(const MI_Class* self, const MI_Char** nameSpace)
+{
+    if (!nameSpace)
+        return MI_RESULT_INVALID_PARAMETER;
+    *nameSpace = self->namespaceName;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Class_GetServerName(const MI_Class* self, const MI_Char** serverName)
+{
+    if (!serverName)
+        return MI_RESULT_INVALID_PARAMETER;
+    *serverName = self->serverName;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Class_GetElementCount(const MI_Class* self, MI_Uint32* count)
+{
+    if (!count)
+        return MI_RESULT_INVALID_PARAMETER;
+    *count = (MI_Uint32)AsStub(self)->m_decl->m_properties.size();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Class_GetElementAt(const MI_Class* self, MI_Uint32 index, const MI_Char** name,
+    MI_Value* value, MI_Boolean* valueExists, MI_Type* type, MI_Char** referenceClass,
+    MI_QualifierSet* qualifierSet, MI_Uint32* flags)
+{
+    auto decl = AsStub(self)->m_decl;
+    if (index >= decl->m_properties.size())
+        return MI_RESULT_NOT_FOUND;
+    auto const& p = decl->m_properties[index];
+    if (name)
+        *name = p.m_name.c_str();
+    if (value)
+    {
+        if (p.m_default.m_isNull)
+            memset(value, 0, sizeof(MI_Value));
+        else
+            memcpy(value, &p.m_default.m_value, sizeof(MI_Value));
+    }
+    if (valueExists)
+        *valueExists = p.m_default.m_isNull ? MI_FALSE : MI_TRUE;
+    if (type)
+        *type = p.m_type;
+    if (referenceClass)
+        *referenceClass = nullptr;
+    if (flags)
+        *flags = p.m_flags | (p.m_default.m_isNull ? MI_FLAG_NULL : 0);
+    MakeQualifierSet(p.m_qualifiers, qualifierSet);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Class_GetElement(const MI_Class* self, const MI_Char* name, MI_Value* value,
+    MI_Boolean* valueExists, MI_Type* type, MI_Char** referenceClass, MI_QualifierSet* qualifierSet,
+    MI_Uint32* flags, MI_Uint32* index)
+{
+    int i = AsStub(self)->m_decl->FindProperty(name);
+    if (i < 0)
+        return MI_RESULT_NO_SUCH_PROPERTY;
+    if (index)
+        *index = (MI_Uint32)i;
+    return Class_GetElementAt(self, (MI_Uint32)i, nullptr, value, valueExists, type, referenceClass,
+        qualifierSet, flags);
+}
+
+static MI_Result MI_CALL Class_GetClassQualifierSet(const MI_Class* self, MI_QualifierSet* qualifierSet)
+{
+    if (!qualifierSet)
+        return MI_RESULT_INVALID_PARAMETER;
+    MakeQualifierSet(AsStub(self)->m_decl->m_qualifiers, qualifierSet);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Class_GetMethodCount(const MI_Class* self, MI_Uint32* count)
+{
+    if (!count)
+        return MI_RESULT_INVALID_PARAMETER;
+    *count = (MI_Uint32)AsStub(self)->m_decl->m_methods.size();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Class_GetMethodAt(const MI_Class* self, MI_Uint32 index, const MI_Char** name,
+    MI_QualifierSet* qualifierSet, MI_ParameterSet* parameterSet)
+{
+    auto decl = AsStub(self)->m_decl;
+    if (index >= decl->m_methods.size())
+        return MI_RESULT_METHOD_NOT_FOUND;
+    auto const& m = decl->m_methods[index];
+    if (name)
+        *name = m.m_name.c_str();
+    MakeQualifierSet(m.m_qualifiers, qualifierSet);
+    if (parameterSet)
+    {
+        memset(parameterSet, 0, sizeof(MI_ParameterSet));
+        parameterSet->reserved2 = (ptrdiff_t)&m;
+        parameterSet->ft = &g_parameterSetFT;
+    }
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Class_GetMethod(const MI_Class* self, const MI_Char* name, MI_QualifierSet* qualifierSet,
+    MI_ParameterSet* parameterSet, MI_Uint32* index)
+{
+    int i = AsStub(self)->m_decl->FindMethod(name);
+    if (i < 0)
+        return MI_RESULT_METHOD_NOT_FOUND;
+    if (index)
+        *index = (MI_Uint32)i;
+    return Class_GetMethodAt(self, (MI_Uint32)i, nullptr, qualifierSet, parameterSet);
+}
+
+static MI_Result MI_CALL Class_GetParentClassName(const MI_Class* self, const MI_Char** name)
+{
+    if (!name)
+        return MI_RESULT_INVALID_PARAMETER;
+    auto parent = AsStub(self)->m_decl->m_parent;
+    if (!parent)
+    {
+        *name = nullptr;
+        return MI_RESULT_INVALID_SUPERCLASS;
+    }
+    *name = parent->m_name.c_str();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Class_GetParentClass(const MI_Class* self, MI_Class** parentClass)
+{
+    if (!parentClass)
+        return MI_RESULT_INVALID_PARAMETER;
+    auto stubClass = AsStub(self);
+    auto parent = stubClass->m_decl->m_parent;
+    if (!parent)
+    {
+        *parentClass = nullptr;
+        return MI_RESULT_INVALID_SUPERCLASS;
+    }
+    *parentClass = new StubClass(parent, stubClass->m_namespace, stubClass->m_serverName);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Class_Delete(MI_Class* self)
+{
+    delete AsStub(self);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Class_Clone(const MI_Class* self, MI_Class** newClass)
+{
+    if (!newClass)
+        return MI_RESULT_INVALID_PARAMETER;
+    auto stubClass = AsStub(self);
+    *newClass = new StubClass(stubClass->m_decl, stubClass->m_namespace, stubClass->m_serverName);
+    return MI_RESULT_OK;
+}
+
+const MI_ClassFT g_classFT =
+{
+    Class_GetClassName,
+    Class_GetNameSpace,
+    Class_GetServerName,
+    Class_GetElementCount,
+    Class_GetElement,
+    Class_GetElementAt,
+    Class_GetClassQualifierSet,
+    Class_GetMethodCount,
+    Class_GetMethodAt,
+    Class_GetMethod,
+    Class_GetParentClassName,
+    Class_GetParentClass,
+    Class_Delete,
+    Class_Clone
+};
+
+/*
+**==============================================================================
+**
+** Value formatting, shared by the serializer and instance identity
+**
+**==============================================================================
+*/
+
+static void FormatInstanceXml(std::wostringstream& o, const StubInstance* instance);
+
+static void FormatDatetime(std::wostringstream& o, const MI_Datetime& dt)
+{
+    wchar_t buf[64];
+    if (dt.isTimestamp)
+    {
+        const MI_Timestamp& t = dt.u.timestamp;
+        swprintf(buf, 64, L"%04u%02u%02u%02u%02u%02u.%06u%lc%03d", t.year, t.month, t.day, t.hour, t.minute,
+            t.second, t.microseconds, t.utc < 0 ? L'-' : L'+', t.utc < 0 ? -t.utc : t.utc);
+    }
+    else
+    {
+        const MI_Interval& i = dt.u.interval;
+        swprintf(buf, 64, L"%08u%02u%02u%02u.%06u:000", i.days, i.hours, i.minutes, i.seconds, i.microseconds);
+    }
+    o << buf;
+}
+
+static void FormatScalar(std::wostringstream& o, const void* data, MI_Type type)
+{
+    switch (type)
+    {
+    case MI_BOOLEAN: o << (*(const MI_Boolean*)data ? L"true" : L"false"); break;
+    case MI_UINT8: o << (unsigned)*(const MI_Uint8*)data; break;
+    case MI_SINT8: o << (int)*(const MI_Sint8*)data; break;
+    case MI_UINT16: o << *(const MI_Uint16*)data; break;
+    case MI_SINT16: o << *(const MI_Sint16*)data; break;
+    case MI_UINT32: o << *(const MI_Uint32*)data; break;
+    case MI_SINT32: o << *(const MI_Sint32*)data; break;
+    case MI_UINT64: o << *(const MI_Uint64*)data; break;
+    case MI_SINT64: o << *(const MI_Sint64*)data; break;
+    case MI_REAL32: o << std::setprecision(9) << *(const MI_Real32*)data; break;
+    case MI_REAL64: o << std::setprecision(17) << *(const MI_Real64*)data; break;
+    case MI_CHAR16: o << (unsigned)*(const MI_Char16*)data; break;
+    case MI_DATETIME: FormatDatetime(o, *(const MI_Datetime*)data); break;
+    case MI_STRING:
+        {
+            const MI_Char* s = *(MI_Char* const*)data;
+            o << (s ? s : L"");
+        }
+        break;
+    case MI_INSTANCE:
+    case MI_REFERENCE:
+        {
+            const MI_Instance* instance = *(MI_Instance* const*)data;
+            if (instance)
+                FormatInstanceXml(o, AsStub(instance));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static std::wstring EscapeXml(const std::wstring& s)
+{
+    std::wstring escaped;
+    escaped.reserve(s.length());
+    for (wchar_t c : s)
+    {
+        switch (c)
+        {
+        case L'&': escaped += L"&amp;"; break;
+        case L'<': escaped += L"&lt;"; break;
+        case L'>': escaped += L"&gt;"; break;
+        case L'"': escaped += L"&quot;"; break;
+        case L'\'': escaped += L"&apos;"; break;
+        default: escaped += c; break;
+        }
+    }
+    return escaped;
+}
+
+static const wchar_t* TypeName(MI_Type type)
+{
+    static const wchar_t* names[] =
+    {
+        L"boolean", L"uint8", L"sint8", L"uint16", L"sint16", L"uint32", L"sint32", L"uint64", L"sint64",
+        L"real32", L"real64", L"char16", L"datetime", L"string", L"reference", L"string"
+    };
+    return names[type & ~MI_ARRAY];
+}
+
+static void FormatValueXml(std::wostringstream& o, const MI_Value& value, MI_Type type)
+{
+    if (type & MI_ARRAY)
+    {
+        MI_Type itemType = (MI_Type)(type & ~MI_ARRAY);
+        unsigned itemSize = GetItemSize(itemType);
+        o << L"<VALUE.ARRAY>";
+        for (MI_Uint32 i = 0; i < value.array.size; i++)
+        {
+            std::wostringstream item;
+            FormatScalar(item, (const MI_Uint8*)value.array.data + i * itemSize, itemType);
+            o << L"<VALUE>" << EscapeXml(item.str()) << L"</VALUE>";
+        }
+        o << L"</VALUE.ARRAY>";
+    }
+    else
+    {
+        std::wostringstream item;
+        FormatScalar(item, &value, type);
+        o << L"<VALUE>" << EscapeXml(item.str()) << L"</VALUE>";
+    }
+}
+
+static void FormatInstanceXml(std::wostringstream& o, const StubInstance* instance)
+{
+    o << L"<INSTANCE CLASSNAME=\"" << EscapeXml(instance->m_className) << L"\">";
+    for (auto const& e : instance->m_elements)
+    {
+        bool isArray = (e.m_type & MI_ARRAY) != 0;
+        o << (isArray ? L"<PROPERTY.ARRAY" : L"<PROPERTY") << L" NAME=\"" << EscapeXml(e.m_name)
+          << L"\" TYPE=\"" << TypeName(e.m_type) << L"\"";
+        if ((e.m_type & ~MI_ARRAY) == MI_INSTANCE)
+            o << L" EmbeddedObject=\"instance\"";
+        o << L">";
+        if (!e.m_value.m_isNull)
+            FormatValueXml(o, e.m_value.m_value, e.m_type);
+        o << (isArray ? L"</PROPERTY.ARRAY>" : L"</PROPERTY>");
+    }
+    o << L"</INSTANCE>";
+}
+
+static void FormatQualifiersXml(std::wostringstream& o, const QualifierList& qualifiers)
+{
+    for (auto const& q : qualifiers)
+    {
+        o << L"<QUALIFIER NAME=\"" << EscapeXml(q.m_name) << L"\" TYPE=\"" << TypeName(q.m_value.m_type) << L"\">";
+        FormatValueXml(o, q.m_value.m_value, q.m_value.m_type);
+        o << L"</QUALIFIER>";
+    }
+}
+
+static void FormatTypeXml(std::wostringstream& o, MI_Type type)
+{
+    o << L" TYPE=\"" << TypeName(type) << L"\"";
+    if ((type & ~MI_ARRAY) == MI_INSTANCE)
+        o << L" EmbeddedObject=\"instance\"";
+}
+
+// Written so that DeserializeClass can rebuild the same declaration
+static void FormatClassXml(std::wostringstream& o, const MI_ClassDecl* decl, bool deep)
+{
+    if (deep && decl->m_parent)
+        FormatClassXml(o, decl->m_parent.get(), deep);
+
+    o << L"<CLASS NAME=\"" << EscapeXml(decl->m_name) << L"\"";
+    if (decl->m_parent)
+        o << L" SUPERCLASS=\"" << EscapeXml(decl->m_parent->m_name) << L"\"";
+    o << L">";
+    FormatQualifiersXml(o, decl->m_qualifiers);
+    for (auto const& p : decl->m_properties)
+    {
+        const wchar_t* tag = (p.m_type & MI_ARRAY) ? L"PROPERTY.ARRAY" : L"PROPERTY";
+        o << L"<" << tag << L" NAME=\"" << EscapeXml(p.m_name) << L"\"";
+        FormatTypeXml(o, p.m_type);
+        o << L">";
+        FormatQualifiersXml(o, p.m_qualifiers);
+        if (!p.m_default.m_isNull)
+            FormatValueXml(o, p.m_default.m_value, p.m_type);
+        o << L"</" << tag << L">";
+    }
+    for (auto const& m : decl->m_methods)
+    {
+        o << L"<METHOD NAME=\"" << EscapeXml(m.m_name) << L"\"";
+        FormatTypeXml(o, m.m_returnType);
+        o << L">";
+        FormatQualifiersXml(o, m.m_qualifiers);
+        for (auto const& p : m.m_parameters)
+        {
+            const wchar_t* tag = (p.m_type & MI_ARRAY) ? L"PARAMETER.ARRAY" : L"PARAMETER";
+            o << L"<" << tag << L" NAME=\"" << EscapeXml(p.m_name) << L"\"";
+            FormatTypeXml(o, p.m_type);
+            o << L">";
+            FormatQualifiersXml(o, p.m_qualifiers);
+            o << L"</" << tag << L">";
+        }
+        o << L"</METHOD>";
+    }
+    o << L"</CLASS>";
+}
+
+/*
+**==============================================================================
+**
+** WQL
+**
+**==============================================================================
+*/
+
+namespace
+{
+    struct Token
+    {
+        enum Kind { End, Identifier, String, Number, Operator, Comma, Star, LParen, RParen } m_kind;
+        std::wstring m_text;
+    };
+
+    std::vector<Token> Tokenize(const std::wstring& query)
+    {
+        std::vector<Token> tokens;
+        size_t i = 0;
+        while (i < query.length())
+        {
+            wchar_t c = query[i];
+            if (iswspace(c))
+            {
+                i++;
+            }
+            else if (c == L'\'' || c == L'"')
+            {
+                std::wstring text;
+                i++;
+                while (i < query.length() && query[i] != c)
+                {
+                    if (query[i] == L'\\' && i + 1 < query.length())
+                        i++;
+                    text += query[i++];
+                }
+                if (i >= query.length())
+                    throw std::invalid_argument("Unterminated string literal");
+                i++;
+                tokens.push_back({ Token::String, text });
+            }
+            else if (iswdigit(c) || ((c == L'-' || c == L'+') && i + 1 < query.length() && iswdigit(query[i + 1])))
+            {
+                size_t start = i++;
+                while (i < query.length() && (iswdigit(query[i]) || query[i] == L'.'))
+                    i++;
+                tokens.push_back({ Token::Number, query.substr(start, i - start) });
+            }
+            else if (iswalpha(c) || c == L'_')
+            {
+                size_t start = i;
+                while (i < query.length() && (iswalnum(query[i]) || query[i] == L'_' || query[i] == L'.'))
+                    i++;
+                tokens.push_back({ Token::Identifier, query.substr(start, i - start) });
+            }
+            else if (c == L',')
+            {
+                tokens.push_back({ Token::Comma, L"," });
+                i++;
+            }
+            else if (c == L'*')
+            {
+                tokens.push_back({ Token::Star, L"*" });
+                i++;
+            }
+            else if (c == L'(')
+            {
+                tokens.push_back({ Token::LParen, L"(" });
+                i++;
+            }
+            else if (c == L')')
+            {
+                tokens.push_back({ Token::RParen, L")" });
+                i++;
+            }
+            else if (c == L'=' || c == L'<' || c == L'>' || c == L'!')
+            {
+                size_t start = i++;
+                if (i < query.length() && (query[i] == L'=' || query[i] == L'>'))
+                    i++;
+                tokens.push_back({ Token::Operator, query.substr(start, i - start) });
+            }
+            else
+            {
+                throw std::invalid_argument("Unexpected character in query");
+            }
+        }
+        tokens.push_back({ Token::End, L"" });
+        return tokens;
+    }
+
+    struct Condition
+    {
+        enum Kind { Compare, And, Or, Not, IsNull, IsNotNull, Isa, Like } m_kind;
+        std::wstring m_property;
+        std::wstring m_operator;
+        Token m_literal;
+        std::unique_ptr<Condition> m_left;
+        std::unique_ptr<Condition> m_right;
+    };
+
+    struct Query
+    {
+        std::wstring m_className;
+        std::unique_ptr<Condition> m_where;
+    };
+
+    class QueryParser
+    {
+    private:
+        std::vector<Token> m_tokens;
+        size_t m_pos = 0;
+
+        const Token& Peek() const { return m_tokens[m_pos]; }
+        const Token& Next() { return m_tokens[m_pos < m_tokens.size() - 1 ? m_pos++ : m_pos]; }
+
+        bool IsKeyword(const wchar_t* keyword) const
+        {
+            return Peek().m_kind == Token::Identifier && IEquals(Peek().m_text.c_str(), keyword);
+        }
+
+        void Expect(const wchar_t* keyword)
+        {
+            if (!IsKeyword(keyword))
+                throw std::invalid_argument("Invalid query");
+            Next();
+        }
+
+        std::unique_ptr<Condition> ParseOr()
+        {
+            auto left = ParseAnd();
+            while (IsKeyword(L"OR"))
+            {
+                Next();
+                std::unique_ptr<Condition> c(new Condition());
+                c->m_kind = Condition::Or;
+                c->m_left = std::move(left);
+                c->m_right = ParseAnd();
+                left = std::move(c);
+            }
+            return left;
+        }
+
+        std::unique_ptr<Condition> ParseAnd()
+        {
+            auto left = ParseUnary();
+            while (IsKeyword(L"AND"))
+            {
+                Next();
+                std::unique_ptr<Condition> c(new Condition());
+                c->m_kind = Condition::And;
+                c->m_left = std::move(left);
+                c->m_right = ParseUnary();
+                left = std::move(c);
+            }
+            return left;
+        }
+
+        std::unique_ptr<Condition> ParseUnary()
+        {
+            std::unique_ptr<Condition> c(new Condition());
+            if (IsKeyword(L"NOT"))
+            {
+                Next();
+                c->m_kind = Condition::Not;
+                c->m_left = ParseUnary();
+                return c;
+            }
+            if (Peek().m_kind == Token::LParen)
+            {
+                Next();
+                auto inner = ParseOr();
+                if (Next().m_kind != Token::RParen)
+                    throw std::invalid_argument("Invalid query");
+                return inner;
+            }
+            if (Peek().m_kind != Token::Identifier)
+                throw std::invalid_argument("Invalid query");
+            c->m_property = Next().m_text;
+            if (IsKeyword(L"IS"))
+            {
+                Next();
+                c->m_kind = Condition::IsNull;
+                if (IsKeyword(L"NOT"))
+                {
+                    Next();
+                    c->m_kind = Condition::IsNotNull;
+                }
+                Expect(L"NULL");
+                return c;
+            }
+            if (IsKeyword(L"ISA") || IsKeyword(L"LIKE"))
+            {
+                c->m_kind = IsKeyword(L"ISA") ? Condition::Isa : Condition::Like;
+                Next();
+            }
+            else if (Peek().m_kind == Token::Operator)
+            {
+                c->m_kind = Condition::Compare;
+                c->m_operator = Next().m_text;
+            }
+            else
+            {
+                throw std::invalid_argument("Invalid query");
+            }
+            const Token& literal = Next();
+            if (literal.m_kind != Token::String && literal.m_kind != Token::Number &&
+                literal.m_kind != Token::Identifier)
+                throw std::invalid_argument("Invalid query");
+            c->m_literal = literal;
+            return c;
+        }
+
+    public:
+        QueryParser(const std::wstring& query) : m_tokens(Tokenize(query)) {}
+
+        Query Parse()
+        {
+            Query query;
+            Expect(L"SELECT");
+            while (Peek().m_kind != Token::End && !IsKeyword(L"FROM"))
+                Next();
+            Expect(L"FROM");
+            if (Peek().m_kind != Token::Identifier)
+                throw std::invalid_argument("Invalid query");
+            query.m_className = Next().m_text;
+            if (IsKeyword(L"WITHIN"))
+            {
+                Next();
+                Next();
+            }
+            if (IsKeyword(L"WHERE"))
+            {
+                Next();
+                query.m_where = ParseOr();
+            }
+            if (Peek().m_kind != Token::End)
+                throw std::invalid_argument("Invalid query");
+            return query;
+        }
+    };
+
+    const ElementImpl* ResolveProperty(const StubInstance* instance, const std::wstring& path)
+    {
+        size_t start = 0;
+        while (instance)
+        {
+            size_t dot = path.find(L'.', start);
+            auto e = instance->GetElement(path.substr(start, dot == std::wstring::npos ? dot : dot - start).c_str());
+            if (!e || dot == std::wstring::npos)
+                return e;
+            if (e->m_type != MI_INSTANCE || e->m_value.m_isNull)
+                return nullptr;
+            instance = AsStub(e->m_value.m_value.instance);
+            start = dot + 1;
+        }
+        return nullptr;
+    }
+
+    bool ToNumber(const ElementImpl& e, double& number)
+    {
+        const MI_Value& v = e.m_value.m_value;
+        switch (e.m_type)
+        {
+        case MI_BOOLEAN: number = v.boolean; return true;
+        case MI_UINT8: number = v.uint8; return true;
+        case MI_SINT8: number = v.sint8; return true;
+        case MI_UINT16: number = v.uint16; return true;
+        case MI_SINT16: number = v.sint16; return true;
+        case MI_UINT32: number = v.uint32; return true;
+        case MI_SINT32: number = v.sint32; return true;
+        case MI_UINT64: number = (double)v.uint64; return true;
+        case MI_SINT64: number = (double)v.sint64; return true;
+        case MI_REAL32: number = v.real32; return true;
+        case MI_REAL64: number = v.real64; return true;
+        case MI_CHAR16: number = v.char16; return true;
+        default: return false;
+        }
+    }
+
+    bool LikeMatch(const wchar_t* s, const wchar_t* pattern)
+    {
+        if (!*pattern)
+            return !*s;
+        if (*pattern == L'%')
+        {
+            for (; ; s++)
+            {
+                if (LikeMatch(s, pattern + 1))
+                    return true;
+                if (!*s)
+                    return false;
+            }
+        }
+        if (!*s)
+            return false;
+        if (*pattern == L'_' || towlower(*pattern) == towlower(*s))
+            return LikeMatch(s + 1, pattern + 1);
+        return false;
+    }
+
+    bool Compare(int cmp, const std::wstring& op)
+    {
+        if (op == L"=")
+            return cmp == 0;
+        if (op == L"<>" || op == L"!=")
+            return cmp != 0;
+        if (op == L"<")
+            return cmp < 0;
+        if (op == L"<=")
+            return cmp <= 0;
+        if (op == L">")
+            return cmp > 0;
+        if (op == L">=")
+            return cmp >= 0;
+        return false;
+    }
+
+    bool Evaluate(const Condition* c, const StubInstance* instance)
+    {
+        switch (c->m_kind)
+        {
+        case Condition::And:
+            return Evaluate(c->m_left.get(), instance) && Evaluate(c->m_right.get(), instance);
+        case Condition::Or:
+            return Evaluate(c->m_left.get(), instance) || Evaluate(c->m_right.get(), instance);
+        case Condition::Not:
+            return !Evaluate(c->m_left.get(), instance);
+        default:
+            break;
+        }
+
+        auto e = ResolveProperty(instance, c->m_property);
+        bool isNull = !e || e->m_value.m_isNull;
+        switch (c->m_kind)
+        {
+        case Condition::IsNull:
+            return isNull;
+        case Condition::IsNotNull:
+            return !isNull;
+        case Condition::Isa:
+            return !isNull && e->m_type == MI_INSTANCE && AsStub(e->m_value.m_value.instance)->IsA(c->m_literal.m_text);
+        case Condition::Like:
+            return !isNull && e->m_type == MI_STRING && LikeMatch(e->m_value.m_value.string, c->m_literal.m_text.c_str());
+        default:
+            break;
+        }
+        if (isNull)
+            return false;
+
+        if (e->m_type == MI_STRING)
+        {
+            std::wstring a = ToLower(e->m_value.m_value.string);
+            std::wstring b = ToLower(c->m_literal.m_text);
+            return Compare(a.compare(b), c->m_operator);
+        }
+
+        double a = 0;
+        if (!ToNumber(*e, a))
+            return false;
+        double b = 0;
+        if (c->m_literal.m_kind == Token::Identifier)
+        {
+            if (IEquals(c->m_literal.m_text.c_str(), L"TRUE"))
+                b = 1;
+            else if (!IEquals(c->m_literal.m_text.c_str(), L"FALSE"))
+                return false;
+        }
+        else
+        {
+            b = wcstod(c->m_literal.m_text.c_str(), nullptr);
+        }
+        return Compare(a < b ? -1 : (a > b ? 1 : 0), c->m_operator);
+    }
+}
+
+/*
+**==============================================================================
+**
+** Repository
+**
+**==============================================================================
+*/
+
+typedef std::shared_ptr<const StubInstance> InstancePtr;
+
+struct OperationImpl;
+
+struct AssociationImpl
+{
+    std::wstring m_namespace;
+    std::wstring m_assocClassName;
+    std::wstring m_left;
+    std::wstring m_right;
+};
+
+struct HostState
+{
+    std::chrono::microseconds m_latency{ 0 };
+    std::chrono::microseconds m_connectLatency{ 0 };
+    std::chrono::microseconds m_batchLatency{ 0 };
+    size_t m_batchSize = 0;
+    bool m_unreachable = false;
+    std::map<std::wstring, std::vector<InstancePtr>> m_instances;
+    std::vector<AssociationImpl> m_associations;
+};
+
+class Repository
+{
+public:
+    std::mutex m_mutex;
+    std::wstring m_localComputerName = L"localhost";
+    std::wstring m_errorClassName = L"MSFT_WmiError";
+    size_t m_openSessions = 0;
+    std::map<std::wstring, ClassDeclPtr> m_classes;
+    std::map<std::wstring, ClassDeclPtr> m_builtinClasses;
+    std::map<std::wstring, HostState> m_hosts;
+    std::map<std::wstring, MethodHandler> m_methodHandlers;
+    std::vector<OperationImpl*> m_subscriptions;
+
+    Repository()
+    {
+        DefineBuiltinClasses();
+    }
+
+    static Repository& Get()
+    {
+        static Repository repository;
+        return repository;
+    }
+
+    std::wstring NormalizeHost(const std::wstring& host)
+    {
+        if (!host.length() || host == L"." || IEquals(host, L"localhost"))
+            return m_localComputerName;
+        return host;
+    }
+
+    static std::wstring ClassKey(const std::wstring& ns, const std::wstring& className)
+    {
+        return NormalizeNamespace(ns) + L":" + ToLower(className);
+    }
+
+    ClassDeclPtr FindClass(const std::wstring& ns, const std::wstring& className)
+    {
+        auto it = m_classes.find(ClassKey(ns, className));
+        if (it != m_classes.end())
+            return it->second;
+        auto it2 = m_builtinClasses.find(ToLower(className));
+        if (it2 != m_builtinClasses.end())
+            return it2->second;
+        return nullptr;
+    }
+
+    HostState& GetHost(const std::wstring& host)
+    {
+        return m_hosts[ToLower(NormalizeHost(host))];
+    }
+
+    HostState* FindHost(const std::wstring& host)
+    {
+        auto it = m_hosts.find(ToLower(NormalizeHost(host)));
+        return it == m_hosts.end() ? nullptr : &it->second;
+    }
+
+    ClassDeclPtr BuildClassDecl(const ClassDefinition& definition, ClassDeclPtr parent)
+    {
+        auto decl = std::make_shared<MI_ClassDecl>();
+        decl->m_name = definition.m_name;
+        decl->m_namespace = definition.m_namespace;
+        decl->m_parent = parent;
+        decl->m_qualifiers = MakeQualifiers(definition.m_qualifiers);
+        if (parent)
+        {
+            decl->m_properties = parent->m_properties;
+            decl->m_methods = parent->m_methods;
+        }
+
+        for (auto const& p : definition.m_properties)
+        {
+            PropertyImpl prop;
+            prop.m_name = p.m_name;
+            prop.m_type = p.m_type;
+            prop.m_flags = p.m_flags | MI_FLAG_PROPERTY;
+            prop.m_qualifiers = MakeQualifiers(p.m_qualifiers);
+            if ((p.m_flags & MI_FLAG_KEY) && !HasQualifier(prop.m_qualifiers, L"Key"))
+                prop.m_qualifiers.push_back(MakeQualifier(L"Key"));
+            prop.m_default.m_type = p.m_type;
+
+            int i = decl->FindProperty(p.m_name.c_str());
+            if (i >= 0)
+                decl->m_properties[i] = std::move(prop);
+            else
+                decl->m_properties.push_back(std::move(prop));
+        }
+
+        for (auto const& m : definition.m_methods)
+        {
+            MethodImpl method;
+            method.m_name = m.m_name;
+            method.m_returnType = m.m_returnType;
+            method.m_qualifiers = MakeQualifiers(m.m_qualifiers);
+            if ((m.m_flags & MI_FLAG_STATIC) && !HasQualifier(method.m_qualifiers, L"Static"))
+                method.m_qualifiers.push_back(MakeQualifier(L"Static"));
+            for (auto const& p : m.m_parameters)
+            {
+                ParameterImpl param;
+                param.m_name = p.m_name;
+                param.m_type = p.m_type;
+                param.m_qualifiers = MakeQualifiers(p.m_qualifiers);
+                if ((p.m_flags & MI_FLAG_IN) && !HasQualifier(param.m_qualifiers, L"In"))
+                    param.m_qualifiers.push_back(MakeQualifier(L"In"));
+                if ((p.m_flags & MI_FLAG_OUT) && !HasQualifier(param.m_qualifiers, L"Out"))
+                    param.m_qualifiers.push_back(MakeQualifier(L"Out"));
+                method.m_parameters.push_back(std::move(param));
+            }
+
+            int i = decl->FindMethod(m.m_name.c_str());
+            if (i >= 0)
+                decl->m_methods[i] = std::move(method);
+            else
+                decl->m_methods.push_back(std::move(method));
+        }
+        return decl;
+    }
+
+    void DefineBuiltinClasses()
+    {
+        ClassDefinition cimError = { L"", L"CIM_Error", L"", {
+            { L"ErrorType", MI_UINT16, 0 },
+            { L"OtherErrorType", MI_STRING, 0 },
+            { L"OwningEntity", MI_STRING, 0 },
+            { L"MessageID", MI_STRING, 0 },
+            { L"Message", MI_STRING, 0 },
+            { L"MessageArguments", MI_STRINGA, 0 },
+            { L"PerceivedSeverity", MI_UINT16, 0 },
+            { L"ProbableCause", MI_UINT16, 0 },
+            { L"CIMStatusCode", MI_UINT32, 0 },
+        } };
+        auto cimErrorDecl = BuildClassDecl(cimError, nullptr);
+        m_builtinClasses[L"cim_error"] = cimErrorDecl;
+
+        ClassDefinition wmiError = { L"", L"MSFT_WmiError", L"CIM_Error", {
+            { L"error_Category", MI_UINT16, 0 },
+            { L"error_Code", MI_UINT32, 0 },
+            { L"error_Type", MI_STRING, 0 },
+            { L"error_WindowsErrorMessage", MI_STRING, 0 },
+        } };
+        m_builtinClasses[L"msft_wmierror"] = BuildClassDecl(wmiError, cimErrorDecl);
+
+        // Fetched by the wmi module to validate new connections
+        ClassDefinition provider = { L"", L"__Provider", L"", {
+            { L"Name", MI_STRING, MI_FLAG_KEY },
+        } };
+        m_builtinClasses[L"__provider"] = BuildClassDecl(provider, nullptr);
+    }
+
+    // Class name and key values, used to match instances across operations.
+    std::wstring GetIdentity(const std::wstring& ns, const StubInstance* instance)
+    {
+        auto decl = instance->m_decl ? instance->m_decl : FindClass(ns, instance->m_className);
+        std::wostringstream o;
+        o << ToLower(instance->m_className);
+        if (decl)
+        {
+            for (auto const& p : decl->m_properties)
+            {
+                if (!(p.m_flags & MI_FLAG_KEY))
+                    continue;
+                o << L"," << ToLower(p.m_name) << L"=";
+                auto e = instance->GetElement(p.m_name.c_str());
+                if (e && !e->m_value.m_isNull)
+                    FormatScalar(o, &e->m_value.m_value, e->m_type);
+            }
+        }
+        return o.str();
+    }
+
+    std::vector<InstancePtr>* FindInstances(const std::wstring& host, const std::wstring& ns)
+    {
+        auto h = FindHost(host);
+        if (!h)
+            return nullptr;
+        auto it = h->m_instances.find(NormalizeNamespace(ns));
+        return it == h->m_instances.end() ? nullptr : &it->second;
+    }
+
+    // Copy of "instance" bound to its class declaration, with the same element layout.
+    std::unique_ptr<StubInstance> Bind(const std::wstring& host, const std::wstring& ns,
+        const StubInstance* instance, MI_Result& result)
+    {
+        auto decl = FindClass(ns, instance->m_className);
+        if (!decl)
+        {
+            result = MI_RESULT_INVALID_CLASS;
+            return nullptr;
+        }
+        std::unique_ptr<StubInstance> bound(new StubInstance(decl->m_name, decl));
+        for (auto const& e : instance->m_elements)
+        {
+            int i = bound->FindElement(e.m_name.c_str());
+            if (i < 0)
+            {
+                result = MI_RESULT_NO_SUCH_PROPERTY;
+                return nullptr;
+            }
+            if (!e.m_value.m_isNull && e.m_type != bound->m_elements[i].m_type)
+            {
+                result = MI_RESULT_TYPE_MISMATCH;
+                return nullptr;
+            }
+            bound->m_elements[i].m_value = e.m_value;
+            bound->m_elements[i].m_value.m_type = bound->m_elements[i].m_type;
+        }
+        bound->m_namespace = ns;
+        bound->m_serverName = NormalizeHost(host);
+        bound->UpdateHeader();
+        result = MI_RESULT_OK;
+        return bound;
+    }
+};
+
+/*
+**==============================================================================
+**
+** Options
+**
+**==============================================================================
+*/
+
+struct OperationOptionsImpl
+{
+    MI_Interval m_timeout;
+    std::map<std::wstring, OwnedValue> m_customOptions;
+
+    OperationOptionsImpl()
+    {
+        memset(&m_timeout, 0, sizeof(m_timeout));
+    }
+};
+
+struct DestinationOptionsImpl
+{
+    MI_Interval m_timeout;
+    std::wstring m_locale;
+    std::wstring m_transport;
+    std::vector<std::wstring> m_credentials;
+
+    DestinationOptionsImpl()
+    {
+        memset(&m_timeout, 0, sizeof(m_timeout));
+    }
+};
+
+extern const MI_OperationOptionsFT g_operationOptionsFT;
+extern const MI_DestinationOptionsFT g_destinationOptionsFT;
+
+static OperationOptionsImpl* GetImpl(const MI_OperationOptions* options)
+{
+    return (OperationOptionsImpl*)options->reserved2;
+}
+
+static DestinationOptionsImpl* GetImpl(const MI_DestinationOptions* options)
+{
+    return (DestinationOptionsImpl*)options->reserved2;
+}
+
+static void MI_CALL OperationOptions_Delete(MI_OperationOptions* options)
+{
+    delete GetImpl(options);
+    memset(options, 0, sizeof(MI_OperationOptions));
+}
+
+static MI_Result MI_CALL OperationOptions_SetTimeout(MI_OperationOptions* options, const MI_Interval* timeout)
+{
+    if (!timeout)
+        return MI_RESULT_INVALID_PARAMETER;
+    GetImpl(options)->m_timeout = *timeout;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL OperationOptions_GetTimeout(MI_OperationOptions* options, MI_Interval* timeout)
+{
+    if (!timeout)
+        return MI_RESULT_INVALID_PARAMETER;
+    *timeout = GetImpl(options)->m_timeout;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL OperationOptions_SetCustomOption(MI_OperationOptions* options, const MI_Char* optionName,
+    MI_Type optionValueType, const MI_Value* optionValue, MI_Boolean mustComply)
+{
+    if (!optionName || !optionValue)
+        return MI_RESULT_INVALID_PARAMETER;
+    GetImpl(options)->m_customOptions[optionName] = OwnedValue(optionValue, optionValueType);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL OperationOptions_Clone(const MI_OperationOptions* self, MI_OperationOptions* newOptions)
+{
+    if (!newOptions)
+        return MI_RESULT_INVALID_PARAMETER;
+    *newOptions = *self;
+    newOptions->reserved2 = (ptrdiff_t)new OperationOptionsImpl(*GetImpl(self));
+    return MI_RESULT_OK;
+}
+
+const MI_OperationOptionsFT g_operationOptionsFT =
+{
+    OperationOptions_Delete,
+    OperationOptions_SetTimeout,
+    OperationOptions_GetTimeout,
+    OperationOptions_SetCustomOption,
+    OperationOptions_Clone
+};
+
+static void MI_CALL DestinationOptions_Delete(MI_DestinationOptions* options)
+{
+    delete GetImpl(options);
+    memset(options, 0, sizeof(MI_DestinationOptions));
+}
+
+static MI_Result MI_CALL DestinationOptions_SetTimeout(MI_DestinationOptions* options, const MI_Interval* timeout)
+{
+    if (!timeout)
+        return MI_RESULT_INVALID_PARAMETER;
+    GetImpl(options)->m_timeout = *timeout;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL DestinationOptions_GetTimeout(MI_DestinationOptions* options, MI_Interval* timeout)
+{
+    if (!timeout)
+        return MI_RESULT_INVALID_PARAMETER;
+    *timeout = GetImpl(options)->m_timeout;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL DestinationOptions_SetUILocale(MI_DestinationOptions* options, const MI_Char* locale)
+{
+    if (!locale)
+        return MI_RESULT_INVALID_PARAMETER;
+    GetImpl(options)->m_locale = locale;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL DestinationOptions_GetUILocale(MI_DestinationOptions* options, const MI_Char** locale)
+{
+    if (!locale)
+        return MI_RESULT_INVALID_PARAMETER;
+    *locale = GetImpl(options)->m_locale.c_str();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL DestinationOptions_SetTransport(MI_DestinationOptions* options, const MI_Char* transport)
+{
+    if (!transport)
+        return MI_RESULT_INVALID_PARAMETER;
+    GetImpl(options)->m_transport = transport;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL DestinationOptions_GetTransport(MI_DestinationOptions* options, const MI_Char** transport)
+{
+    if (!transport)
+        return MI_RESULT_INVALID_PARAMETER;
+    *transport = GetImpl(options)->m_transport.c_str();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL DestinationOptions_AddDestinationCredentials(MI_DestinationOptions* options,
+    const MI_UserCredentials* credentials)
+{
+    if (!credentials || !credentials->authenticationType)
+        return MI_RESULT_INVALID_PARAMETER;
+    GetImpl(options)->m_credentials.push_back(credentials->authenticationType);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL DestinationOptions_Clone(const MI_DestinationOptions* self, MI_DestinationOptions* newOptions)
+{
+    if (!newOptions)
+        return MI_RESULT_INVALID_PARAMETER;
+    *newOptions = *self;
+    newOptions->reserved2 = (ptrdiff_t)new DestinationOptionsImpl(*GetImpl(self));
+    return MI_RESULT_OK;
+}
+
+const MI_DestinationOptionsFT g_destinationOptionsFT =
+{
+    DestinationOptions_Delete,
+    DestinationOptions_SetTimeout,
+    DestinationOptions_GetTimeout,
+    DestinationOptions_SetUILocale,
+    DestinationOptions_GetUILocale,
+    DestinationOptions_SetTransport,
+    DestinationOptions_GetTransport,
+    DestinationOptions_AddDestinationCredentials,
+    DestinationOptions_Clone
+};
+
+/*
+**==============================================================================
+**
+** Operation
+**
+**==============================================================================
+*/
+
+struct SessionImpl
+{
+    std::wstring m_host;
+    std::wstring m_protocol;
+};
+
+extern const MI_OperationFT g_operationFT;
+
+struct OperationImpl
+{
+    enum Kind { InstanceResults, ClassResult, Indications };
+
+    MI_Operation m_handle;
+    Kind m_kind = InstanceResults;
+    std::shared_ptr<SessionImpl> m_session;
+    std::wstring m_namespace;
+
+    // Results, consumed in order
+    std::vector<InstancePtr> m_instances;
+    size_t m_next = 0;
+    ClassDeclPtr m_class;
+    std::deque<InstancePtr> m_indications;
+    Query m_subscriptionQuery;
+
+    // Completion
+    MI_Result m_result = MI_RESULT_OK;
+    std::wstring m_errorMessage;
+    std::unique_ptr<StubInstance> m_errorDetails;
+
+    // The item returned by the last pull, valid until the next one
+    std::unique_ptr<StubInstance> m_currentInstance;
+    std::unique_ptr<StubClass> m_currentClass;
+
+    std::chrono::microseconds m_latency{ 0 };
+    std::chrono::microseconds m_batchLatency{ 0 };
+    size_t m_batchSize = 0;
+    std::chrono::microseconds m_timeout{ 0 };
+    // The host starts processing the operation as soon as it's issued
+    std::chrono::steady_clock::time_point m_startTime = std::chrono::steady_clock::now();
+    bool m_started = false;
+    bool m_completed = false;
+    bool m_cancelled = false;
+    bool m_closed = false;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+
+    // Callback mode
+    MI_OperationCallbacks m_callbacks;
+    std::thread m_worker;
+    bool m_acknowledged = false;
+    bool m_deleteOnExit = false;
+
+    OperationImpl()
+    {
+        MI_OperationCallbacks nullCallbacks = MI_OPERATIONCALLBACKS_NULL;
+        m_callbacks = nullCallbacks;
+        memset(&m_handle, 0, sizeof(m_handle));
+    }
+
+    void SetError(MI_Result result, const std::wstring& message, MI_Uint32 errorCode = 0)
+    {
+        m_result = result;
+        m_errorMessage = message;
+
+        auto& repository = Repository::Get();
+        auto decl = repository.FindClass(m_namespace, repository.m_errorClassName);
+        if (!decl)
+            decl = repository.FindClass(L"", L"MSFT_WmiError");
+        m_errorDetails.reset(new StubInstance(decl->m_name, decl));
+        MI_Value v;
+        v.string = (MI_Char*)message.c_str();
+        Instance_SetElement(m_errorDetails.get(), L"Message", &v, MI_STRING, 0);
+        v.uint32 = errorCode ? errorCode : (MI_Uint32)result;
+        Instance_SetElement(m_errorDetails.get(), L"error_Code", &v, MI_UINT32, 0);
+        v.uint32 = (MI_Uint32)result;
+        Instance_SetElement(m_errorDetails.get(), L"CIMStatusCode", &v, MI_UINT32, 0);
+        m_errorDetails->m_namespace = m_namespace;
+        m_errorDetails->UpdateHeader();
+    }
+
+    // Waits for the host latency, bounded by the operation timeout. Called with m_mutex held.
+    void Start(std::unique_lock<std::mutex>& lock)
+    {
+        if (m_started)
+            return;
+        m_started = true;
+
+        if (m_latency.count() <= 0)
+            return;
+
+        bool timedOut = m_timeout.count() > 0 && m_timeout < m_latency;
+        auto wait = timedOut ? m_timeout : m_latency;
+        auto deadline = m_startTime + wait;
+        m_cv.wait_until(lock, deadline, [&]() { return m_cancelled; });
+        if (!m_cancelled && timedOut)
+        {
+            m_instances.clear();
+            m_class = nullptr;
+            SetError(MI_RESULT_FAILED, L"The operation timed out.", STUB_ERR_TIMEOUT);
+        }
+    }
+
+    void CheckCancelled()
+    {
+        if (m_cancelled && !m_completed && m_result == MI_RESULT_OK)
+        {
+            m_instances.clear();
+            m_next = 0;
+            m_class = nullptr;
+            SetError(MI_RESULT_FAILED, L"The operation was cancelled.");
+        }
+    }
+
+    MI_Result GetInstance(const MI_Instance** instance, MI_Boolean* moreResults, MI_Result* result,
+        const MI_Char** errorMessage, const MI_Instance** completionDetails)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_kind != InstanceResults)
+            return MI_RESULT_INVALID_PARAMETER;
+        Start(lock);
+        // Each batch after the first one is a new round trip
+        if (m_batchLatency.count() > 0 && m_next > 0 && m_next < m_instances.size() && m_next % m_batchSize == 0)
+        {
+            m_cv.wait_for(lock, m_batchLatency, [&]() { return m_cancelled; });
+        }
+        CheckCancelled();
+
+        m_currentInstance.reset();
+        const MI_Instance* resultInstance = nullptr;
+        bool more = false;
+        if (m_next < m_instances.size())
+        {
+            m_currentInstance.reset(new StubInstance(*m_instances[m_next++]));
+            resultInstance = m_currentInstance.get();
+            more = m_next < m_instances.size() || m_result != MI_RESULT_OK;
+        }
+        m_completed = !more;
+
+        if (instance)
+            *instance = resultInstance;
+        if (moreResults)
+            *moreResults = more ? MI_TRUE : MI_FALSE;
+        SetCompletion(more, result, errorMessage, completionDetails);
+        return MI_RESULT_OK;
+    }
+
+    MI_Result GetClass(const MI_Class** classResult, MI_Boolean* moreResults, MI_Result* result,
+        const MI_Char** errorMessage, const MI_Instance** completionDetails)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_kind != ClassResult)
+            return MI_RESULT_INVALID_PARAMETER;
+        Start(lock);
+        CheckCancelled();
+
+        m_currentClass.reset();
+        if (m_class && !m_completed)
+        {
+            m_currentClass.reset(new StubClass(m_class, m_namespace, m_session->m_host));
+        }
+        m_completed = true;
+
+        if (classResult)
+            *classResult = m_currentClass.get();
+        if (moreResults)
+            *moreResults = MI_FALSE;
+        SetCompletion(false, result, errorMessage, completionDetails);
+        return MI_RESULT_OK;
+    }
+
+    MI_Result GetIndication(const MI_Instance** instance, const MI_Char** bookmark, const MI_Char** machineID,
+        MI_Boolean* moreResults, MI_Result* result, const MI_Char** errorMessage,
+        const MI_Instance** completionDetails)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_kind != Indications)
+            return MI_RESULT_INVALID_PARAMETER;
+        Start(lock);
+
+        m_currentInstance.reset();
+        m_cv.wait(lock, [&]() { return m_cancelled || m_result != MI_RESULT_OK || !m_indications.empty(); });
+        CheckCancelled();
+
+        bool more = false;
+        if (m_result == MI_RESULT_OK && !m_indications.empty())
+        {
+            m_currentInstance.reset(new StubInstance(*m_indications.front()));
+            m_indications.pop_front();
+            more = true;
+        }
+        m_completed = !more;
+
+        if (instance)
+            *instance = m_currentInstance.get();
+        if (bookmark)
+            *bookmark = nullptr;
+        if (machineID)
+            *machineID = nullptr;
+        if (moreResults)
+            *moreResults = more ? MI_TRUE : MI_FALSE;
+        SetCompletion(more, result, errorMessage, completionDetails);
+        return MI_RESULT_OK;
+    }
+
+    void SetCompletion(bool more, MI_Result* result, const MI_Char** errorMessage, const MI_Instance** completionDetails)
+    {
+        if (result)
+            *result = more ? MI_RESULT_OK : m_result;
+        if (errorMessage)
+            *errorMessage = !more && m_result != MI_RESULT_OK ? m_errorMessage.c_str() : nullptr;
+        if (completionDetails)
+            *completionDetails = !more ? m_errorDetails.get() : nullptr;
+    }
+
+    static MI_Result MI_CALL Acknowledge(MI_Operation* operation)
+    {
+        auto impl = (OperationImpl*)operation->reserved2;
+        std::lock_guard<std::mutex> lock(impl->m_mutex);
+        impl->m_acknowledged = true;
+        impl->m_cv.notify_all();
+        return MI_RESULT_OK;
+    }
+
+    // Delivers results through the callbacks, waiting for each acknowledgement.
+    void Run()
+    {
+        bool more = true;
+        while (more)
+        {
+            const MI_Instance* instance = nullptr;
+            const MI_Class* miClass = nullptr;
+            MI_Boolean moreResults = MI_FALSE;
+            MI_Result result = MI_RESULT_OK;
+            const MI_Char* errorMessage = nullptr;
+            const MI_Instance* completionDetails = nullptr;
+
+            switch (m_kind)
+            {
+            case InstanceResults:
+                GetInstance(&instance, &moreResults, &result, &errorMessage, &completionDetails);
+                break;
+            case ClassResult:
+                GetClass(&miClass, &moreResults, &result, &errorMessage, &completionDetails);
+                break;
+            case Indications:
+                GetIndication(&instance, nullptr, nullptr, &moreResults, &result, &errorMessage, &completionDetails);
+                break;
+            }
+            more = moreResults != MI_FALSE;
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_acknowledged = false;
+            }
+
+            bool delivered = false;
+            switch (m_kind)
+            {
+            case InstanceResults:
+                if (m_callbacks.instanceResult)
+                {
+                    m_callbacks.instanceResult(&m_handle, m_callbacks.callbackContext, instance, moreResults,
+                        result, errorMessage, completionDetails, Acknowledge);
+                    delivered = true;
+                }
+                break;
+            case ClassResult:
+                if (m_callbacks.classResult)
+                {
+                    m_callbacks.classResult(&m_handle, m_callbacks.callbackContext, miClass, moreResults, result,
+                        errorMessage, completionDetails, Acknowledge);
+                    delivered = true;
+                }
+                break;
+            case Indications:
+                if (m_callbacks.indicationResult)
+                {
+                    m_callbacks.indicationResult(&m_handle, m_callbacks.callbackContext, instance, nullptr, nullptr,
+                        moreResults, result, errorMessage, completionDetails, Acknowledge);
+                    delivered = true;
+                }
+                break;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (delivered)
+            {
+                m_cv.wait(lock, [&]() { return m_acknowledged || m_closed; });
+            }
+            if (m_closed)
+            {
+                break;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_deleteOnExit)
+        {
+            lock.unlock();
+            delete this;
+        }
+    }
+};
+
+static OperationImpl* GetImpl(const MI_Operation* operation)
+{
+    return (OperationImpl*)operation->reserved2;
+}
+
+static void RemoveSubscription(OperationImpl* impl)
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    auto& subscriptions = repository.m_subscriptions;
+    subscriptions.erase(std::remove(subscriptions.begin(), subscriptions.end(), impl), subscriptions.end());
+}
+
+static MI_Result MI_CALL Operation_Close(MI_Operation* operation)
+{
+    auto impl = GetImpl(operation);
+    if (!impl)
+        return MI_RESULT_INVALID_PARAMETER;
+
+    if (impl->m_kind == OperationImpl::Indications)
+        RemoveSubscription(impl);
+
+    {
+        std::lock_guard<std::mutex> lock(impl->m_mutex);
+        impl->m_closed = true;
+        impl->m_cancelled = true;
+        impl->m_cv.notify_all();
+    }
+
+    if (impl->m_worker.joinable())
+    {
+        if (impl->m_worker.get_id() == std::this_thread::get_id())
+        {
+            // Closed from a callback, the worker releases the operation when it returns
+            std::lock_guard<std::mutex> lock(impl->m_mutex);
+            impl->m_worker.detach();
+            impl->m_deleteOnExit = true;
+            memset(operation, 0, sizeof(MI_Operation));
+            return MI_RESULT_OK;
+        }
+        impl->m_worker.join();
+    }
+
+    delete impl;
+    memset(operation, 0, sizeof(MI_Operation));
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Operation_Cancel(MI_Operation* operation, MI_CancellationReason reason)
+{
+    auto impl = GetImpl(operation);
+    if (!impl)
+        return MI_RESULT_INVALID_PARAMETER;
+    std::lock_guard<std::mutex> lock(impl->m_mutex);
+    impl->m_cancelled = true;
+    impl->m_cv.notify_all();
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Operation_GetSession(MI_Operation* operation, MI_Session* session)
+{
+    return MI_RESULT_NOT_SUPPORTED;
+}
+
+static MI_Result MI_CALL Operation_GetInstance(MI_Operation* operation, const MI_Instance** instance,
+    MI_Boolean* moreResults, MI_Result* result, const MI_Char** errorMessage,
+    const MI_Instance** completionDetails)
+{
+    auto impl = GetImpl(operation);
+    if (!impl || impl->m_worker.joinable())
+        return MI_RESULT_INVALID_PARAMETER;
+    return impl->GetInstance(instance, moreResults, result, errorMessage, completionDetails);
+}
+
+static MI_Result MI_CALL Operation_GetIndication(MI_Operation* operation, const MI_Instance** instance,
+    const MI_Char** bookmark, const MI_Char** machineID, MI_Boolean* moreResults, MI_Result* result,
+    const MI_Char** errorMessage, const MI_Instance** completionDetails)
+{
+    auto impl = GetImpl(operation);
+    if (!impl || impl->m_worker.joinable())
+        return MI_RESULT_INVALID_PARAMETER;
+    return impl->GetIndication(instance, bookmark, machineID, moreResults, result, errorMessage,
+        completionDetails);
+}
+
+static MI_Result MI_CALL Operation_GetClass(MI_Operation* operation, const MI_Class** classResult,
+    MI_Boolean* moreResults, MI_Result* result, const MI_Char** errorMessage,
+    const MI_Instance** completionDetails)
+{
+    auto impl = GetImpl(operation);
+    if (!impl || impl->m_worker.joinable())
+        return MI_RESULT_INVALID_PARAMETER;
+    return impl->GetClass(classResult, moreResults, result, errorMessage, completionDetails);
+}
+
+const MI_OperationFT g_operationFT =
+{
+    Operation_Close,
+    Operation_Cancel,
+    Operation_GetSession,
+    Operation_GetInstance,
+    Operation_GetIndication,
+    Operation_GetClass
+};
+
+/*
+**==============================================================================
+**
+** Session
+**
+**==============================================================================
+*/
+
+extern const MI_SessionFT g_sessionFT;
+
+static std::shared_ptr<SessionImpl> GetImpl(const MI_Session* session)
+{
+    auto holder = (std::shared_ptr<SessionImpl>*)session->reserved2;
+    return holder ? *holder : nullptr;
+}
+
+static std::chrono::microseconds ToMicroseconds(const MI_Interval& interval)
+{
+    return std::chrono::microseconds(
+        (((MI_Uint64)interval.days * 24 + interval.hours) * 60 + interval.minutes) * 60000000ULL +
+        (MI_Uint64)interval.seconds * 1000000ULL + interval.microseconds);
+}
+
+// Creates the operation and applies the host state. Takes the repository lock,
+// which is returned to the caller to fill the results.
+static OperationImpl* NewOperation(MI_Session* session, MI_OperationOptions* options, const MI_Char* namespaceName,
+    std::unique_lock<std::mutex>& lock)
+{
+    auto impl = new OperationImpl();
+    impl->m_session = GetImpl(session);
+    impl->m_namespace = namespaceName ? namespaceName : L"";
+    if (options && options->reserved2)
+        impl->m_timeout = ToMicroseconds(GetImpl(options)->m_timeout);
+
+    auto& repository = Repository::Get();
+    lock = std::unique_lock<std::mutex>(repository.m_mutex);
+    if (!impl->m_session)
+    {
+        impl->SetError(MI_RESULT_INVALID_PARAMETER, L"The session is closed.");
+        return impl;
+    }
+    if (!namespaceName)
+    {
+        impl->SetError(MI_RESULT_INVALID_NAMESPACE, L"Invalid namespace");
+        return impl;
+    }
+
+    auto host = repository.FindHost(impl->m_session->m_host);
+    if (host)
+    {
+        impl->m_latency = host->m_latency;
+        impl->m_batchLatency = host->m_batchLatency;
+        impl->m_batchSize = host->m_batchSize;
+        if (host->m_unreachable)
+            impl->SetError(MI_RESULT_FAILED, L"The RPC server is unavailable.", STUB_ERR_RPC_SERVER_UNAVAILABLE);
+    }
+    return impl;
+}
+
+static void StartOperation(OperationImpl* impl, MI_OperationCallbacks* callbacks, MI_Operation* operation)
+{
+    if (!operation)
+    {
+        delete impl;
+        return;
+    }
+    operation->reserved1 = 0;
+    operation->reserved2 = (ptrdiff_t)impl;
+    operation->ft = &g_operationFT;
+    impl->m_handle = *operation;
+
+    if (callbacks && (callbacks->instanceResult || callbacks->classResult || callbacks->indicationResult))
+    {
+        impl->m_callbacks = *callbacks;
+        impl->m_worker = std::thread([impl]() { impl->Run(); });
+    }
+}
+
+static MI_Result MI_CALL Session_Close(MI_Session* session, void* completionContext,
+    void (MI_CALL *completionCallback)(void* completionContext))
+{
+    auto holder = (std::shared_ptr<SessionImpl>*)session->reserved2;
+    if (!holder)
+        return MI_RESULT_INVALID_PARAMETER;
+    delete holder;
+    memset(session, 0, sizeof(MI_Session));
+    {
+        auto& repository = Repository::Get();
+        std::lock_guard<std::mutex> lock(repository.m_mutex);
+        repository.m_openSessions--;
+    }
+    if (completionCallback)
+        completionCallback(completionContext);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Session_GetApplication(MI_Session* session, MI_Application* application)
+{
+    return MI_RESULT_NOT_SUPPORTED;
+}
+
+static void MI_CALL Session_GetInstance(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    std::unique_lock<std::mutex> lock;
+    auto impl = NewOperation(session, options, namespaceName, lock);
+    if (impl->m_result == MI_RESULT_OK)
+    {
+        auto& repository = Repository::Get();
+        auto instances = repository.FindInstances(impl->m_session->m_host, impl->m_namespace);
+        if (!inboundInstance)
+        {
+            impl->SetError(MI_RESULT_INVALID_PARAMETER, L"Invalid parameter");
+        }
+        else
+        {
+            auto identity = repository.GetIdentity(impl->m_namespace, AsStub(inboundInstance));
+            if (instances)
+            {
+                for (auto const& instance : *instances)
+                {
+                    if (repository.GetIdentity(impl->m_namespace, instance.get()) == identity)
+                    {
+                        impl->m_instances.push_back(instance);
+                        break;
+                    }
+                }
+            }
+            if (impl->m_instances.empty())
+                impl->SetError(MI_RESULT_NOT_FOUND, L"Not found");
+        }
+    }
+    lock.unlock();
+    StartOperation(impl, callbacks, operation);
+}
+
+static void MI_CALL Session_ModifyInstance(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    std::unique_lock<std::mutex> lock;
+    auto impl = NewOperation(session, options, namespaceName, lock);
+    if (impl->m_result == MI_RESULT_OK)
+    {
+        auto& repository = Repository::Get();
+        auto instances = repository.FindInstances(impl->m_session->m_host, impl->m_namespace);
+        auto inbound = inboundInstance ? AsStub(inboundInstance) : nullptr;
+        bool found = false;
+        if (inbound && instances)
+        {
+            auto identity = repository.GetIdentity(impl->m_namespace, inbound);
+            for (auto& instance : *instances)
+            {
+                if (repository.GetIdentity(impl->m_namespace, instance.get()) != identity)
+                    continue;
+                std::shared_ptr<StubInstance> modified(new StubInstance(*instance));
+                for (auto const& e : inbound->m_elements)
+                {
+                    int i = modified->FindElement(e.m_name.c_str());
+                    if (i >= 0 && (e.m_value.m_isNull || e.m_type == modified->m_elements[i].m_type))
+                        modified->m_elements[i].m_value = e.m_value;
+                }
+                instance = modified;
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            impl->SetError(MI_RESULT_NOT_FOUND, L"Not found");
+    }
+    lock.unlock();
+    StartOperation(impl, callbacks, operation);
+}
+
+static void MI_CALL Session_CreateInstance(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    std::unique_lock<std::mutex> lock;
+    auto impl = NewOperation(session, options, namespaceName, lock);
+    if (impl->m_result == MI_RESULT_OK)
+    {
+        auto& repository = Repository::Get();
+        MI_Result result = MI_RESULT_INVALID_PARAMETER;
+        std::unique_ptr<StubInstance> bound;
+        if (inboundInstance)
+            bound = repository.Bind(impl->m_session->m_host, impl->m_namespace, AsStub(inboundInstance), result);
+        if (!bound)
+        {
+            impl->SetError(result, L"Invalid instance");
+        }
+        else
+        {
+            auto& instances = repository.GetHost(impl->m_session->m_host).m_instances[NormalizeNamespace(impl->m_namespace)];
+            auto identity = repository.GetIdentity(impl->m_namespace, bound.get());
+            for (auto const& instance : instances)
+            {
+                if (repository.GetIdentity(impl->m_namespace, instance.get()) == identity)
+                {
+                    impl->SetError(MI_RESULT_ALREADY_EXISTS, L"Already exists");
+                    break;
+                }
+            }
+            if (impl->m_result == MI_RESULT_OK)
+            {
+                InstancePtr created(bound.release());
+                instances.push_back(created);
+                impl->m_instances.push_back(created);
+            }
+        }
+    }
+    lock.unlock();
+    StartOperation(impl, callbacks, operation);
+}
+
+static void MI_CALL Session_DeleteInstance(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    std::unique_lock<std::mutex> lock;
+    auto impl = NewOperation(session, options, namespaceName, lock);
+    if (impl->m_result == MI_RESULT_OK)
+    {
+        auto& repository = Repository::Get();
+        auto instances = repository.FindInstances(impl->m_session->m_host, impl->m_namespace);
+        bool found = false;
+        if (inboundInstance && instances)
+        {
+            auto identity = repository.GetIdentity(impl->m_namespace, AsStub(inboundInstance));
+            for (auto it = instances->begin(); it != instances->end(); ++it)
+            {
+                if (repository.GetIdentity(impl->m_namespace, it->get()) == identity)
+                {
+                    instances->erase(it);
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (!found)
+            impl->SetError(MI_RESULT_NOT_FOUND, L"Not found");
+    }
+    lock.unlock();
+    StartOperation(impl, callbacks, operation);
+}
+
+static void MI_CALL Session_Invoke(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Char* className, const MI_Char* methodName,
+    const MI_Instance* inboundInstance, const MI_Instance* inboundProperties, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    std::unique_lock<std::mutex> lock;
+    auto impl = NewOperation(session, options, namespaceName, lock);
+    if (impl->m_result == MI_RESULT_OK)
+    {
+        auto& repository = Repository::Get();
+        auto decl = className ? repository.FindClass(impl->m_namespace, className) : nullptr;
+        if (!decl)
+        {
+            impl->SetError(MI_RESULT_INVALID_CLASS, L"Invalid class");
+        }
+        else if (!methodName || decl->FindMethod(methodName) < 0)
+        {
+            impl->SetError(MI_RESULT_METHOD_NOT_FOUND, L"Method not found");
+        }
+        else
+        {
+            auto const& method = decl->m_methods[decl->FindMethod(methodName)];
+            std::shared_ptr<StubInstance> outParams(new StubInstance(L"__parameters"));
+            MI_Value v;
+            memset(&v, 0, sizeof(v));
+            Instance_AddElement(outParams.get(), L"ReturnValue", &v, method.m_returnType, 0);
+            for (auto const& p : method.m_parameters)
+            {
+                if (HasQualifier(p.m_qualifiers, L"Out"))
+                    Instance_AddElement(outParams.get(), p.m_name.c_str(), nullptr, p.m_type, MI_FLAG_NULL);
+            }
+
+            MethodHandler handler;
+            for (const MI_ClassDecl* d = decl.get(); d && !handler; d = d->m_parent.get())
+            {
+                auto it = repository.m_methodHandlers.find(
+                    Repository::ClassKey(impl->m_namespace, d->m_name) + L"." + ToLower(methodName));
+                if (it != repository.m_methodHandlers.end())
+                    handler = it->second;
+            }
+
+            MI_Result result = MI_RESULT_OK;
+            if (handler)
+            {
+                lock.unlock();
+                try
+                {
+                    result = handler(inboundInstance, inboundProperties, outParams.get());
+                }
+                catch (std::exception&)
+                {
+                    result = MI_RESULT_FAILED;
+                }
+                lock.lock();
+            }
+
+            if (result != MI_RESULT_OK)
+                impl->SetError(result, L"The method failed");
+            else
+                impl->m_instances.push_back(outParams);
+        }
+    }
+    lock.unlock();
+    StartOperation(impl, callbacks, operation);
+}
+
+static void MI_CALL Session_EnumerateInstances(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Char* className, MI_Boolean keysOnly, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    std::wstring query = L"SELECT * FROM ";
+    query += className ? className : L"";
+    ::MI_Session_QueryInstances(session, flags, options, namespaceName, L"WQL", query.c_str(), callbacks, operation);
+}
+
+static void MI_CALL Session_QueryInstances(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Char* queryDialect, const MI_Char* queryExpression,
+    MI_OperationCallbacks* callbacks, MI_Operation* operation)
+{
+    std::unique_lock<std::mutex> lock;
+    auto impl = NewOperation(session, options, namespaceName, lock);
+    if (impl->m_result == MI_RESULT_OK)
+    {
+        Query query;
+        bool valid = true;
+        try
+        {
+            query = QueryParser(queryExpression ? queryExpression : L"").Parse();
+        }
+        catch (std::invalid_argument&)
+        {
+            valid = false;
+        }
+
+        auto& repository = Repository::Get();
+        if (!queryDialect || !IEquals(queryDialect, L"WQL"))
+        {
+            impl->SetError(MI_RESULT_QUERY_LANGUAGE_NOT_SUPPORTED, L"Query language not supported");
+        }
+        else if (!valid)
+        {
+            impl->SetError(MI_RESULT_INVALID_QUERY, L"Invalid query");
+        }
+        else if (!repository.FindClass(impl->m_namespace, query.m_className))
+        {
+            impl->SetError(MI_RESULT_INVALID_CLASS, L"Invalid class");
+        }
+        else
+        {
+            auto instances = repository.FindInstances(impl->m_session->m_host, impl->m_namespace);
+            if (instances)
+            {
+                for (auto const& instance : *instances)
+                {
+                    if (instance->IsA(query.m_className) &&
+                        (!query.m_where || Evaluate(query.m_where.get(), instance.get())))
+                    {
+                        impl->m_instances.push_back(instance);
+                    }
+                }
+            }
+        }
+    }
+    lock.unlock();
+    StartOperation(impl, callbacks, operation);
+}
+
+static void MI_CALL Session_AssociatorInstances(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Instance* instanceKey, const MI_Char* assocClass,
+    const MI_Char* resultClass, const MI_Char* role, const MI_Char* resultRole, MI_Boolean keysOnly,
+    MI_OperationCallbacks* callbacks, MI_Operation* operation)
+{
+    std::unique_lock<std::mutex> lock;
+    auto impl = NewOperation(session, options, namespaceName, lock);
+    if (impl->m_result == MI_RESULT_OK)
+    {
+        auto& repository = Repository::Get();
+        auto host = repository.FindHost(impl->m_session->m_host);
+        auto instances = repository.FindInstances(impl->m_session->m_host, impl->m_namespace);
+        if (!instanceKey)
+        {
+            impl->SetError(MI_RESULT_INVALID_PARAMETER, L"Invalid parameter");
+        }
+        else if (host && instances)
+        {
+            auto ns = NormalizeNamespace(impl->m_namespace);
+            auto identity = repository.GetIdentity(impl->m_namespace, AsStub(instanceKey));
+            for (auto const& a : host->m_associations)
+            {
+                if (a.m_namespace != ns || (assocClass && !IEquals(a.m_assocClassName.c_str(), assocClass)))
+                    continue;
+                const std::wstring* other = nullptr;
+                if (a.m_left == identity)
+                    other = &a.m_right;
+                else if (a.m_right == identity)
+                    other = &a.m_left;
+                if (!other)
+                    continue;
+                for (auto const& instance : *instances)
+                {
+                    if ((!resultClass || instance->IsA(resultClass)) &&
+                        repository.GetIdentity(impl->m_namespace, instance.get()) == *other)
+                    {
+                        impl->m_instances.push_back(instance);
+                    }
+                }
+            }
+        }
+    }
+    lock.unlock();
+    StartOperation(impl, callbacks, operation);
+}
+
+static void MI_CALL Session_Subscribe(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Char* queryDialect, const MI_Char* queryExpression,
+    const MI_SubscriptionDeliveryOptions* deliverOptions, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    std::unique_lock<std::mutex> lock;
+    auto impl = NewOperation(session, options, namespaceName, lock);
+    impl->m_kind = OperationImpl::Indications;
+    if (impl->m_result == MI_RESULT_OK)
+    {
+        try
+        {
+            impl->m_subscriptionQuery = QueryParser(queryExpression ? queryExpression : L"").Parse();
+            Repository::Get().m_subscriptions.push_back(impl);
+        }
+        catch (std::invalid_argument&)
+        {
+            impl->SetError(MI_RESULT_INVALID_QUERY, L"Invalid query");
+        }
+    }
+    lock.unlock();
+    StartOperation(impl, callbacks, operation);
+}
+
+static void MI_CALL Session_GetClass(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Char* className, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    std::unique_lock<std::mutex> lock;
+    auto impl = NewOperation(session, options, namespaceName, lock);
+    impl->m_kind = OperationImpl::ClassResult;
+    if (impl->m_result == MI_RESULT_OK)
+    {
+        impl->m_class = className ? Repository::Get().FindClass(impl->m_namespace, className) : nullptr;
+        if (!impl->m_class)
+            impl->SetError(MI_RESULT_NOT_FOUND, L"Not found");
+    }
+    lock.unlock();
+    StartOperation(impl, callbacks, operation);
+}
+
+// Fails like any other operation when the host is unreachable
+static void MI_CALL Session_TestConnection(MI_Session* session, MI_Uint32 flags, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    std::unique_lock<std::mutex> lock;
+    auto impl = NewOperation(session, nullptr, L"", lock);
+    lock.unlock();
+    StartOperation(impl, callbacks, operation);
+}
+
+const MI_SessionFT g_sessionFT =
+{
+    Session_Close,
+    Session_GetApplication,
+    Session_GetInstance,
+    Session_ModifyInstance,
+    Session_CreateInstance,
+    Session_DeleteInstance,
+    Session_Invoke,
+    Session_EnumerateInstances,
+    Session_QueryInstances,
+    Session_AssociatorInstances,
+    Session_Subscribe,
+    Session_GetClass,
+    Session_TestConnection
+};
+
+/*
+**==============================================================================
+**
+** Serializer
+**
+**==============================================================================
+*/
+
+static MI_Result CopyToBuffer(const std::wstring& data, MI_Uint8* clientBuffer, MI_Uint32 clientBufferLength,
+    MI_Uint32* clientBufferNeeded)
+{
+    MI_Uint32 needed = (MI_Uint32)(data.length() * sizeof(wchar_t));
+    if (clientBufferNeeded)
+        *clientBufferNeeded = needed;
+    if (!clientBuffer || clientBufferLength < needed)
+        return MI_RESULT_FAILED;
+    memcpy(clientBuffer, data.c_str(), needed);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Serializer_Close(MI_Serializer* serializer)
+{
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Serializer_SerializeClass(MI_Serializer* serializer, MI_Uint32 flags,
+    const MI_Class* classObject, MI_Uint8* clientBuffer, MI_Uint32 clientBufferLength,
+    MI_Uint32* clientBufferNeeded)
+{
+    if (!classObject)
+        return MI_RESULT_INVALID_PARAMETER;
+    std::wostringstream o;
+    FormatClassXml(o, AsStub(classObject)->m_decl.get(), (flags & MI_SERIALIZER_FLAGS_CLASS_DEEP) != 0);
+    return CopyToBuffer(o.str(), clientBuffer, clientBufferLength, clientBufferNeeded);
+}
+
+static MI_Result MI_CALL Serializer_SerializeInstance(MI_Serializer* serializer, MI_Uint32 flags,
+    const MI_Instance* instanceObject, MI_Uint8* clientBuffer, MI_Uint32 clientBufferLength,
+    MI_Uint32* clientBufferNeeded)
+{
+    if (!instanceObject)
+        return MI_RESULT_INVALID_PARAMETER;
+    auto instance = AsStub(instanceObject);
+    std::wostringstream o;
+    if ((flags & MI_SERIALIZER_FLAGS_INSTANCE_WITH_CLASS) && instance->m_decl)
+        FormatClassXml(o, instance->m_decl.get(), false);
+    FormatInstanceXml(o, instance);
+    return CopyToBuffer(o.str(), clientBuffer, clientBufferLength, clientBufferNeeded);
+}
+
+static const MI_SerializerFT g_serializerFT =
+{
+    Serializer_Close,
+    Serializer_SerializeClass,
+    Serializer_SerializeInstance
+};
+
+/*
+**==============================================================================
+**
+** Deserializer
+**
+**==============================================================================
+*/
+
+namespace
+{
+    struct XmlTag
+    {
+        std::wstring m_name;
+        std::map<std::wstring, std::wstring> m_attributes;
+        bool m_end = false;
+        bool m_empty = false;
+
+        std::wstring Get(const wchar_t* name) const
+        {
+            auto it = m_attributes.find(name);
+            return it == m_attributes.end() ? L"" : it->second;
+        }
+    };
+
+    // Reads the class XML written by FormatClassXml, throws std::invalid_argument
+    // if the data is malformed.
+    class ClassXmlReader
+    {
+    private:
+        const wchar_t* m_start;
+        const wchar_t* m_p;
+        const wchar_t* m_end;
+
+        static std::wstring Unescape(const wchar_t* begin, const wchar_t* end)
+        {
+            static const struct { const wchar_t* m_entity; wchar_t m_char; } entities[] =
+            {
+                { L"&amp;", L'&' }, { L"&lt;", L'<' }, { L"&gt;", L'>' }, { L"&quot;", L'"' }, { L"&apos;", L'\'' }
+            };
+            std::wstring s;
+            s.reserve(end - begin);
+            while (begin < end)
+            {
+                bool matched = false;
+                if (*begin == L'&')
+                {
+                    for (auto const& e : entities)
+                    {
+                        size_t length = wcslen(e.m_entity);
+                        if ((size_t)(end - begin) >= length && !wcsncmp(begin, e.m_entity, length))
+                        {
+                            s += e.m_char;
+                            begin += length;
+                            matched = true;
+                            break;
+                        }
+                    }
+                    if (!matched)
+                        throw std::invalid_argument("Invalid entity");
+                }
+                else
+                {
+                    s += *begin++;
+                }
+            }
+            return s;
+        }
+
+        void SkipSpaces()
+        {
+            while (m_p < m_end && iswspace(*m_p))
+                m_p++;
+        }
+
+        const wchar_t* Find(wchar_t c)
+        {
+            const wchar_t* p = m_p;
+            while (p < m_end && *p != c)
+                p++;
+            if (p == m_end)
+                throw std::invalid_argument("Unexpected end of data");
+            return p;
+        }
+
+    public:
+        ClassXmlReader(const wchar_t* data, size_t length) : m_start(data), m_p(data), m_end(data + length) {}
+
+        size_t GetPosition() const { return m_p - m_start; }
+
+        XmlTag ReadTag()
+        {
+            XmlTag tag;
+            SkipSpaces();
+            if (m_p == m_end || *m_p != L'<')
+                throw std::invalid_argument("Tag expected");
+            m_p++;
+            if (m_p < m_end && *m_p == L'/')
+            {
+                tag.m_end = true;
+                m_p++;
+            }
+            while (m_p < m_end && !iswspace(*m_p) && *m_p != L'>' && *m_p != L'/')
+                tag.m_name += *m_p++;
+            while (true)
+            {
+                SkipSpaces();
+                if (m_p == m_end)
+                    throw std::invalid_argument("Unexpected end of data");
+                if (*m_p == L'>')
+                {
+                    m_p++;
+                    break;
+                }
+                if (*m_p == L'/')
+                {
+                    tag.m_empty = true;
+                    m_p++;
+                    continue;
+                }
+                const wchar_t* equals = Find(L'=');
+                std::wstring name(m_p, equals);
+                m_p = equals + 1;
+                if (m_p == m_end || *m_p != L'"')
+                    throw std::invalid_argument("Attribute value expected");
+                m_p++;
+                const wchar_t* quote = Find(L'"');
+                tag.m_attributes[name] = Unescape(m_p, quote);
+                m_p = quote + 1;
+            }
+            if (tag.m_name.empty())
+                throw std::invalid_argument("Tag name expected");
+            return tag;
+        }
+
+        std::wstring ReadText()
+        {
+            const wchar_t* p = Find(L'<');
+            auto text = Unescape(m_p, p);
+            m_p = p;
+            return text;
+        }
+
+        void ReadEndTag(const std::wstring& name)
+        {
+            auto tag = ReadTag();
+            if (!tag.m_end || tag.m_name != name)
+                throw std::invalid_argument("Unexpected tag");
+        }
+    };
+
+    MI_Type ParseTypeName(const XmlTag& tag, bool isArray)
+    {
+        static const struct { const wchar_t* m_name; MI_Type m_type; } types[] =
+        {
+            { L"boolean", MI_BOOLEAN }, { L"uint8", MI_UINT8 }, { L"sint8", MI_SINT8 }, { L"uint16", MI_UINT16 },
+            { L"sint16", MI_SINT16 }, { L"uint32", MI_UINT32 }, { L"sint32", MI_SINT32 }, { L"uint64", MI_UINT64 },
+            { L"sint64", MI_SINT64 }, { L"real32", MI_REAL32 }, { L"real64", MI_REAL64 }, { L"char16", MI_CHAR16 },
+            { L"datetime", MI_DATETIME }, { L"string", MI_STRING }, { L"reference", MI_REFERENCE }
+        };
+        auto name = tag.Get(L"TYPE");
+        for (auto const& t : types)
+        {
+            if (name == t.m_name)
+            {
+                MI_Type type = t.m_type;
+                if (type == MI_STRING && tag.Get(L"EmbeddedObject") == L"instance")
+                    type = MI_INSTANCE;
+                return (MI_Type)(isArray ? type | MI_ARRAY : type);
+            }
+        }
+        throw std::invalid_argument("Unknown type");
+    }
+
+    // Datetime and instance values are not written by the classes the stub
+    // defines, they are left null.
+    bool ParseScalar(const std::wstring& text, MI_Type type, MI_Value& value)
+    {
+        switch (type)
+        {
+        case MI_BOOLEAN: value.boolean = text == L"true" ? MI_TRUE : MI_FALSE; return true;
+        case MI_UINT8: value.uint8 = (MI_Uint8)wcstoul(text.c_str(), nullptr, 10); return true;
+        case MI_SINT8: value.sint8 = (MI_Sint8)wcstol(text.c_str(), nullptr, 10); return true;
+        case MI_UINT16: value.uint16 = (MI_Uint16)wcstoul(text.c_str(), nullptr, 10); return true;
+        case MI_SINT16: value.sint16 = (MI_Sint16)wcstol(text.c_str(), nullptr, 10); return true;
+        case MI_UINT32: value.uint32 = (MI_Uint32)wcstoul(text.c_str(), nullptr, 10); return true;
+        case MI_SINT32: value.sint32 = (MI_Sint32)wcstol(text.c_str(), nullptr, 10); return true;
+        case MI_UINT64: value.uint64 = wcstoull(text.c_str(), nullptr, 10); return true;
+        case MI_SINT64: value.sint64 = wcstoll(text.c_str(), nullptr, 10); return true;
+        case MI_REAL32: value.real32 = wcstof(text.c_str(), nullptr); return true;
+        case MI_REAL64: value.real64 = wcstod(text.c_str(), nullptr); return true;
+        case MI_CHAR16: value.char16 = (MI_Char16)wcstoul(text.c_str(), nullptr, 10); return true;
+        case MI_STRING: value.string = (MI_Char*)text.c_str(); return true;
+        default: return false;
+        }
+    }
+
+    // Reads a VALUE or VALUE.ARRAY, "tag" being its start tag
+    void ReadValueXml(ClassXmlReader& reader, const XmlTag& tag, MI_Type type, OwnedValue& value)
+    {
+        std::vector<std::wstring> items;
+        bool isArray = tag.m_name == L"VALUE.ARRAY";
+        if (isArray)
+        {
+            while (true)
+            {
+                auto item = reader.ReadTag();
+                if (item.m_end)
+                    break;
+                items.push_back(reader.ReadText());
+                reader.ReadEndTag(L"VALUE");
+            }
+        }
+        else
+        {
+            items.push_back(reader.ReadText());
+            reader.ReadEndTag(L"VALUE");
+        }
+
+        MI_Type itemType = (MI_Type)(type & ~MI_ARRAY);
+        std::vector<MI_Value> itemValues(items.size());
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            if (!ParseScalar(items[i], itemType, itemValues[i]))
+                return;
+        }
+
+        MI_Value v;
+        if (isArray)
+        {
+            unsigned itemSize = GetItemSize(itemType);
+            std::vector<MI_Uint8> data(items.size() * itemSize);
+            for (size_t i = 0; i < items.size(); i++)
+                memcpy(&data[i * itemSize], &itemValues[i], itemSize);
+            v.array.data = data.data();
+            v.array.size = (MI_Uint32)items.size();
+            value.Set(&v, (MI_Type)(itemType | MI_ARRAY));
+        }
+        else
+        {
+            value.Set(&itemValues[0], itemType);
+        }
+    }
+
+    // Reads the qualifiers and the value of an element until its end tag
+    void ReadElementXml(ClassXmlReader& reader, const std::wstring& name, MI_Type type, QualifierList& qualifiers,
+        OwnedValue* value, std::vector<XmlTag>* children = nullptr)
+    {
+        while (true)
+        {
+            auto tag = reader.ReadTag();
+            if (tag.m_end)
+            {
+                if (tag.m_name != name)
+                    throw std::invalid_argument("Unexpected end tag");
+                return;
+            }
+            if (tag.m_name == L"QUALIFIER")
+            {
+                QualifierImpl q;
+                q.m_name = tag.Get(L"NAME");
+                q.m_flags = MI_FLAG_TOSUBCLASS;
+                MI_Type qualifierType = ParseTypeName(tag, false);
+                auto valueTag = reader.ReadTag();
+                if (!valueTag.m_end)
+                {
+                    ReadValueXml(reader, valueTag, qualifierType, q.m_value);
+                    reader.ReadEndTag(L"QUALIFIER");
+                }
+                qualifiers.push_back(std::move(q));
+            }
+            else if (value && (tag.m_name == L"VALUE" || tag.m_name == L"VALUE.ARRAY"))
+            {
+                ReadValueXml(reader, tag, type, *value);
+            }
+            else if (children)
+            {
+                children->push_back(tag);
+                return;
+            }
+            else
+            {
+                throw std::invalid_argument("Unexpected tag");
+            }
+        }
+    }
+
+    void ReadMethodXml(ClassXmlReader& reader, MethodImpl& method)
+    {
+        while (true)
+        {
+            std::vector<XmlTag> children;
+            ReadElementXml(reader, L"METHOD", method.m_returnType, method.m_qualifiers, nullptr, &children);
+            if (children.empty())
+                return;
+            auto const& tag = children[0];
+            bool isArray = tag.m_name == L"PARAMETER.ARRAY";
+            if (!isArray && tag.m_name != L"PARAMETER")
+                throw std::invalid_argument("Unexpected tag");
+            ParameterImpl param;
+            param.m_name = tag.Get(L"NAME");
+            param.m_type = ParseTypeName(tag, isArray);
+            ReadElementXml(reader, tag.m_name, param.m_type, param.m_qualifiers, nullptr);
+            method.m_parameters.push_back(std::move(param));
+        }
+    }
+
+    std::shared_ptr<MI_ClassDecl> ReadClassXml(ClassXmlReader& reader, const XmlTag& classTag, ClassDeclPtr parent)
+    {
+        auto decl = std::make_shared<MI_ClassDecl>();
+        decl->m_name = classTag.Get(L"NAME");
+        decl->m_parent = parent;
+        while (true)
+        {
+            std::vector<XmlTag> children;
+            ReadElementXml(reader, L"CLASS", MI_BOOLEAN, decl->m_qualifiers, nullptr, &children);
+            if (children.empty())
+                return decl;
+            auto const& tag = children[0];
+            if (tag.m_name == L"PROPERTY" || tag.m_name == L"PROPERTY.ARRAY")
+            {
+                PropertyImpl prop;
+                prop.m_name = tag.Get(L"NAME");
+                prop.m_type = ParseTypeName(tag, tag.m_name == L"PROPERTY.ARRAY");
+                prop.m_default.m_type = prop.m_type;
+                ReadElementXml(reader, tag.m_name, prop.m_type, prop.m_qualifiers, &prop.m_default);
+                prop.m_flags = MI_FLAG_PROPERTY;
+                if (HasQualifier(prop.m_qualifiers, L"Key"))
+                    prop.m_flags |= MI_FLAG_KEY;
+                if (HasQualifier(prop.m_qualifiers, L"Required"))
+                    prop.m_flags |= MI_FLAG_REQUIRED;
+                decl->m_properties.push_back(std::move(prop));
+            }
+            else if (tag.m_name == L"METHOD")
+            {
+                MethodImpl method;
+                method.m_name = tag.Get(L"NAME");
+                method.m_returnType = ParseTypeName(tag, false);
+                ReadMethodXml(reader, method);
+                decl->m_methods.push_back(std::move(method));
+            }
+            else
+            {
+                throw std::invalid_argument("Unexpected tag");
+            }
+        }
+    }
+
+    XmlTag ReadClassTag(MI_Uint8* buffer, MI_Uint32 length)
+    {
+        ClassXmlReader reader((const wchar_t*)buffer, length / sizeof(wchar_t));
+        auto tag = reader.ReadTag();
+        if (tag.m_end || tag.m_name != L"CLASS")
+            throw std::invalid_argument("Class expected");
+        return tag;
+    }
+
+    MI_Result CopyName(const std::wstring& name, MI_Char* buffer, MI_Uint32* length)
+    {
+        if (!length)
+            return MI_RESULT_INVALID_PARAMETER;
+        MI_Uint32 needed = (MI_Uint32)name.length() + 1;
+        bool fits = buffer && *length >= needed;
+        *length = needed;
+        if (!fits)
+            return MI_RESULT_FAILED;
+        memcpy(buffer, name.c_str(), needed * sizeof(wchar_t));
+        return MI_RESULT_OK;
+    }
+}
+
+static MI_Result MI_CALL Deserializer_Close(MI_Deserializer* deserializer)
+{
+    return MI_RESULT_OK;
+}
+
+// Reads one class, the superclass must be passed as "parentClass" or be
+// provided by "classObjectNeeded"
+static MI_Result MI_CALL Deserializer_DeserializeClass(MI_Deserializer* deserializer, MI_Uint32 flags,
+    MI_Uint8* serializedBuffer, MI_Uint32 serializedBufferLength, MI_Class* parentClass, const MI_Char* serverName,
+    const MI_Char* namespaceName, MI_Deserializer_ClassObjectNeeded classObjectNeeded, void* classObjectNeededContext,
+    MI_Uint32* serializedBufferRead, MI_Class** classObject, MI_Instance** cimErrorDetails)
+{
+    if (cimErrorDetails)
+        *cimErrorDetails = nullptr;
+    if (!serializedBuffer || !classObject)
+        return MI_RESULT_INVALID_PARAMETER;
+    *classObject = nullptr;
+
+    try
+    {
+        ClassXmlReader reader((const wchar_t*)serializedBuffer, serializedBufferLength / sizeof(wchar_t));
+        auto classTag = reader.ReadTag();
+        if (classTag.m_end || classTag.m_name != L"CLASS")
+            return MI_RESULT_INVALID_PARAMETER;
+
+        ClassDeclPtr parent;
+        auto superClassName = classTag.Get(L"SUPERCLASS");
+        if (superClassName.length())
+        {
+            MI_Class* neededClass = nullptr;
+            if (!parentClass && classObjectNeeded)
+            {
+                classObjectNeeded(classObjectNeededContext, serverName, namespaceName, superClassName.c_str(),
+                    &neededClass);
+                parentClass = neededClass;
+            }
+            if (parentClass && IEquals(AsStub(parentClass)->m_decl->m_name, superClassName))
+                parent = AsStub(parentClass)->m_decl;
+            if (neededClass)
+                Class_Delete(neededClass);
+            if (!parent)
+                return MI_RESULT_INVALID_SUPERCLASS;
+        }
+
+        auto decl = ReadClassXml(reader, classTag, parent);
+        decl->m_namespace = namespaceName ? namespaceName : L"";
+        if (serializedBufferRead)
+            *serializedBufferRead = (MI_Uint32)(reader.GetPosition() * sizeof(wchar_t));
+        *classObject = new StubClass(decl, decl->m_namespace, serverName ? serverName : L"");
+        return MI_RESULT_OK;
+    }
+    catch (std::invalid_argument&)
+    {
+        return MI_RESULT_INVALID_PARAMETER;
+    }
+}
+
+static MI_Result MI_CALL Deserializer_Class_GetClassName(MI_Deserializer* deserializer, MI_Uint8* serializedBuffer,
+    MI_Uint32 serializedBufferLength, MI_Char* className, MI_Uint32* classNameLength, MI_Instance** cimErrorDetails)
+{
+    if (cimErrorDetails)
+        *cimErrorDetails = nullptr;
+    if (!serializedBuffer)
+        return MI_RESULT_INVALID_PARAMETER;
+    try
+    {
+        return CopyName(ReadClassTag(serializedBuffer, serializedBufferLength).Get(L"NAME"), className,
+            classNameLength);
+    }
+    catch (std::invalid_argument&)
+    {
+        return MI_RESULT_INVALID_PARAMETER;
+    }
+}
+
+static MI_Result MI_CALL Deserializer_Class_GetParentClassName(MI_Deserializer* deserializer,
+    MI_Uint8* serializedBuffer, MI_Uint32 serializedBufferLength, MI_Char* parentClassName,
+    MI_Uint32* parentClassNameLength, MI_Instance** cimErrorDetails)
+{
+    if (cimErrorDetails)
+        *cimErrorDetails = nullptr;
+    if (!serializedBuffer)
+        return MI_RESULT_INVALID_PARAMETER;
+    try
+    {
+        auto name = ReadClassTag(serializedBuffer, serializedBufferLength).Get(L"SUPERCLASS");
+        if (name.empty())
+            return MI_RESULT_INVALID_SUPERCLASS;
+        return CopyName(name, parentClassName, parentClassNameLength);
+    }
+    catch (std::invalid_argument&)
+    {
+        return MI_RESULT_INVALID_PARAMETER;
+    }
+}
+
+static MI_Result MI_CALL Deserializer_DeserializeInstance(MI_Deserializer* deserializer, MI_Uint32 flags,
+    MI_Uint8* serializedBuffer, MI_Uint32 serializedBufferLength, MI_Class** classObjects,
+    MI_Uint32 numberClassObjects, MI_Deserializer_ClassObjectNeeded classObjectNeeded,
+    void* classObjectNeededContext, MI_Uint32* serializedBufferRead, MI_Instance** instanceObject,
+    MI_Instance** cimErrorDetails)
+{
+    return MI_RESULT_NOT_SUPPORTED;
+}
+
+static MI_Result MI_CALL Deserializer_Instance_GetClassName(MI_Deserializer* deserializer,
+    MI_Uint8* serializedBuffer, MI_Uint32 serializedBufferLength, MI_Char* className, MI_Uint32* classNameLength,
+    MI_Instance** cimErrorDetails)
+{
+    return MI_RESULT_NOT_SUPPORTED;
+}
+
+static const MI_DeserializerFT g_deserializerFT =
+{
+    Deserializer_Close,
+    Deserializer_DeserializeClass,
+    Deserializer_Class_GetClassName,
+    Deserializer_Class_GetParentClassName,
+    Deserializer_DeserializeInstance,
+    Deserializer_Instance_GetClassName
+};
+
+/*
+**==============================================================================
+**
+** Application
+**
+**==============================================================================
+*/
+
+extern const MI_ApplicationFT g_applicationFT;
+
+struct ApplicationImpl
+{
+    std::wstring m_applicationId;
+};
+
+static MI_Result MI_CALL Application_Close(MI_Application* application)
+{
+    delete (ApplicationImpl*)application->reserved2;
+    memset(application, 0, sizeof(MI_Application));
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Application_NewSession(MI_Application* application, const MI_Char* protocol,
+    const MI_Char* destination, MI_DestinationOptions* options, MI_SessionCallbacks* callbacks,
+    MI_Instance** extendedError, MI_Session* session)
+{
+    if (extendedError)
+        *extendedError = nullptr;
+    if (protocol && !IEquals(protocol, L"WMIDCOM") && !IEquals(protocol, L"WINRM"))
+        return MI_RESULT_NOT_SUPPORTED;
+
+    auto impl = std::make_shared<SessionImpl>();
+    std::chrono::microseconds connectLatency{ 0 };
+    {
+        auto& repository = Repository::Get();
+        std::lock_guard<std::mutex> lock(repository.m_mutex);
+        impl->m_host = repository.NormalizeHost(destination ? destination : L"");
+        auto host = repository.FindHost(impl->m_host);
+        if (host)
+            connectLatency = host->m_connectLatency;
+        repository.m_openSessions++;
+    }
+    impl->m_protocol = protocol ? protocol : L"";
+    if (connectLatency.count() > 0)
+        std::this_thread::sleep_for(connectLatency);
+
+    session->reserved1 = 0;
+    session->reserved2 = (ptrdiff_t)new std::shared_ptr<SessionImpl>(impl);
+    session->ft = &g_sessionFT;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Application_NotSupported(MI_Application* application)
+{
+    return MI_RESULT_NOT_SUPPORTED;
+}
+
+static MI_Result MI_CALL Application_NewInstance(MI_Application* application, const MI_Char* className,
+    const MI_ClassDecl* classRTTI, MI_Instance** instance)
+{
+    if (!className || !instance)
+        return MI_RESULT_INVALID_PARAMETER;
+    *instance = new StubInstance(className);
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Application_NewDestinationOptions(MI_Application* application, MI_DestinationOptions* options)
+{
+    options->reserved1 = 0;
+    options->reserved2 = (ptrdiff_t)new DestinationOptionsImpl();
+    options->ft = &g_destinationOptionsFT;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Application_NewOperationOptions(MI_Application* application,
+    MI_Boolean customOptionsMustUnderstand, MI_OperationOptions* options)
+{
+    options->reserved1 = 0;
+    options->reserved2 = (ptrdiff_t)new OperationOptionsImpl();
+    options->ft = &g_operationOptionsFT;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Application_NewSerializer(MI_Application* application, MI_Uint32 flags,
+    const MI_Char* format, MI_Serializer* serializer)
+{
+    if (!format || !IEquals(format, L"MI_XML"))
+        return MI_RESULT_NOT_SUPPORTED;
+    serializer->reserved1 = 0;
+    serializer->reserved2 = (ptrdiff_t)&g_serializerFT;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Application_NewDeserializer(MI_Application* application, MI_Uint32 flags,
+    const MI_Char* format, MI_Deserializer* deserializer)
+{
+    if (!format || !IEquals(format, L"MI_XML"))
+        return MI_RESULT_NOT_SUPPORTED;
+    deserializer->reserved1 = 0;
+    deserializer->reserved2 = (ptrdiff_t)&g_deserializerFT;
+    return MI_RESULT_OK;
+}
+
+static MI_Result MI_CALL Application_NewInstanceFromClass(MI_Application* application, const MI_Char* className,
+    const MI_Class* classObject, MI_Instance** instance)
+{
+    if (!className || !classObject || !instance)
+        return MI_RESULT_INVALID_PARAMETER;
+    auto stubClass = AsStub(classObject);
+    auto newInstance = new StubInstance(className, stubClass->m_decl);
+    newInstance->m_namespace = stubClass->m_namespace;
+    newInstance->m_serverName = stubClass->m_serverName;
+    newInstance->UpdateHeader();
+    *instance = newInstance;
+    return MI_RESULT_OK;
+}
+
+const MI_ApplicationFT g_applicationFT =
+{
+    Application_Close,
+    Application_NewSession,
+    Application_NotSupported,
+    Application_NewInstance,
+    Application_NewDestinationOptions,
+    Application_NewOperationOptions,
+    Application_NotSupported,
+    Application_NewSerializer,
+    Application_NewDeserializer,
+    Application_NewInstanceFromClass
+};
+
+extern "C" MI_Result MI_CALL MI_Application_Initialize(MI_Uint32 flags, const MI_Char* applicationID,
+    MI_Instance** extendedError, MI_Application* application)
+{
+    if (extendedError)
+        *extendedError = nullptr;
+    if (!application)
+        return MI_RESULT_INVALID_PARAMETER;
+    auto impl = new ApplicationImpl();
+    impl->m_applicationId = applicationID ? applicationID : L"";
+    application->reserved1 = 1;
+    application->reserved2 = (ptrdiff_t)impl;
+    application->ft = &g_applicationFT;
+    return MI_RESULT_OK;
+}
+
+/*
+**==============================================================================
+**
+** Public API
+**
+**==============================================================================
+*/
+
+void MIStub::Reset()
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    repository.m_classes.clear();
+    repository.m_hosts.clear();
+    repository.m_methodHandlers.clear();
+    repository.m_localComputerName = L"localhost";
+    repository.m_errorClassName = L"MSFT_WmiError";
+}
+
+void MIStub::SetLocalComputerName(const std::wstring& name)
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    repository.m_localComputerName = name;
+}
+
+void MIStub::SetErrorClass(const std::wstring& className)
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    repository.m_errorClassName = className;
+}
+
+void MIStub::DefineClass(const ClassDefinition& definition)
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    if (!definition.m_name.length())
+        throw std::invalid_argument("Invalid class name");
+
+    ClassDeclPtr parent;
+    if (definition.m_parentName.length())
+    {
+        parent = repository.FindClass(definition.m_namespace, definition.m_parentName);
+        if (!parent)
+            throw std::invalid_argument("Unknown parent class");
+    }
+    repository.m_classes[Repository::ClassKey(definition.m_namespace, definition.m_name)] =
+        repository.BuildClassDecl(definition, parent);
+}
+
+MI_Result MIStub::AddInstance(const std::wstring& host, const std::wstring& ns, const MI_Instance* instance)
+{
+    if (!instance)
+        return MI_RESULT_INVALID_PARAMETER;
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    MI_Result result = MI_RESULT_OK;
+    auto bound = repository.Bind(host, ns, AsStub(instance), result);
+    if (bound)
+        repository.GetHost(host).m_instances[NormalizeNamespace(ns)].push_back(InstancePtr(bound.release()));
+    return result;
+}
+
+size_t MIStub::GetInstanceCount(const std::wstring& host, const std::wstring& ns, const std::wstring& className)
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    auto instances = repository.FindInstances(host, ns);
+    if (!instances)
+        return 0;
+    return std::count_if(instances->begin(), instances->end(),
+        [&](const InstancePtr& instance) { return instance->IsA(className); });
+}
+
+MI_Result MIStub::AddAssociation(const std::wstring& host, const std::wstring& ns, const std::wstring& assocClassName,
+    const MI_Instance* left, const MI_Instance* right)
+{
+    if (!left || !right)
+        return MI_RESULT_INVALID_PARAMETER;
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    AssociationImpl a;
+    a.m_namespace = NormalizeNamespace(ns);
+    a.m_assocClassName = assocClassName;
+    a.m_left = repository.GetIdentity(ns, AsStub(left));
+    a.m_right = repository.GetIdentity(ns, AsStub(right));
+    repository.GetHost(host).m_associations.push_back(a);
+    return MI_RESULT_OK;
+}
+
+void MIStub::RegisterMethodHandler(const std::wstring& ns, const std::wstring& className, const std::wstring& methodName,
+    MethodHandler handler)
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    repository.m_methodHandlers[Repository::ClassKey(ns, className) + L"." + ToLower(methodName)] = handler;
+}
+
+void MIStub::SetHostLatency(const std::wstring& host, std::chrono::microseconds latency)
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    repository.GetHost(host).m_latency = latency;
+}
+
+void MIStub::SetHostBatchLatency(const std::wstring& host, std::chrono::microseconds latency, size_t batchSize)
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    auto& hostState = repository.GetHost(host);
+    hostState.m_batchLatency = batchSize ? latency : std::chrono::microseconds::zero();
+    hostState.m_batchSize = batchSize;
+}
+
+void MIStub::SetHostConnectLatency(const std::wstring& host, std::chrono::microseconds latency)
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    repository.GetHost(host).m_connectLatency = latency;
+}
+
+size_t MIStub::GetOpenSessionCount()
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    return repository.m_openSessions;
+}
+
+void MIStub::SetHostUnreachable(const std::wstring& host, bool unreachable)
+{
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    repository.GetHost(host).m_unreachable = unreachable;
+}
+
+void MIStub::PublishIndication(const std::wstring& host, const std::wstring& ns, const MI_Instance* indication)
+{
+    if (!indication)
+        return;
+    auto& repository = Repository::Get();
+    std::lock_guard<std::mutex> lock(repository.m_mutex);
+    auto stubIndication = AsStub(indication);
+    std::shared_ptr<StubInstance> copy(new StubInstance(*stubIndication));
+    copy->m_namespace = ns;
+    copy->m_serverName = repository.NormalizeHost(host);
+    copy->UpdateHeader();
+
+    auto normalizedHost = ToLower(repository.NormalizeHost(host));
+    for (auto impl : repository.m_subscriptions)
+    {
+        if (ToLower(impl->m_session->m_host) != normalizedHost ||
+            NormalizeNamespace(impl->m_namespace) != NormalizeNamespace(ns))
+            continue;
+        auto const& query = impl->m_subscriptionQuery;
+        if (!copy->IsA(query.m_className) || (query.m_where && !Evaluate(query.m_where.get(), copy.get())))
+            continue;
+        std::lock_guard<std::mutex> opLock(impl->m_mutex);
+        impl->m_indications.push_back(copy);
+        impl->m_cv.notify_all();
+    }
+}
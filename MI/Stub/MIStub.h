@@ -0,0 +1,107 @@
+#pragma once
+
+// In-memory MI backend used when building without the Windows SDK.
+//
+// The stub implements the MI_Application / MI_Session / MI_Operation /
+// MI_Instance / MI_Class function tables declared in Stub/include/MI.h and
+// serves classes and instances registered through the functions below, so
+// that MI++ and PyMI can be built, exercised and benchmarked on any host.
+
+#include <MI.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace MIStub
+{
+    // A qualifier with an empty value is a boolean qualifier set to true,
+    // otherwise it is a string qualifier.
+    struct QualifierDefinition
+    {
+        std::wstring m_name;
+        std::wstring m_value;
+    };
+
+    struct PropertyDefinition
+    {
+        std::wstring m_name;
+        MI_Type m_type;
+        MI_Uint32 m_flags;
+        std::vector<QualifierDefinition> m_qualifiers;
+    };
+
+    struct ParameterDefinition
+    {
+        std::wstring m_name;
+        MI_Type m_type;
+        MI_Uint32 m_flags; // MI_FLAG_IN / MI_FLAG_OUT
+        std::vector<QualifierDefinition> m_qualifiers;
+    };
+
+    struct MethodDefinition
+    {
+        std::wstring m_name;
+        MI_Type m_returnType;
+        MI_Uint32 m_flags;
+        std::vector<ParameterDefinition> m_parameters;
+        std::vector<QualifierDefinition> m_qualifiers;
+    };
+
+    struct ClassDefinition
+    {
+        std::wstring m_namespace;
+        std::wstring m_name;
+        std::wstring m_parentName;
+        std::vector<PropertyDefinition> m_properties;
+        std::vector<MethodDefinition> m_methods;
+        std::vector<QualifierDefinition> m_qualifiers;
+    };
+
+    // Invoked for MI_Session_Invoke. "target" is null for static methods,
+    // "outParams" is a __parameters instance already holding ReturnValue = 0.
+    typedef std::function<MI_Result(const MI_Instance* target, const MI_Instance* inParams,
+        MI_Instance* outParams)> MethodHandler;
+
+    // Drops all registered classes, instances, hosts and handlers.
+    void Reset();
+
+    // Name reported as server name for sessions targeting ".", default "localhost".
+    void SetLocalComputerName(const std::wstring& name);
+
+    // Registers a class. The parent class, if any, must be registered first.
+    // Throws std::invalid_argument on invalid definitions.
+    void DefineClass(const ClassDefinition& definition);
+
+    // Stores a copy of "instance" on the given host. The instance is bound to
+    // the registered class with the same name in "ns".
+    MI_Result AddInstance(const std::wstring& host, const std::wstring& ns, const MI_Instance* instance);
+    size_t GetInstanceCount(const std::wstring& host, const std::wstring& ns, const std::wstring& className);
+
+    // Links two stored instances for MI_Session_AssociatorInstances.
+    MI_Result AddAssociation(const std::wstring& host, const std::wstring& ns, const std::wstring& assocClassName,
+        const MI_Instance* left, const MI_Instance* right);
+
+    void RegisterMethodHandler(const std::wstring& ns, const std::wstring& className, const std::wstring& methodName,
+        MethodHandler handler);
+
+    // Class of the extended error instances reported by failed operations,
+    // MSFT_WmiError by default. The class must derive from CIM_Error and be
+    // registered in the namespace of the failing operations.
+    void SetErrorClass(const std::wstring& className);
+
+    // Delay applied before an operation on "host" produces its first result.
+    void SetHostLatency(const std::wstring& host, std::chrono::microseconds latency);
+    // Delay applied before each batch of "batchSize" instance results after the
+    // first one, as WinRM enumerations pull each envelope in a round trip.
+    void SetHostBatchLatency(const std::wstring& host, std::chrono::microseconds latency, size_t batchSize);
+    // Delay applied when opening a session to "host", as DCOM activation or WinRM authentication.
+    void SetHostConnectLatency(const std::wstring& host, std::chrono::microseconds latency);
+    // Number of sessions opened and not closed yet, across all the hosts.
+    size_t GetOpenSessionCount();
+    // Operations on an unreachable host fail with an RPC server unavailable error.
+    void SetHostUnreachable(const std::wstring& host, bool unreachable);
+
+    // Delivers a copy of "indication" to the matching active subscriptions.
+    void PublishIndication(const std::wstring& host, const std::wstring& ns, const MI_Instance* indication);
+};
@@ -0,0 +1,1406 @@
+// MI.h : subset of the Windows SDK Management Infrastructure header used by
+// MI++ and PyMI, for builds without the Windows SDK.
+//
+// Type layouts, constants and function table signatures follow the SDK
+// header so that MI++ compiles unchanged against either. All inline API
+// wrappers dispatch through the function tables, which are provided by the
+// in-memory backend in MIStub.cpp.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+#ifndef MI_CALL
+#define MI_CALL
+#endif
+
+#ifndef MI_INLINE
+#define MI_INLINE static inline
+#endif
+
+#ifndef MI_CONST
+#define MI_CONST const
+#endif
+
+#ifndef _In_
+#define _In_
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned char MI_Boolean;
+typedef unsigned char MI_Uint8;
+typedef signed char MI_Sint8;
+typedef unsigned short MI_Uint16;
+typedef signed short MI_Sint16;
+typedef unsigned int MI_Uint32;
+typedef signed int MI_Sint32;
+typedef uint64_t MI_Uint64;
+typedef int64_t MI_Sint64;
+typedef float MI_Real32;
+typedef double MI_Real64;
+typedef unsigned short MI_Char16;
+typedef wchar_t MI_Char;
+
+#define MI_TRUE ((MI_Boolean)1)
+#define MI_FALSE ((MI_Boolean)0)
+
+typedef enum _MI_Result
+{
+    MI_RESULT_OK = 0,
+    MI_RESULT_FAILED = 1,
+    MI_RESULT_ACCESS_DENIED = 2,
+    MI_RESULT_INVALID_NAMESPACE = 3,
+    MI_RESULT_INVALID_PARAMETER = 4,
+    MI_RESULT_INVALID_CLASS = 5,
+    MI_RESULT_NOT_FOUND = 6,
+    MI_RESULT_NOT_SUPPORTED = 7,
+    MI_RESULT_CLASS_HAS_CHILDREN = 8,
+    MI_RESULT_CLASS_HAS_INSTANCES = 9,
+    MI_RESULT_INVALID_SUPERCLASS = 10,
+    MI_RESULT_ALREADY_EXISTS = 11,
+    MI_RESULT_NO_SUCH_PROPERTY = 12,
+    MI_RESULT_TYPE_MISMATCH = 13,
+    MI_RESULT_QUERY_LANGUAGE_NOT_SUPPORTED = 14,
+    MI_RESULT_INVALID_QUERY = 15,
+    MI_RESULT_METHOD_NOT_AVAILABLE = 16,
+    MI_RESULT_METHOD_NOT_FOUND = 17,
+    MI_RESULT_NAMESPACE_NOT_EMPTY = 20,
+    MI_RESULT_INVALID_ENUMERATION_CONTEXT = 21,
+    MI_RESULT_INVALID_OPERATION_TIMEOUT = 22,
+    MI_RESULT_PULL_HAS_BEEN_ABANDONED = 23,
+    MI_RESULT_PULL_CANNOT_BE_ABANDONED = 24,
+    MI_RESULT_FILTERED_ENUMERATION_NOT_SUPPORTED = 25,
+    MI_RESULT_CONTINUATION_ON_ERROR_NOT_SUPPORTED = 26,
+    MI_RESULT_SERVER_LIMITS_EXCEEDED = 27,
+    MI_RESULT_SERVER_IS_SHUTTING_DOWN = 28
+} MI_Result;
+
+typedef enum _MI_Type
+{
+    MI_BOOLEAN = 0,
+    MI_UINT8 = 1,
+    MI_SINT8 = 2,
+    MI_UINT16 = 3,
+    MI_SINT16 = 4,
+    MI_UINT32 = 5,
+    MI_SINT32 = 6,
+    MI_UINT64 = 7,
+    MI_SINT64 = 8,
+    MI_REAL32 = 9,
+    MI_REAL64 = 10,
+    MI_CHAR16 = 11,
+    MI_DATETIME = 12,
+    MI_STRING = 13,
+    MI_REFERENCE = 14,
+    MI_INSTANCE = 15,
+    MI_BOOLEANA = 16,
+    MI_UINT8A = 17,
+    MI_SINT8A = 18,
+    MI_UINT16A = 19,
+    MI_SINT16A = 20,
+    MI_UINT32A = 21,
+    MI_SINT32A = 22,
+    MI_UINT64A = 23,
+    MI_SINT64A = 24,
+    MI_REAL32A = 25,
+    MI_REAL64A = 26,
+    MI_CHAR16A = 27,
+    MI_DATETIMEA = 28,
+    MI_STRINGA = 29,
+    MI_REFERENCEA = 30,
+    MI_INSTANCEA = 31
+} MI_Type;
+
+#define MI_ARRAY 16
+
+#define MI_FLAG_CLASS (1 << 0)
+#define MI_FLAG_METHOD (1 << 1)
+#define MI_FLAG_PROPERTY (1 << 2)
+#define MI_FLAG_PARAMETER (1 << 3)
+#define MI_FLAG_ASSOCIATION (1 << 4)
+#define MI_FLAG_INDICATION (1 << 5)
+#define MI_FLAG_REFERENCE (1 << 6)
+#define MI_FLAG_ANY (1|2|4|8|16|32|64)
+#define MI_FLAG_ENABLEOVERRIDE (1 << 7)
+#define MI_FLAG_DISABLEOVERRIDE (1 << 8)
+#define MI_FLAG_RESTRICTED (1 << 9)
+#define MI_FLAG_TOSUBCLASS (1 << 10)
+#define MI_FLAG_TRANSLATABLE (1 << 11)
+#define MI_FLAG_KEY (1 << 12)
+#define MI_FLAG_IN (1 << 13)
+#define MI_FLAG_OUT (1 << 14)
+#define MI_FLAG_REQUIRED (1 << 15)
+#define MI_FLAG_STATIC (1 << 16)
+#define MI_FLAG_ABSTRACT (1 << 17)
+#define MI_FLAG_TERMINAL (1 << 18)
+#define MI_FLAG_EXPENSIVE (1 << 19)
+#define MI_FLAG_STREAM (1 << 20)
+#define MI_FLAG_READONLY (1 << 21)
+#define MI_FLAG_EXTENDED (1 << 12)
+#define MI_FLAG_NOT_MODIFIED (1 << 25)
+#define MI_FLAG_NULL (1 << 29)
+#define MI_FLAG_BORROW (1 << 30)
+#define MI_FLAG_ADOPT (1u << 31)
+
+typedef struct _MI_Timestamp
+{
+    MI_Uint32 year;
+    MI_Uint32 month;
+    MI_Uint32 day;
+    MI_Uint32 hour;
+    MI_Uint32 minute;
+    MI_Uint32 second;
+    MI_Uint32 microseconds;
+    MI_Sint32 utc;
+} MI_Timestamp;
+
+typedef struct _MI_Interval
+{
+    MI_Uint32 days;
+    MI_Uint32 hours;
+    MI_Uint32 minutes;
+    MI_Uint32 seconds;
+    MI_Uint32 microseconds;
+    MI_Uint32 __padding1;
+    MI_Uint32 __padding2;
+    MI_Uint32 __padding3;
+} MI_Interval;
+
+typedef struct _MI_Datetime
+{
+    MI_Uint32 isTimestamp;
+    union
+    {
+        MI_Timestamp timestamp;
+        MI_Interval interval;
+    } u;
+} MI_Datetime;
+
+typedef struct _MI_Instance MI_Instance;
+typedef struct _MI_Class MI_Class;
+
+#define MI_DECLARE_ARRAY(NAME, TYPE) \
+    typedef struct _##NAME \
+    { \
+        TYPE* data; \
+        MI_Uint32 size; \
+    } NAME
+
+MI_DECLARE_ARRAY(MI_BooleanA, MI_Boolean);
+MI_DECLARE_ARRAY(MI_Uint8A, MI_Uint8);
+MI_DECLARE_ARRAY(MI_Sint8A, MI_Sint8);
+MI_DECLARE_ARRAY(MI_Uint16A, MI_Uint16);
+MI_DECLARE_ARRAY(MI_Sint16A, MI_Sint16);
+MI_DECLARE_ARRAY(MI_Uint32A, MI_Uint32);
+MI_DECLARE_ARRAY(MI_Sint32A, MI_Sint32);
+MI_DECLARE_ARRAY(MI_Uint64A, MI_Uint64);
+MI_DECLARE_ARRAY(MI_Sint64A, MI_Sint64);
+MI_DECLARE_ARRAY(MI_Real32A, MI_Real32);
+MI_DECLARE_ARRAY(MI_Real64A, MI_Real64);
+MI_DECLARE_ARRAY(MI_Char16A, MI_Char16);
+MI_DECLARE_ARRAY(MI_DatetimeA, MI_Datetime);
+MI_DECLARE_ARRAY(MI_StringA, MI_Char*);
+MI_DECLARE_ARRAY(MI_ReferenceA, MI_Instance*);
+MI_DECLARE_ARRAY(MI_InstanceA, MI_Instance*);
+MI_DECLARE_ARRAY(MI_Array, void);
+
+#undef MI_DECLARE_ARRAY
+
+typedef union _MI_Value
+{
+    MI_Boolean boolean;
+    MI_Uint8 uint8;
+    MI_Sint8 sint8;
+    MI_Uint16 uint16;
+    MI_Sint16 sint16;
+    MI_Uint32 uint32;
+    MI_Sint32 sint32;
+    MI_Uint64 uint64;
+    MI_Sint64 sint64;
+    MI_Real32 real32;
+    MI_Real64 real64;
+    MI_Char16 char16;
+    MI_Datetime datetime;
+    MI_Char* string;
+    MI_Instance* instance;
+    MI_Instance* reference;
+    MI_BooleanA booleana;
+    MI_Uint8A uint8a;
+    MI_Sint8A sint8a;
+    MI_Uint16A uint16a;
+    MI_Sint16A sint16a;
+    MI_Uint32A uint32a;
+    MI_Sint32A sint32a;
+    MI_Uint64A uint64a;
+    MI_Sint64A sint64a;
+    MI_Real32A real32a;
+    MI_Real64A real64a;
+    MI_Char16A char16a;
+    MI_DatetimeA datetimea;
+    MI_StringA stringa;
+    MI_ReferenceA referencea;
+    MI_InstanceA instancea;
+    MI_Array array;
+} MI_Value;
+
+/*
+**==============================================================================
+**
+** Qualifier and parameter sets
+**
+**==============================================================================
+*/
+
+typedef struct _MI_QualifierSetFT MI_QualifierSetFT;
+typedef struct _MI_ParameterSetFT MI_ParameterSetFT;
+
+typedef struct _MI_QualifierSet
+{
+    MI_Uint64 reserved1;
+    ptrdiff_t reserved2;
+    ptrdiff_t reserved3;
+    const MI_QualifierSetFT* ft;
+} MI_QualifierSet;
+
+typedef struct _MI_ParameterSet
+{
+    MI_Uint64 reserved1;
+    ptrdiff_t reserved2;
+    ptrdiff_t reserved3;
+    const MI_ParameterSetFT* ft;
+} MI_ParameterSet;
+
+struct _MI_QualifierSetFT
+{
+    MI_Result (MI_CALL *GetQualifierCount)(const MI_QualifierSet* self, MI_Uint32* count);
+    MI_Result (MI_CALL *GetQualifierAt)(const MI_QualifierSet* self, MI_Uint32 index, const MI_Char** name,
+        MI_Type* qualifierType, MI_Uint32* qualifierFlags, MI_Value* qualifierValue);
+    MI_Result (MI_CALL *GetQualifier)(const MI_QualifierSet* self, const MI_Char* name, MI_Type* qualifierType,
+        MI_Uint32* qualifierFlags, MI_Value* qualifierValue, MI_Uint32* index);
+};
+
+struct _MI_ParameterSetFT
+{
+    MI_Result (MI_CALL *GetMethodReturnType)(const MI_ParameterSet* self, MI_Type* returnType, MI_QualifierSet* qualifierSet);
+    MI_Result (MI_CALL *GetParameterCount)(const MI_ParameterSet* self, MI_Uint32* count);
+    MI_Result (MI_CALL *GetParameterAt)(const MI_ParameterSet* self, MI_Uint32 index, const MI_Char** name,
+        MI_Type* parameterType, MI_Char** referenceClass, MI_QualifierSet* qualifierSet);
+    MI_Result (MI_CALL *GetParameter)(const MI_ParameterSet* self, const MI_Char* name, MI_Type* parameterType,
+        MI_Char** referenceClass, MI_QualifierSet* qualifierSet, MI_Uint32* index);
+};
+
+/*
+**==============================================================================
+**
+** Class
+**
+**==============================================================================
+*/
+
+typedef struct _MI_ClassFT MI_ClassFT;
+typedef struct _MI_ClassDecl MI_ClassDecl;
+
+struct _MI_Class
+{
+    const MI_ClassFT* ft;
+    MI_CONST MI_ClassDecl* classDecl;
+    MI_CONST MI_Char* namespaceName;
+    MI_CONST MI_Char* serverName;
+    ptrdiff_t reserved[4];
+};
+
+struct _MI_ClassFT
+{
+    MI_Result (MI_CALL *GetClassName)(const MI_Class* self, const MI_Char** className);
+    MI_Result (MI_CALL *GetNameSpace)(const MI_Class* self, const MI_Char** nameSpace);
+    MI_Result (MI_CALL *GetServerName)(const MI_Class* self, const MI_Char** serverName);
+    MI_Result (MI_CALL *GetElementCount)(const MI_Class* self, MI_Uint32* count);
+    MI_Result (MI_CALL *GetElement)(const MI_Class* self, const MI_Char* name, MI_Value* value,
+        MI_Boolean* valueExists, MI_Type* type, MI_Char** referenceClass, MI_QualifierSet* qualifierSet,
+        MI_Uint32* flags, MI_Uint32* index);
+    MI_Result (MI_CALL *GetElementAt)(const MI_Class* self, MI_Uint32 index, const MI_Char** name,
+        MI_Value* value, MI_Boolean* valueExists, MI_Type* type, MI_Char** referenceClass,
+        MI_QualifierSet* qualifierSet, MI_Uint32* flags);
+    MI_Result (MI_CALL *GetClassQualifierSet)(const MI_Class* self, MI_QualifierSet* qualifierSet);
+    MI_Result (MI_CALL *GetMethodCount)(const MI_Class* self, MI_Uint32* count);
+    MI_Result (MI_CALL *GetMethodAt)(const MI_Class* self, MI_Uint32 index, const MI_Char** name,
+        MI_QualifierSet* qualifierSet, MI_ParameterSet* parameterSet);
+    MI_Result (MI_CALL *GetMethod)(const MI_Class* self, const MI_Char* name, MI_QualifierSet* qualifierSet,
+        MI_ParameterSet* parameterSet, MI_Uint32* index);
+    MI_Result (MI_CALL *GetParentClassName)(const MI_Class* self, const MI_Char** name);
+    MI_Result (MI_CALL *GetParentClass)(const MI_Class* self, MI_Class** parentClass);
+    MI_Result (MI_CALL *Delete)(MI_Class* self);
+    MI_Result (MI_CALL *Clone)(const MI_Class* self, MI_Class** newClass);
+};
+
+/*
+**==============================================================================
+**
+** Instance
+**
+**==============================================================================
+*/
+
+typedef struct _MI_InstanceFT MI_InstanceFT;
+
+struct _MI_Instance
+{
+    const MI_InstanceFT* ft;
+    MI_CONST MI_ClassDecl* classDecl;
+    MI_CONST MI_Char* serverName;
+    MI_CONST MI_Char* nameSpace;
+    ptrdiff_t reserved[4];
+};
+
+struct _MI_InstanceFT
+{
+    MI_Result (MI_CALL *Clone)(const MI_Instance* self, MI_Instance** newInstance);
+    MI_Result (MI_CALL *Destruct)(MI_Instance* self);
+    MI_Result (MI_CALL *Delete)(MI_Instance* self);
+    MI_Result (MI_CALL *IsA)(const MI_Instance* self, const MI_ClassDecl* classDecl, MI_Boolean* flag);
+    MI_Result (MI_CALL *GetClassName)(const MI_Instance* self, const MI_Char** className);
+    MI_Result (MI_CALL *SetNameSpace)(MI_Instance* self, const MI_Char* nameSpace);
+    MI_Result (MI_CALL *GetNameSpace)(const MI_Instance* self, const MI_Char** nameSpace);
+    MI_Result (MI_CALL *GetElementCount)(const MI_Instance* self, MI_Uint32* count);
+    MI_Result (MI_CALL *AddElement)(MI_Instance* self, const MI_Char* name, const MI_Value* value,
+        MI_Type type, MI_Uint32 flags);
+    MI_Result (MI_CALL *SetElement)(MI_Instance* self, const MI_Char* name, const MI_Value* value,
+        MI_Type type, MI_Uint32 flags);
+    MI_Result (MI_CALL *SetElementAt)(MI_Instance* self, MI_Uint32 index, const MI_Value* value,
+        MI_Type type, MI_Uint32 flags);
+    MI_Result (MI_CALL *GetElement)(const MI_Instance* self, const MI_Char* name, MI_Value* value,
+        MI_Type* type, MI_Uint32* flags, MI_Uint32* index);
+    MI_Result (MI_CALL *GetElementAt)(const MI_Instance* self, MI_Uint32 index, const MI_Char** name,
+        MI_Value* value, MI_Type* type, MI_Uint32* flags);
+    MI_Result (MI_CALL *ClearElement)(MI_Instance* self, const MI_Char* name);
+    MI_Result (MI_CALL *ClearElementAt)(MI_Instance* self, MI_Uint32 index);
+    MI_Result (MI_CALL *GetServerName)(const MI_Instance* self, const MI_Char** serverName);
+    MI_Result (MI_CALL *SetServerName)(MI_Instance* self, const MI_Char* serverName);
+    MI_Result (MI_CALL *GetClass)(const MI_Instance* self, MI_Class** instanceClass);
+};
+
+/*
+**==============================================================================
+**
+** Options
+**
+**==============================================================================
+*/
+
+typedef struct _MI_OperationOptionsFT MI_OperationOptionsFT;
+typedef struct _MI_DestinationOptionsFT MI_DestinationOptionsFT;
+
+typedef struct _MI_OperationOptions
+{
+    MI_Uint64 reserved1;
+    ptrdiff_t reserved2;
+    const MI_OperationOptionsFT* ft;
+} MI_OperationOptions;
+
+#define MI_OPERATIONOPTIONS_NULL { 0, 0, NULL }
+
+typedef struct _MI_DestinationOptions
+{
+    MI_Uint64 reserved1;
+    ptrdiff_t reserved2;
+    const MI_DestinationOptionsFT* ft;
+} MI_DestinationOptions;
+
+#define MI_DESTINATIONOPTIONS_NULL { 0, 0, NULL }
+
+typedef struct _MI_UsernamePasswordCreds
+{
+    const MI_Char* domain;
+    const MI_Char* username;
+    const MI_Char* password;
+} MI_UsernamePasswordCreds;
+
+typedef struct _MI_UserCredentials
+{
+    const MI_Char* authenticationType;
+    union
+    {
+        MI_UsernamePasswordCreds usernamePassword;
+        const MI_Char* certificateThumbprint;
+    } credentials;
+} MI_UserCredentials;
+
+#define MI_AUTH_TYPE_DEFAULT L"Default"
+#define MI_AUTH_TYPE_NONE L"None"
+#define MI_AUTH_TYPE_DIGEST L"Digest"
+#define MI_AUTH_TYPE_NEGO_WITH_CREDS L"NegoWithCreds"
+#define MI_AUTH_TYPE_NEGO_NO_CREDS L"NegoNoCreds"
+#define MI_AUTH_TYPE_BASIC L"Basic"
+#define MI_AUTH_TYPE_KERBEROS L"Kerberos"
+#define MI_AUTH_TYPE_CLIENT_CERTS L"ClientCerts"
+#define MI_AUTH_TYPE_NTLM L"Ntlmdomain"
+#define MI_AUTH_TYPE_CREDSSP L"CredSSP"
+#define MI_AUTH_TYPE_ISSUER_CERT L"IssuerCert"
+
+#define MI_DESTINATIONOPTIONS_TRANSPORT_HTTP L"HTTP"
+#define MI_DESTINATIONOPTIONS_TRANPSORT_HTTPS L"HTTPS"
+
+struct _MI_OperationOptionsFT
+{
+    void (MI_CALL *Delete)(MI_OperationOptions* options);
+    MI_Result (MI_CALL *SetTimeout)(MI_OperationOptions* options, const MI_Interval* timeout);
+    MI_Result (MI_CALL *GetTimeout)(MI_OperationOptions* options, MI_Interval* timeout);
+    MI_Result (MI_CALL *SetCustomOption)(MI_OperationOptions* options, const MI_Char* optionName,
+        MI_Type optionValueType, const MI_Value* optionValue, MI_Boolean mustComply);
+    MI_Result (MI_CALL *Clone)(const MI_OperationOptions* self, MI_OperationOptions* newOperationOptions);
+};
+
+struct _MI_DestinationOptionsFT
+{
+    void (MI_CALL *Delete)(MI_DestinationOptions* options);
+    MI_Result (MI_CALL *SetTimeout)(MI_DestinationOptions* options, const MI_Interval* timeout);
+    MI_Result (MI_CALL *GetTimeout)(MI_DestinationOptions* options, MI_Interval* timeout);
+    MI_Result (MI_CALL *SetUILocale)(MI_DestinationOptions* options, const MI_Char* locale);
+    MI_Result (MI_CALL *GetUILocale)(MI_DestinationOptions* options, const MI_Char** locale);
+    MI_Result (MI_CALL *SetTransport)(MI_DestinationOptions* options, const MI_Char* transport);
+    MI_Result (MI_CALL *GetTransport)(MI_DestinationOptions* options, const MI_Char** transport);
+    MI_Result (MI_CALL *AddDestinationCredentials)(MI_DestinationOptions* options, const MI_UserCredentials* credentials);
+    MI_Result (MI_CALL *Clone)(const MI_DestinationOptions* self, MI_DestinationOptions* newDestinationOptions);
+};
+
+/*
+**==============================================================================
+**
+** Operation
+**
+**==============================================================================
+*/
+
+typedef struct _MI_OperationFT MI_OperationFT;
+
+typedef struct _MI_Operation
+{
+    MI_Uint64 reserved1;
+    ptrdiff_t reserved2;
+    const MI_OperationFT* ft;
+} MI_Operation;
+
+#define MI_OPERATION_NULL { 0, 0, NULL }
+
+typedef enum _MI_CancellationReason
+{
+    MI_REASON_NONE = 0,
+    MI_REASON_TIMEOUT,
+    MI_REASON_SHUTDOWN,
+    MI_REASON_SERVICESTOP
+} MI_CancellationReason;
+
+typedef enum _MI_OperationCallback_ResponseType
+{
+    MI_OperationCallback_ResponseType_No = 0,
+    MI_OperationCallback_ResponseType_Yes,
+    MI_OperationCallback_ResponseType_NoToAll,
+    MI_OperationCallback_ResponseType_YesToAll
+} MI_OperationCallback_ResponseType;
+
+typedef enum _MI_PromptType
+{
+    MI_PROMPTTYPE_NORMAL = 0,
+    MI_PROMPTTYPE_CRITICAL
+} MI_PromptType;
+
+typedef void (MI_CALL *MI_OperationCallback_PromptUser)(MI_Operation* operation, void* callbackContext,
+    const MI_Char* message, MI_PromptType promptType,
+    MI_Result (MI_CALL *promptUserResult)(MI_Operation* operation, MI_OperationCallback_ResponseType response));
+
+typedef void (MI_CALL *MI_OperationCallback_WriteError)(MI_Operation* operation, void* callbackContext,
+    MI_Instance* instance,
+    MI_Result (MI_CALL *writeErrorResult)(MI_Operation* operation, MI_OperationCallback_ResponseType response));
+
+typedef void (MI_CALL *MI_OperationCallback_WriteMessage)(MI_Operation* operation, void* callbackContext,
+    MI_Uint32 channel, const MI_Char* message);
+
+typedef void (MI_CALL *MI_OperationCallback_WriteProgress)(MI_Operation* operation, void* callbackContext,
+    const MI_Char* activity, const MI_Char* currentOperation, const MI_Char* statusDescription,
+    MI_Uint32 percentageComplete, MI_Uint32 secondsRemaining);
+
+typedef void (MI_CALL *MI_OperationCallback_Instance)(MI_Operation* operation, void* callbackContext,
+    const MI_Instance* instance, MI_Boolean moreResults, MI_Result resultCode, const MI_Char* errorString,
+    const MI_Instance* errorDetails, MI_Result (MI_CALL *resultAcknowledgement)(MI_Operation* operation));
+
+typedef void (MI_CALL *MI_OperationCallback_Indication)(MI_Operation* operation, void* callbackContext,
+    const MI_Instance* instance, const MI_Char* bookmark, const MI_Char* machineID, MI_Boolean moreResults,
+    MI_Result resultCode, const MI_Char* errorString, const MI_Instance* errorDetails,
+    MI_Result (MI_CALL *resultAcknowledgement)(MI_Operation* operation));
+
+typedef void (MI_CALL *MI_OperationCallback_Class)(MI_Operation* operation, void* callbackContext,
+    const MI_Class* classResult, MI_Boolean moreResults, MI_Result resultCode, const MI_Char* errorString,
+    const MI_Instance* errorDetails, MI_Result (MI_CALL *resultAcknowledgement)(MI_Operation* operation));
+
+typedef void (MI_CALL *MI_OperationCallback_StreamedParameter)(MI_Operation* operation, void* callbackContext,
+    const MI_Char* parameterName, MI_Type resultType, const MI_Value* result,
+    MI_Result (MI_CALL *resultAcknowledgement)(MI_Operation* operation));
+
+typedef struct _MI_OperationCallbacks
+{
+    void* callbackContext;
+    MI_OperationCallback_PromptUser promptUser;
+    MI_OperationCallback_WriteError writeError;
+    MI_OperationCallback_WriteMessage writeMessage;
+    MI_OperationCallback_WriteProgress writeProgress;
+    MI_OperationCallback_Instance instanceResult;
+    MI_OperationCallback_Indication indicationResult;
+    MI_OperationCallback_Class classResult;
+    MI_OperationCallback_StreamedParameter streamedParameterResult;
+} MI_OperationCallbacks;
+
+#define MI_OPERATIONCALLBACKS_NULL { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL }
+
+struct _MI_OperationFT
+{
+    MI_Result (MI_CALL *Close)(MI_Operation* operation);
+    MI_Result (MI_CALL *Cancel)(MI_Operation* operation, MI_CancellationReason reason);
+    MI_Result (MI_CALL *GetSession)(MI_Operation* operation, struct _MI_Session* session);
+    MI_Result (MI_CALL *GetInstance)(MI_Operation* operation, const MI_Instance** instance,
+        MI_Boolean* moreResults, MI_Result* result, const MI_Char** errorMessage,
+        const MI_Instance** completionDetails);
+    MI_Result (MI_CALL *GetIndication)(MI_Operation* operation, const MI_Instance** instance,
+        const MI_Char** bookmark, const MI_Char** machineID, MI_Boolean* moreResults, MI_Result* result,
+        const MI_Char** errorMessage, const MI_Instance** completionDetails);
+    MI_Result (MI_CALL *GetClass)(MI_Operation* operation, const MI_Class** classResult,
+        MI_Boolean* moreResults, MI_Result* result, const MI_Char** errorMessage,
+        const MI_Instance** completionDetails);
+};
+
+/*
+**==============================================================================
+**
+** Session
+**
+**==============================================================================
+*/
+
+typedef struct _MI_SessionFT MI_SessionFT;
+typedef struct _MI_SubscriptionDeliveryOptions MI_SubscriptionDeliveryOptions;
+typedef struct _MI_SessionCallbacks MI_SessionCallbacks;
+
+typedef struct _MI_Session
+{
+    MI_Uint64 reserved1;
+    ptrdiff_t reserved2;
+    const MI_SessionFT* ft;
+} MI_Session;
+
+#define MI_SESSION_NULL { 0, 0, NULL }
+
+#define MI_OPERATIONFLAGS_DEFAULT_RTTI 0x0000
+#define MI_OPERATIONFLAGS_BASIC_RTTI 0x0002
+#define MI_OPERATIONFLAGS_FULL_RTTI 0x0004
+#define MI_OPERATIONFLAGS_NO_RTTI 0x0400
+#define MI_OPERATIONFLAGS_STANDARD_RTTI 0x0800
+
+struct _MI_SessionFT
+{
+    MI_Result (MI_CALL *Close)(MI_Session* session, void* completionContext,
+        void (MI_CALL *completionCallback)(void* completionContext));
+    MI_Result (MI_CALL *GetApplication)(MI_Session* session, struct _MI_Application* application);
+    void (MI_CALL *GetInstance)(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+        const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+        MI_Operation* operation);
+    void (MI_CALL *ModifyInstance)(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+        const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+        MI_Operation* operation);
+    void (MI_CALL *CreateInstance)(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+        const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+        MI_Operation* operation);
+    void (MI_CALL *DeleteInstance)(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+        const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+        MI_Operation* operation);
+    void (MI_CALL *Invoke)(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+        const MI_Char* namespaceName, const MI_Char* className, const MI_Char* methodName,
+        const MI_Instance* inboundInstance, const MI_Instance* inboundProperties,
+        MI_OperationCallbacks* callbacks, MI_Operation* operation);
+    void (MI_CALL *EnumerateInstances)(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+        const MI_Char* namespaceName, const MI_Char* className, MI_Boolean keysOnly,
+        MI_OperationCallbacks* callbacks, MI_Operation* operation);
+    void (MI_CALL *QueryInstances)(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+        const MI_Char* namespaceName, const MI_Char* queryDialect, const MI_Char* queryExpression,
+        MI_OperationCallbacks* callbacks, MI_Operation* operation);
+    void (MI_CALL *AssociatorInstances)(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+        const MI_Char* namespaceName, const MI_Instance* instanceKey, const MI_Char* assocClass,
+        const MI_Char* resultClass, const MI_Char* role, const MI_Char* resultRole, MI_Boolean keysOnly,
+        MI_OperationCallbacks* callbacks, MI_Operation* operation);
+    void (MI_CALL *Subscribe)(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+        const MI_Char* namespaceName, const MI_Char* queryDialect, const MI_Char* queryExpression,
+        const MI_SubscriptionDeliveryOptions* deliverOptions, MI_OperationCallbacks* callbacks,
+        MI_Operation* operation);
+    void (MI_CALL *GetClass)(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+        const MI_Char* namespaceName, const MI_Char* className, MI_OperationCallbacks* callbacks,
+        MI_Operation* operation);
+    void (MI_CALL *TestConnection)(MI_Session* session, MI_Uint32 flags, MI_OperationCallbacks* callbacks,
+        MI_Operation* operation);
+};
+
+/*
+**==============================================================================
+**
+** Serializer
+**
+**==============================================================================
+*/
+
+typedef struct _MI_SerializerFT MI_SerializerFT;
+
+typedef struct _MI_Serializer
+{
+    MI_Uint64 reserved1;
+    ptrdiff_t reserved2;
+} MI_Serializer;
+
+#define MI_SERIALIZER_FLAGS_CLASS_DEEP 1
+#define MI_SERIALIZER_FLAGS_INSTANCE_WITH_CLASS 1
+
+struct _MI_SerializerFT
+{
+    MI_Result (MI_CALL *Close)(MI_Serializer* serializer);
+    MI_Result (MI_CALL *SerializeClass)(MI_Serializer* serializer, MI_Uint32 flags, const MI_Class* classObject,
+        MI_Uint8* clientBuffer, MI_Uint32 clientBufferLength, MI_Uint32* clientBufferNeeded);
+    MI_Result (MI_CALL *SerializeInstance)(MI_Serializer* serializer, MI_Uint32 flags,
+        const MI_Instance* instanceObject, MI_Uint8* clientBuffer, MI_Uint32 clientBufferLength,
+        MI_Uint32* clientBufferNeeded);
+};
+
+/*
+**==============================================================================
+**
+** Deserializer
+**
+**==============================================================================
+*/
+
+typedef struct _MI_DeserializerFT MI_DeserializerFT;
+
+typedef struct _MI_Deserializer
+{
+    MI_Uint64 reserved1;
+    ptrdiff_t reserved2;
+} MI_Deserializer;
+
+typedef MI_Result (MI_CALL *MI_Deserializer_ClassObjectNeeded)(void* context, const MI_Char* serverName,
+    const MI_Char* namespaceName, const MI_Char* className, MI_Class** requestedClassObject);
+
+struct _MI_DeserializerFT
+{
+    MI_Result (MI_CALL *Close)(MI_Deserializer* deserializer);
+    MI_Result (MI_CALL *DeserializeClass)(MI_Deserializer* deserializer, MI_Uint32 flags,
+        MI_Uint8* serializedBuffer, MI_Uint32 serializedBufferLength, MI_Class* parentClass,
+        const MI_Char* serverName, const MI_Char* namespaceName, MI_Deserializer_ClassObjectNeeded classObjectNeeded,
+        void* classObjectNeededContext, MI_Uint32* serializedBufferRead, MI_Class** classObject,
+        MI_Instance** cimErrorDetails);
+    MI_Result (MI_CALL *Class_GetClassName)(MI_Deserializer* deserializer, MI_Uint8* serializedBuffer,
+        MI_Uint32 serializedBufferLength, MI_Char* className, MI_Uint32* classNameLength,
+        MI_Instance** cimErrorDetails);
+    MI_Result (MI_CALL *Class_GetParentClassName)(MI_Deserializer* deserializer, MI_Uint8* serializedBuffer,
+        MI_Uint32 serializedBufferLength, MI_Char* parentClassName, MI_Uint32* parentClassNameLength,
+        MI_Instance** cimErrorDetails);
+    MI_Result (MI_CALL *DeserializeInstance)(MI_Deserializer* deserializer, MI_Uint32 flags,
+        MI_Uint8* serializedBuffer, MI_Uint32 serializedBufferLength, MI_Class** classObjects,
+        MI_Uint32 numberClassObjects, MI_Deserializer_ClassObjectNeeded classObjectNeeded,
+        void* classObjectNeededContext, MI_Uint32* serializedBufferRead, MI_Instance** instanceObject,
+        MI_Instance** cimErrorDetails);
+    MI_Result (MI_CALL *Instance_GetClassName)(MI_Deserializer* deserializer, MI_Uint8* serializedBuffer,
+        MI_Uint32 serializedBufferLength, MI_Char* className, MI_Uint32* classNameLength,
+        MI_Instance** cimErrorDetails);
+};
+
+/*
+**==============================================================================
+**
+** Application
+**
+**==============================================================================
+*/
+
+typedef struct _MI_ApplicationFT MI_ApplicationFT;
+
+typedef struct _MI_Application
+{
+    MI_Uint64 reserved1;
+    ptrdiff_t reserved2;
+    const MI_ApplicationFT* ft;
+} MI_Application;
+
+#define MI_APPLICATION_NULL { 0, 0, NULL }
+
+struct _MI_ApplicationFT
+{
+    MI_Result (MI_CALL *Close)(MI_Application* application);
+    MI_Result (MI_CALL *NewSession)(MI_Application* application, const MI_Char* protocol,
+        const MI_Char* destination, MI_DestinationOptions* options, MI_SessionCallbacks* callbacks,
+        MI_Instance** extendedError, MI_Session* session);
+    MI_Result (MI_CALL *NewHostedProvider)(MI_Application* application);
+    MI_Result (MI_CALL *NewInstance)(MI_Application* application, const MI_Char* className,
+        const MI_ClassDecl* classRTTI, MI_Instance** instance);
+    MI_Result (MI_CALL *NewDestinationOptions)(MI_Application* application, MI_DestinationOptions* options);
+    MI_Result (MI_CALL *NewOperationOptions)(MI_Application* application, MI_Boolean customOptionsMustUnderstand,
+        MI_OperationOptions* options);
+    MI_Result (MI_CALL *NewSubscriptionDeliveryOptions)(MI_Application* application);
+    MI_Result (MI_CALL *NewSerializer)(MI_Application* application, MI_Uint32 flags, const MI_Char* format,
+        MI_Serializer* serializer);
+    MI_Result (MI_CALL *NewDeserializer)(MI_Application* application, MI_Uint32 flags, const MI_Char* format,
+        MI_Deserializer* deserializer);
+    MI_Result (MI_CALL *NewInstanceFromClass)(MI_Application* application, const MI_Char* className,
+        const MI_Class* classObject, MI_Instance** instance);
+};
+
+MI_Result MI_CALL MI_Application_Initialize(MI_Uint32 flags, const MI_Char* applicationID,
+    MI_Instance** extendedError, MI_Application* application);
+
+/*
+**==============================================================================
+**
+** Inline API wrappers
+**
+**==============================================================================
+*/
+
+MI_INLINE MI_Result MI_Application_Close(MI_Application* application)
+{
+    if (!application || !application->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return application->ft->Close(application);
+}
+
+MI_INLINE MI_Result MI_Application_NewSession(MI_Application* application, const MI_Char* protocol,
+    const MI_Char* destination, MI_DestinationOptions* options, MI_SessionCallbacks* callbacks,
+    MI_Instance** extendedError, MI_Session* session)
+{
+    if (!application || !application->ft || !session)
+        return MI_RESULT_INVALID_PARAMETER;
+    return application->ft->NewSession(application, protocol, destination, options, callbacks, extendedError, session);
+}
+
+MI_INLINE MI_Result MI_Application_NewInstance(MI_Application* application, const MI_Char* className,
+    const MI_ClassDecl* classRTTI, MI_Instance** instance)
+{
+    if (!application || !application->ft || !instance)
+        return MI_RESULT_INVALID_PARAMETER;
+    return application->ft->NewInstance(application, className, classRTTI, instance);
+}
+
+MI_INLINE MI_Result MI_Application_NewInstanceFromClass(MI_Application* application, const MI_Char* className,
+    const MI_Class* classObject, MI_Instance** instance)
+{
+    if (!application || !application->ft || !instance)
+        return MI_RESULT_INVALID_PARAMETER;
+    return application->ft->NewInstanceFromClass(application, className, classObject, instance);
+}
+
+MI_INLINE MI_Result MI_Application_NewDestinationOptions(MI_Application* application, MI_DestinationOptions* options)
+{
+    if (!application || !application->ft || !options)
+        return MI_RESULT_INVALID_PARAMETER;
+    return application->ft->NewDestinationOptions(application, options);
+}
+
+MI_INLINE MI_Result MI_Application_NewOperationOptions(MI_Application* application,
+    MI_Boolean customOptionsMustUnderstand, MI_OperationOptions* options)
+{
+    if (!application || !application->ft || !options)
+        return MI_RESULT_INVALID_PARAMETER;
+    return application->ft->NewOperationOptions(application, customOptionsMustUnderstand, options);
+}
+
+MI_INLINE MI_Result MI_Application_NewSerializer(MI_Application* application, MI_Uint32 flags,
+    const MI_Char* format, MI_Serializer* serializer)
+{
+    if (!application || !application->ft || !serializer)
+        return MI_RESULT_INVALID_PARAMETER;
+    return application->ft->NewSerializer(application, flags, format, serializer);
+}
+
+MI_INLINE MI_Result MI_Application_NewDeserializer(MI_Application* application, MI_Uint32 flags,
+    const MI_Char* format, MI_Deserializer* deserializer)
+{
+    if (!application || !application->ft || !deserializer)
+        return MI_RESULT_INVALID_PARAMETER;
+    return application->ft->NewDeserializer(application, flags, format, deserializer);
+}
+
+MI_INLINE MI_Result MI_Session_Close(MI_Session* session, void* completionContext,
+    void (MI_CALL *completionCallback)(void* completionContext))
+{
+    if (!session || !session->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return session->ft->Close(session, completionContext, completionCallback);
+}
+
+MI_INLINE void MI_Session_GetInstance(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    if (session && session->ft)
+        session->ft->GetInstance(session, flags, options, namespaceName, inboundInstance, callbacks, operation);
+}
+
+MI_INLINE void MI_Session_ModifyInstance(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    if (session && session->ft)
+        session->ft->ModifyInstance(session, flags, options, namespaceName, inboundInstance, callbacks, operation);
+}
+
+MI_INLINE void MI_Session_CreateInstance(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    if (session && session->ft)
+        session->ft->CreateInstance(session, flags, options, namespaceName, inboundInstance, callbacks, operation);
+}
+
+MI_INLINE void MI_Session_DeleteInstance(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Instance* inboundInstance, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    if (session && session->ft)
+        session->ft->DeleteInstance(session, flags, options, namespaceName, inboundInstance, callbacks, operation);
+}
+
+MI_INLINE void MI_Session_Invoke(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Char* className, const MI_Char* methodName,
+    const MI_Instance* inboundInstance, const MI_Instance* inboundProperties, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    if (session && session->ft)
+        session->ft->Invoke(session, flags, options, namespaceName, className, methodName, inboundInstance,
+            inboundProperties, callbacks, operation);
+}
+
+MI_INLINE void MI_Session_QueryInstances(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Char* queryDialect, const MI_Char* queryExpression,
+    MI_OperationCallbacks* callbacks, MI_Operation* operation)
+{
+    if (session && session->ft)
+        session->ft->QueryInstances(session, flags, options, namespaceName, queryDialect, queryExpression,
+            callbacks, operation);
+}
+
+MI_INLINE void MI_Session_AssociatorInstances(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Instance* instanceKey, const MI_Char* assocClass,
+    const MI_Char* resultClass, const MI_Char* role, const MI_Char* resultRole, MI_Boolean keysOnly,
+    MI_OperationCallbacks* callbacks, MI_Operation* operation)
+{
+    if (session && session->ft)
+        session->ft->AssociatorInstances(session, flags, options, namespaceName, instanceKey, assocClass,
+            resultClass, role, resultRole, keysOnly, callbacks, operation);
+}
+
+MI_INLINE void MI_Session_Subscribe(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Char* queryDialect, const MI_Char* queryExpression,
+    const MI_SubscriptionDeliveryOptions* deliverOptions, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    if (session && session->ft)
+        session->ft->Subscribe(session, flags, options, namespaceName, queryDialect, queryExpression,
+            deliverOptions, callbacks, operation);
+}
+
+MI_INLINE void MI_Session_GetClass(MI_Session* session, MI_Uint32 flags, MI_OperationOptions* options,
+    const MI_Char* namespaceName, const MI_Char* className, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    if (session && session->ft)
+        session->ft->GetClass(session, flags, options, namespaceName, className, callbacks, operation);
+}
+
+MI_INLINE void MI_Session_TestConnection(MI_Session* session, MI_Uint32 flags, MI_OperationCallbacks* callbacks,
+    MI_Operation* operation)
+{
+    if (session && session->ft)
+        session->ft->TestConnection(session, flags, callbacks, operation);
+}
+
+MI_INLINE MI_Result MI_Operation_Close(MI_Operation* operation)
+{
+    if (!operation || !operation->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return operation->ft->Close(operation);
+}
+
+MI_INLINE MI_Result MI_Operation_Cancel(MI_Operation* operation, MI_CancellationReason reason)
+{
+    if (!operation || !operation->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return operation->ft->Cancel(operation, reason);
+}
+
+MI_INLINE MI_Result MI_Operation_GetInstance(MI_Operation* operation, const MI_Instance** instance,
+    MI_Boolean* moreResults, MI_Result* result, const MI_Char** errorMessage,
+    const MI_Instance** completionDetails)
+{
+    if (!operation || !operation->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return operation->ft->GetInstance(operation, instance, moreResults, result, errorMessage, completionDetails);
+}
+
+MI_INLINE MI_Result MI_Operation_GetIndication(MI_Operation* operation, const MI_Instance** instance,
+    const MI_Char** bookmark, const MI_Char** machineID, MI_Boolean* moreResults, MI_Result* result,
+    const MI_Char** errorMessage, const MI_Instance** completionDetails)
+{
+    if (!operation || !operation->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return operation->ft->GetIndication(operation, instance, bookmark, machineID, moreResults, result,
+        errorMessage, completionDetails);
+}
+
+MI_INLINE MI_Result MI_Operation_GetClass(MI_Operation* operation, const MI_Class** classResult,
+    MI_Boolean* moreResults, MI_Result* result, const MI_Char** errorMessage,
+    const MI_Instance** completionDetails)
+{
+    if (!operation || !operation->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return operation->ft->GetClass(operation, classResult, moreResults, result, errorMessage, completionDetails);
+}
+
+MI_INLINE MI_Result MI_Instance_Clone(const MI_Instance* self, MI_Instance** newInstance)
+{
+    if (!self || !self->ft || !newInstance)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->Clone(self, newInstance);
+}
+
+MI_INLINE MI_Result MI_Instance_Delete(MI_Instance* self)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->Delete(self);
+}
+
+MI_INLINE MI_Result MI_Instance_GetClassName(const MI_Instance* self, const MI_Char** className)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetClassName(self, className);
+}
+
+MI_INLINE MI_Result MI_Instance_GetNameSpace(const MI_Instance* self, const MI_Char** nameSpace)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetNameSpace(self, nameSpace);
+}
+
+MI_INLINE MI_Result MI_Instance_SetNameSpace(MI_Instance* self, const MI_Char* nameSpace)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->SetNameSpace(self, nameSpace);
+}
+
+MI_INLINE MI_Result MI_Instance_GetServerName(const MI_Instance* self, const MI_Char** serverName)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetServerName(self, serverName);
+}
+
+MI_INLINE MI_Result MI_Instance_SetServerName(MI_Instance* self, const MI_Char* serverName)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->SetServerName(self, serverName);
+}
+
+MI_INLINE MI_Result MI_Instance_GetElementCount(const MI_Instance* self, MI_Uint32* count)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetElementCount(self, count);
+}
+
+MI_INLINE MI_Result MI_Instance_AddElement(MI_Instance* self, const MI_Char* name, const MI_Value* value,
+    MI_Type type, MI_Uint32 flags)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->AddElement(self, name, value, type, flags);
+}
+
+MI_INLINE MI_Result MI_Instance_SetElement(MI_Instance* self, const MI_Char* name, const MI_Value* value,
+    MI_Type type, MI_Uint32 flags)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->SetElement(self, name, value, type, flags);
+}
+
+MI_INLINE MI_Result MI_Instance_SetElementAt(MI_Instance* self, MI_Uint32 index, const MI_Value* value,
+    MI_Type type, MI_Uint32 flags)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->SetElementAt(self, index, value, type, flags);
+}
+
+MI_INLINE MI_Result MI_Instance_GetElement(const MI_Instance* self, const MI_Char* name, MI_Value* value,
+    MI_Type* type, MI_Uint32* flags, MI_Uint32* index)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetElement(self, name, value, type, flags, index);
+}
+
+MI_INLINE MI_Result MI_Instance_GetElementAt(const MI_Instance* self, MI_Uint32 index, const MI_Char** name,
+    MI_Value* value, MI_Type* type, MI_Uint32* flags)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetElementAt(self, index, name, value, type, flags);
+}
+
+MI_INLINE MI_Result MI_Instance_ClearElement(MI_Instance* self, const MI_Char* name)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->ClearElement(self, name);
+}
+
+MI_INLINE MI_Result MI_Instance_ClearElementAt(MI_Instance* self, MI_Uint32 index)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->ClearElementAt(self, index);
+}
+
+MI_INLINE MI_Result MI_Instance_GetClass(const MI_Instance* self, MI_Class** instanceClass)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetClass(self, instanceClass);
+}
+
+MI_INLINE MI_Result MI_Class_GetClassName(const MI_Class* self, const MI_Char** className)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetClassName(self, className);
+}
+
+MI_INLINE MI_Result MI_Class_GetNameSpace(const MI_Class* self, const MI_Char** nameSpace)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetNameSpace(self, nameSpace);
+}
+
+MI_INLINE MI_Result MI_Class_GetServerName(const MI_Class* self, const MI_Char** serverName)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetServerName(self, serverName);
+}
+
+MI_INLINE MI_Result MI_Class_GetElementCount(const MI_Class* self, MI_Uint32* count)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetElementCount(self, count);
+}
+
+MI_INLINE MI_Result MI_Class_GetElement(const MI_Class* self, const MI_Char* name, MI_Value* value,
+    MI_Boolean* valueExists, MI_Type* type, MI_Char** referenceClass, MI_QualifierSet* qualifierSet,
+    MI_Uint32* flags, MI_Uint32* index)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetElement(self, name, value, valueExists, type, referenceClass, qualifierSet, flags, index);
+}
+
+MI_INLINE MI_Result MI_Class_GetElementAt(const MI_Class* self, MI_Uint32 index, const MI_Char** name,
+    MI_Value* value, MI_Boolean* valueExists, MI_Type* type, MI_Char** referenceClass,
+    MI_QualifierSet* qualifierSet, MI_Uint32* flags)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetElementAt(self, index, name, value, valueExists, type, referenceClass, qualifierSet, flags);
+}
+
+MI_INLINE MI_Result MI_Class_GetClassQualifierSet(const MI_Class* self, MI_QualifierSet* qualifierSet)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetClassQualifierSet(self, qualifierSet);
+}
+
+MI_INLINE MI_Result MI_Class_GetMethodCount(const MI_Class* self, MI_Uint32* count)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetMethodCount(self, count);
+}
+
+MI_INLINE MI_Result MI_Class_GetMethodAt(const MI_Class* self, MI_Uint32 index, const MI_Char** name,
+    MI_QualifierSet* qualifierSet, MI_ParameterSet* parameterSet)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetMethodAt(self, index, name, qualifierSet, parameterSet);
+}
+
+MI_INLINE MI_Result MI_Class_GetMethod(const MI_Class* self, const MI_Char* name, MI_QualifierSet* qualifierSet,
+    MI_ParameterSet* parameterSet, MI_Uint32* index)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetMethod(self, name, qualifierSet, parameterSet, index);
+}
+
+MI_INLINE MI_Result MI_Class_GetParentClassName(const MI_Class* self, const MI_Char** name)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetParentClassName(self, name);
+}
+
+MI_INLINE MI_Result MI_Class_GetParentClass(const MI_Class* self, MI_Class** parentClass)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetParentClass(self, parentClass);
+}
+
+MI_INLINE MI_Result MI_Class_Delete(MI_Class* self)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->Delete(self);
+}
+
+MI_INLINE MI_Result MI_Class_Clone(const MI_Class* self, MI_Class** newClass)
+{
+    if (!self || !self->ft || !newClass)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->Clone(self, newClass);
+}
+
+MI_INLINE MI_Result MI_QualifierSet_GetQualifierCount(const MI_QualifierSet* self, MI_Uint32* count)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetQualifierCount(self, count);
+}
+
+MI_INLINE MI_Result MI_QualifierSet_GetQualifierAt(const MI_QualifierSet* self, MI_Uint32 index,
+    const MI_Char** name, MI_Type* qualifierType, MI_Uint32* qualifierFlags, MI_Value* qualifierValue)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetQualifierAt(self, index, name, qualifierType, qualifierFlags, qualifierValue);
+}
+
+MI_INLINE MI_Result MI_QualifierSet_GetQualifier(const MI_QualifierSet* self, const MI_Char* name,
+    MI_Type* qualifierType, MI_Uint32* qualifierFlags, MI_Value* qualifierValue, MI_Uint32* index)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetQualifier(self, name, qualifierType, qualifierFlags, qualifierValue, index);
+}
+
+MI_INLINE MI_Result MI_ParameterSet_GetMethodReturnType(const MI_ParameterSet* self, MI_Type* returnType,
+    MI_QualifierSet* qualifierSet)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetMethodReturnType(self, returnType, qualifierSet);
+}
+
+MI_INLINE MI_Result MI_ParameterSet_GetParameterCount(const MI_ParameterSet* self, MI_Uint32* count)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetParameterCount(self, count);
+}
+
+MI_INLINE MI_Result MI_ParameterSet_GetParameterAt(const MI_ParameterSet* self, MI_Uint32 index,
+    const MI_Char** name, MI_Type* parameterType, MI_Char** referenceClass, MI_QualifierSet* qualifierSet)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetParameterAt(self, index, name, parameterType, referenceClass, qualifierSet);
+}
+
+MI_INLINE MI_Result MI_ParameterSet_GetParameter(const MI_ParameterSet* self, const MI_Char* name,
+    MI_Type* parameterType, MI_Char** referenceClass, MI_QualifierSet* qualifierSet, MI_Uint32* index)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->GetParameter(self, name, parameterType, referenceClass, qualifierSet, index);
+}
+
+MI_INLINE void MI_OperationOptions_Delete(MI_OperationOptions* options)
+{
+    if (options && options->ft)
+        options->ft->Delete(options);
+}
+
+MI_INLINE MI_Result MI_OperationOptions_SetTimeout(MI_OperationOptions* options, const MI_Interval* timeout)
+{
+    if (!options || !options->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return options->ft->SetTimeout(options, timeout);
+}
+
+MI_INLINE MI_Result MI_OperationOptions_GetTimeout(MI_OperationOptions* options, MI_Interval* timeout)
+{
+    if (!options || !options->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return options->ft->GetTimeout(options, timeout);
+}
+
+MI_INLINE MI_Result MI_OperationOptions_SetCustomOption(MI_OperationOptions* options, const MI_Char* optionName,
+    MI_Type optionValueType, const MI_Value* optionValue, MI_Boolean mustComply)
+{
+    if (!options || !options->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return options->ft->SetCustomOption(options, optionName, optionValueType, optionValue, mustComply);
+}
+
+MI_INLINE MI_Result MI_OperationOptions_Clone(const MI_OperationOptions* self, MI_OperationOptions* newOptions)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->Clone(self, newOptions);
+}
+
+MI_INLINE void MI_DestinationOptions_Delete(MI_DestinationOptions* options)
+{
+    if (options && options->ft)
+        options->ft->Delete(options);
+}
+
+MI_INLINE MI_Result MI_DestinationOptions_SetTimeout(MI_DestinationOptions* options, const MI_Interval* timeout)
+{
+    if (!options || !options->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return options->ft->SetTimeout(options, timeout);
+}
+
+MI_INLINE MI_Result MI_DestinationOptions_GetTimeout(MI_DestinationOptions* options, MI_Interval* timeout)
+{
+    if (!options || !options->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return options->ft->GetTimeout(options, timeout);
+}
+
+MI_INLINE MI_Result MI_DestinationOptions_SetUILocale(MI_DestinationOptions* options, const MI_Char* locale)
+{
+    if (!options || !options->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return options->ft->SetUILocale(options, locale);
+}
+
+MI_INLINE MI_Result MI_DestinationOptions_GetUILocale(MI_DestinationOptions* options, const MI_Char** locale)
+{
+    if (!options || !options->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return options->ft->GetUILocale(options, locale);
+}
+
+MI_INLINE MI_Result MI_DestinationOptions_SetTransport(MI_DestinationOptions* options, const MI_Char* transport)
+{
+    if (!options || !options->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return options->ft->SetTransport(options, transport);
+}
+
+MI_INLINE MI_Result MI_DestinationOptions_GetTransport(MI_DestinationOptions* options, const MI_Char** transport)
+{
+    if (!options || !options->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return options->ft->GetTransport(options, transport);
+}
+
+MI_INLINE MI_Result MI_DestinationOptions_AddDestinationCredentials(MI_DestinationOptions* options,
+    const MI_UserCredentials* credentials)
+{
+    if (!options || !options->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return options->ft->AddDestinationCredentials(options, credentials);
+}
+
+MI_INLINE MI_Result MI_DestinationOptions_Clone(const MI_DestinationOptions* self, MI_DestinationOptions* newOptions)
+{
+    if (!self || !self->ft)
+        return MI_RESULT_INVALID_PARAMETER;
+    return self->ft->Clone(self, newOptions);
+}
+
+MI_INLINE MI_Result MI_Serializer_Close(MI_Serializer* serializer)
+{
+    if (!serializer || !serializer->reserved2)
+        return MI_RESULT_INVALID_PARAMETER;
+    return ((const MI_SerializerFT*)serializer->reserved2)->Close(serializer);
+}
+
+MI_INLINE MI_Result MI_Serializer_SerializeClass(MI_Serializer* serializer, MI_Uint32 flags,
+    const MI_Class* classObject, MI_Uint8* clientBuffer, MI_Uint32 clientBufferLength,
+    MI_Uint32* clientBufferNeeded)
+{
+    if (!serializer || !serializer->reserved2)
+        return MI_RESULT_INVALID_PARAMETER;
+    return ((const MI_SerializerFT*)serializer->reserved2)->SerializeClass(serializer, flags, classObject,
+        clientBuffer, clientBufferLength, clientBufferNeeded);
+}
+
+MI_INLINE MI_Result MI_Serializer_SerializeInstance(MI_Serializer* serializer, MI_Uint32 flags,
+    const MI_Instance* instanceObject, MI_Uint8* clientBuffer, MI_Uint32 clientBufferLength,
+    MI_Uint32* clientBufferNeeded)
+{
+    if (!serializer || !serializer->reserved2)
+        return MI_RESULT_INVALID_PARAMETER;
+    return ((const MI_SerializerFT*)serializer->reserved2)->SerializeInstance(serializer, flags, instanceObject,
+        clientBuffer, clientBufferLength, clientBufferNeeded);
+}
+
+MI_INLINE MI_Result MI_Deserializer_Close(MI_Deserializer* deserializer)
+{
+    if (!deserializer || !deserializer->reserved2)
+        return MI_RESULT_INVALID_PARAMETER;
+    return ((const MI_DeserializerFT*)deserializer->reserved2)->Close(deserializer);
+}
+
+MI_INLINE MI_Result MI_Deserializer_DeserializeClass(MI_Deserializer* deserializer, MI_Uint32 flags,
+    MI_Uint8* serializedBuffer, MI_Uint32 serializedBufferLength, MI_Class* parentClass, const MI_Char* serverName,
+    const MI_Char* namespaceName, MI_Deserializer_ClassObjectNeeded classObjectNeeded, void* classObjectNeededContext,
+    MI_Uint32* serializedBufferRead, MI_Class** classObject, MI_Instance** cimErrorDetails)
+{
+    if (!deserializer || !deserializer->reserved2)
+        return MI_RESULT_INVALID_PARAMETER;
+    return ((const MI_DeserializerFT*)deserializer->reserved2)->DeserializeClass(deserializer, flags,
+        serializedBuffer, serializedBufferLength, parentClass, serverName, namespaceName, classObjectNeeded,
+        classObjectNeededContext, serializedBufferRead, classObject, cimErrorDetails);
+}
+
+MI_INLINE MI_Result MI_Deserializer_Class_GetClassName(MI_Deserializer* deserializer, MI_Uint8* serializedBuffer,
+    MI_Uint32 serializedBufferLength, MI_Char* className, MI_Uint32* classNameLength, MI_Instance** cimErrorDetails)
+{
+    if (!deserializer || !deserializer->reserved2)
+        return MI_RESULT_INVALID_PARAMETER;
+    return ((const MI_DeserializerFT*)deserializer->reserved2)->Class_GetClassName(deserializer, serializedBuffer,
+        serializedBufferLength, className, classNameLength, cimErrorDetails);
+}
+
+MI_INLINE MI_Result MI_Deserializer_Class_GetParentClassName(MI_Deserializer* deserializer,
+    MI_Uint8* serializedBuffer, MI_Uint32 serializedBufferLength, MI_Char* parentClassName,
+    MI_Uint32* parentClassNameLength, MI_Instance** cimErrorDetails)
+{
+    if (!deserializer || !deserializer->reserved2)
+        return MI_RESULT_INVALID_PARAMETER;
+    return ((const MI_DeserializerFT*)deserializer->reserved2)->Class_GetParentClassName(deserializer,
+        serializedBuffer, serializedBufferLength, parentClassName, parentClassNameLength, cimErrorDetails);
+}
+
+#ifdef __cplusplus
+}
+#endif
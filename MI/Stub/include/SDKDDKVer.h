@@ -0,0 +1,3 @@
+// SDKDDKVer.h : placeholder for builds without the Windows SDK.
+
+#pragma once
@@ -0,0 +1,173 @@
+// windows.h : minimal subset of the Win32 API used by MI++ and PyMI, for
+// builds without the Windows SDK. Only what the sources actually reference
+// is provided.
+
+#pragma once
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+typedef int BOOL;
+typedef unsigned long DWORD;
+typedef unsigned int UINT;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef wchar_t* LPWSTR;
+typedef const wchar_t* LPCWSTR;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define CP_ACP 0
+#define CP_UTF8 65001
+
+#define ZeroMemory(Destination, Length) memset((Destination), 0, (Length))
+
+static inline int memcpy_s(void* dest, size_t destSize, const void* src, size_t count)
+{
+    if (!dest || (count && !src) || count > destSize)
+        return EINVAL;
+    memcpy(dest, src, count);
+    return 0;
+}
+
+static inline int lstrlenW(const wchar_t* s)
+{
+    return s ? (int)wcslen(s) : 0;
+}
+
+static inline int lstrlenA(const char* s)
+{
+    return s ? (int)strlen(s) : 0;
+}
+
+#define lstrlen lstrlenW
+
+static inline DWORD GetLastError()
+{
+    return (DWORD)errno;
+}
+
+// Both code pages are treated as UTF-8, which is what the callers pass in
+// practice on non-Windows hosts.
+static inline int MultiByteToWideChar(UINT codePage, DWORD flags, const char* src, int srcLen,
+    wchar_t* dest, int destLen)
+{
+    (void)codePage;
+    (void)flags;
+    if (srcLen < 0)
+        srcLen = (int)strlen(src) + 1;
+
+    int written = 0;
+    int i = 0;
+    while (i < srcLen)
+    {
+        unsigned char c = (unsigned char)src[i];
+        unsigned int cp;
+        int extra;
+        if (c < 0x80) { cp = c; extra = 0; }
+        else if ((c & 0xE0) == 0xC0) { cp = c & 0x1F; extra = 1; }
+        else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; extra = 2; }
+        else { cp = c & 0x07; extra = 3; }
+        if (i + extra >= srcLen)
+            return 0;
+        for (int j = 1; j <= extra; j++)
+            cp = (cp << 6) | ((unsigned char)src[i + j] & 0x3F);
+        i += extra + 1;
+        if (destLen)
+        {
+            if (written >= destLen)
+                return 0;
+            dest[written] = (wchar_t)cp;
+        }
+        written++;
+    }
+    return written;
+}
+
+static inline int WideCharToMultiByte(UINT codePage, DWORD flags, const wchar_t* src, int srcLen,
+    char* dest, int destLen, const char* defaultChar, BOOL* usedDefaultChar)
+{
+    (void)codePage;
+    (void)flags;
+    (void)defaultChar;
+    if (usedDefaultChar)
+        *usedDefaultChar = FALSE;
+    if (srcLen < 0)
+        srcLen = (int)wcslen(src) + 1;
+
+    int written = 0;
+    for (int i = 0; i < srcLen; i++)
+    {
+        unsigned int cp = (unsigned int)src[i];
+        char buf[4];
+        int n;
+        if (cp < 0x80) { buf[0] = (char)cp; n = 1; }
+        else if (cp < 0x800) { buf[0] = (char)(0xC0 | (cp >> 6)); buf[1] = (char)(0x80 | (cp & 0x3F)); n = 2; }
+        else if (cp < 0x10000)
+        {
+            buf[0] = (char)(0xE0 | (cp >> 12));
+            buf[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+            buf[2] = (char)(0x80 | (cp & 0x3F));
+            n = 3;
+        }
+        else
+        {
+            buf[0] = (char)(0xF0 | (cp >> 18));
+            buf[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+            buf[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+            buf[3] = (char)(0x80 | (cp & 0x3F));
+            n = 4;
+        }
+        if (destLen)
+        {
+            if (written + n > destLen)
+                return 0;
+            memcpy(dest + written, buf, n);
+        }
+        written += n;
+    }
+    return written;
+}
+
+typedef struct _CRITICAL_SECTION
+{
+    pthread_mutex_t mutex;
+} CRITICAL_SECTION, *PCRITICAL_SECTION, *LPCRITICAL_SECTION;
+
+static inline void InitializeCriticalSection(LPCRITICAL_SECTION cs)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&cs->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static inline void EnterCriticalSection(LPCRITICAL_SECTION cs)
+{
+    pthread_mutex_lock(&cs->mutex);
+}
+
+static inline BOOL TryEnterCriticalSection(LPCRITICAL_SECTION cs)
+{
+    return pthread_mutex_trylock(&cs->mutex) == 0;
+}
+
+static inline void LeaveCriticalSection(LPCRITICAL_SECTION cs)
+{
+    pthread_mutex_unlock(&cs->mutex);
+}
+
+static inline void DeleteCriticalSection(LPCRITICAL_SECTION cs)
+{
+    pthread_mutex_destroy(&cs->mutex);
+}
@@ -4,10 +4,15 @@
 #include "Class.h"
 #include "Instance.h"
 #include "Serializer.h"
+#include "JsonSerializer.h"
+#include "ClassSchemaCache.h"
 #include "OperationOptions.h"
 #include "DestinationOptions.h"
+#include "FanOutQuery.h"
 #include "Utils.h"
 
+#include <datetime.h>
+
 
 static PyObject* Application_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
@@ -43,9 +48,11 @@ static PyObject* Application_NewSession(Application *self, PyObject *args, PyObj
     char* protocol = "";
     char* computerName = ".";
     PyObject* destinationOptions = NULL;
+    PyObject* pooled = NULL;
 
-    static char *kwlist[] = { "protocol", "computer_name", "destination_options", NULL };
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|ssO", kwlist, &protocol, &computerName, &destinationOptions))
+    static char *kwlist[] = { "protocol", "computer_name", "destination_options", "pooled", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|ssOO", kwlist, &protocol, &computerName, &destinationOptions,
+                                     &pooled))
         return NULL;
 
     try
@@ -55,12 +62,117 @@ static PyObject* Application_NewSession(Application *self, PyObject *args, PyObj
             throw MI::TypeConversionException(L"\"destination_options\" must have type DestinationOptions");
         }
 
+        bool usePool = pooled && PyObject_IsTrue(pooled);
         std::shared_ptr<MI::Session> session;
+        if (usePool)
+        {
+            std::shared_ptr<MI::SessionPool> sessionPool;
+            AllowThreads(&self->cs, [&]() {
+                if (!self->sessionPool)
+                {
+                    self->sessionPool = std::make_shared<MI::SessionPool>(self->app);
+                }
+                sessionPool = self->sessionPool;
+            });
+            // Connecting to a host doesn't hold back the other callers
+            AllowThreads(NULL, [&]() {
+                session = sessionPool->GetSession(ToWstring(protocol).c_str(), ToWstring(computerName).c_str(),
+                    !CheckPyNone(destinationOptions) ? ((DestinationOptions*)destinationOptions)->destinationOptions : NULL,
+                    &usePool);
+            });
+        }
+        else
+        {
+            AllowThreads(&self->cs, [&]() {
+                session = self->app->NewSession(ToWstring(protocol).c_str(), ToWstring(computerName).c_str(),
+                    !CheckPyNone(destinationOptions) ? ((DestinationOptions*)destinationOptions)->destinationOptions : NULL);
+            });
+        }
+        return (PyObject*)Session_New(session, usePool);
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* Application_FanOutQuery(Application *self, PyObject *args, PyObject *kwds)
+{
+    PyObject* computerNames = NULL;
+    char* ns = NULL;
+    char* query = NULL;
+    char* dialect = "WQL";
+    char* protocol = "";
+    PyObject* destinationOptions = NULL;
+    PyObject* operationOptions = NULL;
+    unsigned maxConcurrency = 16;
+    PyObject* hostTimeout = NULL;
+
+    static char *kwlist[] = { "computer_names", "ns", "query", "dialect", "protocol", "destination_options",
+                              "operation_options", "max_concurrency", "host_timeout", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "Oss|ssOOIO", kwlist, &computerNames, &ns, &query, &dialect,
+                                     &protocol, &destinationOptions, &operationOptions, &maxConcurrency, &hostTimeout))
+        return NULL;
+
+    PyDateTime_IMPORT;
+
+    try
+    {
+        ValidatePyObjectType(destinationOptions, L"destination_options",
+                             &DestinationOptionsType, L"DestinationOptions");
+        ValidatePyObjectType(operationOptions, L"operation_options",
+                             &OperationOptionsType, L"OperationOptions");
+        std::chrono::milliseconds timeout(0);
+        if (!CheckPyNone(hostTimeout))
+        {
+            timeout = PyDeltaToMilliseconds(hostTimeout, L"host_timeout");
+        }
+
+        std::vector<std::wstring> names;
+        PyObject* iterator = PyObject_GetIter(computerNames);
+        if (!iterator)
+        {
+            return NULL;
+        }
+        PyObject* item = NULL;
+        while ((item = PyIter_Next(iterator)))
+        {
+            std::wstring name;
+            bool isStr = false;
+            try
+            {
+                isStr = PyStrToWString(item, name);
+            }
+            catch (std::exception&)
+            {
+                Py_DECREF(item);
+                Py_DECREF(iterator);
+                throw;
+            }
+            Py_DECREF(item);
+            if (!isStr)
+            {
+                Py_DECREF(iterator);
+                throw MI::TypeConversionException(L"\"computer_names\" items must have type str");
+            }
+            names.push_back(std::move(name));
+        }
+        Py_DECREF(iterator);
+        if (PyErr_Occurred())
+        {
+            return NULL;
+        }
+
+        std::shared_ptr<MI::FanOutQuery> fanOutQuery;
         AllowThreads(&self->cs, [&]() {
-            session = self->app->NewSession(ToWstring(protocol).c_str(), ToWstring(computerName).c_str(),
-                !CheckPyNone(destinationOptions) ? ((DestinationOptions*)destinationOptions)->destinationOptions : NULL);
+            fanOutQuery = std::make_shared<MI::FanOutQuery>(self->app, names, ToWstring(ns), ToWstring(query),
+                ToWstring(dialect), ToWstring(protocol),
+                !CheckPyNone(destinationOptions) ? ((DestinationOptions*)destinationOptions)->destinationOptions : NULL,
+                !CheckPyNone(operationOptions) ? ((OperationOptions*)operationOptions)->operationOptions : NULL,
+                maxConcurrency, timeout);
         });
-        return (PyObject*)Session_New(session);
+        return (PyObject*)FanOutQuery_New(fanOutQuery);
     }
     catch (std::exception& ex)
     {
@@ -69,14 +181,71 @@ static PyObject* Application_NewSession(Application *self, PyObject *args, PyObj
     }
 }
 
-static void Application_dealloc(Application* self)
+static PyObject* Application_ConfigureSessionPool(Application *self, PyObject *args, PyObject *kwds)
 {
-    if (self->app)
+    unsigned maxSessions = 32;
+    PyObject* idleTimeout = NULL;
+    PyObject* validationInterval = NULL;
+
+    static char *kwlist[] = { "max_sessions", "idle_timeout", "validation_interval", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|IOO", kwlist, &maxSessions, &idleTimeout, &validationInterval))
+        return NULL;
+
+    PyDateTime_IMPORT;
+
+    try
     {
+        std::chrono::milliseconds idle = std::chrono::minutes(5);
+        std::chrono::milliseconds validation = std::chrono::seconds(30);
+        if (!CheckPyNone(idleTimeout))
+        {
+            idle = PyDeltaToMilliseconds(idleTimeout, L"idle_timeout");
+        }
+        if (!CheckPyNone(validationInterval))
+        {
+            validation = PyDeltaToMilliseconds(validationInterval, L"validation_interval");
+        }
+
+        // Sessions in use are kept by their owners, the idle ones are closed
+        std::shared_ptr<MI::SessionPool> oldSessionPool;
         AllowThreads(&self->cs, [&]() {
-            self->app = NULL;
+            oldSessionPool = self->sessionPool;
+            self->sessionPool = std::make_shared<MI::SessionPool>(self->app, maxSessions, idle, validation);
+            oldSessionPool = NULL;
         });
+        Py_RETURN_NONE;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
     }
+}
+
+static PyObject* Application_ClearSessionPool(Application *self, PyObject*)
+{
+    try
+    {
+        AllowThreads(&self->cs, [&]() {
+            if (self->sessionPool)
+            {
+                self->sessionPool->Clear();
+            }
+        });
+        Py_RETURN_NONE;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static void Application_dealloc(Application* self)
+{
+    // The pooled sessions are closed before the application
+    ReleaseBlockingObject(self->sessionPool);
+    ReleaseBlockingObject(self->app);
     ::DeleteCriticalSection(&self->cs);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
@@ -173,6 +342,60 @@ static PyObject* Application_NewSerializer(Application* self, PyObject*)
     }
 }
 
+static PyObject* Application_NewClassSchemaCache(Application* self, PyObject* args, PyObject* kwds)
+{
+    char* path = NULL;
+    char* schemaVersion = "";
+    PyObject* maxAge = NULL;
+    static char *kwlist[] = { "path", "schema_version", "max_age", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|sO", kwlist, &path, &schemaVersion, &maxAge))
+        return NULL;
+
+    PyDateTime_IMPORT;
+
+    try
+    {
+        auto age = std::chrono::seconds::zero();
+        if (!CheckPyNone(maxAge))
+        {
+            age = std::chrono::duration_cast<std::chrono::seconds>(PyDeltaToMilliseconds(maxAge, L"max_age"));
+        }
+
+        std::shared_ptr<MI::ClassSchemaCache> classSchemaCache;
+        // Maps the cache file
+        AllowThreads(&self->cs, [&]() {
+            classSchemaCache = std::make_shared<MI::ClassSchemaCache>(self->app, ToWstring(path),
+                ToWstring(schemaVersion), age);
+        });
+        return (PyObject*)ClassSchemaCache_New(classSchemaCache);
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* Application_NewJsonSerializer(Application* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* includeClassName = NULL;
+    static char *kwlist[] = { "include_class_name", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &includeClassName))
+        return NULL;
+
+    try
+    {
+        auto serializer = std::make_shared<MI::JsonSerializer>(
+            includeClassName && PyObject_IsTrue(includeClassName));
+        return (PyObject*)JsonSerializer_New(serializer);
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
 static PyObject* Application_NewOperationOptions(Application* self, PyObject*)
 {
     try
@@ -212,6 +435,10 @@ static PyObject* Application_Close(Application *self, PyObject*)
     try
     {
         AllowThreads(&self->cs, [&]() {
+            if (self->sessionPool)
+            {
+                self->sessionPool->Clear();
+            }
             self->app->Close();
         });
         Py_RETURN_NONE;
@@ -232,6 +459,10 @@ static PyObject* Application_self(Application *self, PyObject*)
 static PyObject* Application_exit(Application* self, PyObject*)
 {
     AllowThreads(&self->cs, [&]() {
+        if (self->sessionPool)
+        {
+            self->sessionPool->Clear();
+        }
         if (!self->app->IsClosed())
             self->app->Close();
     });
@@ -243,11 +474,16 @@ static PyMemberDef Application_members[] = {
 };
 
 static PyMethodDef Application_methods[] = {
-    { "create_session", (PyCFunction)Application_NewSession, METH_VARARGS | METH_KEYWORDS, "Creates a new session." },
+    { "create_session", (PyCFunction)Application_NewSession, METH_VARARGS | METH_KEYWORDS, "Creates a new session, or shares a pooled one." },
+    { "configure_session_pool", (PyCFunction)Application_ConfigureSessionPool, METH_VARARGS | METH_KEYWORDS, "Sets the size and timeouts of the session pool." },
+    { "clear_session_pool", (PyCFunction)Application_ClearSessionPool, METH_NOARGS, "Closes the idle pooled sessions." },
     { "create_instance", (PyCFunction)Application_NewInstance, METH_VARARGS | METH_KEYWORDS, "Creates a new instance." },
     { "create_instance_from_class", (PyCFunction)Application_NewInstanceFromClass, METH_VARARGS | METH_KEYWORDS, "Creates a new instance from a class." },
     { "create_method_params", (PyCFunction)Application_NewMethodInboundParameters, METH_VARARGS | METH_KEYWORDS, "Creates a new __parameters instance with a method's inbound parameters." },
+    { "fan_out_query", (PyCFunction)Application_FanOutQuery, METH_VARARGS | METH_KEYWORDS, "Runs a query against multiple hosts, returns an iterator over the tagged results." },
     { "create_serializer", (PyCFunction)Application_NewSerializer, METH_NOARGS, "Creates a serializer." },
+    { "create_class_schema_cache", (PyCFunction)Application_NewClassSchemaCache, METH_VARARGS | METH_KEYWORDS, "Creates a class schema cache persisted in a file." },
+    { "create_json_serializer", (PyCFunction)Application_NewJsonSerializer, METH_VARARGS | METH_KEYWORDS, "Creates a JSON serializer." },
     { "create_operation_options", (PyCFunction)Application_NewOperationOptions, METH_NOARGS, "Creates a new OperationObjects instance." },
     { "create_destination_options", (PyCFunction)Application_NewDestinationOptions, METH_NOARGS, "Creates a new DestinationOptions instance."},
     { "close", (PyCFunction)Application_Close, METH_NOARGS, "Closes the application." },
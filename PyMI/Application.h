@@ -2,12 +2,15 @@
 
 #include <Python.h>
 #include <MI++.h>
+#include <MISessionPool.h>
 #include <memory>
 
 typedef struct {
     PyObject_HEAD
     /* Type-specific fields go here. */
     std::shared_ptr<MI::Application> app;
+    // Created on first use by create_session(pooled=True)
+    std::shared_ptr<MI::SessionPool> sessionPool;
     CRITICAL_SECTION cs;
 } Application;
 
@@ -50,6 +50,12 @@ void PythonMICallbacks::IndicationResult(std::shared_ptr<MI::Operation> operatio
             CallPythonCallback(m_indicationResult, "(OuuIIuO)", instanceObj, bookmark.c_str(), machineID.c_str(), moreResults ? 1 : 0,
                 resultCode, errorString.c_str(), errorDetailsObj);
 
+            // Kept by the callback, cloned once it returns
+            if (instance && Py_REFCNT(instanceObj) > 1)
+            {
+                std::const_pointer_cast<MI::Instance>(instance)->Retain();
+            }
+
             Py_DECREF(instanceObj);
             Py_DECREF(errorDetailsObj);
             PyGILState_Release(gstate);
@@ -66,6 +72,88 @@ void PythonMICallbacks::IndicationResult(std::shared_ptr<MI::Operation> operatio
 
 PythonMICallbacks::~PythonMICallbacks()
 {
+    // The operation holding the callbacks may be released with the GIL unlocked
+    PyGILState_STATE gstate = PyGILState_Ensure();
     Py_XDECREF(m_indicationResult);
     m_indicationResult = NULL;
+    PyGILState_Release(gstate);
+}
+
+PythonMIBatchCallbacks::PythonMIBatchCallbacks(PyObject* instanceResult, size_t batchSize) :
+    m_instanceResult(instanceResult), m_batchSize(batchSize ? batchSize : 1)
+{
+    Py_XINCREF(m_instanceResult);
+    m_batch.reserve(m_batchSize);
+}
+
+void PythonMIBatchCallbacks::InstanceResult(std::shared_ptr<MI::Operation> operation, std::shared_ptr<const MI::Instance> instance,
+    bool moreResults, MI_Result resultCode, const std::wstring& errorString, std::shared_ptr<const MI::Instance> errorDetails)
+{
+    // Results are delivered one at a time per operation and are valid only during the call,
+    // the clones are taken without the GIL
+    if (instance)
+    {
+        m_batch.push_back(instance->Clone());
+    }
+
+    if (!moreResults)
+    {
+        DeliverBatch(false, resultCode, errorString, errorDetails ? errorDetails->Clone() : nullptr);
+    }
+    else if (m_batch.size() >= m_batchSize)
+    {
+        DeliverBatch(true, resultCode, errorString, nullptr);
+    }
+}
+
+void PythonMIBatchCallbacks::DeliverBatch(bool moreResults, MI_Result resultCode, const std::wstring& errorString,
+    std::shared_ptr<const MI::Instance> errorDetails)
+{
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    PyObject* instancesObj = NULL;
+    PyObject* errorDetailsObj = NULL;
+
+    try
+    {
+        instancesObj = PyList_New(m_batch.size());
+        for (size_t i = 0; i < m_batch.size(); i++)
+        {
+            PyList_SET_ITEM(instancesObj, i, (PyObject*)Instance_New(m_batch[i]));
+        }
+        m_batch.clear();
+
+        if (errorDetails)
+        {
+            errorDetailsObj = (PyObject*)Instance_New(std::const_pointer_cast<MI::Instance>(errorDetails));
+        }
+        else
+        {
+            errorDetailsObj = Py_None;
+            Py_INCREF(Py_None);
+        }
+
+        CallPythonCallback(m_instanceResult, "(OIIuO)", instancesObj, moreResults ? 1 : 0, resultCode,
+            errorString.c_str(), errorDetailsObj);
+
+        Py_DECREF(instancesObj);
+        Py_DECREF(errorDetailsObj);
+        PyGILState_Release(gstate);
+    }
+    catch (std::exception&)
+    {
+        m_batch.clear();
+        Py_XDECREF(instancesObj);
+        Py_XDECREF(errorDetailsObj);
+        PyGILState_Release(gstate);
+        throw;
+    }
+}
+
+PythonMIBatchCallbacks::~PythonMIBatchCallbacks()
+{
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    m_batch.clear();
+    Py_XDECREF(m_instanceResult);
+    m_instanceResult = NULL;
+    PyGILState_Release(gstate);
 }
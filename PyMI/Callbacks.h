@@ -3,6 +3,7 @@
 #include <Python.h>
 #include <MI++.h>
 #include <memory>
+#include <vector>
 
 class PythonMICallbacks : public MI::Callbacks
 {
@@ -16,3 +17,20 @@ public:
         const std::wstring& errorString, std::shared_ptr<const MI::Instance> errorDetails);
     ~PythonMICallbacks();
 };
+
+// Delivers instance results to a Python callable in batches, taking the GIL once per batch
+class PythonMIBatchCallbacks : public MI::Callbacks
+{
+private:
+    PyObject* m_instanceResult = NULL;
+    size_t m_batchSize;
+    std::vector<std::shared_ptr<MI::Instance>> m_batch;
+
+    void DeliverBatch(bool moreResults, MI_Result resultCode, const std::wstring& errorString,
+        std::shared_ptr<const MI::Instance> errorDetails);
+public:
+    PythonMIBatchCallbacks(PyObject* instanceResult, size_t batchSize);
+    void InstanceResult(std::shared_ptr<MI::Operation> operation, std::shared_ptr<const MI::Instance> instance, bool moreResults,
+        MI_Result resultCode, const std::wstring& errorString, std::shared_ptr<const MI::Instance> errorDetails);
+    ~PythonMIBatchCallbacks();
+};
@@ -2,6 +2,7 @@
 #include "Class.h"
 #include "Utils.h"
 #include "PyMI.h"
+#include "StringCache.h"
 
 
 static PyObject* Class_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
@@ -21,9 +22,8 @@ static int Class_init(Class* self, PyObject* args, PyObject* kwds)
 
 static void Class_dealloc(Class* self)
 {
-    AllowThreads(&self->cs, [&]() {
-        self->miClass = NULL;
-    });
+    // Deleting an MI class doesn't block
+    self->miClass = NULL;
     ::DeleteCriticalSection(&self->cs);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
@@ -113,7 +113,7 @@ static PyObject* Class_GetClassName(Class* self, PyObject*)
     try
     {
         std::wstring className = self->miClass->GetClassName();
-        return PyUnicode_FromWideChar(className.c_str(), className.length());
+        return GetNamePyString(className.c_str());
     }
     catch (std::exception& ex)
     {
@@ -150,6 +150,31 @@ static PyObject* Class_GetServerName(Class* self, PyObject*)
     }
 }
 
+static PyObject* Class_HasMethod(Class* self, PyObject* name)
+{
+    try
+    {
+        std::wstring methodName;
+        Py_ssize_t i;
+        GetIndexOrName(name, methodName, i);
+        if (i >= 0)
+        {
+            throw MI::Exception(L"Invalid method name");
+        }
+
+        bool found = false;
+        AllowThreads(&self->cs, [&]() {
+            found = self->miClass->HasMethod(methodName);
+        });
+        return PyBool_FromLong(found);
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
 static PyMemberDef Class_members[] = {
     { NULL }  /* Sentinel */
 };
@@ -159,6 +184,7 @@ static PyMethodDef Class_methods[] = {
     { "get_namespace", (PyCFunction)Class_GetNameSpace, METH_NOARGS, "" },
     { "get_server_name", (PyCFunction)Class_GetServerName, METH_NOARGS, "" },
     { "__getitem__", (PyCFunction)Class_subscript, METH_O | METH_COEXIST, "" },
+    { "has_method", (PyCFunction)Class_HasMethod, METH_O, "Returns True if the class has a method with the given name." },
     { "clone", (PyCFunction)Class_Clone, METH_NOARGS, "Clones this class." },
     { NULL }  /* Sentinel */
 };
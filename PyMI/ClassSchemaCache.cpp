@@ -0,0 +1,167 @@
+#include "stdafx.h"
+#include "ClassSchemaCache.h"
+#include "PyMI.h"
+#include "Class.h"
+#include "Session.h"
+#include "Utils.h"
+
+
+static PyObject* ClassSchemaCache_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
+{
+    ClassSchemaCache* self = NULL;
+    self = (ClassSchemaCache*)type->tp_alloc(type, 0);
+    ::InitializeCriticalSection(&self->cs);
+    return (PyObject *)self;
+}
+
+static void ClassSchemaCache_dealloc(ClassSchemaCache* self)
+{
+    // Saves the cache
+    ReleaseBlockingObject(self->classSchemaCache);
+    ::DeleteCriticalSection(&self->cs);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int ClassSchemaCache_init(ClassSchemaCache* self, PyObject* args, PyObject* kwds)
+{
+    PyErr_SetString(PyMIError, "Please use Application.create_class_schema_cache to allocate a ClassSchemaCache object.");
+    return -1;
+}
+
+ClassSchemaCache* ClassSchemaCache_New(std::shared_ptr<MI::ClassSchemaCache> classSchemaCache)
+{
+    ClassSchemaCache* obj = (ClassSchemaCache*)ClassSchemaCache_new(&ClassSchemaCacheType, NULL, NULL);
+    obj->classSchemaCache = classSchemaCache;
+    return obj;
+}
+
+static PyObject* ClassSchemaCache_GetClass(ClassSchemaCache* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* session = NULL;
+    char* ns = NULL;
+    char* className = NULL;
+    char* computerName = ".";
+    static char *kwlist[] = { "session", "ns", "class_name", "computer_name", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "Oss|s", kwlist, &session, &ns, &className, &computerName))
+        return NULL;
+
+    try
+    {
+        if (!PyObject_IsInstance(session, reinterpret_cast<PyObject*>(&SessionType)))
+            throw MI::TypeConversionException(L"\"session\" must have type Session");
+
+        auto miSession = Session_GetSession((Session*)session);
+        std::shared_ptr<MI::Class> c;
+        // The cache is thread safe, misses don't hold back the other callers
+        AllowThreads(NULL, [&]() {
+            c = self->classSchemaCache->GetClass(miSession, ToWstring(computerName),
+                ToWstring(ns), ToWstring(className));
+        });
+        return (PyObject*)Class_New(c);
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* ClassSchemaCache_Invalidate(ClassSchemaCache* self, PyObject* args, PyObject* kwds)
+{
+    char* computerName = "";
+    char* ns = "";
+    char* className = "";
+    static char *kwlist[] = { "computer_name", "ns", "class_name", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|sss", kwlist, &computerName, &ns, &className))
+        return NULL;
+
+    try
+    {
+        AllowThreads(NULL, [&]() {
+            self->classSchemaCache->Invalidate(ToWstring(computerName), ToWstring(ns), ToWstring(className));
+        });
+        Py_RETURN_NONE;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* ClassSchemaCache_Save(ClassSchemaCache* self, PyObject*)
+{
+    try
+    {
+        AllowThreads(NULL, [&]() {
+            self->classSchemaCache->Save();
+        });
+        Py_RETURN_NONE;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static Py_ssize_t ClassSchemaCache_Length(ClassSchemaCache* self)
+{
+    return (Py_ssize_t)self->classSchemaCache->GetSize();
+}
+
+static PySequenceMethods ClassSchemaCache_as_sequence = {
+    (lenfunc)ClassSchemaCache_Length, /* sq_length */
+};
+
+static PyMemberDef ClassSchemaCache_members[] = {
+    { NULL }  /* Sentinel */
+};
+
+static PyMethodDef ClassSchemaCache_methods[] = {
+    { "get_class", (PyCFunction)ClassSchemaCache_GetClass, METH_VARARGS | METH_KEYWORDS, "Returns the cached class, getting it with the session if needed." },
+    { "invalidate", (PyCFunction)ClassSchemaCache_Invalidate, METH_VARARGS | METH_KEYWORDS, "Removes the matching classes, empty arguments match any value." },
+    { "save", (PyCFunction)ClassSchemaCache_Save, METH_NOARGS, "Writes the cache file if the cache changed." },
+    { NULL }  /* Sentinel */
+};
+
+PyTypeObject ClassSchemaCacheType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "mi.ClassSchemaCache",             /*tp_name*/
+    sizeof(ClassSchemaCache),             /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)ClassSchemaCache_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    &ClassSchemaCache_as_sequence, /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    "ClassSchemaCache objects",           /* tp_doc */
+    0,                     /* tp_traverse */
+    0,                     /* tp_clear */
+    0,                     /* tp_richcompare */
+    0,                     /* tp_weaklistoffset */
+    0,                     /* tp_iter */
+    0,                     /* tp_iternext */
+    ClassSchemaCache_methods,             /* tp_methods */
+    ClassSchemaCache_members,             /* tp_members */
+    0,                         /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)ClassSchemaCache_init,      /* tp_init */
+    0,                         /* tp_alloc */
+    ClassSchemaCache_new,                 /* tp_new */
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Python.h>
+#include <MIClassSchemaCache.h>
+#include <memory>
+
+typedef struct {
+    PyObject_HEAD
+    /* Type-specific fields go here. */
+    std::shared_ptr<MI::ClassSchemaCache> classSchemaCache;
+    CRITICAL_SECTION cs;
+} ClassSchemaCache;
+
+extern PyTypeObject ClassSchemaCacheType;
+
+ClassSchemaCache* ClassSchemaCache_New(std::shared_ptr<MI::ClassSchemaCache> classSchemaCache);
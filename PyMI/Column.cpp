@@ -0,0 +1,266 @@
+#include "stdafx.h"
+#include "Column.h"
+#include "PyMI.h"
+#include "Utils.h"
+
+// Exports the validity bitmap or the string offsets of a column, keeping the column alive
+typedef struct {
+    PyObject_HEAD
+    Column* column;
+    const void* data;
+    Py_ssize_t shape;
+    Py_ssize_t itemSize;
+    const char* format;
+} ColumnBuffer;
+
+static PyObject* ColumnBuffer_New(Column* column, const void* data, Py_ssize_t shape, Py_ssize_t itemSize,
+    const char* format)
+{
+    ColumnBuffer* buffer = PyObject_New(ColumnBuffer, &ColumnBufferType);
+    if (!buffer)
+        return NULL;
+    Py_INCREF(column);
+    buffer->column = column;
+    buffer->data = data;
+    buffer->shape = shape;
+    buffer->itemSize = itemSize;
+    buffer->format = format;
+
+    PyObject* view = PyMemoryView_FromObject((PyObject*)buffer);
+    Py_DECREF(buffer);
+    return view;
+}
+
+static void ColumnBuffer_dealloc(ColumnBuffer* self)
+{
+    Py_DECREF(self->column);
+    PyObject_Del(self);
+}
+
+static int ColumnBuffer_GetBuffer(ColumnBuffer* self, Py_buffer* view, int flags)
+{
+    return FillReadOnlyPyBuffer((PyObject*)self, self->data, &self->shape, self->itemSize, self->format, view, flags);
+}
+
+static PyObject* Column_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
+{
+    Column* self = NULL;
+    self = (Column*)type->tp_alloc(type, 0);
+    self->column = NULL;
+    return (PyObject *)self;
+}
+
+static void Column_dealloc(Column* self)
+{
+    self->column = NULL;
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int Column_init(Column* self, PyObject* args, PyObject* kwds)
+{
+    PyErr_SetString(PyMIError, "Please use Operation.fetch_columns to allocate a Column object.");
+    return -1;
+}
+
+Column* Column_New(std::shared_ptr<const MI::Column> column)
+{
+    Column* obj = (Column*)Column_new(&ColumnType, NULL, NULL);
+    obj->column = column;
+    obj->shape = (Py_ssize_t)(column->m_type == MI_STRING ? column->m_values.size() : column->m_count);
+    return obj;
+}
+
+static int Column_GetBuffer(Column* self, Py_buffer* view, int flags)
+{
+    auto& column = *self->column;
+    Py_ssize_t itemSize = column.m_type == MI_ARRAY ? 1 : (Py_ssize_t)column.GetItemSize();
+    return FillReadOnlyPyBuffer((PyObject*)self, column.m_values.data(), &self->shape, itemSize,
+        GetPyBufferFormat(column.m_type), view, flags);
+}
+
+static Py_ssize_t Column_length(Column* self)
+{
+    return (Py_ssize_t)self->column->m_count;
+}
+
+// Boxes a single value, None for nulls
+static PyObject* Column_item(Column* self, Py_ssize_t i)
+{
+    auto& column = *self->column;
+    if (i < 0 || (size_t)i >= column.m_count)
+    {
+        PyErr_SetString(PyExc_IndexError, "Column index out of range");
+        return NULL;
+    }
+
+    try
+    {
+        if (column.IsNull(i))
+            Py_RETURN_NONE;
+
+        switch (column.m_type)
+        {
+        case MI_STRING:
+        {
+            auto begin = column.m_offsets[i];
+            return PyUnicode_DecodeUTF8((const char*)column.m_values.data() + begin,
+                (Py_ssize_t)(column.m_offsets[i + 1] - begin), NULL);
+        }
+        case MI_DATETIME:
+        {
+            MI_Sint64 microseconds = 0;
+            memcpy(&microseconds, column.m_values.data() + i * sizeof(microseconds), sizeof(microseconds));
+            return PyLong_FromLongLong(microseconds);
+        }
+        default:
+        {
+            MI_Value value;
+            auto itemSize = column.GetItemSize();
+            memcpy(&value, column.m_values.data() + i * itemSize, itemSize);
+            return MI2Py(value, column.m_type, 0);
+        }
+        }
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* Column_GetName(Column* self, void*)
+{
+    return PyUnicode_FromWideChar(self->column->m_name.c_str(), self->column->m_name.length());
+}
+
+static PyObject* Column_GetType(Column* self, void*)
+{
+    if (self->column->m_type == MI_ARRAY)
+        Py_RETURN_NONE;
+    return PyLong_FromUnsignedLong(self->column->m_type);
+}
+
+static PyObject* Column_GetNullCount(Column* self, void*)
+{
+    return PyLong_FromSize_t(self->column->m_nullCount);
+}
+
+static PyObject* Column_GetValidity(Column* self, void*)
+{
+    auto& validity = self->column->m_validity;
+    return ColumnBuffer_New(self, validity.data(), (Py_ssize_t)validity.size(), 1, "B");
+}
+
+static PyObject* Column_GetOffsets(Column* self, void*)
+{
+    auto& offsets = self->column->m_offsets;
+    if (self->column->m_type != MI_STRING)
+        Py_RETURN_NONE;
+    return ColumnBuffer_New(self, offsets.data(), (Py_ssize_t)offsets.size(), sizeof(MI_Sint64), "q");
+}
+
+static PyGetSetDef Column_getset[] = {
+    { "name", (getter)Column_GetName, NULL, "Property name.", NULL },
+    { "type", (getter)Column_GetType, NULL, "MI type of the values, None if no row was read.", NULL },
+    { "null_count", (getter)Column_GetNullCount, NULL, "Number of null rows.", NULL },
+    { "validity", (getter)Column_GetValidity, NULL, "Bitmap with the bit of each non null row set, least significant bit first.", NULL },
+    { "offsets", (getter)Column_GetOffsets, NULL, "Start of each string in the UTF-8 data followed by the end of the last one, None for other types.", NULL },
+    { NULL }  /* Sentinel */
+};
+
+static PyMemberDef Column_members[] = {
+    { NULL }  /* Sentinel */
+};
+
+static PyMethodDef Column_methods[] = {
+    { NULL }  /* Sentinel */
+};
+
+static PySequenceMethods Column_as_sequence = {
+    (lenfunc)Column_length,    /* sq_length */
+    0,                         /* sq_concat */
+    0,                         /* sq_repeat */
+    (ssizeargfunc)Column_item, /* sq_item */
+};
+
+static PyBufferProcs Column_as_buffer = {
+#ifndef IS_PY3K
+    0, 0, 0, 0,
+#endif
+    (getbufferproc)Column_GetBuffer, /* bf_getbuffer */
+    0,                         /* bf_releasebuffer */
+};
+
+static PyBufferProcs ColumnBuffer_as_buffer = {
+#ifndef IS_PY3K
+    0, 0, 0, 0,
+#endif
+    (getbufferproc)ColumnBuffer_GetBuffer, /* bf_getbuffer */
+    0,                         /* bf_releasebuffer */
+};
+
+PyTypeObject ColumnType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "mi.Column",             /*tp_name*/
+    sizeof(Column),             /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)Column_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    &Column_as_sequence,       /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    &Column_as_buffer,         /*tp_as_buffer*/
+    PYMI_BUFFER_TPFLAGS | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    "Column objects, exporting the values through the buffer protocol: numbers as their MI type, "
+    "datetimes as microseconds and strings as UTF-8 data", /* tp_doc */
+    0,                     /* tp_traverse */
+    0,                     /* tp_clear */
+    0,                     /* tp_richcompare */
+    0,                     /* tp_weaklistoffset */
+    0,                     /* tp_iter */
+    0,                     /* tp_iternext */
+    Column_methods,             /* tp_methods */
+    Column_members,             /* tp_members */
+    Column_getset,             /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)Column_init,      /* tp_init */
+    0,                         /* tp_alloc */
+    Column_new,                 /* tp_new */
+};
+
+PyTypeObject ColumnBufferType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "mi.ColumnBuffer",             /*tp_name*/
+    sizeof(ColumnBuffer),             /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)ColumnBuffer_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    &ColumnBuffer_as_buffer,   /*tp_as_buffer*/
+    PYMI_BUFFER_TPFLAGS,            /*tp_flags*/
+    "Buffer of a Column",           /* tp_doc */
+};
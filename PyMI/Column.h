@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Python.h>
+#include <MIColumnReader.h>
+#include <memory>
+
+typedef struct {
+    PyObject_HEAD
+    /* Type-specific fields go here. */
+    // Immutable, no lock needed
+    std::shared_ptr<const MI::Column> column;
+    Py_ssize_t shape;
+} Column;
+
+extern PyTypeObject ColumnType;
+extern PyTypeObject ColumnBufferType;
+
+Column* Column_New(std::shared_ptr<const MI::Column> column);
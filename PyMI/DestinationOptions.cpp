@@ -24,9 +24,7 @@ static int DestinationOptions_init(DestinationOptions* self, PyObject* args, PyO
 
 static void DestinationOptions_dealloc(DestinationOptions* self)
 {
-    AllowThreads(&self->cs, [&]() {
-        self->destinationOptions = NULL;
-    });
+    self->destinationOptions = NULL;
     ::DeleteCriticalSection(&self->cs);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
@@ -0,0 +1,185 @@
+#include "stdafx.h"
+#include "FanOutQuery.h"
+#include "Instance.h"
+#include "Utils.h"
+#include "PyMI.h"
+
+
+static PyObject* FanOutQuery_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
+{
+    FanOutQuery* self = NULL;
+    self = (FanOutQuery*)type->tp_alloc(type, 0);
+    self->query = NULL;
+    return (PyObject *)self;
+}
+
+static int FanOutQuery_init(FanOutQuery* self, PyObject* args, PyObject* kwds)
+{
+    PyErr_SetString(PyMIError, "Please use Application.fan_out_query to allocate a FanOutQuery object.");
+    return -1;
+}
+
+static void FanOutQuery_dealloc(FanOutQuery* self)
+{
+    // Cancels the query and waits for the hosts to be closed
+    ReleaseBlockingObject(self->query);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+// Returns a (computer_name, instance, mi_result, error_message, error_details, timed_out)
+// tuple, or NULL without an exception set once all the hosts completed
+static PyObject* GetNextResult(FanOutQuery* self)
+{
+    MI::FanOutResult result;
+    bool hasResult = false;
+    AllowThreads(NULL, [&]() {
+        hasResult = self->query->GetNextResult(result);
+    });
+    if (!hasResult)
+    {
+        return NULL;
+    }
+
+    PyObject* instanceObj = Py_None;
+    PyObject* errorDetailsObj = Py_None;
+    if (result.m_instance)
+    {
+        instanceObj = (PyObject*)Instance_New(result.m_instance);
+    }
+    else
+    {
+        Py_INCREF(Py_None);
+    }
+    if (result.m_errorDetails)
+    {
+        errorDetailsObj = (PyObject*)Instance_New(result.m_errorDetails);
+    }
+    else
+    {
+        Py_INCREF(Py_None);
+    }
+
+    return Py_BuildValue("(uNIuNN)", result.m_computerName.c_str(), instanceObj, result.m_result,
+        result.m_errorMessage.c_str(), errorDetailsObj, PyBool_FromLong(result.m_timedOut));
+}
+
+static PyObject* FanOutQuery_GetNextResult(FanOutQuery* self, PyObject*)
+{
+    try
+    {
+        PyObject* result = GetNextResult(self);
+        if (result)
+        {
+            return result;
+        }
+        Py_RETURN_NONE;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* FanOutQuery_iternext(FanOutQuery* self)
+{
+    try
+    {
+        return GetNextResult(self);
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* FanOutQuery_Cancel(FanOutQuery* self, PyObject*)
+{
+    try
+    {
+        AllowThreads(NULL, [&]() {
+            self->query->Cancel();
+        });
+        Py_RETURN_NONE;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* FanOutQuery_self(FanOutQuery *self, PyObject*)
+{
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject* FanOutQuery_exit(FanOutQuery* self, PyObject*)
+{
+    AllowThreads(NULL, [&]() {
+        self->query->Cancel();
+    });
+    Py_RETURN_NONE;
+}
+
+FanOutQuery* FanOutQuery_New(std::shared_ptr<MI::FanOutQuery> query)
+{
+    FanOutQuery* obj = (FanOutQuery*)FanOutQuery_new(&FanOutQueryType, NULL, NULL);
+    obj->query = query;
+    return obj;
+}
+
+static PyMemberDef FanOutQuery_members[] = {
+    { NULL }  /* Sentinel */
+};
+
+static PyMethodDef FanOutQuery_methods[] = {
+    { "get_next_result", (PyCFunction)FanOutQuery_GetNextResult, METH_NOARGS, "Waits for the next result of any host." },
+    { "cancel", (PyCFunction)FanOutQuery_Cancel, METH_NOARGS, "Cancels the queries still running." },
+    { "__enter__", (PyCFunction)FanOutQuery_self, METH_NOARGS, "" },
+    { "__exit__",  (PyCFunction)FanOutQuery_exit, METH_VARARGS, "" },
+    { NULL }  /* Sentinel */
+};
+
+PyTypeObject FanOutQueryType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "mi.FanOutQuery",             /*tp_name*/
+    sizeof(FanOutQuery),             /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)FanOutQuery_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    "FanOutQuery objects",           /* tp_doc */
+    0,                     /* tp_traverse */
+    0,                     /* tp_clear */
+    0,                     /* tp_richcompare */
+    0,                     /* tp_weaklistoffset */
+    PyObject_SelfIter,     /* tp_iter */
+    (iternextfunc)FanOutQuery_iternext, /* tp_iternext */
+    FanOutQuery_methods,             /* tp_methods */
+    FanOutQuery_members,             /* tp_members */
+    0,                         /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)FanOutQuery_init,    /* tp_init */
+    0,                         /* tp_alloc */
+    FanOutQuery_new,                 /* tp_new */
+};
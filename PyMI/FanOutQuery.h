@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Python.h>
+#include <MIFanOutQuery.h>
+#include <memory>
+
+typedef struct {
+    PyObject_HEAD
+    /* Type-specific fields go here. */
+    // Synchronized by MI::FanOutQuery itself, so that cancel isn't held back by a pending read
+    std::shared_ptr<MI::FanOutQuery> query;
+} FanOutQuery;
+
+extern PyTypeObject FanOutQueryType;
+
+FanOutQuery* FanOutQuery_New(std::shared_ptr<MI::FanOutQuery> query);
@@ -3,13 +3,166 @@
 #include "Class.h"
 #include "Utils.h"
 #include "PyMI.h"
+#include "StringCache.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <wctype.h>
+
+// Instances the reclaimer thread waits for before deleting them
+#define RECLAIM_BATCH_SIZE 256
+// Longest time the reclaimer thread waits for a batch to fill up
+#define RECLAIM_DELAY_MS 10
+// Instances waiting to be deleted before they're deleted inline again
+#define MAX_PENDING_DELETES (64 * 1024)
+
+// Deletes the owned instances dropped by their last wrapper from a background
+// thread, so that releasing a large result set doesn't stall the GIL holder for
+// each MI_Instance_Delete. The thread is woken up once per batch, waiting at most
+// RECLAIM_DELAY_MS for it to fill up. It never takes the GIL, and is stopped and
+// joined at exit, before the interpreter is finalized, the instances dropped
+// afterwards being deleted inline.
+class InstanceReclaimer
+{
+private:
+    std::vector<std::shared_ptr<MI::Instance>> m_pending;
+    bool m_stopped = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+
+    void Run()
+    {
+        std::vector<std::shared_ptr<MI::Instance>> instances;
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+        while (true)
+        {
+            this->m_cv.wait(lock, [&]() { return this->m_stopped || !this->m_pending.empty(); });
+            this->m_cv.wait_for(lock, std::chrono::milliseconds(RECLAIM_DELAY_MS), [&]() {
+                return this->m_stopped || this->m_pending.size() >= RECLAIM_BATCH_SIZE;
+            });
+            instances.swap(this->m_pending);
+            lock.unlock();
+            instances.clear();
+            lock.lock();
+            if (this->m_stopped && this->m_pending.empty())
+            {
+                return;
+            }
+        }
+    }
+
+public:
+    InstanceReclaimer()
+    {
+        this->m_thread = std::thread([this]() { this->Run(); });
+    }
+
+    // Returns false, leaving the instance to be deleted inline, if stopped or if too many deletes are pending
+    bool Add(std::shared_ptr<MI::Instance>& instance)
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        if (this->m_stopped || this->m_pending.size() >= MAX_PENDING_DELETES)
+        {
+            return false;
+        }
+        this->m_pending.push_back(std::move(instance));
+        if (this->m_pending.size() == 1 || this->m_pending.size() == RECLAIM_BATCH_SIZE)
+        {
+            this->m_cv.notify_one();
+        }
+        return true;
+    }
+
+    // Waits for the thread to delete the pending instances and to exit
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            this->m_stopped = true;
+            this->m_cv.notify_one();
+        }
+        if (this->m_thread.joinable())
+        {
+            this->m_thread.join();
+        }
+    }
+};
+
+// Accessed with the GIL held
+static InstanceReclaimer* g_reclaimer = NULL;
+static bool g_reclaimerStopped = false;
+
+static PyObject* Instance_StopReclaimer(PyObject* self, PyObject*)
+{
+    g_reclaimerStopped = true;
+    if (g_reclaimer)
+    {
+        AllowThreads(NULL, [&]() {
+            g_reclaimer->Stop();
+        });
+    }
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef Instance_StopReclaimerDef = {
+    "_stop_instance_reclaimer", (PyCFunction)Instance_StopReclaimer, METH_NOARGS, "Stops the instance reclaimer thread."
+};
+
+// Registers the reclaimer thread to be stopped by atexit, before the interpreter is finalized
+int Instance_RegisterAtExit()
+{
+    PyObject* atexit = PyImport_ImportModule("atexit");
+    if (!atexit)
+        return -1;
+    PyObject* func = PyCFunction_New(&Instance_StopReclaimerDef, NULL);
+    PyObject* result = func ? PyObject_CallMethod(atexit, "register", "O", func) : NULL;
+    Py_XDECREF(result);
+    Py_XDECREF(func);
+    Py_DECREF(atexit);
+    return result ? 0 : -1;
+}
+
+// Element index dictionaries whose MI++ table was released, possibly by a thread
+// not holding the GIL, e.g. the reclaimer's. Released by the next GIL holder.
+static std::vector<PyObject*> g_releasedElementIndexes;
+static std::atomic<bool> g_hasReleasedElementIndexes(false);
+static std::mutex g_releasedElementIndexesMutex;
+
+static void ReleaseElementIndexes(PyObject* elementIndexes)
+{
+    std::lock_guard<std::mutex> lock(g_releasedElementIndexesMutex);
+    g_releasedElementIndexes.push_back(elementIndexes);
+    g_hasReleasedElementIndexes = true;
+}
+
+// Called with the GIL held
+static void ClearReleasedElementIndexes()
+{
+    if (!g_hasReleasedElementIndexes)
+        return;
+
+    std::vector<PyObject*> released;
+    {
+        std::lock_guard<std::mutex> lock(g_releasedElementIndexesMutex);
+        released.swap(g_releasedElementIndexes);
+        g_hasReleasedElementIndexes = false;
+    }
+    for (auto elementIndexes : released)
+    {
+        Py_DECREF(elementIndexes);
+    }
+}
 
 static PyObject* Instance_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
     Instance* self = NULL;
     self = (Instance*)type->tp_alloc(type, 0);
     self->instance = NULL;
+    self->elementIndexes = NULL;
     ::InitializeCriticalSection(&self->cs);
     return (PyObject *)self;
 }
@@ -22,39 +175,156 @@ static int Instance_init(Instance* self, PyObject* args, PyObject* kwds)
 
 static void Instance_dealloc(Instance* self)
 {
-    AllowThreads(&self->cs, [&]() {
-        self->instance = NULL;
-    });
+    // Owned instances are deleted by the reclaimer thread. The operation results
+    // not owned by the wrapper have nothing to delete and are released inline,
+    // removing themselves from their operation's scope under its lock.
+    auto& instance = self->instance;
+    if (instance && instance.use_count() == 1 && instance->OwnsInstance() && !g_reclaimerStopped)
+    {
+        try
+        {
+            if (!g_reclaimer)
+            {
+                g_reclaimer = new InstanceReclaimer();
+            }
+            g_reclaimer->Add(instance);
+        }
+        catch (std::exception&)
+        {
+            // Deleted inline
+        }
+    }
+    self->instance = NULL;
+    ClearReleasedElementIndexes();
     ::DeleteCriticalSection(&self->cs);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
-std::shared_ptr<MI::ValueElement> GetElement(Instance *self, PyObject *item)
+// Instances allocated with Instance.__new__ have no MI++ instance
+static void CheckInstance(Instance* self)
+{
+    if (!self->instance)
+        throw MI::Exception(L"The instance is not initialized");
+}
+
+// Instances owning their MI instance, e.g. clones, are in memory and are only
+// accessed with the GIL held, as releasing it would take longer than the access
+// itself. The GIL serializes those accesses, the instance's lock isn't taken.
+// Operation results are accessed with the GIL released and the lock held, as the
+// operation can release them meanwhile. The lock is thus never taken while
+// holding the GIL, nor the GIL while holding the lock.
+template<typename F> static void AccessInstance(Instance* self, const F& action)
+{
+    CheckInstance(self);
+    if (self->instance->OwnsInstance())
+    {
+        action();
+    }
+    else
+    {
+        AllowThreads(&self->cs, action);
+    }
+}
+
+// Returns the Python str to element index dictionary kept with the MI++ element
+// index table of the instance's class, a borrowed reference valid as long as the instance
+static PyObject* GetElementIndexes(std::shared_ptr<void> data, Instance* self)
+{
+    if (!data)
+    {
+        ClearReleasedElementIndexes();
+        PyObject* elementIndexes = PyDict_New();
+        if (!elementIndexes)
+            throw MI::Exception(L"PyDict_New failed");
+        std::shared_ptr<void> newData(elementIndexes, [](void* obj) { ReleaseElementIndexes((PyObject*)obj); });
+        data = self->instance->SetElementIndexData(newData);
+    }
+    return (PyObject*)data.get();
+}
+
+// Case insensitive comparison, without converting the Python string
+static bool ElementNameEquals(PyObject* pyName, const MI_Char* name)
 {
+#ifdef IS_PY3K
+    Py_ssize_t len = PyUnicode_GET_LENGTH(pyName);
+    int kind = PyUnicode_KIND(pyName);
+    void* data = PyUnicode_DATA(pyName);
+    for (Py_ssize_t i = 0; i < len; i++)
+    {
+        Py_UCS4 c = PyUnicode_READ(kind, data, i);
+        if (!name[i] || c > WCHAR_MAX)
+            return false;
+        if ((wchar_t)c != name[i] && towlower((wchar_t)c) != towlower(name[i]))
+            return false;
+    }
+    return !name[len];
+#else
+    return false;
+#endif
+}
+
+// Looks up a named element through the per class index dictionary. Returns
+// false if the name is not cached yet or refers to a different element.
+static bool GetCachedElement(Instance *self, PyObject *item, MI::ValueElementRef& element)
+{
+    if (!self->elementIndexes)
+        return false;
+
+    PyObject* pyIndex = PyDict_GetItem(self->elementIndexes, item);
+    if (!pyIndex)
+        return false;
+    unsigned index = (unsigned)PyLong_AsUnsignedLong(pyIndex);
+
+    bool found = false;
+    AccessInstance(self, [&]() {
+        if (index < self->instance->GetElementsCount())
+        {
+            self->instance->GetElement(index, element);
+            found = true;
+        }
+    });
+    return found && ElementNameEquals(item, element.m_name);
+}
+
+static void GetElement(Instance *self, PyObject *item, MI::ValueElementRef& element)
+{
+    if (PyUnicode_Check(item) && GetCachedElement(self, item, element))
+        return;
+
     std::wstring name;
     Py_ssize_t i;
     GetIndexOrName(item, name, i);
 
-    std::shared_ptr<MI::ValueElement> element;
-    AllowThreads(&self->cs, [&]() {
+    std::shared_ptr<void> elementIndexData;
+    AccessInstance(self, [&]() {
         if (i >= 0)
         {
-            element = (*self->instance)[(unsigned)i];
+            self->instance->GetElement((unsigned)i, element);
         }
         else
         {
-            element = (*self->instance)[name];
+            self->instance->GetElement(name, element);
+            elementIndexData = self->instance->GetElementIndexData();
         }
     });
-    return element;
+
+    if (i < 0 && PyUnicode_Check(item))
+    {
+        self->elementIndexes = GetElementIndexes(elementIndexData, self);
+        PyObject* pyIndex = PyLong_FromUnsignedLong(element.m_index);
+        if (!pyIndex || PyDict_SetItem(self->elementIndexes, item, pyIndex) < 0)
+            PyErr_Clear();
+        Py_XDECREF(pyIndex);
+    }
 }
 
 static PyObject* Instance_subscript(Instance *self, PyObject *item)
 {
     try
     {
-        auto element = GetElement(self, item);
-        return MI2Py(element->m_value, element->m_type, element->m_flags);
+        MI::ValueElementRef element;
+        GetElement(self, item, element);
+        return MI2Py(element.m_value, element.m_type, element.m_flags);
     }
     catch (std::exception& ex)
     {
@@ -67,15 +337,16 @@ static PyObject* Instance_GetElement(Instance *self, PyObject *item)
 {
     try
     {
-        auto element = GetElement(self, item);
+        MI::ValueElementRef element;
+        GetElement(self, item, element);
         PyObject* tuple = PyTuple_New(3);
-        PyTuple_SetItem(tuple, 0, PyUnicode_FromWideChar(element->m_name.c_str(), element->m_name.length()));
+        PyTuple_SetItem(tuple, 0, GetNamePyString(element.m_name));
 #ifdef IS_PY3K
-        PyTuple_SetItem(tuple, 1, PyLong_FromLong(element->m_type));
+        PyTuple_SetItem(tuple, 1, PyLong_FromLong(element.m_type));
 #else
-        PyTuple_SetItem(tuple, 1, PyInt_FromLong(element->m_type));
+        PyTuple_SetItem(tuple, 1, PyInt_FromLong(element.m_type));
 #endif
-        PyTuple_SetItem(tuple, 2, MI2Py(element->m_value, element->m_type, element->m_flags));
+        PyTuple_SetItem(tuple, 2, MI2Py(element.m_value, element.m_type, element.m_flags));
         return tuple;
     }
     catch (std::exception& ex)
@@ -85,12 +356,184 @@ static PyObject* Instance_GetElement(Instance *self, PyObject *item)
     }
 }
 
+static PyObject* Instance_HasElement(Instance *self, PyObject *item)
+{
+    try
+    {
+        MI::ValueElementRef element;
+        if (PyUnicode_Check(item) && GetCachedElement(self, item, element))
+        {
+            Py_RETURN_TRUE;
+        }
+
+        std::wstring name;
+        Py_ssize_t i;
+        GetIndexOrName(item, name, i);
+
+        bool found = false;
+        AccessInstance(self, [&]() {
+            if (i >= 0)
+            {
+                found = (unsigned)i < self->instance->GetElementsCount();
+            }
+            else
+            {
+                found = self->instance->TryGetElement(name, element);
+            }
+        });
+        return PyBool_FromLong(found);
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* Instance_GetElements(Instance *self, PyObject*)
+{
+    try
+    {
+        std::vector<MI::ValueElementRef> elements;
+        AccessInstance(self, [&]() {
+            self->instance->GetAllElements(elements);
+        });
+
+        PyObject* list = PyList_New(elements.size());
+        if (!list)
+            return NULL;
+        try
+        {
+            for (size_t i = 0; i < elements.size(); i++)
+            {
+                auto& element = elements[i];
+                PyObject* tuple = PyTuple_New(3);
+                PyList_SET_ITEM(list, i, tuple);
+                PyTuple_SET_ITEM(tuple, 0, GetNamePyString(element.m_name));
+#ifdef IS_PY3K
+                PyTuple_SET_ITEM(tuple, 1, PyLong_FromLong(element.m_type));
+#else
+                PyTuple_SET_ITEM(tuple, 1, PyInt_FromLong(element.m_type));
+#endif
+                PyTuple_SET_ITEM(tuple, 2, MI2Py(element.m_value, element.m_type, element.m_flags));
+            }
+        }
+        catch (std::exception&)
+        {
+            Py_DECREF(list);
+            throw;
+        }
+        return list;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+void ReadInstanceElements(const MI::Instance& instance, const std::vector<std::wstring>* elementNames,
+                          std::vector<MI::ValueElementRef>& elements)
+{
+    if (!elementNames)
+    {
+        instance.GetAllElements(elements);
+        return;
+    }
+
+    elements.resize(elementNames->size());
+    for (size_t i = 0; i < elementNames->size(); i++)
+    {
+        instance.GetElement((*elementNames)[i], elements[i]);
+    }
+}
+
+PyObject* InstanceElementsToPyDict(const MI::ValueElementRef* elements, size_t count, PyObject* names,
+                                   bool cloneInstances)
+{
+    PyObject* dict = PyDict_New();
+    if (!dict)
+        return NULL;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        auto& element = elements[i];
+        PyObject* key = NULL;
+        if (names)
+        {
+            key = PyTuple_GET_ITEM(names, i);
+            Py_INCREF(key);
+        }
+        else
+        {
+            key = GetNamePyString(element.m_name);
+        }
+
+        PyObject* value = NULL;
+        try
+        {
+            value = key ? MI2Py(element.m_value, element.m_type, element.m_flags, cloneInstances) : NULL;
+        }
+        catch (std::exception&)
+        {
+            Py_XDECREF(key);
+            Py_DECREF(dict);
+            throw;
+        }
+
+        int result = value ? PyDict_SetItem(dict, key, value) : -1;
+        Py_XDECREF(key);
+        Py_XDECREF(value);
+        if (result < 0)
+        {
+            Py_DECREF(dict);
+            return NULL;
+        }
+    }
+    return dict;
+}
+
+static PyObject* Instance_ToDict(Instance *self, PyObject* args, PyObject* kwds)
+{
+    PyObject* names = NULL;
+    static char *kwlist[] = { "names", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &names))
+        return NULL;
+
+    PyObject* namesTuple = NULL;
+    try
+    {
+        std::vector<std::wstring> elementNames;
+        if (!CheckPyNone(names))
+        {
+            namesTuple = GetElementNames(names, elementNames);
+            if (!namesTuple)
+                return NULL;
+        }
+
+        std::vector<MI::ValueElementRef> elements;
+        AccessInstance(self, [&]() {
+            ReadInstanceElements(*self->instance, namesTuple ? &elementNames : NULL, elements);
+        });
+
+        PyObject* dict = InstanceElementsToPyDict(elements.data(), elements.size(), namesTuple, false);
+        Py_XDECREF(namesTuple);
+        return dict;
+    }
+    catch (std::exception& ex)
+    {
+        Py_XDECREF(namesTuple);
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
 static Py_ssize_t Instance_length(Instance *self)
 {
     try
     {
         Py_ssize_t l = 0;
-        AllowThreads(&self->cs, [&]() {
+        AccessInstance(self, [&]() {
             l = self->instance->GetElementsCount();
         });
         return l;
@@ -111,7 +554,7 @@ static int Instance_ass_subscript(Instance* self, PyObject* item, PyObject* valu
         GetIndexOrName(item, name, i);
 
         MI_Type miType;
-        AllowThreads(&self->cs, [&]() {
+        AccessInstance(self, [&]() {
             if (i >= 0)
             {
                 miType = self->instance->GetElementType((unsigned)i);
@@ -124,7 +567,7 @@ static int Instance_ass_subscript(Instance* self, PyObject* item, PyObject* valu
 
         auto miValue = Py2MI(value, miType);
 
-        AllowThreads(&self->cs, [&]() {
+        AccessInstance(self, [&]() {
             if (i >= 0)
             {
                 self->instance->SetElement((unsigned)i, *miValue);
@@ -165,7 +608,7 @@ static PyObject* Instance_GetClass(Instance *self, PyObject*)
     try
     {
         std::shared_ptr<MI::Class> c;
-        AllowThreads(&self->cs, [&]() {
+        AccessInstance(self, [&]() {
             c = self->instance->GetClass();
         });
         return (PyObject*)Class_New(c);
@@ -182,7 +625,7 @@ static PyObject* Instance_Clone(Instance *self, PyObject*)
     try
     {
         std::shared_ptr<MI::Instance> instance;
-        AllowThreads(&self->cs, [&]() {
+        AccessInstance(self, [&]() {
             instance = self->instance->Clone();
         });
         return (PyObject*)Instance_New(instance);
@@ -194,10 +637,27 @@ static PyObject* Instance_Clone(Instance *self, PyObject*)
     }
 }
 
+static PyObject* Instance_Retain(Instance *self, PyObject*)
+{
+    try
+    {
+        CheckInstance(self);
+        self->instance->Retain();
+        Py_INCREF(self);
+        return (PyObject*)self;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
 static PyObject* Instance_GetPath(Instance *self, PyObject*)
 {
     try
     {
+        CheckInstance(self);
         std::wstring path = self->instance->GetPath();
         return PyUnicode_FromWideChar(path.c_str(), path.length());
     }
@@ -212,8 +672,9 @@ static PyObject* Instance_GetClassName(Instance *self, PyObject*)
 {
     try
     {
+        CheckInstance(self);
         std::wstring className = self->instance->GetClassName();
-        return PyUnicode_FromWideChar(className.c_str(), className.length());
+        return GetNamePyString(className.c_str());
     }
     catch (std::exception& ex)
     {
@@ -226,6 +687,7 @@ static PyObject* Instance_GetNameSpace(Instance* self, PyObject*)
 {
     try
     {
+        CheckInstance(self);
         std::wstring nameSpace = self->instance->GetNameSpace();
         return PyUnicode_FromWideChar(nameSpace.c_str(), nameSpace.length());
     }
@@ -240,6 +702,7 @@ static PyObject* Instance_GetServerName(Instance* self, PyObject*)
 {
     try
     {
+        CheckInstance(self);
         std::wstring serverName = self->instance->GetServerName();
         return PyUnicode_FromWideChar(serverName.c_str(), serverName.length());
     }
@@ -264,12 +727,16 @@ static PyMemberDef Instance_members[] = {
 static PyMethodDef Instance_methods[] = {
     { "__getitem__", (PyCFunction)Instance_subscript, METH_O | METH_COEXIST, "" },
     { "get_element", (PyCFunction)Instance_GetElement, METH_O, "Returns an element by either index or name" },
+    { "has_element", (PyCFunction)Instance_HasElement, METH_O, "Returns True if the instance has an element with the given name or index." },
+    { "get_elements", (PyCFunction)Instance_GetElements, METH_NOARGS, "Returns all the elements as a list of (name, type, value) tuples" },
+    { "to_dict", (PyCFunction)Instance_ToDict, METH_VARARGS | METH_KEYWORDS, "Returns a dict of the elements named in names, all the elements if None." },
     { "get_path", (PyCFunction)Instance_GetPath, METH_NOARGS, "" },
     { "get_class_name", (PyCFunction)Instance_GetClassName, METH_NOARGS, "" },
     { "get_namespace", (PyCFunction)Instance_GetNameSpace, METH_NOARGS, "" },
     { "get_server_name", (PyCFunction)Instance_GetServerName, METH_NOARGS, "" },
     { "get_class", (PyCFunction)Instance_GetClass, METH_NOARGS, "" },
     { "clone", (PyCFunction)Instance_Clone, METH_NOARGS, "Clones this instance." },
+    { "retain", (PyCFunction)Instance_Retain, METH_NOARGS, "Keeps this result valid once its operation moves on or is closed, returning the instance." },
     { NULL }  /* Sentinel */
 };
 
@@ -3,14 +3,27 @@
 #include <Python.h>
 #include <MI++.h>
 #include <memory>
+#include <string>
+#include <vector>
 
 typedef struct {
     PyObject_HEAD
     /* Type-specific fields go here. */
     std::shared_ptr<MI::Instance> instance;
     CRITICAL_SECTION cs;
+    // Borrowed, name to element index dictionary shared by the instances of the same class
+    PyObject* elementIndexes;
 } Instance;
 
 extern PyTypeObject InstanceType;
 
 Instance* Instance_New(std::shared_ptr<MI::Instance> instance);
+int Instance_RegisterAtExit();
+// Reads the elements named in "elementNames", all the elements if NULL. Called without the GIL.
+void ReadInstanceElements(const MI::Instance& instance, const std::vector<std::wstring>* elementNames,
+                          std::vector<MI::ValueElementRef>& elements);
+// Dict of the elements read by ReadInstanceElements, keyed by the items of the "names" tuple
+// or by the element names if NULL. Embedded instances are cloned if "cloneInstances" is set,
+// so that they outlive the elements' instance.
+PyObject* InstanceElementsToPyDict(const MI::ValueElementRef* elements, size_t count, PyObject* names,
+                                   bool cloneInstances);
@@ -0,0 +1,190 @@
+#include "stdafx.h"
+#include "JsonSerializer.h"
+#include "PyMI.h"
+#include "Instance.h"
+#include "Operation.h"
+#include "Utils.h"
+
+
+static PyObject* JsonSerializer_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
+{
+    JsonSerializer* self = NULL;
+    self = (JsonSerializer*)type->tp_alloc(type, 0);
+    ::InitializeCriticalSection(&self->cs);
+    return (PyObject *)self;
+}
+
+static void JsonSerializer_dealloc(JsonSerializer* self)
+{
+    self->serializer = NULL;
+    ::DeleteCriticalSection(&self->cs);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int JsonSerializer_init(JsonSerializer* self, PyObject* args, PyObject* kwds)
+{
+    PyErr_SetString(PyMIError, "Please use Application.create_json_serializer to allocate a JsonSerializer object.");
+    return -1;
+}
+
+JsonSerializer* JsonSerializer_New(std::shared_ptr<MI::JsonSerializer> serializer)
+{
+    JsonSerializer* obj = (JsonSerializer*)JsonSerializer_new(&JsonSerializerType, NULL, NULL);
+    obj->serializer = serializer;
+    return obj;
+}
+
+static PyObject* JsonSerializer_SerializeInstance(JsonSerializer* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* instance = NULL;
+    static char *kwlist[] = { "instance", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &instance))
+        return NULL;
+
+    try
+    {
+        if (!PyObject_IsInstance(instance, reinterpret_cast<PyObject*>(&InstanceType)))
+            throw MI::TypeConversionException(L"\"instance\" must have type Instance");
+
+        std::string data;
+        AllowThreads(&self->cs, [&]() {
+            data = self->serializer->SerializeInstance(*((Instance*)instance)->instance);
+        });
+        return PyBytes_FromStringAndSize(data.c_str(), data.length());
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+// The results are pulled and written while holding both the serializer and the operation
+static void WriteOperationResults(JsonSerializer* self, Operation* operation, std::function<void()> write)
+{
+    Operation_ReleaseCurrentResult(operation);
+    AllowThreads(&self->cs, [&]() {
+        ::EnterCriticalSection(&operation->cs);
+        try
+        {
+            write();
+        }
+        catch (std::exception&)
+        {
+            ::LeaveCriticalSection(&operation->cs);
+            throw;
+        }
+        ::LeaveCriticalSection(&operation->cs);
+    });
+}
+
+static PyObject* JsonSerializer_SerializeOperation(JsonSerializer* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* operation = NULL;
+    PyObject* ndjsonObj = NULL;
+    static char *kwlist[] = { "operation", "ndjson", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O", kwlist, &operation, &ndjsonObj))
+        return NULL;
+
+    try
+    {
+        if (!PyObject_IsInstance(operation, reinterpret_cast<PyObject*>(&OperationType)))
+            throw MI::TypeConversionException(L"\"operation\" must have type Operation");
+
+        bool ndjson = !ndjsonObj || PyObject_IsTrue(ndjsonObj);
+
+        std::string data;
+        WriteOperationResults(self, (Operation*)operation, [&]() {
+            data = self->serializer->SerializeOperation(*((Operation*)operation)->operation, ndjson);
+        });
+        return PyBytes_FromStringAndSize(data.c_str(), data.length());
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* JsonSerializer_WriteOperation(JsonSerializer* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* operation = NULL;
+    int fd = -1;
+    PyObject* ndjsonObj = NULL;
+    static char *kwlist[] = { "operation", "fd", "ndjson", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "Oi|O", kwlist, &operation, &fd, &ndjsonObj))
+        return NULL;
+
+    try
+    {
+        if (!PyObject_IsInstance(operation, reinterpret_cast<PyObject*>(&OperationType)))
+            throw MI::TypeConversionException(L"\"operation\" must have type Operation");
+        if (fd < 0)
+            throw MI::TypeConversionException(L"\"fd\" must be a valid file descriptor");
+
+        bool ndjson = !ndjsonObj || PyObject_IsTrue(ndjsonObj);
+
+        size_t count = 0;
+        WriteOperationResults(self, (Operation*)operation, [&]() {
+            count = self->serializer->WriteOperation(*((Operation*)operation)->operation, fd, ndjson);
+        });
+        return PyLong_FromSize_t(count);
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyMemberDef JsonSerializer_members[] = {
+    { NULL }  /* Sentinel */
+};
+
+static PyMethodDef JsonSerializer_methods[] = {
+    { "serialize_instance", (PyCFunction)JsonSerializer_SerializeInstance, METH_VARARGS | METH_KEYWORDS, "Serializes an instance, returns UTF-8 JSON." },
+    { "serialize_operation", (PyCFunction)JsonSerializer_SerializeOperation, METH_VARARGS | METH_KEYWORDS, "Serializes the remaining results of an operation, returns UTF-8 NDJSON or a JSON array." },
+    { "write_operation", (PyCFunction)JsonSerializer_WriteOperation, METH_VARARGS | METH_KEYWORDS, "Writes the remaining results of an operation to a file descriptor, returns the number of instances." },
+    { NULL }  /* Sentinel */
+};
+
+PyTypeObject JsonSerializerType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "mi.JsonSerializer",             /*tp_name*/
+    sizeof(JsonSerializer),             /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)JsonSerializer_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    "JsonSerializer objects",           /* tp_doc */
+    0,                     /* tp_traverse */
+    0,                     /* tp_clear */
+    0,                     /* tp_richcompare */
+    0,                     /* tp_weaklistoffset */
+    0,                     /* tp_iter */
+    0,                     /* tp_iternext */
+    JsonSerializer_methods,             /* tp_methods */
+    JsonSerializer_members,             /* tp_members */
+    0,                         /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)JsonSerializer_init,      /* tp_init */
+    0,                         /* tp_alloc */
+    JsonSerializer_new,                 /* tp_new */
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Python.h>
+#include <MIJsonSerializer.h>
+#include <memory>
+
+typedef struct {
+    PyObject_HEAD
+    /* Type-specific fields go here. */
+    std::shared_ptr<MI::JsonSerializer> serializer;
+    CRITICAL_SECTION cs;
+} JsonSerializer;
+
+extern PyTypeObject JsonSerializerType;
+
+JsonSerializer* JsonSerializer_New(std::shared_ptr<MI::JsonSerializer> serializer);
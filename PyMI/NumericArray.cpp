@@ -0,0 +1,285 @@
+#include "stdafx.h"
+#include "NumericArray.h"
+#include "PyMI.h"
+#include "Utils.h"
+#include <cstddef>
+
+#ifdef IS_PY3K
+#define PYSLICE_CAST(o) (o)
+#else
+#define PYSLICE_CAST(o) ((PySliceObject*)(o))
+typedef long Py_hash_t;
+#endif
+
+bool IsNumericArrayItemType(MI_Type itemType)
+{
+    switch (itemType)
+    {
+    case MI_UINT8:
+    case MI_SINT8:
+    case MI_UINT16:
+    case MI_SINT16:
+    case MI_UINT32:
+    case MI_SINT32:
+    case MI_UINT64:
+    case MI_SINT64:
+    case MI_REAL32:
+    case MI_REAL64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+PyObject* NumericArray_New(const void* data, MI_Uint32 count, MI_Type itemType)
+{
+    Py_ssize_t itemSize = MI::MIValue::GetItemSize(itemType);
+    NumericArray* self = PyObject_NewVar(NumericArray, &NumericArrayType, count * itemSize);
+    if (!self)
+        return NULL;
+    self->itemType = itemType;
+    self->count = count;
+    self->itemSize = itemSize;
+    if (count)
+        memcpy(self->data, data, count * itemSize);
+    return (PyObject*)self;
+}
+
+static void NumericArray_dealloc(NumericArray* self)
+{
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+// Same conversions as MI2Py, without going through an MI_Value
+static PyObject* NumericArray_GetItem(NumericArray* self, Py_ssize_t i)
+{
+    switch (self->itemType)
+    {
+    case MI_SINT8:
+        return PyLong_FromLong(((const MI_Sint8*)self->data)[i]);
+    case MI_UINT8:
+        return PyLong_FromUnsignedLong(((const MI_Uint8*)self->data)[i]);
+    case MI_SINT16:
+        return PyLong_FromLong(((const MI_Sint16*)self->data)[i]);
+    case MI_UINT16:
+        return PyLong_FromUnsignedLong(((const MI_Uint16*)self->data)[i]);
+    case MI_SINT32:
+        return PyLong_FromLong(((const MI_Sint32*)self->data)[i]);
+    case MI_UINT32:
+        return PyLong_FromUnsignedLong(((const MI_Uint32*)self->data)[i]);
+    case MI_SINT64:
+        return PyLong_FromLongLong(((const MI_Sint64*)self->data)[i]);
+    case MI_UINT64:
+        return PyLong_FromUnsignedLongLong(((const MI_Uint64*)self->data)[i]);
+    case MI_REAL32:
+        return PyFloat_FromDouble(((const MI_Real32*)self->data)[i]);
+    case MI_REAL64:
+        return PyFloat_FromDouble(((const MI_Real64*)self->data)[i]);
+    default:
+        PyErr_SetString(PyExc_TypeError, "Unsupported NumericArray item type");
+        return NULL;
+    }
+}
+
+static PyObject* NumericArray_ToTuple(NumericArray* self, Py_ssize_t start, Py_ssize_t step, Py_ssize_t length)
+{
+    PyObject* tuple = PyTuple_New(length);
+    if (!tuple)
+        return NULL;
+    for (Py_ssize_t i = 0; i < length; i++)
+    {
+        PyObject* item = NumericArray_GetItem(self, start + i * step);
+        if (!item)
+        {
+            Py_DECREF(tuple);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(tuple, i, item);
+    }
+    return tuple;
+}
+
+static Py_ssize_t NumericArray_length(NumericArray* self)
+{
+    return self->count;
+}
+
+static PyObject* NumericArray_item(NumericArray* self, Py_ssize_t i)
+{
+    if (i < 0 || i >= self->count)
+    {
+        PyErr_SetString(PyExc_IndexError, "NumericArray index out of range");
+        return NULL;
+    }
+    return NumericArray_GetItem(self, i);
+}
+
+// Slices return tuples, as for the tuples previously returned for all arrays
+static PyObject* NumericArray_subscript(NumericArray* self, PyObject* key)
+{
+    if (PyIndex_Check(key))
+    {
+        Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+        if (i == -1 && PyErr_Occurred())
+            return NULL;
+        return NumericArray_item(self, i < 0 ? i + self->count : i);
+    }
+    if (PySlice_Check(key))
+    {
+        Py_ssize_t start, stop, step, length;
+        if (PySlice_GetIndicesEx(PYSLICE_CAST(key), self->count, &start, &stop, &step, &length) < 0)
+            return NULL;
+        return NumericArray_ToTuple(self, start, step, length);
+    }
+    PyErr_SetString(PyExc_TypeError, "NumericArray indices must be integers or slices");
+    return NULL;
+}
+
+// Compares as the tuple of the items
+static PyObject* NumericArray_richcompare(NumericArray* self, PyObject* other, int op)
+{
+    // Integers only, equal reals can differ bitwise
+    if ((op == Py_EQ || op == Py_NE) && Py_TYPE(other) == &NumericArrayType &&
+        ((NumericArray*)other)->itemType == self->itemType &&
+        self->itemType != MI_REAL32 && self->itemType != MI_REAL64)
+    {
+        auto otherArray = (NumericArray*)other;
+        bool equal = otherArray->count == self->count &&
+            !memcmp(otherArray->data, self->data, self->count * self->itemSize);
+        if (equal == (op == Py_EQ))
+            Py_RETURN_TRUE;
+        Py_RETURN_FALSE;
+    }
+
+    PyObject* tuple = NumericArray_ToTuple(self, 0, 1, self->count);
+    if (!tuple)
+        return NULL;
+    PyObject* otherTuple = other;
+    if (Py_TYPE(other) == &NumericArrayType)
+        otherTuple = NumericArray_ToTuple((NumericArray*)other, 0, 1, ((NumericArray*)other)->count);
+    else
+        Py_INCREF(other);
+    PyObject* result = otherTuple ? PyObject_RichCompare(tuple, otherTuple, op) : NULL;
+    Py_DECREF(tuple);
+    Py_XDECREF(otherTuple);
+    return result;
+}
+
+static Py_hash_t NumericArray_hash(NumericArray* self)
+{
+    PyObject* tuple = NumericArray_ToTuple(self, 0, 1, self->count);
+    if (!tuple)
+        return -1;
+    Py_hash_t hash = PyObject_Hash(tuple);
+    Py_DECREF(tuple);
+    return hash;
+}
+
+static PyObject* NumericArray_repr(NumericArray* self)
+{
+    PyObject* tuple = NumericArray_ToTuple(self, 0, 1, self->count);
+    if (!tuple)
+        return NULL;
+    PyObject* repr = PyObject_Repr(tuple);
+    Py_DECREF(tuple);
+    return repr;
+}
+
+// Boxes all the items at once, cheaper than item by item
+static PyObject* NumericArray_iter(NumericArray* self)
+{
+    PyObject* tuple = NumericArray_ToTuple(self, 0, 1, self->count);
+    if (!tuple)
+        return NULL;
+    PyObject* iterator = PyObject_GetIter(tuple);
+    Py_DECREF(tuple);
+    return iterator;
+}
+
+static PyObject* NumericArray_Reduce(NumericArray* self, PyObject*)
+{
+    PyObject* tuple = NumericArray_ToTuple(self, 0, 1, self->count);
+    if (!tuple)
+        return NULL;
+    return Py_BuildValue("(O(N))", (PyObject*)&PyTuple_Type, tuple);
+}
+
+static PyObject* NumericArray_GetItemType(NumericArray* self, void*)
+{
+    return PyLong_FromUnsignedLong(self->itemType);
+}
+
+static int NumericArray_GetBuffer(NumericArray* self, Py_buffer* view, int flags)
+{
+    return FillReadOnlyPyBuffer((PyObject*)self, self->data, &self->count, self->itemSize,
+                                GetPyBufferFormat(self->itemType), view, flags);
+}
+
+static PyGetSetDef NumericArray_getset[] = {
+    { "item_type", (getter)NumericArray_GetItemType, NULL, "MI type of the items.", NULL },
+    { NULL }  /* Sentinel */
+};
+
+static PyMemberDef NumericArray_members[] = {
+    { NULL }  /* Sentinel */
+};
+
+static PyMethodDef NumericArray_methods[] = {
+    { "__reduce__", (PyCFunction)NumericArray_Reduce, METH_NOARGS, "Pickles as a tuple." },
+    { NULL }  /* Sentinel */
+};
+
+static PySequenceMethods NumericArray_as_sequence = {
+    (lenfunc)NumericArray_length,    /* sq_length */
+    0,                         /* sq_concat */
+    0,                         /* sq_repeat */
+    (ssizeargfunc)NumericArray_item, /* sq_item */
+};
+
+static PyMappingMethods NumericArray_as_mapping = {
+    (lenfunc)NumericArray_length,
+    (binaryfunc)NumericArray_subscript,
+    0
+};
+
+static PyBufferProcs NumericArray_as_buffer = {
+#ifndef IS_PY3K
+    0, 0, 0, 0,
+#endif
+    (getbufferproc)NumericArray_GetBuffer, /* bf_getbuffer */
+    0,                         /* bf_releasebuffer */
+};
+
+PyTypeObject NumericArrayType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "mi.NumericArray",             /*tp_name*/
+    offsetof(NumericArray, data),  /*tp_basicsize*/
+    1,                         /*tp_itemsize*/
+    (destructor)NumericArray_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    (reprfunc)NumericArray_repr, /*tp_repr*/
+    0,                         /*tp_as_number*/
+    &NumericArray_as_sequence, /*tp_as_sequence*/
+    &NumericArray_as_mapping,  /*tp_as_mapping*/
+    (hashfunc)NumericArray_hash, /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    &NumericArray_as_buffer,   /*tp_as_buffer*/
+    PYMI_BUFFER_TPFLAGS,       /*tp_flags*/
+    "Read-only array of MI numbers, exporting the items through the buffer protocol "
+    "and comparing as a tuple", /* tp_doc */
+    0,                     /* tp_traverse */
+    0,                     /* tp_clear */
+    (richcmpfunc)NumericArray_richcompare, /* tp_richcompare */
+    0,                     /* tp_weaklistoffset */
+    (getiterfunc)NumericArray_iter, /* tp_iter */
+    0,                     /* tp_iternext */
+    NumericArray_methods,             /* tp_methods */
+    NumericArray_members,             /* tp_members */
+    NumericArray_getset,             /* tp_getset */
+};
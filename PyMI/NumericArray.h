@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Python.h>
+#include <MI.h>
+
+typedef struct {
+    PyObject_VAR_HEAD
+    /* Type-specific fields go here. */
+    MI_Type itemType;
+    Py_ssize_t count;
+    Py_ssize_t itemSize;
+    // The items, allocated with the object
+    MI_Uint64 data[1];
+} NumericArray;
+
+extern PyTypeObject NumericArrayType;
+
+bool IsNumericArrayItemType(MI_Type itemType);
+// Copies "count" items of an MI array of "itemType"
+PyObject* NumericArray_New(const void* data, MI_Uint32 count, MI_Type itemType);
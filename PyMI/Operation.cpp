@@ -2,15 +2,23 @@
 #include "Operation.h"
 #include "Instance.h"
 #include "Class.h"
+#include "Column.h"
 #include "Utils.h"
 #include "PyMI.h"
 
+// Results read ahead by prefetch when no count is given
+#define DEFAULT_PREFETCH_COUNT 64
+// Indications returned by get_indications when no count is given
+#define DEFAULT_INDICATION_BATCH_SIZE 256
 
 static PyObject* Operation_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
 {
     Operation* self = NULL;
     self = (Operation*)type->tp_alloc(type, 0);
     self->operation = NULL;
+    self->prefetcher = NULL;
+    self->indicationQueue = NULL;
+    self->currentResult = NULL;
     ::InitializeCriticalSection(&self->cs);
     return (PyObject *)self;
 }
@@ -21,11 +29,69 @@ static int Operation_init(Operation* self, PyObject* args, PyObject* kwds)
     return -1;
 }
 
+// The results are read by the prefetcher only, if any
+static void CheckNotPrefetching(Operation* self)
+{
+    if (self->prefetcher)
+    {
+        throw MI::Exception(L"The results of the operation are being prefetched");
+    }
+}
+
+// Stops the prefetcher, if any, before the operation is closed or released
+static void StopPrefetcher(Operation* self)
+{
+    std::shared_ptr<MI::Prefetcher> prefetcher;
+    prefetcher.swap(self->prefetcher);
+    if (prefetcher)
+    {
+        AllowThreads(NULL, [&]() {
+            prefetcher->Stop();
+        });
+    }
+}
+
+// Releases the subscription if blocked on a full queue, before the operation is closed
+static void StopIndicationQueue(Operation* self)
+{
+    if (self->indicationQueue)
+    {
+        self->indicationQueue->Stop();
+    }
+}
+
+// Results still referenced besides the operation, e.g. by a list or by the variable
+// they were assigned to, are cloned when the operation moves on or is closed. The
+// others are invalidated, without the cost of a clone.
+void Operation_ReleaseCurrentResult(Operation* self)
+{
+    if (self->currentResult)
+    {
+        if (Py_REFCNT(self->currentResult) > 1)
+        {
+            ((Instance*)self->currentResult)->instance->Retain();
+        }
+        Py_CLEAR(self->currentResult);
+    }
+}
+
+// Returns a new reference to the wrapper of an instance result of the operation
+static PyObject* SetCurrentResult(Operation* self, std::shared_ptr<MI::Instance> instance)
+{
+    PyObject* obj = (PyObject*)Instance_New(instance);
+    Py_INCREF(obj);
+    self->currentResult = obj;
+    return obj;
+}
+
 static void Operation_dealloc(Operation* self)
 {
-    AllowThreads(&self->cs, [&]() {
-        self->operation = NULL;
-    });
+    Operation_ReleaseCurrentResult(self);
+    StopPrefetcher(self);
+    StopIndicationQueue(self);
+    self->indicationQueue = NULL;
+    // Closes the operation if not closed yet
+    ReleaseBlockingObject(self->operation);
     ::DeleteCriticalSection(&self->cs);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
@@ -51,12 +117,26 @@ static PyObject* Operation_GetNextInstance(Operation* self, PyObject*)
     try
     {
         std::shared_ptr<MI::Instance> instance;
+        auto prefetcher = self->prefetcher;
+        if (prefetcher)
+        {
+            AllowThreads(NULL, [&]() {
+                instance = prefetcher->GetNextInstance();
+            });
+            if (instance)
+            {
+                return (PyObject*)Instance_New(instance);
+            }
+            Py_RETURN_NONE;
+        }
+
+        Operation_ReleaseCurrentResult(self);
         AllowThreads(&self->cs, [&]() {
             instance = self->operation->GetNextInstance();
         });
         if (instance)
         {
-            return (PyObject*)Instance_New(instance);
+            return SetCurrentResult(self, instance);
         }
         Py_RETURN_NONE;
     }
@@ -71,13 +151,19 @@ static PyObject* Operation_GetNextIndication(Operation* self, PyObject*)
 {
     try
     {
+        CheckNotPrefetching(self);
+        if (self->indicationQueue)
+        {
+            throw MI::Exception(L"The indications of the subscription are queued, use get_indications");
+        }
+        Operation_ReleaseCurrentResult(self);
         std::shared_ptr<MI::Instance> instance;
         AllowThreads(&self->cs, [&]() {
             instance = self->operation->GetNextIndication();
         });
         if (instance)
         {
-            return (PyObject*)Instance_New(instance);
+            return SetCurrentResult(self, instance);
         }
         Py_RETURN_NONE;
     }
@@ -88,10 +174,79 @@ static PyObject* Operation_GetNextIndication(Operation* self, PyObject*)
     }
 }
 
+static PyObject* Operation_GetIndications(Operation* self, PyObject* args, PyObject* kwds)
+{
+    Py_ssize_t maxCount = DEFAULT_INDICATION_BATCH_SIZE;
+    PyObject* timeoutObj = NULL;
+    static char *kwlist[] = { "max_count", "timeout", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|nO", kwlist, &maxCount, &timeoutObj))
+        return NULL;
+
+    try
+    {
+        auto indicationQueue = self->indicationQueue;
+        if (!indicationQueue)
+        {
+            throw MI::Exception(L"The operation is not a subscription with a \"queue_size\"");
+        }
+        if (maxCount <= 0)
+        {
+            throw MI::Exception(L"\"max_count\" must be positive");
+        }
+        std::chrono::milliseconds timeout(-1);
+        if (!CheckPyNone(timeoutObj))
+        {
+            timeout = PyDeltaToMilliseconds(timeoutObj, L"timeout");
+        }
+
+        std::vector<std::shared_ptr<MI::Instance>> indications;
+        AllowThreads(NULL, [&]() {
+            indicationQueue->GetIndications(indications, (size_t)maxCount, timeout);
+        });
+
+        PyObject* list = PyList_New(indications.size());
+        if (!list)
+        {
+            return NULL;
+        }
+        for (size_t i = 0; i < indications.size(); i++)
+        {
+            PyList_SET_ITEM(list, i, (PyObject*)Instance_New(indications[i]));
+        }
+        return list;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* Operation_GetIndicationStats(Operation* self, PyObject*)
+{
+    try
+    {
+        if (!self->indicationQueue)
+        {
+            throw MI::Exception(L"The operation is not a subscription with a \"queue_size\"");
+        }
+        auto stats = self->indicationQueue->GetStats();
+        return Py_BuildValue("{sKsKsKsn}", "received", stats.m_received, "dropped", stats.m_dropped,
+            "overflows", stats.m_overflows, "queued", (Py_ssize_t)stats.m_queued);
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
 static PyObject* Operation_GetNextClass(Operation* self, PyObject*)
 {
     try
     {
+        CheckNotPrefetching(self);
+        Operation_ReleaseCurrentResult(self);
         std::shared_ptr<MI::Class> miClass;
         AllowThreads(&self->cs, [&]() {
             miClass = self->operation->GetNextClass();
@@ -109,11 +264,317 @@ static PyObject* Operation_GetNextClass(Operation* self, PyObject*)
     }
 }
 
+static PyObject* Operation_FetchColumns(Operation* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* names = NULL;
+    PyObject* limitObj = NULL;
+    static char *kwlist[] = { "names", "limit", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O", kwlist, &names, &limitObj))
+        return NULL;
+
+    try
+    {
+        CheckNotPrefetching(self);
+        size_t limit = 0;
+        if (!GetLimit(limitObj, limit))
+        {
+            return NULL;
+        }
+
+        std::vector<std::wstring> columnNames;
+        PyObject* namesTuple = GetElementNames(names, columnNames);
+        if (!namesTuple)
+        {
+            return NULL;
+        }
+        Py_DECREF(namesTuple);
+
+        Operation_ReleaseCurrentResult(self);
+        MI::ColumnReader reader(columnNames);
+        AllowThreads(&self->cs, [&]() {
+            reader.ReadOperation(*self->operation, limit);
+        });
+
+        PyObject* columns = PyDict_New();
+        if (!columns)
+        {
+            return NULL;
+        }
+        for (auto& column : reader.TakeColumns())
+        {
+            PyObject* name = PyUnicode_FromWideChar(column.m_name.c_str(), column.m_name.length());
+            if (!name)
+            {
+                Py_DECREF(columns);
+                return NULL;
+            }
+            PyObject* obj = (PyObject*)Column_New(std::make_shared<MI::Column>(std::move(column)));
+            int result = PyDict_SetItem(columns, name, obj);
+            Py_DECREF(name);
+            Py_DECREF(obj);
+            if (result)
+            {
+                Py_DECREF(columns);
+                return NULL;
+            }
+        }
+        return columns;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+// Results read by fetch_all without the GIL. Getting the next result releases
+// the previous one, so the elements are copied: names and strings to a shared
+// buffer, the other scalars inline. The results with array, instance or
+// reference values are cloned instead.
+class FetchedResults
+{
+private:
+    struct Element
+    {
+        MI::ValueElementRef m_ref;
+        // Offsets in m_strings, resolved once all the results are read
+        size_t m_nameOffset;
+        size_t m_stringOffset;
+    };
+
+    std::vector<MI_Char> m_strings;
+    std::vector<Element> m_elements;
+    std::vector<size_t> m_ends;
+    std::vector<std::shared_ptr<MI::Instance>> m_clones;
+    std::vector<MI::ValueElementRef> m_refs;
+    // Offsets of the previous result's names, reused while they match
+    std::vector<size_t> m_nameOffsets;
+    std::vector<MI::ValueElementRef> m_resolved;
+
+    static const size_t npos = (size_t)-1;
+
+    size_t AppendString(const MI_Char* value)
+    {
+        size_t offset = this->m_strings.size();
+        this->m_strings.insert(this->m_strings.end(), value, value + wcslen(value) + 1);
+        return offset;
+    }
+
+    size_t AppendName(size_t position, const MI_Char* name)
+    {
+        if (position < this->m_nameOffsets.size() && !wcscmp(&this->m_strings[this->m_nameOffsets[position]], name))
+        {
+            return this->m_nameOffsets[position];
+        }
+        size_t offset = this->AppendString(name);
+        if (position < this->m_nameOffsets.size())
+        {
+            this->m_nameOffsets[position] = offset;
+        }
+        else
+        {
+            this->m_nameOffsets.push_back(offset);
+        }
+        return offset;
+    }
+
+public:
+    void Append(const MI::Instance& instance, const std::vector<std::wstring>* elementNames)
+    {
+        ReadInstanceElements(instance, elementNames, this->m_refs);
+
+        bool copy = true;
+        for (auto& ref : this->m_refs)
+        {
+            if (!(ref.m_flags & MI_FLAG_NULL) &&
+                ((ref.m_type & MI_ARRAY) || ref.m_type == MI_INSTANCE || ref.m_type == MI_REFERENCE))
+            {
+                copy = false;
+                break;
+            }
+        }
+
+        if (!copy)
+        {
+            auto clone = instance.Clone();
+            ReadInstanceElements(*clone, elementNames, this->m_refs);
+            this->m_clones.push_back(clone);
+        }
+
+        for (size_t i = 0; i < this->m_refs.size(); i++)
+        {
+            Element element = { this->m_refs[i], npos, npos };
+            if (copy)
+            {
+                // The names of the requested elements are not needed
+                if (!elementNames)
+                {
+                    element.m_nameOffset = this->AppendName(i, element.m_ref.m_name);
+                }
+                if (element.m_ref.m_type == MI_STRING && !(element.m_ref.m_flags & MI_FLAG_NULL))
+                {
+                    element.m_stringOffset = this->AppendString(element.m_ref.m_value.string);
+                }
+            }
+            this->m_elements.push_back(element);
+        }
+        this->m_ends.push_back(this->m_elements.size());
+    }
+
+    size_t GetCount() const { return this->m_ends.size(); }
+
+    // Elements of the results, valid as long as this object
+    const std::vector<MI::ValueElementRef>& Resolve()
+    {
+        this->m_resolved.resize(this->m_elements.size());
+        for (size_t i = 0; i < this->m_elements.size(); i++)
+        {
+            auto& element = this->m_elements[i];
+            auto& ref = this->m_resolved[i];
+            ref = element.m_ref;
+            if (element.m_nameOffset != npos)
+            {
+                ref.m_name = &this->m_strings[element.m_nameOffset];
+            }
+            if (element.m_stringOffset != npos)
+            {
+                ref.m_value.string = &this->m_strings[element.m_stringOffset];
+            }
+        }
+        return this->m_resolved;
+    }
+
+    size_t GetBegin(size_t index) const { return index ? this->m_ends[index - 1] : 0; }
+    size_t GetEnd(size_t index) const { return this->m_ends[index]; }
+};
+
+static PyObject* Operation_FetchAll(Operation* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* asDictsObj = NULL;
+    PyObject* limitObj = NULL;
+    PyObject* names = NULL;
+    static char *kwlist[] = { "as_dicts", "limit", "names", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOO", kwlist, &asDictsObj, &limitObj, &names))
+        return NULL;
+
+    PyObject* namesTuple = NULL;
+    try
+    {
+        CheckNotPrefetching(self);
+        size_t limit = 0;
+        if (!GetLimit(limitObj, limit))
+        {
+            return NULL;
+        }
+
+        bool asDicts = !asDictsObj || PyObject_IsTrue(asDictsObj);
+        std::vector<std::wstring> elementNames;
+        if (!CheckPyNone(names))
+        {
+            if (!asDicts)
+            {
+                throw MI::Exception(L"\"names\" requires \"as_dicts\"");
+            }
+            namesTuple = GetElementNames(names, elementNames);
+            if (!namesTuple)
+            {
+                return NULL;
+            }
+        }
+
+        Operation_ReleaseCurrentResult(self);
+        std::vector<std::shared_ptr<MI::Instance>> instances;
+        FetchedResults results;
+        AllowThreads(&self->cs, [&]() {
+            while ((!limit || instances.size() + results.GetCount() < limit) && self->operation->HasMoreResults())
+            {
+                auto instance = self->operation->GetNextInstance();
+                if (!instance)
+                {
+                    continue;
+                }
+                if (asDicts)
+                {
+                    results.Append(*instance, namesTuple ? &elementNames : NULL);
+                }
+                else
+                {
+                    // Getting the next result releases the previous one
+                    instances.push_back(instance->Clone());
+                }
+            }
+        });
+
+        size_t count = asDicts ? results.GetCount() : instances.size();
+        PyObject* list = PyList_New(count);
+        if (!list)
+        {
+            Py_XDECREF(namesTuple);
+            return NULL;
+        }
+        auto& elements = results.Resolve();
+        for (size_t i = 0; i < count; i++)
+        {
+            PyObject* item = NULL;
+            try
+            {
+                if (asDicts)
+                {
+                    size_t begin = results.GetBegin(i);
+                    item = InstanceElementsToPyDict(elements.data() + begin, results.GetEnd(i) - begin,
+                                                    namesTuple, true);
+                }
+                else
+                {
+                    item = (PyObject*)Instance_New(instances[i]);
+                }
+            }
+            catch (std::exception&)
+            {
+                Py_DECREF(list);
+                throw;
+            }
+            if (!item)
+            {
+                Py_DECREF(list);
+                Py_XDECREF(namesTuple);
+                return NULL;
+            }
+            PyList_SET_ITEM(list, i, item);
+        }
+        Py_XDECREF(namesTuple);
+        return list;
+    }
+    catch (std::exception& ex)
+    {
+        Py_XDECREF(namesTuple);
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
 static PyObject* Operation_HasMoreResults(Operation* self, PyObject*)
 {
     try
     {
-        if (self->operation->HasMoreResults())
+        auto prefetcher = self->prefetcher;
+        bool hasMoreResults = false;
+        if (prefetcher)
+        {
+            AllowThreads(NULL, [&]() {
+                hasMoreResults = prefetcher->HasMoreResults();
+            });
+        }
+        else if (self->indicationQueue)
+        {
+            // Push mode operations report more results until closed
+            hasMoreResults = self->indicationQueue->HasMoreResults();
+        }
+        else
+        {
+            hasMoreResults = self->operation->HasMoreResults();
+        }
+        if (hasMoreResults)
         {
             Py_RETURN_TRUE;
         }
@@ -130,10 +591,83 @@ static PyObject* Operation_HasMoreResults(Operation* self, PyObject*)
 }
 
 
+static PyObject* Operation_Prefetch(Operation* self, PyObject* args, PyObject* kwds)
+{
+    Py_ssize_t count = DEFAULT_PREFETCH_COUNT;
+    static char *kwlist[] = { "count", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n", kwlist, &count))
+        return NULL;
+
+    try
+    {
+        if (count <= 0)
+        {
+            throw MI::Exception(L"\"count\" must be positive");
+        }
+        CheckNotPrefetching(self);
+        if (self->operation->IsClosed())
+        {
+            throw MI::Exception(L"The operation is closed");
+        }
+        Operation_ReleaseCurrentResult(self);
+        // Waits for a pending get_next_instance call
+        AllowThreads(&self->cs, [&]() {
+            self->prefetcher = std::make_shared<MI::Prefetcher>(self->operation, (size_t)count);
+        });
+        Py_INCREF(self);
+        return (PyObject*)self;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* Operation_iter(Operation* self)
+{
+    Py_INCREF(self);
+    return (PyObject*)self;
+}
+
+// As get_next_instance, but stops the iteration instead of returning None
+static PyObject* Operation_iternext(Operation* self)
+{
+    try
+    {
+        std::shared_ptr<MI::Instance> instance;
+        auto prefetcher = self->prefetcher;
+        if (prefetcher)
+        {
+            AllowThreads(NULL, [&]() {
+                instance = prefetcher->GetNextInstance();
+            });
+            return instance ? (PyObject*)Instance_New(instance) : NULL;
+        }
+
+        Operation_ReleaseCurrentResult(self);
+        AllowThreads(&self->cs, [&]() {
+            while (!instance && self->operation->HasMoreResults())
+            {
+                instance = self->operation->GetNextInstance();
+            }
+        });
+        return instance ? SetCurrentResult(self, instance) : NULL;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
 static PyObject* Operation_Close(Operation *self, PyObject*)
 {
     try
     {
+        Operation_ReleaseCurrentResult(self);
+        StopPrefetcher(self);
+        StopIndicationQueue(self);
         self->operation->Close();
         Py_RETURN_NONE;
     }
@@ -152,6 +686,9 @@ static PyObject* Operation_self(Operation *self, PyObject*)
 
 static PyObject* Operation_exit(Operation* self, PyObject*)
 {
+    Operation_ReleaseCurrentResult(self);
+    StopPrefetcher(self);
+    StopIndicationQueue(self);
     AllowThreads(&self->cs, [&]() {
         if (!self->operation->IsClosed())
             self->operation->Close();
@@ -174,6 +711,11 @@ static PyMethodDef Operation_methods[] = {
     { "get_next_instance", (PyCFunction)Operation_GetNextInstance, METH_NOARGS, "Returns the next instance." },
     { "get_next_class", (PyCFunction)Operation_GetNextClass, METH_NOARGS, "Returns the next class." },
     { "get_next_indication", (PyCFunction)Operation_GetNextIndication, METH_NOARGS, "Returns the next result from a subscription." },
+    { "get_indications", (PyCFunction)Operation_GetIndications, METH_VARARGS | METH_KEYWORDS, "Waits up to timeout, indefinitely if None, for indications queued by a subscription, returning a list of up to max_count of them." },
+    { "get_indication_stats", (PyCFunction)Operation_GetIndicationStats, METH_NOARGS, "Returns a dict with the number of indications received, dropped, overflowing the queue and queued." },
+    { "fetch_columns", (PyCFunction)Operation_FetchColumns, METH_VARARGS | METH_KEYWORDS, "Reads the remaining results, up to limit, into a dict of Column objects keyed by property name." },
+    { "fetch_all", (PyCFunction)Operation_FetchAll, METH_VARARGS | METH_KEYWORDS, "Reads the remaining results, up to limit, into a list of dicts of the elements named in names, all the elements if None, or of instances if as_dicts is false." },
+    { "prefetch", (PyCFunction)Operation_Prefetch, METH_VARARGS | METH_KEYWORDS, "Reads up to count results ahead from a background thread, returning the operation. The results remain valid once the operation moves on." },
     { "has_more_results", (PyCFunction)Operation_HasMoreResults, METH_NOARGS, "Returns whether the current operation has more results." },
     { "cancel", (PyCFunction)Operation_Cancel, METH_NOARGS, "Cancels the operation." },
     { "close", (PyCFunction)Operation_Close, METH_NOARGS, "Closes the operation." },
@@ -208,8 +750,8 @@ PyTypeObject OperationType = {
     0,                     /* tp_clear */
     0,                     /* tp_richcompare */
     0,                     /* tp_weaklistoffset */
-    0,                     /* tp_iter */
-    0,                     /* tp_iternext */
+    (getiterfunc)Operation_iter, /* tp_iter */
+    (iternextfunc)Operation_iternext, /* tp_iternext */
     Operation_methods,             /* tp_methods */
     Operation_members,             /* tp_members */
     0,                         /* tp_getset */
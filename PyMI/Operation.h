@@ -2,15 +2,25 @@
 
 #include <Python.h>
 #include <MI++.h>
+#include <MIIndicationQueue.h>
+#include <MIPrefetcher.h>
 #include <memory>
 
 typedef struct {
     PyObject_HEAD
     /* Type-specific fields go here. */
     std::shared_ptr<MI::Operation> operation;
+    // Set by prefetch, reads the results in the background
+    std::shared_ptr<MI::Prefetcher> prefetcher;
+    // Set for subscriptions queuing their indications natively
+    std::shared_ptr<MI::IndicationQueue> indicationQueue;
+    // The last instance returned, retained when the operation moves on if still referenced
+    PyObject* currentResult;
     CRITICAL_SECTION cs;
 } Operation;
 
 extern PyTypeObject OperationType;
 
 Operation* Operation_New(std::shared_ptr<MI::Operation> operation);
+// To be called with the GIL before the operation moves on or is closed
+void Operation_ReleaseCurrentResult(Operation* self);
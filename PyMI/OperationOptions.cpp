@@ -23,9 +23,7 @@ static int OperationOptions_init(OperationOptions* self, PyObject* args, PyObjec
 
 static void OperationOptions_dealloc(OperationOptions* self)
 {
-    AllowThreads(&self->cs, [&]() {
-        self->operationOptions = NULL;
-    });
+    self->operationOptions = NULL;
     ::DeleteCriticalSection(&self->cs);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
@@ -11,14 +11,74 @@
 #include "Serializer.h"
 #include "OperationOptions.h"
 #include "DestinationOptions.h"
+#include "FanOutQuery.h"
+#include "JsonSerializer.h"
+#include "ClassSchemaCache.h"
+#include "Column.h"
+#include "NumericArray.h"
 #include "MiError.h"
+#include "StringCache.h"
+#include "Utils.h"
 
 #include <datetime.h>
 
 PyObject *PyMIError;
 PyObject *PyMITimeoutError;
 
+static PyObject* mi_InvalidateClassCache(PyObject* self, PyObject* args, PyObject* kwds)
+{
+    char* serverName = "";
+    char* ns = "";
+    char* className = "";
+
+    static char *kwlist[] = { "server_name", "ns", "class_name", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|sss", kwlist, &serverName, &ns, &className))
+        return NULL;
+
+    try
+    {
+        MI::ClassCache::Invalidate(ToWstring(serverName), ToWstring(ns), ToWstring(className));
+        Py_RETURN_NONE;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* mi_SetStringCache(PyObject* self, PyObject* args, PyObject* kwds)
+{
+    Py_ssize_t size = 0;
+    Py_ssize_t maxLength = 32;
+
+    static char *kwlist[] = { "size", "max_length", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "n|n", kwlist, &size, &maxLength))
+        return NULL;
+
+    try
+    {
+        if (size < 0 || maxLength < 0)
+        {
+            throw MI::Exception(L"\"size\" and \"max_length\" must not be negative");
+        }
+        ConfigureStringValueCache((size_t)size, (size_t)maxLength);
+        Py_RETURN_NONE;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
 static PyMethodDef mi_methods[] = {
+    { "invalidate_class_cache", (PyCFunction)mi_InvalidateClassCache, METH_VARARGS | METH_KEYWORDS,
+      "Drops the cached class metadata matching the given server name, namespace and class name, "
+      "omitted arguments match any value." },
+    { "set_string_cache", (PyCFunction)mi_SetStringCache, METH_VARARGS | METH_KEYWORDS,
+      "Caches up to \"size\" Python strings for the string values of at most \"max_length\" characters, "
+      "so that repeated values share the same object. A size of 0, the default, disables the cache." },
     { NULL, NULL, 0, NULL }  /* Sentinel */
 };
 
@@ -67,6 +127,24 @@ PyObject* _initmi(void)
     if (PyType_Ready(&DestinationOptionsType) < 0)
         return NULL;
 
+    if (PyType_Ready(&FanOutQueryType) < 0)
+        return NULL;
+
+    if (PyType_Ready(&JsonSerializerType) < 0)
+        return NULL;
+
+    if (PyType_Ready(&ClassSchemaCacheType) < 0)
+        return NULL;
+
+    if (PyType_Ready(&ColumnType) < 0)
+        return NULL;
+
+    if (PyType_Ready(&ColumnBufferType) < 0)
+        return NULL;
+
+    if (PyType_Ready(&NumericArrayType) < 0)
+        return NULL;
+
 #ifdef IS_PY3K
     m = PyModule_Create(&mimodule);
     if (m == NULL)
@@ -101,6 +179,24 @@ PyObject* _initmi(void)
     Py_INCREF(&DestinationOptionsType);
     PyModule_AddObject(m, "DestinationOptions", (PyObject*)&DestinationOptionsType);
 
+    Py_INCREF(&FanOutQueryType);
+    PyModule_AddObject(m, "FanOutQuery", (PyObject*)&FanOutQueryType);
+
+    Py_INCREF(&JsonSerializerType);
+    PyModule_AddObject(m, "JsonSerializer", (PyObject*)&JsonSerializerType);
+
+    Py_INCREF(&ClassSchemaCacheType);
+    PyModule_AddObject(m, "ClassSchemaCache", (PyObject*)&ClassSchemaCacheType);
+
+    Py_INCREF(&ColumnType);
+    PyModule_AddObject(m, "Column", (PyObject*)&ColumnType);
+
+    Py_INCREF(&NumericArrayType);
+    PyModule_AddObject(m, "NumericArray", (PyObject*)&NumericArrayType);
+
+    if (Instance_RegisterAtExit() < 0)
+        return NULL;
+
     PyMIError = PyErr_NewException("PyMI.error", NULL, NULL);
     Py_INCREF(PyMIError);
     PyModule_AddObject(m, "error", PyMIError);
@@ -145,6 +241,10 @@ PyObject* _initmi(void)
     PyObject_SetAttrString(m, "MI_INSTANCEA", PyLong_FromLong(MI_INSTANCEA));
     PyObject_SetAttrString(m, "MI_ARRAY", PyLong_FromLong(MI_ARRAY));
 
+    PyObject_SetAttrString(m, "INDICATION_OVERFLOW_BLOCK", PyLong_FromLong(MI::INDICATION_OVERFLOW_BLOCK));
+    PyObject_SetAttrString(m, "INDICATION_OVERFLOW_DROP_OLDEST", PyLong_FromLong(MI::INDICATION_OVERFLOW_DROP_OLDEST));
+    PyObject_SetAttrString(m, "INDICATION_OVERFLOW_DROP_NEWEST", PyLong_FromLong(MI::INDICATION_OVERFLOW_DROP_NEWEST));
+
     PyObject_SetAttrString(m, "MI_AUTH_TYPE_DEFAULT",
                            PyUnicode_FromWideChar(MI_AUTH_TYPE_DEFAULT,
                                                   wcslen(MI_AUTH_TYPE_DEFAULT)));
@@ -16,9 +16,7 @@ static PyObject* Serializer_new(PyTypeObject* type, PyObject* args, PyObject* kw
 
 static void Serializer_dealloc(Serializer* self)
 {
-    AllowThreads(&self->cs, [&]() {
-        self->serializer = NULL;
-    });
+    self->serializer = NULL;
     ::DeleteCriticalSection(&self->cs);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
@@ -79,6 +77,70 @@ static PyObject* Serializer_SerializeInstance(Serializer* self, PyObject* args,
     }
 }
 
+static PyObject* Serializer_SerializeInstances(Serializer* self, PyObject* args, PyObject* kwds)
+{
+    PyObject* instances = NULL;
+    PyObject* includeClassObj = NULL;
+    static char *kwlist[] = { "instances", "include_class", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O", kwlist, &instances, &includeClassObj))
+        return NULL;
+
+    try
+    {
+        bool includeClass = includeClassObj && PyObject_IsTrue(includeClassObj);
+
+        std::vector<std::shared_ptr<const MI::Instance>> miInstances;
+        PyObject* iterator = PyObject_GetIter(instances);
+        if (!iterator)
+        {
+            return NULL;
+        }
+        PyObject* item = NULL;
+        while ((item = PyIter_Next(iterator)))
+        {
+            bool isInstance = PyObject_IsInstance(item, reinterpret_cast<PyObject*>(&InstanceType)) == 1;
+            if (isInstance)
+            {
+                miInstances.push_back(((Instance*)item)->instance);
+            }
+            Py_DECREF(item);
+            if (!isInstance)
+            {
+                Py_DECREF(iterator);
+                throw MI::TypeConversionException(L"\"instances\" items must have type Instance");
+            }
+        }
+        Py_DECREF(iterator);
+        if (PyErr_Occurred())
+        {
+            return NULL;
+        }
+
+        std::vector<std::wstring> data;
+        AllowThreads(&self->cs, [&]() {
+            data = self->serializer->SerializeInstances(miInstances, includeClass);
+        });
+
+        PyObject* texts = PyList_New(data.size());
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            PyObject* text = PyUnicode_FromWideChar(data[i].c_str(), data[i].length());
+            if (!text)
+            {
+                Py_DECREF(texts);
+                return NULL;
+            }
+            PyList_SET_ITEM(texts, i, text);
+        }
+        return texts;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
 static PyObject* Serializer_SerializeClass(Serializer* self, PyObject* args, PyObject* kwds)
 {
     PyObject* miClass = NULL;
@@ -113,6 +175,7 @@ static PyMemberDef Serializer_members[] = {
 
 static PyMethodDef Serializer_methods[] = {
     { "serialize_instance", (PyCFunction)Serializer_SerializeInstance, METH_VARARGS | METH_KEYWORDS, "Serializes an instance." },
+    { "serialize_instances", (PyCFunction)Serializer_SerializeInstances, METH_VARARGS | METH_KEYWORDS, "Serializes a list of instances, returns a list of texts." },
     { "serialize_class", (PyCFunction)Serializer_SerializeClass, METH_VARARGS | METH_KEYWORDS, "Serializes a class." },
     { "__enter__", (PyCFunction)Serializer_self, METH_NOARGS, "" },
     { "__exit__",  (PyCFunction)Serializer_exit, METH_VARARGS, "" },
@@ -8,6 +8,10 @@
 #include "OperationOptions.h"
 #include "Utils.h"
 #include "PyMI.h"
+#include <MIWriteBatch.h>
+
+#define DEFAULT_INSTANCE_RESULT_BATCH_SIZE 100
+#define DEFAULT_WRITE_BATCH_WINDOW 16
 
 
 static PyObject* Session_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
@@ -28,14 +32,30 @@ static int Session_init(Session* self, PyObject* args, PyObject* kwds)
 
 static void Session_dealloc(Session* self)
 {
-    AllowThreads(&self->cs, [&]() {
-        self->session = NULL;
-    });
+    ReleaseBlockingObject(self->session);
     self->operationCallbacks = NULL;
     ::DeleteCriticalSection(&self->cs);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
+// When a callable is passed, results are pushed to it in batches instead of being pulled
+// from the returned operation
+static std::shared_ptr<MI::Callbacks> NewInstanceResultCallbacks(PyObject* instanceResult, unsigned batchSize)
+{
+    if (CheckPyNone(instanceResult))
+    {
+        return nullptr;
+    }
+    if (!PyCallable_Check(instanceResult))
+    {
+        throw MI::TypeConversionException(L"\"instance_result\" must be callable");
+    }
+    if (!batchSize)
+    {
+        throw MI::TypeConversionException(L"\"batch_size\" must be greater than zero");
+    }
+    return std::make_shared<PythonMIBatchCallbacks>(instanceResult, batchSize);
+}
 
 static PyObject* Session_ExecQuery(Session *self, PyObject *args, PyObject *kwds)
 {
@@ -43,23 +63,28 @@ static PyObject* Session_ExecQuery(Session *self, PyObject *args, PyObject *kwds
     char* query = NULL;
     char* dialect = "WQL";
     PyObject* operationOptions = NULL;
+    PyObject* instanceResult = NULL;
+    unsigned batchSize = DEFAULT_INSTANCE_RESULT_BATCH_SIZE;
 
-    static char *kwlist[] = { "ns", "query", "dialect", "operation_options", NULL };
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ss|sO", kwlist, &ns, &query,
-                                     &dialect, &operationOptions))
+    static char *kwlist[] = { "ns", "query", "dialect", "operation_options", "instance_result", "batch_size", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ss|sOOI", kwlist, &ns, &query,
+                                     &dialect, &operationOptions, &instanceResult, &batchSize))
         return NULL;
 
     try
     {
+        auto session = Session_GetSession(self);
         ValidatePyObjectType(operationOptions, L"operation_options",
                              &OperationOptionsType, L"OperationOptions");
+        auto callbacks = NewInstanceResultCallbacks(instanceResult, batchSize);
         std::shared_ptr<MI::Operation> op;
-        AllowThreads(&self->cs, [&]() {
-            op = self->session->ExecQuery(
+        AllowThreads(NULL, [&]() {
+            op = session->ExecQuery(
                 ToWstring(ns).c_str(), ToWstring(query).c_str(), ToWstring(dialect).c_str(),
                 !CheckPyNone(operationOptions)
                     ? ((OperationOptions*)operationOptions)->operationOptions
-                    : NULL);
+                    : NULL,
+                callbacks);
         });
         return (PyObject*)Operation_New(op);
     }
@@ -80,30 +105,36 @@ static PyObject* Session_GetAssociators(Session *self, PyObject *args, PyObject
     char* resultRole = "";
     PyObject* keysOnlyObj = NULL;
     PyObject* operationOptions = NULL;
+    PyObject* instanceResult = NULL;
+    unsigned batchSize = DEFAULT_INSTANCE_RESULT_BATCH_SIZE;
 
     static char *kwlist[] = { "ns", "instance", "assoc_class", "result_class",
-                              "role", "result_role", "keys_only", "operation_options", NULL };
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sO|ssssOO", kwlist, &ns, &instance,
+                              "role", "result_role", "keys_only", "operation_options",
+                              "instance_result", "batch_size", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sO|ssssOOOI", kwlist, &ns, &instance,
                                      &assocClass, &resultClass, &role, &resultRole,
-                                     &keysOnlyObj, &operationOptions))
+                                     &keysOnlyObj, &operationOptions, &instanceResult, &batchSize))
         return NULL;
 
     try
     {
+        auto session = Session_GetSession(self);
         ValidatePyObjectType(instance, L"instance", &InstanceType, L"Instance", false);
         ValidatePyObjectType(operationOptions, L"operation_options",
                              &OperationOptionsType, L"OperationOptions");
+        auto callbacks = NewInstanceResultCallbacks(instanceResult, batchSize);
 
         bool keysOnly = keysOnlyObj && PyObject_IsTrue(keysOnlyObj);
 
         std::shared_ptr<MI::Operation> op;
-        AllowThreads(&self->cs, [&]() {
-            op = self->session->GetAssociators(
+        AllowThreads(NULL, [&]() {
+            op = session->GetAssociators(
                 ToWstring(ns).c_str(), *((Instance*)instance)->instance, ToWstring(assocClass).c_str(),
                 ToWstring(resultClass).c_str(), ToWstring(role).c_str(), ToWstring(resultRole).c_str(), keysOnly,
                 !CheckPyNone(operationOptions)
                     ? ((OperationOptions*)operationOptions)->operationOptions
-                    : NULL);
+                    : NULL,
+                callbacks);
         });
         return (PyObject*)Operation_New(op);
     }
@@ -114,14 +145,31 @@ static PyObject* Session_GetAssociators(Session *self, PyObject *args, PyObject
     }
 }
 
+// Pooled sessions are shared and stay open, closing them returns them to the pool
+static void ReleasePooledSession(Session* self)
+{
+    std::shared_ptr<MI::Session> session;
+    session.swap(self->session);
+    // The last reference to a session evicted from the pool closes it
+    ReleaseBlockingObject(session);
+}
+
 static PyObject* Session_Close(Session *self, PyObject*)
 {
     try
     {
-        AllowThreads(&self->cs, [&]()
+        if (self->pooled)
         {
-            self->session->Close();
-        });
+            ReleasePooledSession(self);
+        }
+        else
+        {
+            auto session = Session_GetSession(self);
+            AllowThreads(&self->cs, [&]()
+            {
+                session->Close();
+            });
+        }
         Py_RETURN_NONE;
     }
     catch (std::exception& ex)
@@ -139,11 +187,20 @@ static PyObject* Session_self(Operation *self, PyObject*)
 
 static PyObject* Session_exit(Session* self, PyObject*)
 {
-    AllowThreads(&self->cs, [&]()
+    if (self->pooled)
+    {
+        ReleasePooledSession(self);
+        Py_RETURN_NONE;
+    }
+
+    if (self->session)
     {
-        if (!self->session->IsClosed())
-            self->session->Close();
-    });
+        AllowThreads(&self->cs, [&]()
+        {
+            if (!self->session->IsClosed())
+                self->session->Close();
+        });
+    }
 
     Py_RETURN_NONE;
 }
@@ -161,12 +218,13 @@ static PyObject* Session_CreateInstance(Session *self, PyObject *args, PyObject
 
     try
     {
+        auto session = Session_GetSession(self);
         ValidatePyObjectType(instance, L"instance", &InstanceType, L"Instance", false);
         ValidatePyObjectType(operationOptions, L"operation_options",
                              &OperationOptionsType, L"OperationOptions");
 
-        AllowThreads(&self->cs, [&]() {
-            self->session->CreateInstance(
+        AllowThreads(NULL, [&]() {
+            session->CreateInstance(
                 ToWstring(ns).c_str(), *((Instance*)instance)->instance,
                 !CheckPyNone(operationOptions)
                     ? ((OperationOptions*)operationOptions)->operationOptions
@@ -194,12 +252,13 @@ static PyObject* Session_ModifyInstance(Session *self, PyObject *args, PyObject
 
     try
     {
+        auto session = Session_GetSession(self);
         ValidatePyObjectType(instance, L"instance", &InstanceType, L"Instance", false);
         ValidatePyObjectType(operationOptions, L"operation_options",
                              &OperationOptionsType, L"OperationOptions");
 
-        AllowThreads(&self->cs, [&]() {
-            self->session->ModifyInstance(
+        AllowThreads(NULL, [&]() {
+            session->ModifyInstance(
                 ToWstring(ns).c_str(), *((Instance*)instance)->instance,
                 !CheckPyNone(operationOptions)
                     ? ((OperationOptions*)operationOptions)->operationOptions
@@ -227,12 +286,13 @@ static PyObject* Session_DeleteInstance(Session *self, PyObject *args, PyObject
 
     try
     {
+        auto session = Session_GetSession(self);
         ValidatePyObjectType(instance, L"instance", &InstanceType, L"Instance", false);
         ValidatePyObjectType(operationOptions, L"operation_options",
                              &OperationOptionsType, L"OperationOptions");
 
-        AllowThreads(&self->cs, [&]() {
-            self->session->DeleteInstance(
+        AllowThreads(NULL, [&]() {
+            session->DeleteInstance(
                 ToWstring(ns).c_str(), *((Instance*)instance)->instance,
                 !CheckPyNone(operationOptions)
                     ? ((OperationOptions*)operationOptions)->operationOptions
@@ -247,6 +307,174 @@ static PyObject* Session_DeleteInstance(Session *self, PyObject *args, PyObject
     }
 }
 
+static PyObject* StartWriteInstance(Session *self, PyObject *args, PyObject *kwds, MI::WriteBatchOperation writeOperation)
+{
+    char* ns = NULL;
+    PyObject* instance = NULL;
+    PyObject* operationOptions = NULL;
+
+    static char *kwlist[] = { "ns", "instance", "operation_options", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sO|O", kwlist, &ns,
+                                     &instance, &operationOptions))
+        return NULL;
+
+    try
+    {
+        auto session = Session_GetSession(self);
+        ValidatePyObjectType(instance, L"instance", &InstanceType, L"Instance", false);
+        ValidatePyObjectType(operationOptions, L"operation_options",
+                             &OperationOptionsType, L"OperationOptions");
+
+        std::shared_ptr<MI::Operation> op;
+        AllowThreads(NULL, [&]() {
+            auto miInstance = ((Instance*)instance)->instance;
+            auto miOperationOptions = !CheckPyNone(operationOptions)
+                ? ((OperationOptions*)operationOptions)->operationOptions : NULL;
+            switch (writeOperation)
+            {
+            case MI::WRITE_BATCH_CREATE:
+                op = session->CreateInstanceAsync(ToWstring(ns), miInstance, miOperationOptions);
+                break;
+            case MI::WRITE_BATCH_MODIFY:
+                op = session->ModifyInstanceAsync(ToWstring(ns), miInstance, miOperationOptions);
+                break;
+            default:
+                op = session->DeleteInstanceAsync(ToWstring(ns), miInstance, miOperationOptions);
+                break;
+            }
+        });
+        return (PyObject*)Operation_New(op);
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* Session_CreateInstanceAsync(Session *self, PyObject *args, PyObject *kwds)
+{
+    return StartWriteInstance(self, args, kwds, MI::WRITE_BATCH_CREATE);
+}
+
+static PyObject* Session_ModifyInstanceAsync(Session *self, PyObject *args, PyObject *kwds)
+{
+    return StartWriteInstance(self, args, kwds, MI::WRITE_BATCH_MODIFY);
+}
+
+static PyObject* Session_DeleteInstanceAsync(Session *self, PyObject *args, PyObject *kwds)
+{
+    return StartWriteInstance(self, args, kwds, MI::WRITE_BATCH_DELETE);
+}
+
+// Returns a list with an item per instance, None if the write succeeded or the
+// exception it would have raised otherwise
+static PyObject* WriteInstances(Session *self, PyObject *args, PyObject *kwds, MI::WriteBatchOperation writeOperation)
+{
+    char* ns = NULL;
+    PyObject* instances = NULL;
+    PyObject* operationOptions = NULL;
+    unsigned window = DEFAULT_WRITE_BATCH_WINDOW;
+
+    static char *kwlist[] = { "ns", "instances", "operation_options", "window", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sO|OI", kwlist, &ns,
+                                     &instances, &operationOptions, &window))
+        return NULL;
+
+    try
+    {
+        auto session = Session_GetSession(self);
+        ValidatePyObjectType(operationOptions, L"operation_options",
+                             &OperationOptionsType, L"OperationOptions");
+        if (!window)
+        {
+            throw MI::TypeConversionException(L"\"window\" must be greater than zero");
+        }
+
+        MI::WriteBatch writeBatch(session, ToWstring(ns),
+            !CheckPyNone(operationOptions) ? ((OperationOptions*)operationOptions)->operationOptions : NULL,
+            window);
+
+        PyObject* iterator = PyObject_GetIter(instances);
+        if (!iterator)
+        {
+            return NULL;
+        }
+        PyObject* item = NULL;
+        while ((item = PyIter_Next(iterator)))
+        {
+            bool isInstance = PyObject_IsInstance(item, reinterpret_cast<PyObject*>(&InstanceType)) == 1;
+            if (isInstance)
+            {
+                writeBatch.Add(writeOperation, ((Instance*)item)->instance);
+            }
+            Py_DECREF(item);
+            if (!isInstance)
+            {
+                Py_DECREF(iterator);
+                throw MI::TypeConversionException(L"\"instances\" items must have type Instance");
+            }
+        }
+        Py_DECREF(iterator);
+        if (PyErr_Occurred())
+        {
+            return NULL;
+        }
+
+        std::vector<std::exception_ptr> errors;
+        AllowThreads(NULL, [&]() {
+            errors = writeBatch.Execute();
+        });
+
+        PyObject* results = PyList_New(errors.size());
+        if (!results)
+        {
+            return NULL;
+        }
+        for (size_t i = 0; i < errors.size(); i++)
+        {
+            PyObject* result = Py_None;
+            if (errors[i])
+            {
+                try
+                {
+                    std::rethrow_exception(errors[i]);
+                }
+                catch (std::exception& ex)
+                {
+                    result = GetPyException(ex);
+                }
+            }
+            else
+            {
+                Py_INCREF(Py_None);
+            }
+            PyList_SET_ITEM(results, i, result);
+        }
+        return results;
+    }
+    catch (std::exception& ex)
+    {
+        SetPyException(ex);
+        return NULL;
+    }
+}
+
+static PyObject* Session_CreateInstances(Session *self, PyObject *args, PyObject *kwds)
+{
+    return WriteInstances(self, args, kwds, MI::WRITE_BATCH_CREATE);
+}
+
+static PyObject* Session_ModifyInstances(Session *self, PyObject *args, PyObject *kwds)
+{
+    return WriteInstances(self, args, kwds, MI::WRITE_BATCH_MODIFY);
+}
+
+static PyObject* Session_DeleteInstances(Session *self, PyObject *args, PyObject *kwds)
+{
+    return WriteInstances(self, args, kwds, MI::WRITE_BATCH_DELETE);
+}
+
 static PyObject* Session_GetClass(Session *self, PyObject *args, PyObject *kwds)
 {
     char* ns = NULL;
@@ -258,9 +486,10 @@ static PyObject* Session_GetClass(Session *self, PyObject *args, PyObject *kwds)
 
     try
     {
+        auto session = Session_GetSession(self);
         std::shared_ptr<MI::Operation> op;
-        AllowThreads(&self->cs, [&]() {
-            op = self->session->GetClass(ToWstring(ns).c_str(), ToWstring(className).c_str());
+        AllowThreads(NULL, [&]() {
+            op = session->GetClass(ToWstring(ns).c_str(), ToWstring(className).c_str());
         });
         return (PyObject*)Operation_New(op);
     }
@@ -275,19 +504,23 @@ static PyObject* Session_GetInstance(Session *self, PyObject *args, PyObject *kw
 {
     char* ns = NULL;
     PyObject* keyInstance = NULL;
+    PyObject* instanceResult = NULL;
+    unsigned batchSize = DEFAULT_INSTANCE_RESULT_BATCH_SIZE;
 
-    static char *kwlist[] = { "ns", "key_instance", NULL };
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sO", kwlist, &ns, &keyInstance))
+    static char *kwlist[] = { "ns", "key_instance", "instance_result", "batch_size", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "sO|OI", kwlist, &ns, &keyInstance, &instanceResult, &batchSize))
         return NULL;
 
     try
     {
+        auto session = Session_GetSession(self);
         if (!PyObject_IsInstance(keyInstance, reinterpret_cast<PyObject*>(&InstanceType)))
             throw MI::TypeConversionException(L"\"instance\" must have type Instance");
+        auto callbacks = NewInstanceResultCallbacks(instanceResult, batchSize);
 
         std::shared_ptr<MI::Operation> op;
-        AllowThreads(&self->cs, [&]() {
-            op = self->session->GetInstance(ToWstring(ns).c_str(), *((Instance*)keyInstance)->instance);
+        AllowThreads(NULL, [&]() {
+            op = session->GetInstance(ToWstring(ns).c_str(), *((Instance*)keyInstance)->instance, callbacks);
         });
         return (PyObject*)Operation_New(op);
     }
@@ -305,13 +538,18 @@ static PyObject* Session_Subscribe(Session *self, PyObject *args, PyObject *kwds
     PyObject* indicationResultCallback = NULL;
     PyObject* operationOptions = NULL;
     char* dialect = "WQL";
+    Py_ssize_t queueSize = 0;
+    int overflow = MI::INDICATION_OVERFLOW_DROP_OLDEST;
 
-    static char *kwlist[] = { "ns", "query", "indication_result", "operation_options", "dialect", NULL };
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ss|OOs", kwlist, &ns, &query, &indicationResultCallback, &operationOptions, &dialect))
+    static char *kwlist[] = { "ns", "query", "indication_result", "operation_options", "dialect",
+                              "queue_size", "overflow", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ss|OOsni", kwlist, &ns, &query, &indicationResultCallback,
+                                     &operationOptions, &dialect, &queueSize, &overflow))
         return NULL;
 
     try
     {
+        auto session = Session_GetSession(self);
         if (!CheckPyNone(indicationResultCallback) && !PyCallable_Check(indicationResultCallback))
         {
             throw MI::TypeConversionException(L"\"indication_result\" must be callable");
@@ -320,21 +558,47 @@ static PyObject* Session_Subscribe(Session *self, PyObject *args, PyObject *kwds
         {
             throw MI::TypeConversionException(L"\"operation_options\" must have type OperationOptions");
         }
+        if (queueSize < 0)
+        {
+            throw MI::Exception(L"\"queue_size\" must not be negative");
+        }
+        if (queueSize && !CheckPyNone(indicationResultCallback))
+        {
+            throw MI::Exception(L"\"indication_result\" and \"queue_size\" are mutually exclusive");
+        }
+        if (overflow != MI::INDICATION_OVERFLOW_BLOCK && overflow != MI::INDICATION_OVERFLOW_DROP_OLDEST &&
+            overflow != MI::INDICATION_OVERFLOW_DROP_NEWEST)
+        {
+            throw MI::Exception(L"Invalid \"overflow\" policy");
+        }
 
-        auto callbacks = !CheckPyNone(indicationResultCallback) ? std::make_shared<PythonMICallbacks>(indicationResultCallback) : NULL;
+        // Indications are queued natively and drained in batches, without the GIL
+        std::shared_ptr<MI::IndicationQueue> indicationQueue;
+        std::shared_ptr<MI::Callbacks> callbacks;
+        if (queueSize)
+        {
+            indicationQueue = std::make_shared<MI::IndicationQueue>((size_t)queueSize,
+                (MI::IndicationOverflowPolicy)overflow);
+            callbacks = indicationQueue;
+        }
+        else if (!CheckPyNone(indicationResultCallback))
+        {
+            callbacks = std::make_shared<PythonMICallbacks>(indicationResultCallback);
+        }
 
         std::shared_ptr<MI::Operation> op;
-        AllowThreads(&self->cs, [&]() {
-            op = self->session->Subscribe(ToWstring(ns).c_str(), ToWstring(query).c_str(), callbacks,
+        AllowThreads(NULL, [&]() {
+            op = session->Subscribe(ToWstring(ns).c_str(), ToWstring(query).c_str(), callbacks,
                 !CheckPyNone(operationOptions) ? ((OperationOptions*)operationOptions)->operationOptions : NULL,
                 ToWstring(dialect).c_str());
         });
-        PyObject* obj = (PyObject*)Operation_New(op);
+        Operation* obj = Operation_New(op);
+        obj->indicationQueue = indicationQueue;
         if (callbacks)
         {
             self->operationCallbacks->push_back(callbacks);
         }
-        return obj;
+        return (PyObject*)obj;
     }
     catch (std::exception& ex)
     {
@@ -349,38 +613,46 @@ static PyObject* Session_InvokeMethod(Session *self, PyObject *args, PyObject *k
     char* methodName = NULL;
     PyObject* inboundParams = NULL;
     PyObject* operationOptions = NULL;
-
-    static char *kwlist[] = { "target", "method_name", "inbound_params", "operation_options", NULL };
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "Os|OO", kwlist,
-                                     &target, &methodName, &inboundParams, &operationOptions))
+    PyObject* instanceResult = NULL;
+    unsigned batchSize = DEFAULT_INSTANCE_RESULT_BATCH_SIZE;
+
+    static char *kwlist[] = { "target", "method_name", "inbound_params", "operation_options",
+                              "instance_result", "batch_size", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "Os|OOOI", kwlist,
+                                     &target, &methodName, &inboundParams, &operationOptions,
+                                     &instanceResult, &batchSize))
         return NULL;
 
     try
     {
+        auto session = Session_GetSession(self);
         ValidatePyObjectType(inboundParams, L"inbound_params", &InstanceType, L"Instance");
         ValidatePyObjectType(operationOptions, L"operation_options",
                              &OperationOptionsType, L"OperationOptions");
+        auto callbacks = NewInstanceResultCallbacks(instanceResult, batchSize);
 
         std::shared_ptr<MI::Operation> op;
         if (PyObject_IsInstance(target, reinterpret_cast<PyObject*>(&InstanceType)))
         {
-            AllowThreads(&self->cs, [&]() {
-                op = self->session->InvokeMethod(*((Instance*)target)->instance, ToWstring(methodName).c_str(),
+            AllowThreads(NULL, [&]() {
+                op = session->InvokeMethod(*((Instance*)target)->instance, ToWstring(methodName).c_str(),
                     !CheckPyNone(inboundParams) ? ((Instance*)inboundParams)->instance : NULL,
                     !CheckPyNone(operationOptions)
                         ? ((OperationOptions*)operationOptions)->operationOptions
-                        : NULL);
+                        : NULL,
+                    callbacks);
             });
         }
         else if (PyObject_IsInstance(target, reinterpret_cast<PyObject*>(&ClassType)))
         {
-            AllowThreads(&self->cs, [&]() {
+            AllowThreads(NULL, [&]() {
                 auto miClass = ((Class*)target)->miClass;
-                op = self->session->InvokeMethod(miClass->GetNameSpace(), miClass->GetClassName(), ToWstring(methodName).c_str(),
+                op = session->InvokeMethod(miClass->GetNameSpace(), miClass->GetClassName(), ToWstring(methodName).c_str(),
                     !CheckPyNone(inboundParams) ? ((Instance*)inboundParams)->instance : NULL,
                     !CheckPyNone(operationOptions)
                         ? ((OperationOptions*)operationOptions)->operationOptions
-                        : NULL);
+                        : NULL,
+                    callbacks);
             });
         }
         else
@@ -401,10 +673,22 @@ static PyObject* Session_InvokeMethod(Session *self, PyObject *args, PyObject *k
     }
 }
 
-Session* Session_New(std::shared_ptr<MI::Session> session)
+// Called with the GIL held, which serializes it with returning a pooled session to the pool.
+// The returned reference keeps the pool's lease while the session is used without the GIL.
+std::shared_ptr<MI::Session> Session_GetSession(Session* self)
+{
+    if (!self->session)
+    {
+        throw MI::Exception(L"The session is closed");
+    }
+    return self->session;
+}
+
+Session* Session_New(std::shared_ptr<MI::Session> session, bool pooled)
 {
     Session* obj = (Session*)Session_new(&SessionType, NULL, NULL);
     obj->session = session;
+    obj->pooled = pooled;
     return obj;
 }
 
@@ -420,6 +704,12 @@ static PyMethodDef Session_methods[] = {
     { "create_instance", (PyCFunction)Session_CreateInstance, METH_VARARGS | METH_KEYWORDS, "Creates an instance." },
     { "modify_instance", (PyCFunction)Session_ModifyInstance, METH_VARARGS | METH_KEYWORDS, "Modifies an instance." },
     { "delete_instance", (PyCFunction)Session_DeleteInstance, METH_VARARGS | METH_KEYWORDS, "Deletes an instance." },
+    { "create_instance_async", (PyCFunction)Session_CreateInstanceAsync, METH_VARARGS | METH_KEYWORDS, "Starts creating an instance, returns the operation." },
+    { "modify_instance_async", (PyCFunction)Session_ModifyInstanceAsync, METH_VARARGS | METH_KEYWORDS, "Starts modifying an instance, returns the operation." },
+    { "delete_instance_async", (PyCFunction)Session_DeleteInstanceAsync, METH_VARARGS | METH_KEYWORDS, "Starts deleting an instance, returns the operation." },
+    { "create_instances", (PyCFunction)Session_CreateInstances, METH_VARARGS | METH_KEYWORDS, "Creates instances, keeping up to \"window\" writes in flight. Returns the per instance errors." },
+    { "modify_instances", (PyCFunction)Session_ModifyInstances, METH_VARARGS | METH_KEYWORDS, "Modifies instances, keeping up to \"window\" writes in flight. Returns the per instance errors." },
+    { "delete_instances", (PyCFunction)Session_DeleteInstances, METH_VARARGS | METH_KEYWORDS, "Deletes instances, keeping up to \"window\" writes in flight. Returns the per instance errors." },
     { "get_instance", (PyCFunction)Session_GetInstance, METH_VARARGS | METH_KEYWORDS, "Retrieves an instance." },
     { "subscribe", (PyCFunction)Session_Subscribe, METH_VARARGS | METH_KEYWORDS, "Subscribes to events." },
     { "close", (PyCFunction)Session_Close, METH_NOARGS, "Closes the session." },
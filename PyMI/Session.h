@@ -10,9 +10,14 @@ typedef struct {
     /* Type-specific fields go here. */
     std::shared_ptr<MI::Session> session;
     std::shared_ptr<std::vector<std::shared_ptr<MI::Callbacks>>> operationCallbacks;
+    // Pooled sessions are shared, they are not closed but returned to the pool on close or dealloc
+    bool pooled;
+    // Serializes closing the session, operations are started concurrently
     CRITICAL_SECTION cs;
 } Session;
 
 extern PyTypeObject SessionType;
 
-Session* Session_New(std::shared_ptr<MI::Session> session);
+Session* Session_New(std::shared_ptr<MI::Session> session, bool pooled = false);
+// Raises once a pooled session was returned to the pool
+std::shared_ptr<MI::Session> Session_GetSession(Session* self);
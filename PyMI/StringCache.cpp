@@ -0,0 +1,98 @@
+#include "stdafx.h"
+#include "StringCache.h"
+
+// Element and class names are few and repeated across all the instances
+static PyStringCache g_names(4096, 256, true);
+// Disabled by default, enabled with mi.set_string_cache
+static PyStringCache g_stringValues(0, 0);
+
+static bool PyStringEquals(PyObject* pyValue, const MI_Char* value, size_t length)
+{
+#ifdef IS_PY3K
+    if ((size_t)PyUnicode_GET_LENGTH(pyValue) != length)
+        return false;
+    int kind = PyUnicode_KIND(pyValue);
+    void* data = PyUnicode_DATA(pyValue);
+    for (size_t i = 0; i < length; i++)
+    {
+        if (PyUnicode_READ(kind, data, i) != (Py_UCS4)value[i])
+            return false;
+    }
+    return true;
+#else
+    return (size_t)PyUnicode_GET_SIZE(pyValue) == length &&
+        !memcmp(PyUnicode_AS_UNICODE(pyValue), value, length * sizeof(MI_Char));
+#endif
+}
+
+PyStringCache::PyStringCache(size_t slots, size_t maxLength, bool intern) : m_intern(intern)
+{
+    this->Configure(slots, maxLength);
+}
+
+void PyStringCache::Configure(size_t slots, size_t maxLength)
+{
+    for (auto& slot : this->m_slots)
+    {
+        Py_CLEAR(slot);
+    }
+
+    size_t size = 1;
+    while (size < slots)
+    {
+        size <<= 1;
+    }
+    this->m_slots.assign(slots ? size : 0, nullptr);
+    this->m_maxLength = maxLength;
+}
+
+PyObject* PyStringCache::Get(const MI_Char* value, size_t length)
+{
+    if (this->m_slots.empty() || length > this->m_maxLength)
+        return PyUnicode_FromWideChar(value, length);
+
+    // FNV-1a
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        // Surrogate pairs are combined by PyUnicode_FromWideChar, such strings
+        // wouldn't compare equal
+        if (value[i] >= 0xD800 && value[i] <= 0xDFFF)
+            return PyUnicode_FromWideChar(value, length);
+        hash = (hash ^ (size_t)value[i]) * 16777619u;
+    }
+
+    PyObject*& slot = this->m_slots[hash & (this->m_slots.size() - 1)];
+    if (slot && PyStringEquals(slot, value, length))
+    {
+        Py_INCREF(slot);
+        return slot;
+    }
+
+    PyObject* pyValue = PyUnicode_FromWideChar(value, length);
+    if (!pyValue)
+        return NULL;
+#ifdef IS_PY3K
+    if (this->m_intern)
+        PyUnicode_InternInPlace(&pyValue);
+#endif
+    Py_XDECREF(slot);
+    Py_INCREF(pyValue);
+    slot = pyValue;
+    return pyValue;
+}
+
+PyObject* GetNamePyString(const MI_Char* name)
+{
+    return g_names.Get(name, wcslen(name));
+}
+
+PyObject* GetStringValuePyString(const MI_Char* value)
+{
+    return g_stringValues.Get(value, wcslen(value));
+}
+
+void ConfigureStringValueCache(size_t slots, size_t maxLength)
+{
+    g_stringValues.Configure(slots, maxLength);
+}
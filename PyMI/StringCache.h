@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Python.h>
+#include <MI.h>
+#include <vector>
+
+// Caches Python strings by content in a fixed number of slots, a new string
+// replacing the one in its slot. Lookups compare with the cached string, without
+// allocating. Accessed with the GIL held, the strings are never released as the
+// caches live as long as the interpreter.
+class PyStringCache
+{
+private:
+    std::vector<PyObject*> m_slots;
+    size_t m_maxLength = 0;
+    bool m_intern = false;
+
+    PyStringCache(const PyStringCache &obj) = delete;
+
+public:
+    // "slots" is rounded up to a power of 2, zero disables the cache. Strings are
+    // interned if "intern" is set.
+    PyStringCache(size_t slots, size_t maxLength, bool intern = false);
+    // Drops the cached strings
+    void Configure(size_t slots, size_t maxLength);
+    // Returns a new reference, created if not cached or longer than the maximum length
+    PyObject* Get(const MI_Char* value, size_t length);
+};
+
+// New reference to the shared Python string of an element or class name
+PyObject* GetNamePyString(const MI_Char* name);
+// New reference to the Python string of an MI string value, shared by the equal
+// values if the string value cache is enabled
+PyObject* GetStringValuePyString(const MI_Char* value);
+void ConfigureStringValueCache(size_t slots, size_t maxLength);
@@ -1,9 +1,9 @@
 #include "stdafx.h"
 #include "PyMI.h"
 #include "Utils.h"
-#include "instance.h"
-#include <codecvt>
-#include <locale>
+#include "Instance.h"
+#include "NumericArray.h"
+#include "StringCache.h"
 
 #include <datetime.h>
 
@@ -96,84 +96,166 @@ void MIIntervalFromPyDelta(PyObject* pyDelta, MI_Interval& interval)
     interval.microseconds = (MI_Uint32)PyDateTime_DELTA_GET_MICROSECONDS(pyDelta);
 }
 
-void GetIndexOrName(PyObject *item, std::wstring& name, Py_ssize_t& i)
+std::chrono::milliseconds PyDeltaToMilliseconds(PyObject* delta, const wchar_t* argName)
 {
-    name.clear();
-    i = -1;
+    // Imported once, the import fails while the interpreter is finalizing
+    if (!PyDateTimeAPI)
+    {
+        PyDateTime_IMPORT;
+        if (!PyDateTimeAPI)
+        {
+            PyErr_Clear();
+            throw MI::Exception(L"The datetime module is not available");
+        }
+    }
+    if (!PyDelta_Check(delta))
+    {
+        throw MI::TypeConversionException(std::wstring(L"\"") + argName + L"\" must have type datetime.timedelta");
+    }
+
+    MI_Interval interval;
+    MIIntervalFromPyDelta(delta, interval);
+    return std::chrono::milliseconds(
+        (((MI_Uint64)interval.days * 24 + interval.hours) * 60 + interval.minutes) * 60000 +
+        (MI_Uint64)interval.seconds * 1000 + interval.microseconds / 1000);
+}
+
+bool PyStrToWString(PyObject* item, std::wstring& value)
+{
+    value.clear();
 
 #ifndef IS_PY3K
     if (PyString_Check(item))
     {
         char* s = PyString_AsString(item);
-        DWORD len = lstrlenA(s) + 1;
-        wchar_t* w = new wchar_t[len];
-
-        if (::MultiByteToWideChar(CP_ACP, 0, s, len, w, len) != len)
+        int len = lstrlenA(s);
+        if (len > 0)
         {
-            delete [] w;
-            throw MI::Exception(L"MultiByteToWideChar failed");
+            value.resize(len);
+            if (::MultiByteToWideChar(CP_ACP, 0, s, len, &value[0], len) != len)
+            {
+                value.clear();
+                throw MI::Exception(L"MultiByteToWideChar failed");
+            }
         }
-        name.assign(w, len);
-        delete[] w;
+        return true;
     }
-    else
 #endif
     if (PyUnicode_Check(item))
     {
-        Py_ssize_t len = PyUnicode_GetLength(item) + 1;
-        wchar_t* w = new wchar_t[len];
-
-        if (PyUnicode_AsWideChar((PYUNICODEASVARCHARARG1TYPE*)item, w, len) < 0)
-        {
-            delete[] w;
+        // The returned size includes the terminating null character
+        Py_ssize_t len = PyUnicode_AsWideChar((PYUNICODEASVARCHARARG1TYPE*)item, NULL, 0);
+        if (len < 0)
             throw MI::Exception(L"PyUnicode_AsWideChar failed");
+        if (len > 1)
+        {
+            value.resize(len - 1);
+            if (PyUnicode_AsWideChar((PYUNICODEASVARCHARARG1TYPE*)item, &value[0], len - 1) < 0)
+            {
+                value.clear();
+                throw MI::Exception(L"PyUnicode_AsWideChar failed");
+            }
         }
-        name.assign(w, len);
-        delete[] w;
+        return true;
     }
-    else if (PyIndex_Check(item))
+    return false;
+}
+
+void GetIndexOrName(PyObject *item, std::wstring& name, Py_ssize_t& i)
+{
+    i = -1;
+
+    if (PyStrToWString(item, name))
+        return;
+    if (!PyIndex_Check(item))
+        throw MI::Exception(L"Invalid name or index");
+
+    i = PyNumber_AsSsize_t(item, PyExc_IndexError);
+    if (i == -1 && PyErr_Occurred())
+        throw MI::Exception(L"Index error");
+}
+
+PyObject* GetElementNames(PyObject* names, std::vector<std::wstring>& elementNames)
+{
+    PyObject* tuple = PySequence_Tuple(names);
+    if (!tuple)
     {
-        i = PyNumber_AsSsize_t(item, PyExc_IndexError);
-        if (i == -1 && PyErr_Occurred())
-            throw MI::Exception(L"Index error");
+        return NULL;
     }
-    else
-        throw MI::Exception(L"Invalid name or index");
+
+    for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(tuple); i++)
+    {
+        std::wstring name;
+        if (!PyStrToWString(PyTuple_GET_ITEM(tuple, i), name))
+        {
+            Py_DECREF(tuple);
+            throw MI::TypeConversionException(L"\"names\" items must have type str");
+        }
+        elementNames.push_back(std::move(name));
+    }
+    return tuple;
 }
 
-std::wstring Py2WString(PyObject* pyValue)
+bool GetLimit(PyObject* limitObj, size_t& limit)
 {
-    auto len = PyUnicode_GetLength(pyValue) + 1;
-    wchar_t* w = new wchar_t[len];
+    limit = 0;
+    if (!CheckPyNone(limitObj))
+    {
+        Py_ssize_t value = PyNumber_AsSsize_t(limitObj, PyExc_OverflowError);
+        if (value == -1 && PyErr_Occurred())
+        {
+            return false;
+        }
+        if (value <= 0)
+        {
+            throw MI::Exception(L"\"limit\" must be positive");
+        }
+        limit = (size_t)value;
+    }
+    return true;
+}
 
-    if (PyUnicode_AsWideChar((PYUNICODEASVARCHARARG1TYPE*)pyValue, w, len) < 0)
+// Allocates the MI string of a unicode object, owned by the MIValue it is stored in
+static MI_Char* PyUnicode2MIString(PyObject* pyValue)
+{
+#ifdef IS_PY3K
+    // The required size includes the terminating null
+    Py_ssize_t len = PyUnicode_AsWideChar((PYUNICODEASVARCHARARG1TYPE*)pyValue, NULL, 0) - 1;
+    if (len < 0)
     {
-        delete[] w;
         throw MI::Exception(L"PyUnicode_AsWideChar failed");
     }
+#else
+    Py_ssize_t len = PyUnicode_GET_SIZE(pyValue);
+#endif
 
-    auto value = std::wstring(w, len);
-    delete[] w;
-    return value;
+    MI_Char* str = MI::MIValue::NewString(len);
+    if (PyUnicode_AsWideChar((PYUNICODEASVARCHARARG1TYPE*)pyValue, (wchar_t*)str, len) < 0)
+    {
+        delete[] str;
+        throw MI::Exception(L"PyUnicode_AsWideChar failed");
+    }
+    return str;
 }
 
-std::shared_ptr<MI::MIValue> Py2StrMIValue(PyObject* pyValue)
+// Allocates the MI string of str(pyValue)
+static MI_Char* PyStr2MIString(PyObject* pyValue)
 {
-    PyObject* pyStrValue = PyObject_CallMethod(pyValue, "__str__", NULL);
+    PyObject* pyStrValue = PyObject_Str(pyValue);
     if (!pyStrValue)
     {
-        throw MI::Exception(L"PyObject_CallMethod failed for __str__");
+        throw MI::Exception(L"PyObject_Str failed");
     }
 
     try
     {
 #ifdef IS_PY3K
-        auto value = Py2WString(pyStrValue);
+        MI_Char* str = PyUnicode2MIString(pyStrValue);
 #else
-        auto value = std::string(PyString_AsString(pyStrValue));
+        MI_Char* str = MI::MIValue::NewString(std::string(PyString_AsString(pyStrValue)));
 #endif
         Py_DECREF(pyStrValue);
-        return MI::MIValue::FromString(value);
+        return str;
     }
     catch (std::exception&)
     {
@@ -182,226 +264,404 @@ std::shared_ptr<MI::MIValue> Py2StrMIValue(PyObject* pyValue)
     }
 }
 
-std::shared_ptr<MI::MIValue> Str2PyLong2MI(char* strValue, MI_Type valueType)
+// The Py2MIItem functions write a scalar of "itemType" at "item", laid out as an
+// MI array item. Strings are allocated with MIValue::NewString.
+
+static void PyLong2MIItem(PyObject* pyValue, MI_Type itemType, void* item)
+{
+    switch (itemType)
+    {
+    case MI_BOOLEAN:
+        *(MI_Boolean*)item = PyObject_IsTrue(pyValue) ? MI_TRUE : MI_FALSE;
+        break;
+    case MI_UINT8:
+        *(MI_Uint8*)item = (MI_Uint8)PyLong_AsUnsignedLong(pyValue);
+        break;
+    case MI_SINT8:
+        *(MI_Sint8*)item = (MI_Sint8)PyLong_AsLong(pyValue);
+        break;
+    case MI_UINT16:
+        *(MI_Uint16*)item = (MI_Uint16)PyLong_AsUnsignedLong(pyValue);
+        break;
+    case MI_SINT16:
+        *(MI_Sint16*)item = (MI_Sint16)PyLong_AsLong(pyValue);
+        break;
+    case MI_CHAR16:
+        *(MI_Char16*)item = (MI_Char16)PyLong_AsLong(pyValue);
+        break;
+    case MI_UINT32:
+        *(MI_Uint32*)item = (MI_Uint32)PyLong_AsUnsignedLong(pyValue);
+        break;
+    case MI_SINT32:
+        *(MI_Sint32*)item = (MI_Sint32)PyLong_AsLong(pyValue);
+        break;
+    case MI_UINT64:
+        *(MI_Uint64*)item = PyLong_AsUnsignedLongLong(pyValue);
+        break;
+    case MI_SINT64:
+        *(MI_Sint64*)item = PyLong_AsLongLong(pyValue);
+        break;
+    case MI_REAL32:
+        *(MI_Real32*)item = (MI_Real32)PyLong_AsDouble(pyValue);
+        break;
+    case MI_REAL64:
+        *(MI_Real64*)item = PyLong_AsDouble(pyValue);
+        break;
+    case MI_STRING:
+        *(MI_Char**)item = PyStr2MIString(pyValue);
+        break;
+    default:
+        throw MI::TypeConversionException();
+    }
+
+    if (PyErr_Occurred())
+    {
+        PyErr_Clear();
+        throw MI::TypeConversionException(L"Integer out of range");
+    }
+}
+
+#ifndef IS_PY3K
+static void PyInt2MIItem(PyObject* pyValue, MI_Type itemType, void* item)
+{
+    long value = PyInt_AsLong(pyValue);
+    switch (itemType)
+    {
+    case MI_BOOLEAN:
+        *(MI_Boolean*)item = value != 0;
+        break;
+    case MI_UINT8:
+        *(MI_Uint8*)item = (MI_Uint8)value;
+        break;
+    case MI_SINT8:
+        *(MI_Sint8*)item = (MI_Sint8)value;
+        break;
+    case MI_UINT16:
+        *(MI_Uint16*)item = (MI_Uint16)value;
+        break;
+    case MI_SINT16:
+        *(MI_Sint16*)item = (MI_Sint16)value;
+        break;
+    case MI_CHAR16:
+        *(MI_Char16*)item = (MI_Char16)value;
+        break;
+    case MI_UINT32:
+        *(MI_Uint32*)item = (MI_Uint32)value;
+        break;
+    case MI_SINT32:
+        *(MI_Sint32*)item = (MI_Sint32)value;
+        break;
+    case MI_UINT64:
+        *(MI_Uint64*)item = (MI_Uint64)value;
+        break;
+    case MI_SINT64:
+        *(MI_Sint64*)item = (MI_Sint64)value;
+        break;
+    case MI_REAL32:
+        *(MI_Real32*)item = (MI_Real32)value;
+        break;
+    case MI_REAL64:
+        *(MI_Real64*)item = (MI_Real64)value;
+        break;
+    case MI_STRING:
+        *(MI_Char**)item = PyStr2MIString(pyValue);
+        break;
+    default:
+        throw MI::TypeConversionException();
+    }
+}
+#endif
+
+static void PyFloat2MIItem(PyObject* pyValue, MI_Type itemType, void* item)
 {
-    auto obj = PyLong_FromString(strValue, NULL, 10);
-    if (!obj)
+    switch (itemType)
     {
+    case MI_REAL32:
+        *(MI_Real32*)item = (MI_Real32)PyFloat_AsDouble(pyValue);
+        break;
+    case MI_REAL64:
+        *(MI_Real64*)item = PyFloat_AsDouble(pyValue);
+        break;
+    case MI_STRING:
+        *(MI_Char**)item = PyStr2MIString(pyValue);
+        break;
+    default:
+        throw MI::TypeConversionException();
+    }
+}
+
+// "pyLong" is the new reference returned by the parsing of a numeric string
+static void ParsedPyLong2MIItem(PyObject* pyLong, MI_Type itemType, void* item)
+{
+    if (!pyLong)
+    {
+        PyErr_Clear();
         throw MI::TypeConversionException();
     }
     try
     {
-        auto retVal = Py2MI(obj, valueType);
-        Py_DECREF(obj);
-        return retVal;
+        PyLong2MIItem(pyLong, itemType, item);
+        Py_DECREF(pyLong);
     }
     catch (std::exception&)
     {
-        Py_DECREF(obj);
+        Py_DECREF(pyLong);
         throw;
     }
 }
 
-std::shared_ptr<MI::MIValue> Py2MI(PyObject* pyValue, MI_Type valueType)
+static void PyUnicode2MIItem(PyObject* pyValue, MI_Type itemType, void* item)
 {
-    if (pyValue == Py_None)
+    switch (itemType)
     {
-        return std::make_shared<MI::MIValue>(valueType);
+    case MI_STRING:
+        *(MI_Char**)item = PyUnicode2MIString(pyValue);
+        break;
+    case MI_SINT8:
+    case MI_UINT8:
+    case MI_SINT16:
+    case MI_UINT16:
+    case MI_CHAR16:
+    case MI_SINT32:
+    case MI_UINT32:
+    case MI_SINT64:
+    case MI_UINT64:
+    case MI_REAL32:
+    case MI_REAL64:
+        // Numeric strings are parsed as base 10 integers
+#ifdef IS_PY3K
+        ParsedPyLong2MIItem(PyLong_FromUnicodeObject(pyValue, 10), itemType, item);
+#else
+        ParsedPyLong2MIItem(PyLong_FromUnicode(PyUnicode_AS_UNICODE(pyValue), PyUnicode_GET_SIZE(pyValue), 10),
+                            itemType, item);
+#endif
+        break;
+    default:
+        throw MI::TypeConversionException();
+    }
+}
+
+#ifndef IS_PY3K
+static void PyString2MIItem(PyObject* pyValue, MI_Type itemType, void* item)
+{
+    switch (itemType)
+    {
+    case MI_STRING:
+        *(MI_Char**)item = MI::MIValue::NewString(std::string(PyString_AsString(pyValue)));
+        break;
+    case MI_SINT8:
+    case MI_UINT8:
+    case MI_SINT16:
+    case MI_UINT16:
+    case MI_CHAR16:
+    case MI_SINT32:
+    case MI_UINT32:
+    case MI_SINT64:
+    case MI_UINT64:
+    case MI_REAL32:
+    case MI_REAL64:
+        ParsedPyLong2MIItem(PyLong_FromString(PyString_AsString(pyValue), NULL, 10), itemType, item);
+        break;
+    default:
+        throw MI::TypeConversionException();
+    }
+}
+#endif
+
+static void PyInstance2MIItem(PyObject* pyValue, MI_Type itemType, void* item)
+{
+    switch (itemType)
+    {
+    case MI_INSTANCE:
+    case MI_REFERENCE:
+        // TODO: Set the same ScopeContextOwner as the container instance / class
+        *(MI_Instance**)item = ((Instance*)pyValue)->instance->GetMIObject();
+        break;
+    default:
+        throw MI::TypeConversionException();
     }
-    if (PyObject_IsInstance(pyValue, reinterpret_cast<PyObject*>(&PyBool_Type)))
+}
+
+// Dispatches on the exact built-in types first, their subclasses and the other
+// types go through the slower checks
+static void Py2MIItem(PyObject* pyValue, MI_Type itemType, void* item)
+{
+    PyTypeObject* pyType = Py_TYPE(pyValue);
+    if (pyType == &PyUnicode_Type)
     {
-        return MI::MIValue::FromBoolean(PyObject_IsTrue(pyValue) ? MI_TRUE : MI_FALSE);
+        PyUnicode2MIItem(pyValue, itemType, item);
     }
-    else if (PyObject_IsInstance(pyValue, reinterpret_cast<PyObject*>(&PyLong_Type)))
+#ifdef IS_PY3K
+    else if (pyType == &PyLong_Type)
     {
-        switch (valueType)
-        {
-        case MI_BOOLEAN:
-            return MI::MIValue::FromBoolean(PyLong_AsLong(pyValue) != 0);
-        case MI_UINT8:
-            return MI::MIValue::FromUint8((MI_Uint8)PyLong_AsUnsignedLong(pyValue));
-        case MI_SINT8:
-            return MI::MIValue::FromSint8((MI_Sint8)PyLong_AsLong(pyValue));
-        case MI_UINT16:
-            return MI::MIValue::FromUint16((MI_Uint16)PyLong_AsUnsignedLong(pyValue));
-        case MI_SINT16:
-            return MI::MIValue::FromSint16((MI_Sint16)PyLong_AsLong(pyValue));
-        case MI_CHAR16:
-            return MI::MIValue::FromChar16((MI_Char16)PyLong_AsLong(pyValue));
-        case MI_UINT32:
-            return MI::MIValue::FromUint32(PyLong_AsUnsignedLong(pyValue));
-        case MI_SINT32:
-            return MI::MIValue::FromSint32(PyLong_AsLong(pyValue));
-        case MI_UINT64:
-            return MI::MIValue::FromUint64(PyLong_AsUnsignedLongLong(pyValue));
-        case MI_SINT64:
-            return MI::MIValue::FromSint64(PyLong_AsLongLong(pyValue));
-        case MI_REAL32:
-            return MI::MIValue::FromReal32((MI_Real32)PyLong_AsDouble(pyValue));
-        case MI_REAL64:
-            return MI::MIValue::FromReal64(PyLong_AsDouble(pyValue));
-        case MI_STRING:
-            return Py2StrMIValue(pyValue);
-        default:
-            throw MI::TypeConversionException();
-        }
+        PyLong2MIItem(pyValue, itemType, item);
+    }
+#else
+    else if (pyType == &PyInt_Type)
+    {
+        PyInt2MIItem(pyValue, itemType, item);
+    }
+    else if (pyType == &PyString_Type)
+    {
+        PyString2MIItem(pyValue, itemType, item);
+    }
+#endif
+    else if (pyType == &PyBool_Type && itemType == MI_BOOLEAN)
+    {
+        *(MI_Boolean*)item = pyValue == Py_True ? MI_TRUE : MI_FALSE;
+    }
+    else if (pyType == &PyFloat_Type)
+    {
+        PyFloat2MIItem(pyValue, itemType, item);
+    }
+    else if (PyLong_Check(pyValue))
+    {
+        PyLong2MIItem(pyValue, itemType, item);
     }
 #ifndef IS_PY3K
-    else if (PyObject_IsInstance(pyValue, reinterpret_cast<PyObject*>(&PyInt_Type)))
+    else if (PyInt_Check(pyValue))
     {
-        switch (valueType)
-        {
-        case MI_BOOLEAN:
-            return MI::MIValue::FromBoolean(PyInt_AsLong(pyValue) != 0);
-        case MI_UINT8:
-            return MI::MIValue::FromUint8((MI_Uint8)PyInt_AsLong(pyValue));
-        case MI_SINT8:
-            return MI::MIValue::FromSint8((MI_Sint8)PyInt_AsLong(pyValue));
-        case MI_UINT16:
-            return MI::MIValue::FromUint16((MI_Uint16)PyInt_AsLong(pyValue));
-        case MI_SINT16:
-            return MI::MIValue::FromSint16((MI_Sint16)PyInt_AsLong(pyValue));
-        case MI_CHAR16:
-            return MI::MIValue::FromChar16((MI_Char16)PyLong_AsLong(pyValue));
-        case MI_UINT32:
-            return MI::MIValue::FromUint32((MI_Uint32)PyInt_AsLong(pyValue));
-        case MI_SINT32:
-            return MI::MIValue::FromSint32((MI_Sint32)PyInt_AsLong(pyValue));
-        case MI_UINT64:
-            return MI::MIValue::FromUint64((MI_Uint64)PyInt_AsLong(pyValue));
-        case MI_SINT64:
-            return MI::MIValue::FromSint64((MI_Sint64)PyInt_AsLong(pyValue));
-        case MI_REAL32:
-            return MI::MIValue::FromReal32((MI_Real32)PyInt_AsLong(pyValue));
-        case MI_REAL64:
-            return MI::MIValue::FromReal64((MI_Real64)PyInt_AsLong(pyValue));
-        case MI_STRING:
-            return Py2StrMIValue(pyValue);
-        default:
-            throw MI::TypeConversionException();
-        }
+        PyInt2MIItem(pyValue, itemType, item);
     }
-    else if (PyObject_IsInstance(pyValue, reinterpret_cast<PyObject*>(&PyString_Type)))
+    else if (PyString_Check(pyValue))
     {
-        switch (valueType)
-        {
-        case MI_STRING:
-            return MI::MIValue::FromString(std::string(PyString_AsString(pyValue)));
-        case MI_SINT8:
-        case MI_UINT8:
-        case MI_SINT16:
-        case MI_UINT16:
-        case MI_CHAR16:
-        case MI_SINT32:
-        case MI_UINT32:
-        case MI_SINT64:
-        case MI_UINT64:
-        case MI_REAL32:
-        case MI_REAL64:
-            return Str2PyLong2MI(PyString_AsString(pyValue), valueType);
-        default:
-            throw MI::TypeConversionException();
-        }
+        PyString2MIItem(pyValue, itemType, item);
     }
 #endif
-    else if (PyObject_IsInstance(pyValue, reinterpret_cast<PyObject*>(&PyUnicode_Type)))
+    else if (PyUnicode_Check(pyValue))
     {
-        switch (valueType)
-        {
-        case MI_STRING:
-            return MI::MIValue::FromString(Py2WString(pyValue));
-        case MI_SINT8:
-        case MI_UINT8:
-        case MI_SINT16:
-        case MI_UINT16:
-        case MI_CHAR16:
-        case MI_SINT32:
-        case MI_UINT32:
-        case MI_SINT64:
-        case MI_UINT64:
-        case MI_REAL32:
-        case MI_REAL64:
-        {
-            auto str = Py2WString(pyValue);
-            std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t> cv;
-            return Str2PyLong2MI((char*)cv.to_bytes(str).c_str(), valueType);
-        }
-        default:
-            throw MI::TypeConversionException();
-        }
+        PyUnicode2MIItem(pyValue, itemType, item);
     }
-    else if (PyObject_IsInstance(pyValue, reinterpret_cast<PyObject*>(&InstanceType)))
+    else if (PyFloat_Check(pyValue))
     {
-        switch (valueType)
-        {
-        case MI_INSTANCE:
-            // TODO: Set the same ScopeContextOwner as the container instance / class
-            return MI::MIValue::FromInstance(*((Instance*)pyValue)->instance);
-        case MI_REFERENCE:
-            // TODO: Set the same ScopeContextOwner as the container instance / class
-            return MI::MIValue::FromReference(*((Instance*)pyValue)->instance);
-        default:
-            throw MI::TypeConversionException();
-        }
+        PyFloat2MIItem(pyValue, itemType, item);
+    }
+    else if (PyObject_TypeCheck(pyValue, &InstanceType))
+    {
+        PyInstance2MIItem(pyValue, itemType, item);
+    }
+    else if (itemType == MI_STRING)
+    {
+        *(MI_Char**)item = PyStr2MIString(pyValue);
     }
-    else if (PyObject_IsInstance(pyValue, reinterpret_cast<PyObject*>(&PyTuple_Type)) ||
-             PyObject_IsInstance(pyValue, reinterpret_cast<PyObject*>(&PyList_Type)))
+    else
     {
-        bool isTuple = PyObject_IsInstance(pyValue, reinterpret_cast<PyObject*>(&PyTuple_Type)) != 0;
-        Py_ssize_t size = 0;
-        if (isTuple)
+        throw MI::TypeConversionException();
+    }
+}
+
+// Converts a tuple or a list with a single allocation, the items being written in place
+static std::shared_ptr<MI::MIValue> PySequence2MIArray(PyObject* pyValue, MI_Type valueType)
+{
+    if (!(valueType & MI_ARRAY))
+    {
+        throw MI::TypeConversionException();
+    }
+
+    MI_Type itemType = (MI_Type)(valueType ^ MI_ARRAY);
+    unsigned itemSize = MI::MIValue::GetItemSize(itemType);
+    Py_ssize_t size = PySequence_Fast_GET_SIZE(pyValue);
+    auto value = MI::MIValue::CreateArray((MI_Uint32)size, valueType);
+    auto items = (MI_Uint8*)value->GetArrayItems();
+
+    for (Py_ssize_t i = 0; i < size; i++)
+    {
+        // Converting an item can run Python code, which could resize a list
+        if (PySequence_Fast_GET_SIZE(pyValue) != size)
         {
-            size = PyTuple_Size(pyValue);
+            throw MI::Exception(L"The sequence changed size during the conversion");
         }
-        else
+
+        PyObject* pyItem = PySequence_Fast_GET_ITEM(pyValue, i);
+        if (pyItem == Py_None)
         {
-            size = PyList_Size(pyValue);
+            // MI arrays have no null items, None isn't written as zero or False
+            throw MI::Exception(L"Array item cannot be NULL");
         }
+        Py2MIItem(pyItem, itemType, items + i * itemSize);
+    }
+    return value;
+}
 
-        MI_Type itemType = (MI_Type)(valueType ^ MI_ARRAY);
-        auto value = MI::MIValue::CreateArray((unsigned)size, valueType);
+std::shared_ptr<MI::MIValue> Py2MI(PyObject* pyValue, MI_Type valueType)
+{
+    if (pyValue == Py_None)
+    {
+        return std::make_shared<MI::MIValue>(valueType);
+    }
 
-        for (Py_ssize_t i = 0; i < size; i++)
+    PyTypeObject* pyType = Py_TYPE(pyValue);
+    if (pyType == &PyTuple_Type || pyType == &PyList_Type)
+    {
+        return PySequence2MIArray(pyValue, valueType);
+    }
+    else if (pyType == &PyBool_Type)
+    {
+        return MI::MIValue::FromBoolean(pyValue == Py_True ? MI_TRUE : MI_FALSE);
+    }
+    else if (pyType == &NumericArrayType)
+    {
+        auto pyArray = (NumericArray*)pyValue;
+        if (valueType == (pyArray->itemType | MI_ARRAY))
         {
-            PyObject* pyObj = NULL;
-            if (isTuple)
-            {
-                pyObj = PyTuple_GetItem(pyValue, i);
-            }
-            else
-            {
-                pyObj = PyList_GetItem(pyValue, i);
-            }
+            return MI::MIValue::FromArray(pyArray->data, (MI_Uint32)pyArray->count, valueType);
+        }
 
-            auto tmpValue = Py2MI(pyObj, itemType);
-            value->SetArrayItem(*tmpValue, (unsigned)i);
+        // Converted item by item
+        PyObject* pyTuple = PySequence_Tuple(pyValue);
+        if (!pyTuple)
+        {
+            throw MI::Exception(L"PySequence_Tuple failed");
         }
-        return value;
-    }
-    else
-    {
-        switch (valueType)
+        try
+        {
+            auto value = PySequence2MIArray(pyTuple, valueType);
+            Py_DECREF(pyTuple);
+            return value;
+        }
+        catch (std::exception&)
         {
-        case MI_STRING:
-            return Py2StrMIValue(pyValue);
-        default:
-            throw MI::TypeConversionException();
+            Py_DECREF(pyTuple);
+            throw;
         }
     }
+    else if (PyTuple_Check(pyValue) || PyList_Check(pyValue))
+    {
+        return PySequence2MIArray(pyValue, valueType);
+    }
+    else if (valueType & MI_ARRAY)
+    {
+        throw MI::TypeConversionException();
+    }
+
+    MI_Value value;
+    Py2MIItem(pyValue, valueType, &value);
+    return std::make_shared<MI::MIValue>(&value, valueType);
 }
 
-PyObject* MIArray2PyTuple(const MI_Value& value, MI_Type itemType)
+PyObject* MIArray2PyTuple(const MI_Value& value, MI_Type itemType, bool cloneInstances)
 {
     // All array members of the MI_Value union have "pointer", "size" members.
     // It is safe to rely on one instead of referencing value.stringa, value.booleana, etc
     MI_Uint32 size = value.uint8a.size;
+    // Numbers are copied in bulk, boxed only when accessed
+    if (IsNumericArrayItemType(itemType))
+    {
+        PyObject* pyArray = NumericArray_New(value.uint8a.data, size, itemType);
+        if (!pyArray)
+        {
+            throw MI::Exception(L"NumericArray_New failed");
+        }
+        return pyArray;
+    }
+
     PyObject* pyObj = PyTuple_New(size);
     unsigned itemSize = MI::MIValue::GetItemSize(itemType);
     for (MI_Uint32 i = 0; i < size; i++)
     {
         MI_Value tmpVal;
         memcpy(&tmpVal, &value.uint8a.data[i * itemSize], itemSize);
-        if (PyTuple_SetItem(pyObj, i, MI2Py(tmpVal, itemType, 0)))
+        if (PyTuple_SetItem(pyObj, i, MI2Py(tmpVal, itemType, 0, cloneInstances)))
         {
             Py_DECREF(pyObj);
             throw MI::Exception(L"PyTuple_SetItem failed");
@@ -410,14 +670,14 @@ PyObject* MIArray2PyTuple(const MI_Value& value, MI_Type itemType)
     return pyObj;
 }
 
-PyObject* MI2Py(const MI_Value& value, MI_Type valueType, MI_Uint32 flags)
+PyObject* MI2Py(const MI_Value& value, MI_Type valueType, MI_Uint32 flags, bool cloneInstances)
 {
     if (flags & MI_FLAG_NULL)
         Py_RETURN_NONE;
 
     if (valueType & MI_ARRAY)
     {
-        return MIArray2PyTuple(value, (MI_Type)(valueType ^ MI_ARRAY));
+        return MIArray2PyTuple(value, (MI_Type)(valueType ^ MI_ARRAY), cloneInstances);
     }
 
     switch (valueType)
@@ -461,11 +721,14 @@ PyObject* MI2Py(const MI_Value& value, MI_Type valueType, MI_Uint32 flags)
         }
         break;
     case MI_STRING:
-        return PyUnicode_FromWideChar(value.string, wcslen(value.string));
+        return GetStringValuePyString(value.string);
     case MI_INSTANCE:
-        return (PyObject*)Instance_New(std::make_shared<MI::Instance>(value.instance, false));
     case MI_REFERENCE:
-        return (PyObject*)Instance_New(std::make_shared<MI::Instance>(value.reference, false));
+    {
+        auto instance = std::make_shared<MI::Instance>(valueType == MI_INSTANCE ? value.instance : value.reference,
+                                                       false);
+        return (PyObject*)Instance_New(cloneInstances ? instance->Clone() : instance);
+    }
     default:
         throw MI::TypeConversionException();
     }
@@ -504,6 +767,20 @@ void SetPyException(const std::exception& ex)
     }
 }
 
+// Returns the exception object SetPyException would raise, without raising it
+PyObject* GetPyException(const std::exception& ex)
+{
+    PyObject* type = NULL;
+    PyObject* value = NULL;
+    PyObject* traceback = NULL;
+    SetPyException(ex);
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    Py_XDECREF(type);
+    Py_XDECREF(traceback);
+    return value;
+}
+
 void ValidatePyObjectType(PyObject* obj, const std::wstring& objName,
                           PyTypeObject* expectedType, const std::wstring& expectedTypeName,
                           bool allowNone)
@@ -544,3 +821,51 @@ std::wstring ToWstring(const std::string& inString)
 
     return result;
 }
+
+// struct module format of the values of "type" exported as a buffer
+const char* GetPyBufferFormat(MI_Type type)
+{
+    switch (type)
+    {
+    case MI_BOOLEAN: return "?";
+    case MI_SINT8: return "b";
+    case MI_SINT16: return "h";
+    case MI_UINT16:
+    case MI_CHAR16: return "H";
+    case MI_SINT32: return "i";
+    case MI_UINT32: return "I";
+    case MI_SINT64:
+    case MI_DATETIME: return "q";
+    case MI_UINT64: return "Q";
+    case MI_REAL32: return "f";
+    case MI_REAL64: return "d";
+    default: return "B";
+    }
+}
+
+// Fills a one dimensional read-only view of "exporter", "shape" must live as long as the exporter
+int FillReadOnlyPyBuffer(PyObject* exporter, const void* data, Py_ssize_t* shape, Py_ssize_t itemSize,
+                         const char* format, Py_buffer* view, int flags)
+{
+    static const MI_Uint8 empty = 0;
+    if (flags & PyBUF_WRITABLE)
+    {
+        PyErr_SetString(PyExc_BufferError, "The buffer is read-only");
+        view->obj = NULL;
+        return -1;
+    }
+
+    view->obj = exporter;
+    Py_INCREF(exporter);
+    view->buf = (void*)(data ? data : &empty);
+    view->len = *shape * itemSize;
+    view->readonly = 1;
+    view->itemsize = itemSize;
+    view->format = (flags & PyBUF_FORMAT) ? (char*)format : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &view->itemsize : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
@@ -3,21 +3,57 @@
 #include <Python.h>
 #include <MI.h>
 #include <MIExceptions.h>
+#include <chrono>
 #include <string>
 #include <functional>
 #include <memory>
-#include "mi++.h"
+#include <vector>
+#include "MI++.h"
 
-PyObject* MI2Py(const MI_Value& value, MI_Type valueType, MI_Uint32 flags);
+// Types exporting buffers, Python 2 requires the new buffer protocol to be enabled
+#ifdef IS_PY3K
+#define PYMI_BUFFER_TPFLAGS Py_TPFLAGS_DEFAULT
+#else
+#define PYMI_BUFFER_TPFLAGS (Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER)
+#endif
+
+// Embedded instances refer to the container's unless "cloneInstances" is set
+PyObject* MI2Py(const MI_Value& value, MI_Type valueType, MI_Uint32 flags, bool cloneInstances = false);
 std::shared_ptr<MI::MIValue> Py2MI(PyObject* pyValue, MI_Type valueType);
+// Converts a unicode object, or a str on Python 2, returns false for the other types
+bool PyStrToWString(PyObject* item, std::wstring& value);
 void GetIndexOrName(PyObject *item, std::wstring& name, Py_ssize_t& i);
+// Returns the iterable "names" as a tuple, NULL with a Python error set on failure
+PyObject* GetElementNames(PyObject* names, std::vector<std::wstring>& elementNames);
+// Parses an optional positive "limit", zero if None. Returns false with a Python error set on failure.
+bool GetLimit(PyObject* limitObj, size_t& limit);
 void SetPyException(const std::exception& ex);
+PyObject* GetPyException(const std::exception& ex);
 void AllowThreads(PCRITICAL_SECTION cs, std::function<void()> action);
+
+// Releases the MI++ object of a wrapper being deallocated. No other thread can use
+// the wrapper anymore, so its lock isn't taken. The GIL is always released, as
+// other threads may drop their references meanwhile, leaving this one the last:
+// the destructor would then wait for MI, e.g. to close an operation or a session,
+// and MI for callbacks requiring the GIL.
+template<typename T> void ReleaseBlockingObject(std::shared_ptr<T>& obj)
+{
+    if (obj)
+    {
+        AllowThreads(NULL, [&]() {
+            obj = NULL;
+        });
+    }
+}
 void CallPythonCallback(PyObject* callable, const char* format, ...);
 void MIIntervalFromPyDelta(PyObject* pyDelta, MI_Interval& interval);
 PyObject* PyDeltaFromMIInterval(const MI_Interval& interval);
+std::chrono::milliseconds PyDeltaToMilliseconds(PyObject* delta, const wchar_t* argName);
 bool CheckPyNone(PyObject* obj);
 void ValidatePyObjectType(PyObject* obj, const std::wstring& objName,
                           PyTypeObject* expectedType, const std::wstring& expectedTypeName,
                           bool allowNone = true);
-std::wstring ToWstring(const std::string& inString);
\ No newline at end of file
+std::wstring ToWstring(const std::string& inString);
+const char* GetPyBufferFormat(MI_Type type);
+int FillReadOnlyPyBuffer(PyObject* exporter, const void* data, Py_ssize_t* shape, Py_ssize_t itemSize,
+                         const char* format, Py_buffer* view, int flags);
@@ -49,7 +49,10 @@ pymi_dir = 'PyMI'
 libmipp = (
     'mi++',
     {'sources': [os.path.join(mi_dir, src) for src in
-                 ['MI++.cpp', 'MIExceptions.cpp', 'MIValue.cpp']],
+                 ['MI++.cpp', 'MIClassSchemaCache.cpp', 'MIColumnReader.cpp',
+                  'MIExceptions.cpp', 'MIFanOutQuery.cpp', 'MIPrefetcher.cpp', 'MIIndicationQueue.cpp',
+                  'MIJsonSerializer.cpp', 'MISessionPool.cpp', 'MIValue.cpp',
+                  'MIWriteBatch.cpp']],
      'macros': [('UNICODE', 1), ('_UNICODE', 1)]}
 )
 pymi_ext = setuptools.Extension(
@@ -58,14 +61,20 @@ pymi_ext = setuptools.Extension(
              ['Application.cpp',
               'Callbacks.cpp',
               'Class.cpp',
+              'ClassSchemaCache.cpp',
+              'Column.cpp',
               'DestinationOptions.cpp',
+              'FanOutQuery.cpp',
               'Instance.cpp',
+              'JsonSerializer.cpp',
               'MiError.cpp',
+              'NumericArray.cpp',
               'Operation.cpp',
               'OperationOptions.cpp',
               'PyMI.cpp',
               'Serializer.cpp',
               'Session.cpp',
+              'StringCache.cpp',
               'stdafx.cpp',
               'Utils.cpp']],
     libraries=['mi++', 'mi', 'kernel32', 'user32', 'gdi32',
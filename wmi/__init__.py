@@ -14,6 +14,8 @@
 #    under the License.
 
 import abc
+import atexit
+import collections
 import ctypes
 import datetime
 import importlib
@@ -74,6 +76,14 @@ def _get_eventlet_original(module_name):
 # In order to enable it, this value must be set.
 DEFAULT_OPERATION_TIMEOUT = None
 
+# Writes kept in flight by the batch write methods.
+DEFAULT_WRITE_BATCH_WINDOW = 16
+
+# Events buffered natively by each event watcher before the overflow policy
+# applies, and events returned at most by a get_events call.
+DEFAULT_EVENT_QUEUE_SIZE = 4096
+DEFAULT_EVENT_BATCH_SIZE = 256
+
 WBEM_E_PROVIDER_NOT_CAPABLE = 0x80041024
 
 
@@ -106,23 +116,27 @@ def unsigned_to_signed(unsigned):
     return signed
 
 
+def _get_wmi_exception(ex):
+    d = ex.args[0]
+    hresult = unsigned_to_signed(d.get("error_code", 0))
+    err_msg = d.get("message") or ""
+    com_ex = com_error(
+        hresult, err_msg,
+        (0, None, err_msg, None, None, hresult),
+        None)
+
+    if(isinstance(ex, mi.timeouterror)):
+        return x_wmi_timed_out(err_msg, com_ex)
+    else:
+        return x_wmi(err_msg, com_ex)
+
+
 def mi_to_wmi_exception(func):
     def func_wrapper(*args, **kwargs):
         try:
             return func(*args, **kwargs)
         except mi.error as ex:
-            d = ex.args[0]
-            hresult = unsigned_to_signed(d.get("error_code", 0))
-            err_msg = d.get("message") or ""
-            com_ex = com_error(
-                hresult, err_msg,
-                (0, None, err_msg, None, None, hresult),
-                None)
-
-            if(isinstance(ex, mi.timeouterror)):
-                raise x_wmi_timed_out(err_msg, com_ex)
-            else:
-                raise x_wmi(err_msg, com_ex)
+            raise _get_wmi_exception(ex)
     return func_wrapper
 
 _app = None
@@ -135,6 +149,33 @@ def _get_app():
     return _app
 
 
+_class_schema_cache = None
+
+
+def enable_class_schema_cache(path, schema_version="", max_age=None):
+    """Keeps the class definitions in a file, shared across processes.
+
+    Classes retrieved once are loaded from the file by the next processes,
+    without a round trip to the server. A different schema_version, e.g. the
+    OS build number, discards the file. max_age is a datetime.timedelta after
+    which a class is retrieved again. The cache is saved on exit.
+    """
+    global _class_schema_cache
+    if _class_schema_cache is None:
+        atexit.register(_save_class_schema_cache)
+    _class_schema_cache = _get_app().create_class_schema_cache(
+        six.text_type(path), six.text_type(schema_version), max_age)
+
+
+def _save_class_schema_cache():
+    if _class_schema_cache is not None:
+        try:
+            _class_schema_cache.save()
+        except mi.error:
+            # The classes are retrieved again by the next processes.
+            pass
+
+
 class _Method(object):
     def __init__(self, conn, target, method_name):
         self._conn = conn
@@ -291,18 +332,24 @@ class _BaseEntity(object):
                 *obj.get_element(name),
                 convert_references=self._convert_references)
         except mi.error:
-            try:
-                return _Method(self._conn, self, name)
-            except mi.error as err:
-                if err.args[0].get('mi_result') == (
-                        mi_error.MI_RESULT_METHOD_NOT_FOUND):
-                    err_msg = ("'%(cls_name)s' has no attribute "
-                               "'%(attr_name)s'.")
-                    raise AttributeError(
-                        err_msg % dict(cls_name=self.get_class_name(),
-                                       attr_name=name))
-                else:
-                    raise
+            return self._get_method(name)
+
+    def _get_method(self, name):
+        try:
+            return _Method(self._conn, self, name)
+        except mi.error as err:
+            if err.args[0].get('mi_result') == (
+                    mi_error.MI_RESULT_METHOD_NOT_FOUND):
+                self._raise_no_attribute(name)
+            else:
+                raise
+
+    def _raise_no_attribute(self, name):
+        err_msg = ("'%(cls_name)s' has no attribute "
+                   "'%(attr_name)s'.")
+        raise AttributeError(
+            err_msg % dict(cls_name=self.get_class_name(),
+                           attr_name=name))
 
     @mi_to_wmi_exception
     def path(self):
@@ -319,6 +366,7 @@ class _Instance(_BaseEntity):
             object.__setattr__(self, "_conn_ref", conn)
         object.__setattr__(self, "_instance", instance)
         object.__setattr__(self, "_cls_name", None)
+        object.__setattr__(self, "_cls", None)
 
     @property
     def _conn(self):
@@ -337,8 +385,32 @@ class _Instance(_BaseEntity):
         return self._cls_name
 
     def get_class(self):
+        if self._cls is not None:
+            return self._cls
         class_name = self.get_class_name()
-        return self._conn.get_class(class_name)
+        cls = self._conn.get_class(class_name)
+        if self._conn._cache_classes:
+            object.__setattr__(self, '_cls', cls)
+        return cls
+
+    @mi_to_wmi_exception
+    def __getattr__(self, name):
+        # Looks up the element and the method without raising, unlike the
+        # lookups of classes.
+        if self._instance.has_element(name):
+            return self._conn._wrap_element(
+                *self._instance.get_element(name),
+                convert_references=self._convert_references)
+
+        if self._conn._cache_classes:
+            # Checking the cached class avoids raising for missing methods.
+            cls = self.get_class()
+            if cls is not None and not cls.get_wrapped_object().has_method(
+                    name):
+                self._raise_no_attribute(name)
+            return _Method(self._conn, self, name)
+
+        return self._get_method(name)
 
     @mi_to_wmi_exception
     def __setattr__(self, name, value):
@@ -429,97 +501,106 @@ class _Class(_BaseEntity):
 
     @mi_to_wmi_exception
     def watch_for(self, raw_wql=None, notification_type="operation",
-                  wmi_class=None, delay_secs=1, fields=[], **where_clause):
-        return _EventWatcher(self._conn, six.text_type(raw_wql))
+                  wmi_class=None, delay_secs=1, fields=[],
+                  queue_size=DEFAULT_EVENT_QUEUE_SIZE,
+                  overflow=mi.INDICATION_OVERFLOW_DROP_OLDEST,
+                  **where_clause):
+        return _EventWatcher(self._conn, six.text_type(raw_wql),
+                             queue_size=queue_size, overflow=overflow)
 
 
 class _EventWatcher(object):
-    def __init__(self, conn, wql):
-        native_threading = _get_eventlet_original('threading')
-
+    def __init__(self, conn, wql, queue_size=DEFAULT_EVENT_QUEUE_SIZE,
+                 overflow=mi.INDICATION_OVERFLOW_DROP_OLDEST):
         self._conn = conn
-        self._events_queue = []
-        self._error = None
-        self._event = native_threading.Event()
+        self._events_queue = collections.deque()
         self._operation = conn.subscribe(
-            wql, self._indication_result, self.close)
-        self._operation_finished = native_threading.Event()
+            wql, None, self.close, queue_size=queue_size, overflow=overflow)
 
-    def _process_events(self):
-        if self._error:
-            err = self._error
-            self._error = None
-            raise x_wmi(info=err[1])
-        if self._events_queue:
-            return self._events_queue.pop(0)
+    def _wrap_event(self, indication):
+        event = _Instance(self._conn,
+                          indication[u"TargetInstance"].clone(),
+                          use_conn_weak_ref=True)
+        try:
+            previous_inst = _Instance(
+                self._conn, indication[u'PreviousInstance'].clone(),
+                use_conn_weak_ref=True)
+            object.__setattr__(event, 'previous', previous_inst)
+        except (mi.error, AttributeError):
+            # The 'PreviousInstance' attribute may be missing, for
+            # example in case of a creation event or simply
+            # because this field was not requested.
+            pass
+        return event
 
     @avoid_blocking_call
+    @mi_to_wmi_exception
+    def get_events(self, max_n=DEFAULT_EVENT_BATCH_SIZE, timeout_ms=-1):
+        """Returns a list of up to max_n events, waiting up to timeout_ms
+        milliseconds, indefinitely if not positive, for the first one.
+
+        The events are buffered natively as they arrive and drained here in
+        batches, see the queue_size and overflow arguments of watch_for.
+        """
+        events = []
+        while self._events_queue and len(events) < max_n:
+            events.append(self._events_queue.popleft())
+        if events:
+            return events
+
+        if not self._operation:
+            raise x_wmi("No more events")
+        timeout = None
+        if timeout_ms and timeout_ms > 0:
+            timeout = datetime.timedelta(milliseconds=timeout_ms)
+        try:
+            indications = self._operation.get_indications(
+                max_count=max_n, timeout=timeout)
+        except mi.error:
+            self.close()
+            raise
+        if not indications:
+            if not self._operation.has_more_results():
+                self.close()
+                raise x_wmi("No more events")
+            raise x_wmi_timed_out()
+        return [self._wrap_event(indication) for indication in indications]
+
     def __call__(self, timeout_ms=-1):
-        while True:
-            try:
-                event = self._process_events()
-                if event:
-                    return event
-
-                timeout = timeout_ms / 1000.0 if timeout_ms else None
-                if not self._event.wait(timeout):
-                    raise x_wmi_timed_out()
-                self._event.clear()
-            finally:
-                if (not self._operation or
-                        not self._operation.has_more_results()):
-                    self.close()
-                    raise x_wmi("No more events")
-
-    def _indication_result(self, instance, bookmark, machine_id, more_results,
-                           result_code, error_string, error_details):
-        if not more_results:
-            self._operation_finished.set()
-
-        if instance:
-            event = _Instance(self._conn,
-                              instance[u"TargetInstance"].clone(),
-                              use_conn_weak_ref=True)
-            try:
-                previous_inst = _Instance(
-                    self._conn, instance[u'PreviousInstance'].clone(),
-                    use_conn_weak_ref=True)
-                object.__setattr__(event, 'previous', previous_inst)
-            except (mi.error, AttributeError):
-                # The 'PreviousInstance' attribute may be missing, for
-                # example in case of a creation event or simply
-                # because this field was not requested.
-                pass
-
-            self._events_queue.append(event)
-        if error_details:
-            self._error = (
-                result_code, error_string,
-                _Instance(
-                    self._conn, error_details.clone(),
-                    use_conn_weak_ref=True))
-        self._event.set()
+        if not self._events_queue:
+            self._events_queue.extend(self.get_events(timeout_ms=timeout_ms))
+        return self._events_queue.popleft()
+
+    def get_stats(self):
+        """Returns the number of events received, dropped, overflowing the
+        native queue and queued, as a dict.
+        """
+        if not self._operation:
+            return None
+        return self._operation.get_indication_stats()
 
     @avoid_blocking_call
     def _wait_for_operation_cancel(self):
-        self._operation_finished.wait()
+        try:
+            while self._operation.has_more_results():
+                self._operation.get_indications()
+        except mi.error:
+            # The cancellation is reported as the completion error
+            pass
 
     def close(self):
         if self._operation:
             self._operation.cancel()
             # Those operations are asynchronous. We'll need to wait for the
-            # subscription to be canceled before deallocating objects,
-            # otherwise MI can crash when receiving further events. We rely on
-            # the fact that an event will be emitted once the subscription is
-            # canceled.
+            # subscription to be canceled before closing it, as MI can
+            # crash when receiving further events otherwise. The queued
+            # events are discarded meanwhile.
             self._wait_for_operation_cancel()
 
             self._operation.close()
 
-        self._event.set()
         self._operation = None
-        self._timeout_ms = None
-        self._events_queue = []
+        self._events_queue.clear()
         self._conn = None
 
     def __del__(self):
@@ -546,11 +627,15 @@ class _Connection(object):
         self._cert_thumbprint = user_cert_thumbprint
 
         self._set_destination_options()
+        # Connections to the same host and with the same credentials
+        # share a pooled session.
         self._session = self._app.create_session(
             computer_name=self._computer_name,
             protocol=self._protocol,
-            destination_options=self._destination_options)
+            destination_options=self._destination_options,
+            pooled=True)
         self._cache_classes = cache_classes
+        self._serializer = None
         self._class_cache = {}
         self._method_params_cache = {}
         self._notify_on_close = []
@@ -589,6 +674,7 @@ class _Connection(object):
         for callback in self._notify_on_close:
             callback()
         self._notify_on_close = []
+        self._serializer = None
         self._session = None
         self._app = None
 
@@ -601,10 +687,12 @@ class _Connection(object):
         return self.get_class(six.text_type(name))
 
     def _get_instances(self, op):
+        # The instances kept in the list are cloned by the operation when it
+        # moves on, there's no need to clone them here.
         l = []
         i = op.get_next_instance()
         while i is not None:
-            l.append(_Instance(self, i.clone()))
+            l.append(_Instance(self, i))
             i = op.get_next_instance()
         return l
 
@@ -723,10 +811,20 @@ class _Connection(object):
             self, self._app.create_instance_from_class(
                 cls.class_name, cls.get_wrapped_object()))
 
+    def _get_serializer(self):
+        # Reused by the connection, it keeps its output buffer across calls.
+        if self._serializer is None:
+            self._serializer = self._app.create_serializer()
+        return self._serializer
+
     @mi_to_wmi_exception
     def serialize_instance(self, instance):
-        with self._app.create_serializer() as s:
-            return s.serialize_instance(instance._instance)
+        return self._get_serializer().serialize_instance(instance._instance)
+
+    @mi_to_wmi_exception
+    def serialize_instances(self, instances):
+        return self._get_serializer().serialize_instances(
+            [instance._instance for instance in instances])
 
     @mi_to_wmi_exception
     def get_class(self, class_name):
@@ -744,6 +842,10 @@ class _Connection(object):
 
     @avoid_blocking_call
     def _get_mi_class(self, class_name):
+        if _class_schema_cache is not None:
+            return _class_schema_cache.get_class(
+                self._session, self._ns, class_name, self._computer_name)
+
         with self._session.get_class(
                 ns=self._ns, class_name=class_name) as op:
             cls = op.get_next_class()
@@ -761,7 +863,7 @@ class _Connection(object):
                 self._ns, key_instance._instance) as op:
             instance = op.get_next_instance()
             if instance:
-                return _Instance(self, instance.clone())
+                return _Instance(self, instance.retain())
 
     @mi_to_wmi_exception
     @avoid_blocking_call
@@ -802,23 +904,84 @@ class _Connection(object):
                 tmp_session = self._app.create_session(
                     computer_name=self._computer_name,
                     protocol=mi.PROTOCOL_WINRM,
-                    destination_options=self._destination_options)
+                    destination_options=self._destination_options,
+                    pooled=True)
                 self._delete_instance(tmp_session, instance,
                                       operation_options)
             else:
                 raise
 
+    def _write_instances(self, write_method, instances, operation_options,
+                         window):
+        operation_options = self._get_mi_operation_options(
+            operation_options=operation_options)
+        errors = write_method(
+            self._ns, [instance._instance for instance in instances],
+            operation_options, window)
+        return [_get_wmi_exception(ex) if ex is not None else None
+                for ex in errors]
+
+    # The batch writes keep up to "window" writes in flight and return a
+    # list with None for each write that succeeded, or its x_wmi exception.
+    @mi_to_wmi_exception
+    @avoid_blocking_call
+    def create_instances(self, instances, operation_options=None,
+                         window=DEFAULT_WRITE_BATCH_WINDOW):
+        return self._write_instances(self._session.create_instances,
+                                     instances, operation_options, window)
+
+    @mi_to_wmi_exception
+    @avoid_blocking_call
+    def modify_instances(self, instances, operation_options=None,
+                         window=DEFAULT_WRITE_BATCH_WINDOW):
+        return self._write_instances(self._session.modify_instances,
+                                     instances, operation_options, window)
+
+    @mi_to_wmi_exception
+    @avoid_blocking_call
+    def delete_instances(self, instances, operation_options=None,
+                         window=DEFAULT_WRITE_BATCH_WINDOW):
+        instances = list(instances)
+        errors = self._write_instances(self._session.delete_instances,
+                                       instances, operation_options, window)
+        # Same as delete_instance, the deletes that WMIDCOM providers
+        # can't handle are retried using a pooled WinRM session.
+        tmp_session = None
+        for i, exc in enumerate(errors):
+            if exc is not None and self._protocol != mi.PROTOCOL_WINRM:
+                err = ctypes.c_uint(exc.com_error.hresult).value
+                if err == WBEM_E_PROVIDER_NOT_CAPABLE:
+                    if tmp_session is None:
+                        tmp_session = self._app.create_session(
+                            computer_name=self._computer_name,
+                            protocol=mi.PROTOCOL_WINRM,
+                            destination_options=self._destination_options,
+                            pooled=True)
+                    try:
+                        self._delete_instance(tmp_session, instances[i],
+                                              operation_options)
+                        errors[i] = None
+                    except x_wmi as retry_exc:
+                        errors[i] = retry_exc
+        return errors
+
     @mi_to_wmi_exception
-    def subscribe(self, query, indication_result_callback, close_callback):
+    def subscribe(self, query, indication_result_callback, close_callback,
+                  queue_size=0, overflow=mi.INDICATION_OVERFLOW_DROP_OLDEST):
         op = self._session.subscribe(
-            self._ns, six.text_type(query), indication_result_callback)
+            self._ns, six.text_type(query), indication_result_callback,
+            queue_size=queue_size, overflow=overflow)
         self._notify_on_close.append(close_callback)
         return op
 
     @mi_to_wmi_exception
     def watch_for(self, raw_wql=None, notification_type="operation",
-                  wmi_class=None, delay_secs=1, fields=[], **where_clause):
-        return _EventWatcher(self, six.text_type(raw_wql))
+                  wmi_class=None, delay_secs=1, fields=[],
+                  queue_size=DEFAULT_EVENT_QUEUE_SIZE,
+                  overflow=mi.INDICATION_OVERFLOW_DROP_OLDEST,
+                  **where_clause):
+        return _EventWatcher(self, six.text_type(raw_wql),
+                             queue_size=queue_size, overflow=overflow)
 
     def _wrap_element(self, name, el_type, value, convert_references=False):
         if isinstance(value, mi.Instance):
@@ -840,7 +1003,8 @@ class _Connection(object):
             else:
                 raise Exception(
                     "Unsupported instance element type: %s" % el_type)
-        if isinstance(value, (tuple, list)):
+        # Numeric arrays are returned as tuples, as for the other arrays
+        if isinstance(value, (tuple, list, mi.NumericArray)):
             if el_type == mi.MI_REFERENCEA:
                 return tuple([i.get_path() for i in value])
             elif el_type == mi.MI_INSTANCEA:
@@ -11,6 +11,41 @@
                     i = q.get_next_instance()
 
 
+def test_mi_fetch_all():
+    import mi
+
+    with mi.Application() as a:
+        with a.create_session(protocol=mi.PROTOCOL_WMIDCOM) as s:
+            with s.exec_query(
+                    u"root\\cimv2", u"select * from win32_process") as q:
+                for i in q.fetch_all(names=[u'name']):
+                    s = i[u'name']
+
+
+def test_mi_threads(thread_count, reads=100000):
+    import threading
+    import mi
+
+    with mi.Application() as a:
+        with a.create_session(protocol=mi.PROTOCOL_WMIDCOM) as s:
+            with s.exec_query(
+                    u"root\\cimv2", u"select * from win32_process") as q:
+                instances = q.fetch_all(as_dicts=False)
+
+    # Reads the cloned instances from all the threads at once
+    def read():
+        for n in range(reads // thread_count):
+            i = instances[n % len(instances)]
+            s = i[u'name']
+            p = i[u'processid']
+
+    threads = [threading.Thread(target=read) for t in range(thread_count)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+
 def test_wmi():
     import wmi
 
@@ -23,5 +58,12 @@ if __name__ == '__main__':
     import timeit
     print(timeit.timeit(
         "test_mi()", setup="from __main__ import test_mi", number=20))
+    print(timeit.timeit(
+        "test_mi_fetch_all()", setup="from __main__ import test_mi_fetch_all",
+        number=20))
+    for thread_count in (1, 4, 16):
+        print(thread_count, timeit.timeit(
+            "test_mi_threads(%d)" % thread_count,
+            setup="from __main__ import test_mi_threads", number=20))
     print(timeit.timeit(
         "test_wmi()", setup="from __main__ import test_wmi", number=20))
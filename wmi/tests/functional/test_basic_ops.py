@@ -13,8 +13,11 @@
 #    License for the specific language governing permissions and limitations
 #    under the License.
 
+import os
+import threading
 import time
 
+import mi
 import wmi
 from wmi.tests.functional import test_base
 
@@ -26,6 +29,77 @@ class BasicOpsTestCase(test_base.BaseFunctionalTestCase):
 
         self.assertTrue(win_version >= [6, 0])
 
+    def test_query_results_outlive_operation(self):
+        # The query results aren't cloned up front, they must remain
+        # valid once the operation moved past them.
+        processes = self._conn_cimv2.Win32_Process()
+        pids = [process.ProcessId for process in processes]
+
+        self.assertTrue(len(processes) > 1)
+        self.assertEqual(len(pids), len(set(pids)))
+        self.assertIn(os.getpid(), pids)
+
+        processes = self._conn_cimv2.query(
+            "SELECT ProcessId, Name FROM Win32_Process")
+        names = dict((process.ProcessId, process.Name)
+                     for process in processes)
+        self.assertEqual(len(processes), len(names))
+        self.assertIn(os.getpid(), names)
+
+    def test_results_held_by_list_outlive_operation(self):
+        app = mi.Application()
+        session = app.create_session()
+        with session.exec_query(u"root/cimv2",
+                                u"SELECT ProcessId FROM Win32_Process") as op:
+            # Only the list references those results.
+            results = [op.get_next_instance() for i in range(2)]
+            results.append(op.get_next_instance())
+            op.get_next_instance()
+            pids = [result[u"ProcessId"] for result in results]
+        self.assertEqual(len(results), len(set(pids)))
+        self.assertEqual(pids, [result[u"ProcessId"] for result in results])
+
+    def _access_instances_from_threads(self, thread_count):
+        app = mi.Application()
+        session = app.create_session()
+        query = u"SELECT ProcessId, Name FROM Win32_Process"
+        with session.exec_query(u"root/cimv2", query) as op:
+            instances = op.fetch_all(as_dicts=False)
+        pids = [instance[u"ProcessId"] for instance in instances]
+        errors = []
+
+        # Reads and writes the shared clones while reading the results of
+        # the thread's own query, accessed with the GIL released.
+        def access(n):
+            try:
+                for i in range(200):
+                    instance = instances[(n + i) % len(instances)]
+                    instance[u"Name"] = u"%d" % n
+                    instance[u"Name"]
+                    instance[u"ProcessId"]
+                    instance.get_class_name()
+                with session.exec_query(u"root/cimv2", query) as op:
+                    for result in op:
+                        result[u"ProcessId"]
+                        result[u"Name"]
+            except Exception as ex:
+                errors.append(ex)
+
+        threads = [threading.Thread(target=access, args=(n,))
+                   for n in range(thread_count)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+        self.assertEqual([], errors)
+        self.assertEqual(pids,
+                         [instance[u"ProcessId"] for instance in instances])
+
+    def test_access_instances_from_threads(self):
+        for thread_count in (1, 4, 16):
+            self._access_instances_from_threads(thread_count)
+
     @test_base.BaseFunctionalTestCase.pass_temp_file
     def test_invoke_method(self, temp_file_path):
         content = str(time.time())
@@ -0,0 +1,146 @@
+# Copyright 2016 Cloudbase Solutions Srl
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License.
+
+import subprocess
+import sys
+import time
+import uuid
+
+import mi
+import wmi
+from wmi.tests.functional import test_base
+
+
+# The following tests watch for the creation of processes started by the
+# tests, identified by a marker passed on their command line.
+class EventWatcherTestCase(test_base.BaseFunctionalTestCase):
+    # Longer than the polling interval of the subscriptions below.
+    _event_timeout_ms = 10000
+
+    def setUp(self):
+        super(EventWatcherTestCase, self).setUp()
+        self._marker = uuid.uuid4().hex
+
+    def _watch_for_processes(self, **kwargs):
+        wql = ("SELECT * FROM __InstanceCreationEvent WITHIN 1 "
+               "WHERE TargetInstance ISA 'Win32_Process' AND "
+               "TargetInstance.CommandLine LIKE '%%%s%%'" % self._marker)
+        watcher = self._conn_cimv2.watch_for(raw_wql=wql, **kwargs)
+        self.addCleanup(watcher.close)
+        return watcher
+
+    def _start_processes(self, count):
+        pids = []
+        for i in range(count):
+            process = subprocess.Popen(
+                [sys.executable, '-c', 'import time; time.sleep(3)',
+                 self._marker])
+            self.addCleanup(process.wait)
+            pids.append(process.pid)
+        return pids
+
+    def _get_all_events(self, watcher, count):
+        events = []
+        while len(events) < count:
+            events += watcher.get_events(
+                max_n=count - len(events),
+                timeout_ms=self._event_timeout_ms)
+        return events
+
+    def _wait_for_stats(self, watcher, received):
+        for i in range(self._event_timeout_ms // 100):
+            stats = watcher.get_stats()
+            if stats['received'] >= received:
+                return stats
+            time.sleep(0.1)
+        self.fail("Expected %d events, got %s" % (received, stats))
+
+    def test_get_events(self):
+        watcher = self._watch_for_processes()
+        pids = self._start_processes(3)
+
+        events = self._get_all_events(watcher, len(pids))
+
+        self.assertEqual(sorted(pids),
+                         sorted(event.ProcessId for event in events))
+        stats = watcher.get_stats()
+        self.assertEqual(len(pids), stats['received'])
+        self.assertEqual(0, stats['dropped'])
+        self.assertEqual(0, stats['queued'])
+
+    def test_get_events_timeout(self):
+        watcher = self._watch_for_processes()
+
+        self.assertRaises(wmi.x_wmi_timed_out,
+                          watcher.get_events, timeout_ms=100)
+
+    def test_call(self):
+        watcher = self._watch_for_processes()
+        pids = self._start_processes(2)
+
+        events = [watcher(timeout_ms=self._event_timeout_ms)
+                  for pid in pids]
+
+        self.assertEqual(sorted(pids),
+                         sorted(event.ProcessId for event in events))
+
+    def test_overflow_drop_oldest(self):
+        watcher = self._watch_for_processes(
+            queue_size=1, overflow=mi.INDICATION_OVERFLOW_DROP_OLDEST)
+        pids = self._start_processes(3)
+
+        stats = self._wait_for_stats(watcher, len(pids))
+        events = watcher.get_events(timeout_ms=self._event_timeout_ms)
+
+        self.assertEqual(len(pids), stats['received'])
+        self.assertEqual(len(pids) - 1, stats['dropped'])
+        self.assertEqual(len(pids) - 1, stats['overflows'])
+        self.assertEqual(1, stats['queued'])
+        self.assertEqual(1, len(events))
+        self.assertIn(events[0].ProcessId, pids)
+
+    def test_overflow_drop_newest(self):
+        watcher = self._watch_for_processes(
+            queue_size=1, overflow=mi.INDICATION_OVERFLOW_DROP_NEWEST)
+        pids = self._start_processes(3)
+
+        stats = self._wait_for_stats(watcher, len(pids))
+        events = watcher.get_events(timeout_ms=self._event_timeout_ms)
+
+        self.assertEqual(len(pids) - 1, stats['dropped'])
+        self.assertEqual(len(pids) - 1, stats['overflows'])
+        self.assertEqual(1, stats['queued'])
+        self.assertEqual(1, len(events))
+        self.assertIn(events[0].ProcessId, pids)
+
+    def test_overflow_block(self):
+        watcher = self._watch_for_processes(
+            queue_size=1, overflow=mi.INDICATION_OVERFLOW_BLOCK)
+        pids = self._start_processes(3)
+
+        events = self._get_all_events(watcher, len(pids))
+
+        self.assertEqual(sorted(pids),
+                         sorted(event.ProcessId for event in events))
+        stats = watcher.get_stats()
+        self.assertEqual(len(pids), stats['received'])
+        self.assertEqual(0, stats['dropped'])
+
+    def test_closed_watcher(self):
+        watcher = self._watch_for_processes()
+        watcher.close()
+
+        self.assertIsNone(watcher.get_stats())
+        self.assertRaises(wmi.x_wmi, watcher.get_events, timeout_ms=100)